@@ -0,0 +1,403 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.c
+ *		TID (ItemPointerData) storage implementation.
+ *
+ * A TidStore holds a set of TIDs.  VACUUM uses it to remember the dead items
+ * found while scanning the heap, and to look them up while vacuuming the
+ * indexes.  TIDs are grouped by block: a radix tree (see lib/radixtree.c)
+ * maps each block number to a bitmap of the offsets stored for the block.
+ * If all the offsets are small enough, the bitmap is kept in the radix tree
+ * value itself; otherwise the value refers to a separately allocated
+ * BlocktableEntry.
+ *
+ * Compared to a sorted array of TIDs, this takes a fraction of the memory as
+ * soon as a block has more than a couple of TIDs, membership tests don't
+ * need a binary search, and the total size is not limited by the maximum
+ * size of a single allocation.
+ *
+ * Offsets must be added one block at a time, with TidStoreSetBlockOffsets.
+ *
+ * A TidStore can live in backend-local memory, or in a DSA area of its own
+ * which other backends can attach to.  There is no locking: the caller must
+ * ensure that nobody reads a shared TidStore while another backend is adding
+ * to it.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/common/tidstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tidstore.h"
+#include "lib/radixtree.h"
+#include "port/pg_bitutils.h"
+#include "storage/off.h"
+#include "utils/memutils.h"
+
+/*
+ * A radix tree value with the lowest bit set holds the offsets of its block
+ * as a bitmap in the remaining bits.  Offset numbers start at 1, so the
+ * lowest bit is free to serve as the tag, and a block whose offsets are all
+ * at most TIDSTORE_EMBED_MAX_OFFSET needs no allocation of its own.  Any
+ * other value is the address of a BlocktableEntry, either a local pointer or
+ * a dsa_pointer, whose lowest bit is always clear because of alignment.
+ */
+#define TIDSTORE_VALUE_EMBEDDED		UINT64CONST(1)
+#define TIDSTORE_EMBED_MAX_OFFSET	63
+
+#define WORDNUM(x)	((x) / 64)
+#define BITNUM(x)	((x) % 64)
+
+/* The offsets of a block, when they don't fit in the radix tree value */
+typedef struct BlocktableEntry
+{
+	int			nwords;
+	uint64		words[FLEXIBLE_ARRAY_MEMBER];
+} BlocktableEntry;
+
+struct TidStore
+{
+	/*
+	 * For a local store, a context owned by the store which holds everything
+	 * including this struct.  For a shared store, the context this struct was
+	 * allocated in.
+	 */
+	MemoryContext context;
+
+	/* For a local store, the context for BlocktableEntries */
+	MemoryContext entry_context;
+
+	/* Maps block numbers to offset bitmaps */
+	radix_tree *tree;
+
+	/* DSA area of a shared store, else NULL */
+	dsa_area   *area;
+};
+
+#define TidStoreIsShared(ts)	((ts)->area != NULL)
+
+struct TidStoreIter
+{
+	TidStore   *ts;
+	rt_iter    *tree_iter;
+
+	/* The result returned to the caller, pointing to offsets[] below */
+	TidStoreIterResult output;
+	OffsetNumber offsets[MaxOffsetNumber];
+};
+
+/*
+ * Create a TidStore in local memory.
+ *
+ * max_bytes is the amount of memory the caller intends to let the store
+ * grow to, as measured by TidStoreMemoryUsage().  It is not enforced here,
+ * but keeps the size of individual allocations small enough that the caller
+ * can stop close to it.
+ */
+TidStore *
+TidStoreCreateLocal(size_t max_bytes)
+{
+	TidStore   *ts;
+	MemoryContext context;
+	size_t		maxBlockSize = ALLOCSET_DEFAULT_MAXSIZE;
+
+	while (maxBlockSize > ALLOCSET_DEFAULT_INITSIZE &&
+		   maxBlockSize > max_bytes / 16)
+		maxBlockSize >>= 1;
+
+	context = AllocSetContextCreate(CurrentMemoryContext,
+									"TID storage",
+									ALLOCSET_SMALL_SIZES);
+
+	ts = (TidStore *) MemoryContextAllocZero(context, sizeof(TidStore));
+	ts->context = context;
+	ts->entry_context = GenerationContextCreate(context,
+												"TID storage entries",
+												0,
+												ALLOCSET_DEFAULT_INITSIZE,
+												maxBlockSize);
+	ts->tree = rt_create(context, NULL);
+
+	return ts;
+}
+
+/*
+ * Create a TidStore in a new DSA area, using the given LWLock tranche for
+ * the area.  Other backends can attach to it with TidStoreAttach(), passing
+ * the handle of the area returned by TidStoreGetDSA() and the handle returned
+ * by TidStoreGetHandle().
+ */
+TidStore *
+TidStoreCreateShared(int tranche_id)
+{
+	TidStore   *ts;
+
+	ts = (TidStore *) palloc0(sizeof(TidStore));
+	ts->context = CurrentMemoryContext;
+	ts->area = dsa_create(tranche_id);
+	ts->tree = rt_create(CurrentMemoryContext, ts->area);
+
+	return ts;
+}
+
+/*
+ * Attach to a shared TidStore created by another backend.
+ */
+TidStore *
+TidStoreAttach(dsa_handle area_handle, dsa_pointer handle)
+{
+	TidStore   *ts;
+
+	Assert(DsaPointerIsValid(handle));
+
+	ts = (TidStore *) palloc0(sizeof(TidStore));
+	ts->context = CurrentMemoryContext;
+	ts->area = dsa_attach(area_handle);
+	ts->tree = rt_attach(ts->area, handle);
+
+	return ts;
+}
+
+/*
+ * Detach from a shared TidStore, releasing the local state.
+ */
+void
+TidStoreDetach(TidStore *ts)
+{
+	Assert(TidStoreIsShared(ts));
+
+	rt_detach(ts->tree);
+	dsa_detach(ts->area);
+	pfree(ts);
+}
+
+/*
+ * Destroy a TidStore, freeing all its memory.
+ *
+ * For a shared store, all other backends must have detached already.  The
+ * DSA area belongs to the store, so there is no need to free the objects in
+ * it one by one: the area is destroyed when the last backend detaches from
+ * it.
+ */
+void
+TidStoreDestroy(TidStore *ts)
+{
+	if (TidStoreIsShared(ts))
+		TidStoreDetach(ts);
+	else
+		MemoryContextDelete(ts->context);
+}
+
+/* Return the BlocktableEntry a radix tree value refers to */
+static inline BlocktableEntry *
+tidstore_get_entry(TidStore *ts, uint64 value)
+{
+	Assert((value & TIDSTORE_VALUE_EMBEDDED) == 0);
+
+	if (TidStoreIsShared(ts))
+		return (BlocktableEntry *) dsa_get_address(ts->area,
+												   (dsa_pointer) value);
+
+	return (BlocktableEntry *) (uintptr_t) value;
+}
+
+static void
+tidstore_free_value(TidStore *ts, uint64 value)
+{
+	if ((value & TIDSTORE_VALUE_EMBEDDED) != 0)
+		return;
+
+	if (TidStoreIsShared(ts))
+		dsa_free(ts->area, (dsa_pointer) value);
+	else
+		pfree((void *) (uintptr_t) value);
+}
+
+/*
+ * Set the offsets stored for the given block, replacing any offsets stored
+ * for it before.  The offsets must be sorted in ascending order.
+ */
+void
+TidStoreSetBlockOffsets(TidStore *ts, BlockNumber blkno, OffsetNumber *offsets,
+						int num_offsets)
+{
+	OffsetNumber max_offset;
+	uint64		value;
+	uint64		old_value;
+
+	Assert(num_offsets > 0);
+	Assert(OffsetNumberIsValid(offsets[0]));
+#ifdef USE_ASSERT_CHECKING
+	for (int i = 1; i < num_offsets; i++)
+		Assert(offsets[i] > offsets[i - 1]);
+#endif
+
+	max_offset = offsets[num_offsets - 1];
+	Assert(max_offset <= MaxOffsetNumber);
+
+	if (max_offset <= TIDSTORE_EMBED_MAX_OFFSET)
+	{
+		/* The offsets fit in the value itself */
+		value = TIDSTORE_VALUE_EMBEDDED;
+		for (int i = 0; i < num_offsets; i++)
+			value |= UINT64CONST(1) << offsets[i];
+	}
+	else
+	{
+		BlocktableEntry *entry;
+		int			nwords = WORDNUM(max_offset) + 1;
+		Size		size;
+
+		size = offsetof(BlocktableEntry, words) + sizeof(uint64) * nwords;
+
+		if (TidStoreIsShared(ts))
+		{
+			dsa_pointer dp = dsa_allocate0(ts->area, size);
+
+			entry = (BlocktableEntry *) dsa_get_address(ts->area, dp);
+			value = (uint64) dp;
+		}
+		else
+		{
+			entry = (BlocktableEntry *) MemoryContextAllocZero(ts->entry_context,
+															   size);
+			value = (uint64) (uintptr_t) entry;
+		}
+		Assert((value & TIDSTORE_VALUE_EMBEDDED) == 0);
+
+		entry->nwords = nwords;
+		for (int i = 0; i < num_offsets; i++)
+			entry->words[WORDNUM(offsets[i])] |=
+				UINT64CONST(1) << BITNUM(offsets[i]);
+	}
+
+	if (rt_search(ts->tree, blkno, &old_value))
+		tidstore_free_value(ts, old_value);
+
+	rt_set(ts->tree, blkno, value);
+}
+
+/* Return true if the TID is in the store */
+bool
+TidStoreIsMember(TidStore *ts, ItemPointer tid)
+{
+	OffsetNumber off = ItemPointerGetOffsetNumber(tid);
+	BlocktableEntry *entry;
+	uint64		value;
+
+	if (!rt_search(ts->tree, ItemPointerGetBlockNumber(tid), &value))
+		return false;
+
+	if ((value & TIDSTORE_VALUE_EMBEDDED) != 0)
+		return off <= TIDSTORE_EMBED_MAX_OFFSET &&
+			(value & (UINT64CONST(1) << off)) != 0;
+
+	entry = tidstore_get_entry(ts, value);
+	if (WORDNUM(off) >= entry->nwords)
+		return false;
+
+	return (entry->words[WORDNUM(off)] & (UINT64CONST(1) << BITNUM(off))) != 0;
+}
+
+/*
+ * Prepare to iterate through the TidStore, in block number order.  The store
+ * must not be modified until the iteration ends.
+ */
+TidStoreIter *
+TidStoreBeginIterate(TidStore *ts)
+{
+	TidStoreIter *iter;
+
+	iter = (TidStoreIter *) palloc0(sizeof(TidStoreIter));
+	iter->ts = ts;
+	iter->tree_iter = rt_begin_iterate(ts->tree);
+	iter->output.offsets = iter->offsets;
+
+	return iter;
+}
+
+/* Append the offsets set in one word of a bitmap to the result */
+static inline void
+tidstore_word_to_offsets(TidStoreIterResult *result, int wordnum, uint64 word)
+{
+	while (word != 0)
+	{
+		int			bitnum = pg_rightmost_one_pos64(word);
+
+		result->offsets[result->num_offsets++] = wordnum * 64 + bitnum;
+		word &= word - 1;
+	}
+}
+
+/*
+ * Return the block number and offsets of the next block in the store, or
+ * NULL if there are no more.  The result is valid until the next call.
+ */
+TidStoreIterResult *
+TidStoreIterateNext(TidStoreIter *iter)
+{
+	TidStoreIterResult *result = &iter->output;
+	uint64		key;
+	uint64		value;
+
+	if (!rt_iterate_next(iter->tree_iter, &key, &value))
+		return NULL;
+
+	result->blkno = (BlockNumber) key;
+	result->num_offsets = 0;
+
+	if ((value & TIDSTORE_VALUE_EMBEDDED) != 0)
+		tidstore_word_to_offsets(result, 0, value & ~TIDSTORE_VALUE_EMBEDDED);
+	else
+	{
+		BlocktableEntry *entry = tidstore_get_entry(iter->ts, value);
+
+		for (int i = 0; i < entry->nwords; i++)
+			tidstore_word_to_offsets(result, i, entry->words[i]);
+	}
+
+	return result;
+}
+
+void
+TidStoreEndIterate(TidStoreIter *iter)
+{
+	rt_end_iterate(iter->tree_iter);
+	pfree(iter);
+}
+
+/*
+ * Return the memory used by the TidStore.  For a shared store, this is the
+ * size of the segments backing its DSA area.
+ */
+size_t
+TidStoreMemoryUsage(TidStore *ts)
+{
+	if (TidStoreIsShared(ts))
+		return dsa_get_total_size(ts->area);
+
+	return MemoryContextMemAllocated(ts->context, true);
+}
+
+/* Return the DSA area of a shared TidStore */
+dsa_area *
+TidStoreGetDSA(TidStore *ts)
+{
+	Assert(TidStoreIsShared(ts));
+
+	return ts->area;
+}
+
+/* Return the handle that other backends can pass to TidStoreAttach() */
+dsa_pointer
+TidStoreGetHandle(TidStore *ts)
+{
+	Assert(TidStoreIsShared(ts));
+
+	return (dsa_pointer) rt_get_handle(ts->tree);
+}
@@ -16,16 +16,148 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
+#include "storage/proc.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000005)
+
+/*
+ * DISABLE_LEADER_PARTICIPATION disables the leader's participation in
+ * parallel index builds.  This may be useful as a debugging aid.
+#undef DISABLE_LEADER_PARTICIPATION
+ */
+
+/*
+ * Upper limit on the number of TIDs a single GinTuple passed through the
+ * tuplesort may carry, so that tuples stay well within MaxAllocSize.  Longer
+ * TID lists are split into several tuples with the same key.
+ */
+#define GIN_TUPLE_MAX_ITEMS \
+	((int) ((MaxAllocSize / 4) / sizeof(ItemPointerData)))
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.  Note that there is a separate tuplesort TOC
+ * entry, private to tuplesort.c but allocated by this module on its behalf.
+ */
+typedef struct GinBuildShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to create state
+	 * corresponding to that used by the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			scantuplesortstates;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can use
+	 * results built by the workers (and before leader can write the data into
+	 * the index).
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects all following fields
+	 *
+	 * These fields contain status information of interest to GIN index builds
+	 * that must work just the same when an index is built in parallel.
+	 */
+	slock_t		mutex;
+
+	/*
+	 * Mutable state that is maintained by workers, and reported back to
+	 * leader at end of the scans.
+	 *
+	 * nparticipantsdone is number of worker processes finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of entries extracted from the heap.
+	 *
+	 * brokenhotchain indicates if any worker detected a broken HOT chain
+	 * during build.
+	 */
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} GinBuildShared;
+
+/*
+ * Return pointer to a GinBuildShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGinBuildShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GinBuildShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipanttuplesorts is the exact number of worker processes
+	 * successfully launched, plus one leader process if it participates as a
+	 * worker (only DISABLE_LEADER_PARTICIPATION builds avoid leader
+	 * participating as a worker).
+	 */
+	int			nparticipanttuplesorts;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 *
+	 * ginshared is the shared state for entire build.  sharedsort is the
+	 * shared, tuplesort-managed state passed to each process tuplesort.
+	 * snapshot is the snapshot used by the scan iff an MVCC snapshot is
+	 * required.
+	 */
+	GinBuildShared *ginshared;
+	Sharedsort *sharedsort;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} GinLeader;
 
 typedef struct
 {
@@ -35,8 +167,67 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+
+	/*
+	 * The following fields are used only by parallel builds.  work_mem is
+	 * the amount of memory (in kB) a participant lets its accumulator use
+	 * before passing the entries to its tuplesort.
+	 */
+	int			work_mem;
+
+	/*
+	 * bs_leader is only present when a parallel index build is performed, and
+	 * only in the leader process.
+	 */
+	GinLeader  *bs_leader;
+
+	/*
+	 * bs_sortstate is the participant's tuplesort; in the leader it is the
+	 * one merging the workers' sorted runs.
+	 */
+	Tuplesortstate *bs_sortstate;
 } GinBuildState;
 
+/*
+ * State used by the leader to combine the sorted GinTuples produced by the
+ * workers into one TID list per key.  The items are kept sorted, without
+ * duplicates.
+ */
+typedef struct GinBuffer
+{
+	OffsetNumber attnum;
+	GinNullCategory category;
+	Datum		key;			/* 0 if no key (and keylen == 0) */
+	int16		typlen;			/* typlen of the key */
+	bool		typbyval;		/* typbyval of the key */
+
+	int			nitems;			/* number of TIDs in items */
+	int			maxitems;		/* allocated length of items */
+	ItemPointerData *items;
+} GinBuffer;
+
+/* parallel index builds */
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+								Relation index, bool isconcurrent,
+								int request);
+static void _gin_end_parallel(GinLeader *ginleader, GinBuildState *state);
+static Size _gin_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _gin_parallel_heapscan(GinBuildState *state,
+									 IndexInfo *indexInfo);
+static double _gin_parallel_merge(GinBuildState *state, IndexInfo *indexInfo);
+static void _gin_leader_participate_as_worker(GinBuildState *buildstate,
+											  Relation heap, Relation index);
+static void _gin_parallel_scan_and_sort(GinBuildShared *ginshared,
+										Sharedsort *sharedsort,
+										Relation heap, Relation index,
+										int sortmem, bool progress);
+static GinTuple *_gin_build_tuple(OffsetNumber attrnum,
+								  GinNullCategory category,
+								  Datum key, int16 typlen, bool typbyval,
+								  ItemPointerData *items, uint32 nitems,
+								  Size *len);
+static Datum _gin_parse_tuple_key(GinTuple *a);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -316,6 +507,83 @@ ginBuildCallback(Relation index, ItemPointer tid, Datum *values,
 	MemoryContextSwitchTo(oldCtx);
 }
 
+/*
+ * Pass all entries gathered in the accumulator to the participant's
+ * tuplesort, in the accumulator's key order, and reset the accumulator.
+ */
+static void
+ginFlushBuildState(GinBuildState *buildstate, Relation index)
+{
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+	TupleDesc	tdesc = RelationGetDescr(index);
+	MemoryContext oldCtx;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tdesc, attnum - 1);
+		uint32		offset = 0;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		/* very long TID lists go into the sort as several tuples */
+		while (offset < nlist)
+		{
+			GinTuple   *tup;
+			Size		tuplen;
+			uint32		nitems = Min(nlist - offset, GIN_TUPLE_MAX_ITEMS);
+
+			tup = _gin_build_tuple(attnum, category, key,
+								   attr->attlen, attr->attbyval,
+								   list + offset, nitems, &tuplen);
+
+			tuplesort_putgintuple(buildstate->bs_sortstate, tup, tuplen);
+
+			pfree(tup);
+			offset += nitems;
+		}
+	}
+
+	MemoryContextReset(buildstate->tmpCtx);
+	ginInitBA(&buildstate->accum);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
+/*
+ * Build callback used by the participants of a parallel build.  Same as
+ * ginBuildCallback, except that the accumulated entries are passed to the
+ * participant's tuplesort rather than inserted into the index.
+ */
+static void
+ginBuildCallbackParallel(Relation index, ItemPointer tid, Datum *values,
+						 bool *isnull, bool tupleIsAlive, void *state)
+{
+	GinBuildState *buildstate = (GinBuildState *) state;
+	MemoryContext oldCtx;
+	int			i;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	for (i = 0; i < buildstate->ginstate.origTupdesc->natts; i++)
+		ginHeapTupleBulkInsert(buildstate, (OffsetNumber) (i + 1),
+							   values[i], isnull[i], tid);
+
+	/* If we've maxed out our available memory, dump everything to the sort */
+	if (buildstate->accum.allocatedMemory >= (Size) buildstate->work_mem * 1024L)
+		ginFlushBuildState(buildstate, index);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
 IndexBuildResult *
 ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 {
@@ -378,26 +646,66 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	buildstate.accum.ginstate = &buildstate.ginstate;
 	ginInitBA(&buildstate.accum);
 
+	buildstate.work_mem = maintenance_work_mem;
+	buildstate.bs_leader = NULL;
+	buildstate.bs_sortstate = NULL;
+
 	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
+	 * Attempt to launch parallel worker scan when required.  If that fails,
+	 * or wasn't asked for, do a serial build.
 	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   ginBuildCallback, (void *) &buildstate,
-									   NULL);
-
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index, indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
+
+	if (buildstate.bs_leader)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		SortCoordinate coordinate;
+
+		/*
+		 * Begin leader tuplesort, which merges the sorted runs produced by
+		 * all participants (including the leader itself, which has already
+		 * done its share of the scan in _gin_begin_parallel).
+		 */
+		coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+		coordinate->isWorker = false;
+		coordinate->nParticipants =
+			buildstate.bs_leader->nparticipanttuplesorts;
+		coordinate->sharedsort = buildstate.bs_leader->sharedsort;
+
+		buildstate.bs_sortstate = tuplesort_begin_index_gin(heap, index,
+															maintenance_work_mem,
+															coordinate,
+															TUPLESORT_NONE);
+
+		/* scan the relation in parallel and merge per-worker results */
+		reltuples = _gin_parallel_merge(&buildstate, indexInfo);
+
+		_gin_end_parallel(buildstate.bs_leader, &buildstate);
+	}
+	else
+	{
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   ginBuildCallback, (void *) &buildstate,
+										   NULL);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginBeginBAScan(&buildstate.accum);
+		while ((list = ginGetBAEntry(&buildstate.accum,
+									 &attnum, &key, &category, &nlist)) != NULL)
+		{
+			/* there could be many entries, so be willing to abort here */
+			CHECK_FOR_INTERRUPTS();
+			ginEntryInsert(&buildstate.ginstate, attnum, key, category,
+						   list, nlist, &buildstate.buildStats);
+		}
+		MemoryContextSwitchTo(oldCtx);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -539,3 +847,798 @@ gininsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized (with the exception of the
+ * tuplesort state, which may later be created based on shared state
+ * initially set up here).
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap, Relation index,
+					bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		estginshared;
+	Size		estsort;
+	GinBuildShared *ginshared;
+	Sharedsort *sharedsort;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	bool		leaderparticipates = true;
+	int			querylen;
+
+#ifdef DISABLE_LEADER_PARTICIPATION
+	leaderparticipates = false;
+#endif
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	scantuplesortstates = leaderparticipates ? request + 1 : request;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and
+	 * PARALLEL_KEY_TUPLESORT tuplesort workspace
+	 */
+	estginshared = _gin_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgWalUsage or
+	 * pgBufferUsage, so do it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinBuildShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->scantuplesortstates = scantuplesortstates;
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SpinLockInit(&ginshared->mutex);
+	/* Initialize mutable state */
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromGinBuildShared(ginshared),
+								  snapshot);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipanttuplesorts = pcxt->nworkers_launched;
+	if (leaderparticipates)
+		ginleader->nparticipanttuplesorts++;
+	ginleader->ginshared = ginshared;
+	ginleader->sharedsort = sharedsort;
+	ginleader->snapshot = snapshot;
+	ginleader->walusage = walusage;
+	ginleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader, NULL);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->bs_leader = ginleader;
+
+	/* Join heap scan ourselves */
+	if (leaderparticipates)
+		_gin_leader_participate_as_worker(buildstate, heap, index);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader, GinBuildState *state)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < ginleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&ginleader->bufferusage[i], &ginleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+
+	if (state)
+		state->bs_leader = NULL;
+}
+
+/*
+ * Within leader, wait for end of heap scan.
+ *
+ * When called, parallel heap scan started by _gin_begin_parallel() will
+ * already be underway within worker processes (when leader participates
+ * as a worker, we should end up here just as workers are finishing).
+ *
+ * Fills in fields needed for ambuild statistics, and marks the IndexInfo
+ * if some worker encountered a broken HOT chain.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_heapscan(GinBuildState *state, IndexInfo *indexInfo)
+{
+	GinBuildShared *ginshared = state->bs_leader->ginshared;
+	int			nparticipanttuplesorts;
+	double		reltuples;
+
+	nparticipanttuplesorts = state->bs_leader->nparticipanttuplesorts;
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == nparticipanttuplesorts)
+		{
+			state->indtuples = ginshared->indtuples;
+			if (ginshared->brokenhotchain)
+				indexInfo->ii_BrokenHotChain = true;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * GinBuffer support routines, used by the leader to combine the TID lists
+ * of consecutive GinTuples with equal keys.
+ */
+static GinBuffer *
+GinBufferInit(void)
+{
+	GinBuffer  *buffer = (GinBuffer *) palloc0(sizeof(GinBuffer));
+
+	buffer->attnum = InvalidOffsetNumber;
+
+	return buffer;
+}
+
+static bool
+GinBufferIsEmpty(GinBuffer *buffer)
+{
+	return (buffer->attnum == InvalidOffsetNumber);
+}
+
+/*
+ * Does the tuple have the same key as the one accumulated in the buffer?
+ */
+static bool
+GinBufferKeyEquals(GinBuffer *buffer, GinTuple *tup, GinState *ginstate)
+{
+	Assert(!GinBufferIsEmpty(buffer));
+
+	return ginCompareAttEntries(ginstate,
+								buffer->attnum, buffer->key,
+								buffer->category,
+								tup->attrnum, _gin_parse_tuple_key(tup),
+								tup->category) == 0;
+}
+
+/*
+ * Should part of the accumulated TID list be written out before adding more?
+ *
+ * The limit is a fraction of maintenance_work_mem, as the leader's tuplesort
+ * is entitled to the whole of it.
+ */
+static bool
+GinBufferShouldTrim(GinBuffer *buffer)
+{
+	Size		limit = (Size) maintenance_work_mem * 1024L / 4;
+
+	return ((Size) buffer->nitems * sizeof(ItemPointerData) >= limit);
+}
+
+/*
+ * Number of leading TIDs in the buffer that sort before the first TID of the
+ * tuple.  Tuples with the same key arrive in order of their first TID, so
+ * those TIDs are final and can be written out.
+ */
+static int
+GinBufferFrozenItems(GinBuffer *buffer, GinTuple *tup)
+{
+	ItemPointer first = GinTupleGetFirst(tup);
+	int			lo = 0,
+				hi = buffer->nitems;
+
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (ItemPointerCompare(&buffer->items[mid], first) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * Add the tuple's TIDs to the buffer, remembering the key first if the
+ * buffer is empty.  TIDs beyond the current end of the list are appended,
+ * overlapping lists are merged.
+ */
+static void
+GinBufferStoreTuple(GinBuffer *buffer, GinTuple *tup)
+{
+	ItemPointer items = GinTupleGetItems(tup);
+
+	if (GinBufferIsEmpty(buffer))
+	{
+		buffer->attnum = tup->attrnum;
+		buffer->category = tup->category;
+		buffer->typlen = tup->typlen;
+		buffer->typbyval = tup->typbyval;
+
+		if (tup->category == GIN_CAT_NORM_KEY)
+			buffer->key = datumCopy(_gin_parse_tuple_key(tup),
+									tup->typbyval, tup->typlen);
+		else
+			buffer->key = (Datum) 0;
+	}
+
+	if (buffer->nitems == 0 ||
+		ItemPointerCompare(&buffer->items[buffer->nitems - 1], &items[0]) < 0)
+	{
+		if (buffer->nitems + tup->nitems > buffer->maxitems)
+		{
+			buffer->maxitems = Max(buffer->maxitems * 2,
+								   buffer->nitems + tup->nitems);
+			if (buffer->items == NULL)
+				buffer->items = (ItemPointerData *)
+					palloc_extended(buffer->maxitems * sizeof(ItemPointerData),
+									MCXT_ALLOC_HUGE);
+			else
+				buffer->items = (ItemPointerData *)
+					repalloc_huge(buffer->items,
+								  buffer->maxitems * sizeof(ItemPointerData));
+		}
+
+		memcpy(&buffer->items[buffer->nitems], items,
+			   tup->nitems * sizeof(ItemPointerData));
+		buffer->nitems += tup->nitems;
+	}
+	else
+	{
+		ItemPointerData *merged;
+		int			nmerged;
+
+		merged = ginMergeItemPointers(buffer->items, buffer->nitems,
+									  items, tup->nitems, &nmerged);
+
+		pfree(buffer->items);
+		buffer->items = merged;
+		buffer->nitems = buffer->maxitems = nmerged;
+	}
+}
+
+/*
+ * Insert the first nitems TIDs of the buffer into the index, and keep only
+ * the remaining ones.
+ */
+static void
+GinBufferFlush(GinBuildState *state, GinBuffer *buffer, int nitems)
+{
+	MemoryContext oldCtx;
+
+	Assert(!GinBufferIsEmpty(buffer));
+	Assert(nitems <= buffer->nitems);
+
+	if (nitems == 0)
+		return;
+
+	oldCtx = MemoryContextSwitchTo(state->tmpCtx);
+	ginEntryInsert(&state->ginstate, buffer->attnum, buffer->key,
+				   buffer->category, buffer->items, nitems,
+				   &state->buildStats);
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(state->tmpCtx);
+
+	buffer->nitems -= nitems;
+	memmove(buffer->items, &buffer->items[nitems],
+			buffer->nitems * sizeof(ItemPointerData));
+}
+
+/*
+ * Forget the key and TIDs in the buffer, keeping the allocated TID array
+ * for reuse.
+ */
+static void
+GinBufferReset(GinBuffer *buffer)
+{
+	if (buffer->category == GIN_CAT_NORM_KEY && !buffer->typbyval)
+		pfree(DatumGetPointer(buffer->key));
+
+	buffer->attnum = InvalidOffsetNumber;
+	buffer->category = 0;
+	buffer->key = (Datum) 0;
+	buffer->nitems = 0;
+}
+
+static void
+GinBufferFree(GinBuffer *buffer)
+{
+	if (!GinBufferIsEmpty(buffer))
+		GinBufferReset(buffer);
+	if (buffer->items)
+		pfree(buffer->items);
+	pfree(buffer);
+}
+
+/*
+ * Within leader, wait for the workers to finish the scan, then read the
+ * merged stream of sorted GinTuples and insert one TID list per key into
+ * the index.
+ *
+ * Since the tuples arrive in key order, and for each key in the order of
+ * their first TIDs, the entries are inserted in the same order as in a
+ * serial build, and each entry's posting list or tree is filled with
+ * ascending TIDs in as few steps as the memory limit allows.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_merge(GinBuildState *state, IndexInfo *indexInfo)
+{
+	GinTuple   *tup;
+	Size		tuplen;
+	double		reltuples;
+	GinBuffer  *buffer;
+
+	/* wait for workers to scan table and produce partial results */
+	reltuples = _gin_parallel_heapscan(state, indexInfo);
+
+	/* do the actual sort in the leader */
+	tuplesort_performsort(state->bs_sortstate);
+
+	buffer = GinBufferInit();
+
+	while ((tup = tuplesort_getgintuple(state->bs_sortstate, &tuplen, true)) != NULL)
+	{
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		if (!GinBufferIsEmpty(buffer) &&
+			!GinBufferKeyEquals(buffer, tup, &state->ginstate))
+		{
+			/* new key, so all TIDs of the buffered key have been seen */
+			GinBufferFlush(state, buffer, buffer->nitems);
+			GinBufferReset(buffer);
+		}
+		else if (!GinBufferIsEmpty(buffer) && GinBufferShouldTrim(buffer))
+		{
+			/* write out the part of the list that can't change anymore */
+			GinBufferFlush(state, buffer, GinBufferFrozenItems(buffer, tup));
+		}
+
+		GinBufferStoreTuple(buffer, tup);
+	}
+
+	/* write out whatever is left for the last key */
+	if (!GinBufferIsEmpty(buffer))
+		GinBufferFlush(state, buffer, buffer->nitems);
+
+	GinBufferFree(buffer);
+
+	tuplesort_end(state->bs_sortstate);
+	state->bs_sortstate = NULL;
+
+	return reltuples;
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gin_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(GinBuildShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, participate as a parallel worker.
+ */
+static void
+_gin_leader_participate_as_worker(GinBuildState *buildstate, Relation heap,
+								  Relation index)
+{
+	GinLeader  *ginleader = buildstate->bs_leader;
+	int			sortmem;
+
+	/*
+	 * Might as well use reliable figure when doling out maintenance_work_mem
+	 * (when requested number of workers were not launched, this will be
+	 * somewhat higher than it is for other workers).
+	 */
+	sortmem = maintenance_work_mem / ginleader->nparticipanttuplesorts;
+
+	/* Perform work common to all participants */
+	_gin_parallel_scan_and_sort(ginleader->ginshared, ginleader->sharedsort,
+								heap, index, sortmem, true);
+}
+
+/*
+ * Perform a worker's portion of a parallel build.
+ *
+ * The participant builds its own accumulator, like a serial build does, but
+ * whenever it fills up (and at the end of the scan) the entries are passed
+ * to the participant's tuplesort as GinTuples, to be merged by the leader.
+ *
+ * sortmem is the amount of working memory to use within each worker,
+ * expressed in KBs.  Half of it is used by the accumulator, half by the
+ * tuplesort.
+ *
+ * When this returns, workers are done, and need only release resources.
+ */
+static void
+_gin_parallel_scan_and_sort(GinBuildShared *ginshared, Sharedsort *sharedsort,
+							Relation heap, Relation index,
+							int sortmem, bool progress)
+{
+	SortCoordinate coordinate;
+	GinBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	/* Initialize local tuplesort coordination state */
+	coordinate = palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	/* Initialize the participant's own build state */
+	initGinState(&buildstate.ginstate, index);
+	buildstate.indtuples = 0;
+	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Gin build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context for user-defined function",
+											   ALLOCSET_DEFAULT_SIZES);
+	buildstate.accum.ginstate = &buildstate.ginstate;
+	ginInitBA(&buildstate.accum);
+
+	buildstate.work_mem = sortmem / 2;
+	buildstate.bs_leader = NULL;
+
+	/* Begin "partial" tuplesort */
+	buildstate.bs_sortstate = tuplesort_begin_index_gin(heap, index,
+														sortmem / 2,
+														coordinate,
+														TUPLESORT_NONE);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGinBuildShared(ginshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo,
+									   true, progress, ginBuildCallbackParallel,
+									   (void *) &buildstate, scan);
+
+	/* pass the remaining accumulated entries to the tuplesort */
+	ginFlushBuildState(&buildstate, index);
+
+	/* Execute this worker's part of the sort */
+	tuplesort_performsort(buildstate.bs_sortstate);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+
+	/* We can end tuplesorts immediately */
+	tuplesort_end(buildstate.bs_sortstate);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinBuildShared *ginshared;
+	Sharedsort *sharedsort;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			sortmem;
+
+	/*
+	 * The only possible status flag that can be set to the parallel worker is
+	 * PROC_IN_SAFE_IC.
+	 */
+	Assert((MyProc->statusFlags == 0) ||
+		   (MyProc->statusFlags == PROC_IN_SAFE_IC));
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Look up shared state private to tuplesort.c */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Perform the scan and sort within the worker */
+	sortmem = maintenance_work_mem / ginshared->scantuplesortstates;
+	_gin_parallel_scan_and_sort(ginshared, sharedsort, heapRel, indexRel,
+								sortmem, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Form a GinTuple for the given key and (part of a) TID list, palloc'd in
+ * the current memory context.  The total size is returned in *len.
+ */
+static GinTuple *
+_gin_build_tuple(OffsetNumber attrnum, GinNullCategory category,
+				 Datum key, int16 typlen, bool typbyval,
+				 ItemPointerData *items, uint32 nitems,
+				 Size *len)
+{
+	GinTuple   *tuple;
+	Size		keylen;
+	Size		tuplen;
+
+	Assert(nitems > 0);
+
+	/* NULL placeholders carry no key value */
+	if (category != GIN_CAT_NORM_KEY)
+		keylen = 0;
+	else if (typbyval)
+		keylen = sizeof(Datum);
+	else
+		keylen = datumGetSize(key, false, typlen);
+
+	tuplen = SizeOfGinTupleHeader + SHORTALIGN(keylen) +
+		nitems * sizeof(ItemPointerData);
+
+	tuple = (GinTuple *) palloc0(tuplen);
+
+	tuple->tuplen = tuplen;
+	tuple->keylen = keylen;
+	tuple->nitems = nitems;
+	tuple->attrnum = attrnum;
+	tuple->typlen = typlen;
+	tuple->typbyval = typbyval;
+	tuple->category = category;
+
+	if (keylen > 0)
+	{
+		if (typbyval)
+			memcpy(GinTupleGetKeyData(tuple), &key, sizeof(Datum));
+		else
+			memcpy(GinTupleGetKeyData(tuple), DatumGetPointer(key), keylen);
+	}
+
+	memcpy(GinTupleGetItems(tuple), items, nitems * sizeof(ItemPointerData));
+
+	*len = tuplen;
+
+	return tuple;
+}
+
+/*
+ * Get the key value stored in a GinTuple, pointing into the tuple itself for
+ * pass-by-reference types.
+ */
+static Datum
+_gin_parse_tuple_key(GinTuple *a)
+{
+	Datum		key;
+
+	if (a->category != GIN_CAT_NORM_KEY)
+		return (Datum) 0;
+
+	if (a->typbyval)
+	{
+		memcpy(&key, GinTupleGetKeyData(a), sizeof(Datum));
+		return key;
+	}
+
+	return PointerGetDatum(GinTupleGetKeyData(a));
+}
+
+/*
+ * Compare two GinTuples by their keys, in the index's order, and then by
+ * the first TID of their lists.  Used by the tuplesort of parallel builds.
+ */
+int
+_gin_compare_tuples(GinTuple *a, GinTuple *b, GinState *ginstate)
+{
+	int			r;
+
+	r = ginCompareAttEntries(ginstate,
+							 a->attrnum, _gin_parse_tuple_key(a), a->category,
+							 b->attrnum, _gin_parse_tuple_key(b), b->category);
+	if (r != 0)
+		return r;
+
+	return ItemPointerCompare(GinTupleGetFirst(a), GinTupleGetFirst(b));
+}
@@ -322,6 +322,8 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_dir = ForwardScanDirection;
+	scan->rs_prefetch_block = InvalidBlockNumber;
 
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
@@ -363,17 +365,18 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 }
 
 /*
- * heapgetpage - subroutine for heapgettup()
+ * heap_prepare_pagescan - determine which tuples on the current page are
+ * visible
  *
- * This routine reads and pins the specified page of the relation.
- * In page-at-a-time mode it performs additional work, namely determining
- * which tuples on the page are visible.
+ * This is the part of reading a page that is specific to page-at-a-time
+ * mode: we prune the page if possible, and collect the offsets of the tuples
+ * visible to the scan's snapshot in rs_vistuples[].
  */
-void
-heapgetpage(TableScanDesc sscan, BlockNumber page)
+static void
+heap_prepare_pagescan(HeapScanDesc scan)
 {
-	HeapScanDesc scan = (HeapScanDesc) sscan;
 	Buffer		buffer;
+	BlockNumber page = scan->rs_cblock;
 	Snapshot	snapshot;
 	Page		dp;
 	int			lines;
@@ -382,29 +385,7 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	ItemId		lpp;
 	bool		all_visible;
 
-	Assert(page < scan->rs_nblocks);
-
-	/* release previous scan buffer, if any */
-	if (BufferIsValid(scan->rs_cbuf))
-	{
-		ReleaseBuffer(scan->rs_cbuf);
-		scan->rs_cbuf = InvalidBuffer;
-	}
-
-	/*
-	 * Be sure to check for interrupts at least once per page.  Checks at
-	 * higher code levels won't be able to stop a seqscan that encounters many
-	 * pages' worth of consecutive dead tuples.
-	 */
-	CHECK_FOR_INTERRUPTS();
-
-	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
-	scan->rs_cblock = page;
-
-	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
-		return;
+	Assert(BufferIsValid(scan->rs_cbuf));
 
 	buffer = scan->rs_cbuf;
 	snapshot = scan->rs_base.rs_snapshot;
@@ -481,6 +462,294 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	scan->rs_ntuples = ntup;
 }
 
+/*
+ * heapgetpage - read and pin the specified page of the relation
+ *
+ * In page-at-a-time mode it performs additional work, namely determining
+ * which tuples on the page are visible.
+ */
+void
+heapgetpage(TableScanDesc sscan, BlockNumber page)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+
+	Assert(page < scan->rs_nblocks);
+
+	/* release previous scan buffer, if any */
+	if (BufferIsValid(scan->rs_cbuf))
+	{
+		ReleaseBuffer(scan->rs_cbuf);
+		scan->rs_cbuf = InvalidBuffer;
+	}
+
+	/*
+	 * Be sure to check for interrupts at least once per page.  Checks at
+	 * higher code levels won't be able to stop a seqscan that encounters many
+	 * pages' worth of consecutive dead tuples.
+	 */
+	CHECK_FOR_INTERRUPTS();
+
+	/* read page using selected strategy */
+	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
+									   RBM_NORMAL, scan->rs_strategy);
+	scan->rs_cblock = page;
+
+	if (scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE)
+		heap_prepare_pagescan(scan);
+}
+
+/*
+ * heapgettup_initial_block - return the first page of a scan in the given
+ * direction, or InvalidBlockNumber if there is nothing to scan
+ */
+static BlockNumber
+heapgettup_initial_block(HeapScanDesc scan, ScanDirection dir)
+{
+	Assert(!ScanDirectionIsNoMovement(dir));
+
+	/* return InvalidBlockNumber immediately if relation is empty */
+	if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+		return InvalidBlockNumber;
+
+	if (ScanDirectionIsForward(dir))
+	{
+		if (scan->rs_base.rs_parallel != NULL)
+		{
+			ParallelBlockTableScanDesc pbscan =
+			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+			ParallelBlockTableScanWorker pbscanwork =
+			scan->rs_parallelworkerdata;
+
+			table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
+													 pbscanwork, pbscan);
+
+			/* Other processes might have already finished the scan. */
+			return table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+													 pbscanwork, pbscan);
+		}
+
+		return scan->rs_startblock; /* first page */
+	}
+
+	/* backward parallel scan not supported */
+	Assert(scan->rs_base.rs_parallel == NULL);
+
+	/*
+	 * Disable reporting to syncscan logic in a backwards scan; it's not very
+	 * likely anyone else is doing the same thing at the same time, and much
+	 * more likely that we'll just bollix things for forward scanners.
+	 */
+	scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
+
+	/*
+	 * Start from last page of the scan.  Ensure we take into account
+	 * rs_numblocks if it's been adjusted by heap_setscanlimits().
+	 */
+	if (scan->rs_numblocks != InvalidBlockNumber)
+		return (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
+	if (scan->rs_startblock > 0)
+		return scan->rs_startblock - 1;
+	return scan->rs_nblocks - 1;
+}
+
+/*
+ * heapgettup_advance_block - return the page following 'page' in the given
+ * direction, or InvalidBlockNumber if we've exhausted all the pages
+ */
+static BlockNumber
+heapgettup_advance_block(HeapScanDesc scan, BlockNumber page,
+						 ScanDirection dir)
+{
+	bool		finished;
+
+	Assert(!ScanDirectionIsNoMovement(dir));
+
+	if (ScanDirectionIsBackward(dir))
+	{
+		finished = (page == scan->rs_startblock) ||
+			(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
+		if (page == 0)
+			page = scan->rs_nblocks;
+		page--;
+	}
+	else if (scan->rs_base.rs_parallel != NULL)
+	{
+		ParallelBlockTableScanDesc pbscan =
+		(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+		ParallelBlockTableScanWorker pbscanwork =
+		scan->rs_parallelworkerdata;
+
+		page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+												 pbscanwork, pbscan);
+		finished = (page == InvalidBlockNumber);
+	}
+	else
+	{
+		page++;
+		if (page >= scan->rs_nblocks)
+			page = 0;
+		finished = (page == scan->rs_startblock) ||
+			(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
+
+		/*
+		 * Report our new scan position for synchronization purposes. We
+		 * don't do that when moving backwards, however. That would just mess
+		 * up any other forward-moving scanners.
+		 *
+		 * Note: we do this before checking for end of scan so that the final
+		 * state of the position hint is back at the start of the rel.  That's
+		 * not strictly necessary, but otherwise when you run the same query
+		 * multiple times the starting position would shift a little bit
+		 * backwards on every invocation, which is confusing. We don't
+		 * guarantee any specific ordering in general, though.
+		 *
+		 * When the pages come from a streaming read, this reports the
+		 * position of the look-ahead rather than of the page being returned,
+		 * but the difference is small enough not to matter.
+		 */
+		if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
+			ss_report_location(scan->rs_base.rs_rd, page);
+	}
+
+	return finished ? InvalidBlockNumber : page;
+}
+
+/*
+ * heap_scan_stream_read_next - streaming read callback for heap scans
+ *
+ * Returns the pages of the scan in the order heapgettup_initial_block() and
+ * heapgettup_advance_block() define, starting over at the beginning whenever
+ * rs_prefetch_block has been reset to InvalidBlockNumber.
+ */
+static BlockNumber
+heap_scan_stream_read_next(void *callback_private_data,
+						   void *per_buffer_data)
+{
+	HeapScanDesc scan = (HeapScanDesc) callback_private_data;
+
+	if (!BlockNumberIsValid(scan->rs_prefetch_block))
+		scan->rs_prefetch_block = heapgettup_initial_block(scan, scan->rs_dir);
+	else
+		scan->rs_prefetch_block = heapgettup_advance_block(scan,
+														   scan->rs_prefetch_block,
+														   scan->rs_dir);
+
+	return scan->rs_prefetch_block;
+}
+
+/*
+ * heapfetchbuf - read and pin the next page of a scan in the given direction
+ *
+ * The previous page is released.  On return, rs_cbuf and rs_cblock are set
+ * to the next page, or to InvalidBuffer and InvalidBlockNumber if we've
+ * exhausted all the pages.  The first page is returned if the scan has not
+ * been inited yet.  In page-at-a-time mode, the visible tuples of the new
+ * page are collected, too.
+ */
+static void
+heapfetchbuf(HeapScanDesc scan, ScanDirection dir)
+{
+	/* release previous scan buffer, if any */
+	if (BufferIsValid(scan->rs_cbuf))
+	{
+		ReleaseBuffer(scan->rs_cbuf);
+		scan->rs_cbuf = InvalidBuffer;
+	}
+
+	/*
+	 * Be sure to check for interrupts at least once per page.  Checks at
+	 * higher code levels won't be able to stop a seqscan that encounters many
+	 * pages' worth of consecutive dead tuples.
+	 */
+	CHECK_FOR_INTERRUPTS();
+
+	if (scan->rs_stream != NULL)
+	{
+		/*
+		 * If the scan direction changed, whatever the stream looked ahead at
+		 * is useless.  Restart it from the current page.
+		 */
+		if (unlikely(scan->rs_dir != dir))
+		{
+			StreamingReadReset(scan->rs_stream);
+			scan->rs_prefetch_block = scan->rs_inited ?
+				scan->rs_cblock : InvalidBlockNumber;
+			scan->rs_dir = dir;
+		}
+
+		scan->rs_cbuf = StreamingReadNextBuffer(scan->rs_stream, NULL);
+		if (BufferIsValid(scan->rs_cbuf))
+			scan->rs_cblock = BufferGetBlockNumber(scan->rs_cbuf);
+		else
+			scan->rs_cblock = InvalidBlockNumber;
+	}
+	else
+	{
+		BlockNumber page;
+
+		if (!scan->rs_inited)
+			page = heapgettup_initial_block(scan, dir);
+		else
+			page = heapgettup_advance_block(scan, scan->rs_cblock, dir);
+
+		/* read page using selected strategy */
+		if (BlockNumberIsValid(page))
+			scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd,
+											   MAIN_FORKNUM, page,
+											   RBM_NORMAL, scan->rs_strategy);
+		scan->rs_cblock = page;
+	}
+
+	if (BufferIsValid(scan->rs_cbuf) &&
+		(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
+		heap_prepare_pagescan(scan);
+}
+
+/*
+ * heapgettup_finish - clean up at the end of a scan
+ *
+ * This is called once heapfetchbuf() has reported that there are no more
+ * pages.  Resetting rs_inited means that a further request will restart the
+ * scan (see comments for heapgettup).
+ */
+static void
+heapgettup_finish(HeapScanDesc scan)
+{
+	Assert(!BufferIsValid(scan->rs_cbuf));
+
+	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_ctup.t_data = NULL;
+	scan->rs_inited = false;
+
+	if (scan->rs_stream != NULL)
+	{
+		StreamingReadReset(scan->rs_stream);
+		scan->rs_prefetch_block = InvalidBlockNumber;
+	}
+}
+
+/*
+ * heap_scan_begin_stream - set up a streaming read for a scan, if useful
+ *
+ * Sequential and TID range scans read their pages in a predictable order, so
+ * they can combine consecutive pages into larger reads and issue prefetch
+ * advice ahead of time.  Other kinds of scans fetch pages on demand.
+ */
+static void
+heap_scan_begin_stream(HeapScanDesc scan)
+{
+	if (scan->rs_base.rs_flags & (SO_TYPE_SEQSCAN | SO_TYPE_TIDRANGESCAN))
+		scan->rs_stream = StreamingReadBegin(scan->rs_base.rs_rd,
+											 MAIN_FORKNUM,
+											 scan->rs_strategy,
+											 STREAMING_READ_DEFAULT,
+											 heap_scan_stream_read_next,
+											 scan,
+											 0);
+	else
+		scan->rs_stream = NULL;
+}
+
 /* ----------------
  *		heapgettup - fetch next heap tuple
  *
@@ -514,7 +783,6 @@ heapgettup(HeapScanDesc scan,
 	Snapshot	snapshot = scan->rs_base.rs_snapshot;
 	bool		backward = ScanDirectionIsBackward(dir);
 	BlockNumber page;
-	bool		finished;
 	Page		dp;
 	int			lines;
 	OffsetNumber lineoff;
@@ -528,39 +796,19 @@ heapgettup(HeapScanDesc scan,
 	{
 		if (!scan->rs_inited)
 		{
+			heapfetchbuf(scan, dir);
+
 			/*
-			 * return null immediately if relation is empty
+			 * return null immediately if there is nothing to scan (the
+			 * relation is empty, or other processes have already finished a
+			 * parallel scan)
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_finish(scan);
 				return;
 			}
-			if (scan->rs_base.rs_parallel != NULL)
-			{
-				ParallelBlockTableScanDesc pbscan =
-				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-				ParallelBlockTableScanWorker pbscanwork =
-				scan->rs_parallelworkerdata;
-
-				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				/* Other processes might have already finished the scan. */
-				if (page == InvalidBlockNumber)
-				{
-					Assert(!BufferIsValid(scan->rs_cbuf));
-					tuple->t_data = NULL;
-					return;
-				}
-			}
-			else
-				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
+			page = scan->rs_cblock; /* first page */
 			lineoff = FirstOffsetNumber;	/* first offnum */
 			scan->rs_inited = true;
 		}
@@ -589,34 +837,16 @@ heapgettup(HeapScanDesc scan,
 		if (!scan->rs_inited)
 		{
 			/*
-			 * return null immediately if relation is empty
+			 * Start from last page of the scan; return null immediately if
+			 * relation is empty
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			heapfetchbuf(scan, dir);
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_finish(scan);
 				return;
 			}
-
-			/*
-			 * Disable reporting to syncscan logic in a backwards scan; it's
-			 * not very likely anyone else is doing the same thing at the same
-			 * time, and much more likely that we'll just bollix things for
-			 * forward scanners.
-			 */
-			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
-
-			/*
-			 * Start from last page of the scan.  Ensure we take into account
-			 * rs_numblocks if it's been adjusted by heap_setscanlimits().
-			 */
-			if (scan->rs_numblocks != InvalidBlockNumber)
-				page = (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
-			else if (scan->rs_startblock > 0)
-				page = scan->rs_startblock - 1;
-			else
-				page = scan->rs_nblocks - 1;
-			heapgetpage((TableScanDesc) scan, page);
+			page = scan->rs_cblock;
 		}
 		else
 		{
@@ -751,64 +981,18 @@ heapgettup(HeapScanDesc scan,
 		/*
 		 * advance to next/prior page and detect end of scan
 		 */
-		if (backward)
-		{
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-			if (page == 0)
-				page = scan->rs_nblocks;
-			page--;
-		}
-		else if (scan->rs_base.rs_parallel != NULL)
-		{
-			ParallelBlockTableScanDesc pbscan =
-			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-			ParallelBlockTableScanWorker pbscanwork =
-			scan->rs_parallelworkerdata;
-
-			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-													 pbscanwork, pbscan);
-			finished = (page == InvalidBlockNumber);
-		}
-		else
-		{
-			page++;
-			if (page >= scan->rs_nblocks)
-				page = 0;
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-
-			/*
-			 * Report our new scan position for synchronization purposes. We
-			 * don't do that when moving backwards, however. That would just
-			 * mess up any other forward-moving scanners.
-			 *
-			 * Note: we do this before checking for end of scan so that the
-			 * final state of the position hint is back at the start of the
-			 * rel.  That's not strictly necessary, but otherwise when you run
-			 * the same query multiple times the starting position would shift
-			 * a little bit backwards on every invocation, which is confusing.
-			 * We don't guarantee any specific ordering in general, though.
-			 */
-			if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
-				ss_report_location(scan->rs_base.rs_rd, page);
-		}
+		heapfetchbuf(scan, dir);
 
 		/*
 		 * return NULL if we've exhausted all the pages
 		 */
-		if (finished)
+		if (!BufferIsValid(scan->rs_cbuf))
 		{
-			if (BufferIsValid(scan->rs_cbuf))
-				ReleaseBuffer(scan->rs_cbuf);
-			scan->rs_cbuf = InvalidBuffer;
-			scan->rs_cblock = InvalidBlockNumber;
-			tuple->t_data = NULL;
-			scan->rs_inited = false;
+			heapgettup_finish(scan);
 			return;
 		}
 
-		heapgetpage((TableScanDesc) scan, page);
+		page = scan->rs_cblock;
 
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
 
@@ -851,7 +1035,6 @@ heapgettup_pagemode(HeapScanDesc scan,
 	HeapTuple	tuple = &(scan->rs_ctup);
 	bool		backward = ScanDirectionIsBackward(dir);
 	BlockNumber page;
-	bool		finished;
 	Page		dp;
 	int			lines;
 	int			lineindex;
@@ -866,39 +1049,19 @@ heapgettup_pagemode(HeapScanDesc scan,
 	{
 		if (!scan->rs_inited)
 		{
+			heapfetchbuf(scan, dir);
+
 			/*
-			 * return null immediately if relation is empty
+			 * return null immediately if there is nothing to scan (the
+			 * relation is empty, or other processes have already finished a
+			 * parallel scan)
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_finish(scan);
 				return;
 			}
-			if (scan->rs_base.rs_parallel != NULL)
-			{
-				ParallelBlockTableScanDesc pbscan =
-				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-				ParallelBlockTableScanWorker pbscanwork =
-				scan->rs_parallelworkerdata;
-
-				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				/* Other processes might have already finished the scan. */
-				if (page == InvalidBlockNumber)
-				{
-					Assert(!BufferIsValid(scan->rs_cbuf));
-					tuple->t_data = NULL;
-					return;
-				}
-			}
-			else
-				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
+			page = scan->rs_cblock; /* first page */
 			lineindex = 0;
 			scan->rs_inited = true;
 		}
@@ -924,34 +1087,16 @@ heapgettup_pagemode(HeapScanDesc scan,
 		if (!scan->rs_inited)
 		{
 			/*
-			 * return null immediately if relation is empty
+			 * Start from last page of the scan; return null immediately if
+			 * relation is empty
 			 */
-			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
+			heapfetchbuf(scan, dir);
+			if (!BufferIsValid(scan->rs_cbuf))
 			{
-				Assert(!BufferIsValid(scan->rs_cbuf));
-				tuple->t_data = NULL;
+				heapgettup_finish(scan);
 				return;
 			}
-
-			/*
-			 * Disable reporting to syncscan logic in a backwards scan; it's
-			 * not very likely anyone else is doing the same thing at the same
-			 * time, and much more likely that we'll just bollix things for
-			 * forward scanners.
-			 */
-			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
-
-			/*
-			 * Start from last page of the scan.  Ensure we take into account
-			 * rs_numblocks if it's been adjusted by heap_setscanlimits().
-			 */
-			if (scan->rs_numblocks != InvalidBlockNumber)
-				page = (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
-			else if (scan->rs_startblock > 0)
-				page = scan->rs_startblock - 1;
-			else
-				page = scan->rs_nblocks - 1;
-			heapgetpage((TableScanDesc) scan, page);
+			page = scan->rs_cblock;
 		}
 		else
 		{
@@ -1060,64 +1205,18 @@ heapgettup_pagemode(HeapScanDesc scan,
 		 * if we get here, it means we've exhausted the items on this page and
 		 * it's time to move to the next.
 		 */
-		if (backward)
-		{
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-			if (page == 0)
-				page = scan->rs_nblocks;
-			page--;
-		}
-		else if (scan->rs_base.rs_parallel != NULL)
-		{
-			ParallelBlockTableScanDesc pbscan =
-			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-			ParallelBlockTableScanWorker pbscanwork =
-			scan->rs_parallelworkerdata;
-
-			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-													 pbscanwork, pbscan);
-			finished = (page == InvalidBlockNumber);
-		}
-		else
-		{
-			page++;
-			if (page >= scan->rs_nblocks)
-				page = 0;
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-
-			/*
-			 * Report our new scan position for synchronization purposes. We
-			 * don't do that when moving backwards, however. That would just
-			 * mess up any other forward-moving scanners.
-			 *
-			 * Note: we do this before checking for end of scan so that the
-			 * final state of the position hint is back at the start of the
-			 * rel.  That's not strictly necessary, but otherwise when you run
-			 * the same query multiple times the starting position would shift
-			 * a little bit backwards on every invocation, which is confusing.
-			 * We don't guarantee any specific ordering in general, though.
-			 */
-			if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
-				ss_report_location(scan->rs_base.rs_rd, page);
-		}
+		heapfetchbuf(scan, dir);
 
 		/*
 		 * return NULL if we've exhausted all the pages
 		 */
-		if (finished)
+		if (!BufferIsValid(scan->rs_cbuf))
 		{
-			if (BufferIsValid(scan->rs_cbuf))
-				ReleaseBuffer(scan->rs_cbuf);
-			scan->rs_cbuf = InvalidBuffer;
-			scan->rs_cblock = InvalidBlockNumber;
-			tuple->t_data = NULL;
-			scan->rs_inited = false;
+			heapgettup_finish(scan);
 			return;
 		}
 
-		heapgetpage((TableScanDesc) scan, page);
+		page = scan->rs_cblock;
 
 		dp = BufferGetPage(scan->rs_cbuf);
 		TestForOldSnapshot(scan->rs_base.rs_snapshot, scan->rs_base.rs_rd, dp);
@@ -1219,6 +1318,8 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 
 	initscan(scan, key, false);
 
+	heap_scan_begin_stream(scan);
+
 	return (TableScanDesc) scan;
 }
 
@@ -1253,10 +1354,22 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	/*
+	 * Release any pages the stream has read ahead.  initscan() may choose a
+	 * different access strategy, so the stream is set up again afterwards.
+	 */
+	if (scan->rs_stream != NULL)
+	{
+		StreamingReadEnd(scan->rs_stream);
+		scan->rs_stream = NULL;
+	}
+
 	/*
 	 * reinitialize scan descriptor
 	 */
 	initscan(scan, key, true);
+
+	heap_scan_begin_stream(scan);
 }
 
 void
@@ -1272,6 +1385,9 @@ heap_endscan(TableScanDesc sscan)
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	if (scan->rs_stream != NULL)
+		StreamingReadEnd(scan->rs_stream);
+
 	/*
 	 * decrement relation reference count and free scan descriptor storage
 	 */
@@ -2218,9 +2334,11 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 	 * To allow parallel inserts, we need to ensure that they are safe to be
 	 * performed in workers. We have the infrastructure to allow parallel
 	 * inserts in general except for the cases where inserts generate a new
-	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * CommandId (eg. inserts into a table having a foreign key column).  So
+	 * we allow them only when the leader already marked the command ID as
+	 * used before starting the workers, as parallel COPY FROM does.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && !IsCurrentCommandIdUsed())
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
@@ -0,0 +1,525 @@
+/*-------------------------------------------------------------------------
+ *
+ * csnlog.c
+ *		PostgreSQL commit sequence number log manager
+ *
+ * The pg_csn manager is a pg_xact-like manager that stores the commit
+ * sequence number (CSN) of each transaction, that is, the order in which
+ * transactions stopped being seen as running.  With csn_snapshots enabled,
+ * an MVCC snapshot records the CSN counter at the time it was taken, and
+ * deciding whether a transaction was running as of the snapshot is a matter
+ * of comparing the transaction's CSN with the snapshot's, instead of
+ * searching the snapshot's XID arrays.
+ *
+ * Subtransactions are assigned the CSN of their top-level transaction when
+ * it commits.  Aborted transactions never get a CSN, which is fine, because
+ * their effects are invisible to every snapshot anyway.
+ *
+ * Committing is a two-step affair.  Before a transaction is removed from the
+ * ProcArray, its XIDs are marked as committing; the CSN is assigned while
+ * holding ProcArrayLock as it is removed, and stored right afterwards.  A
+ * backend that finds an XID still marked as committing waits for the final
+ * value, which is only a few instructions away.
+ *
+ * Like pg_subtrans, we only need to remember CSNs for transactions that
+ * some snapshot might still consider running, so there is no need to
+ * preserve data over a crash and restart, and no XLOG interactions.  XIDs
+ * that were assigned before the CSN log was started up are handled by the
+ * caller, see CSNLogGetStartXid().
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/backend/access/transam/csnlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/csnlog.h"
+#include "access/slru.h"
+#include "access/transam.h"
+#include "miscadmin.h"
+#include "storage/s_lock.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+#include "utils/snapmgr.h"
+
+
+/*
+ * Defines for CSNLog page sizes.  A page is the same BLCKSZ as is used
+ * everywhere else in Postgres.
+ *
+ * Note: because TransactionIds are 32 bits and wrap around at 0xFFFFFFFF,
+ * CSNLog page numbering also wraps around at
+ * 0xFFFFFFFF/CSNLOG_XACTS_PER_PAGE, and segment numbering at
+ * 0xFFFFFFFF/CSNLOG_XACTS_PER_PAGE/SLRU_PAGES_PER_SEGMENT.  We need take no
+ * explicit notice of that fact in this module, except when comparing segment
+ * and page numbers in TruncateCSNLog (see CSNLogPagePrecedes) and zeroing
+ * them in StartupCSNLog.
+ */
+
+/* We need eight bytes per xact */
+#define CSNLOG_XACTS_PER_PAGE (BLCKSZ / sizeof(CommitSeqNo))
+
+#define TransactionIdToPage(xid) ((xid) / (TransactionId) CSNLOG_XACTS_PER_PAGE)
+#define TransactionIdToEntry(xid) ((xid) % (TransactionId) CSNLOG_XACTS_PER_PAGE)
+
+/*
+ * Shared state besides the SLRU itself.
+ */
+typedef struct CSNLogControlData
+{
+	/*
+	 * First XID assigned after the CSN log was started up.  Earlier XIDs
+	 * have no CSN even if they committed.  Set once at startup.
+	 */
+	TransactionId startXid;
+} CSNLogControlData;
+
+/* GUC variable */
+bool		csn_snapshots;
+
+/*
+ * Link to shared-memory data structures for CSNLog control
+ */
+static SlruCtlData CsnLogCtlData;
+
+#define CsnLogCtl  (&CsnLogCtlData)
+
+static CSNLogControlData *CSNLogControl;
+
+/*
+ * Single-item cache for results of CSNLogGetCommitSeqNo.  Only final CSNs
+ * are cached, as those never change.
+ */
+static TransactionId cachedFetchXid = InvalidTransactionId;
+static CommitSeqNo cachedCommitSeqNo;
+
+
+static void CSNLogSetTree(TransactionId xid, int nsubxids,
+						  TransactionId *subxids, CommitSeqNo csn);
+static int	ZeroCSNLogPage(int pageno);
+static bool CSNLogPagePrecedes(int page1, int page2);
+
+
+/*
+ * Mark a transaction and its committed subtransactions as committing.
+ *
+ * This must be called after the commit has been recorded in pg_xact, and
+ * before the transaction is removed from the ProcArray.
+ */
+void
+CSNLogSetCommitting(TransactionId xid, int nsubxids, TransactionId *subxids)
+{
+	if (!csn_snapshots)
+		return;
+
+	CSNLogSetTree(xid, nsubxids, subxids, CommittingCommitSeqNo);
+}
+
+/*
+ * Record the CSN of a transaction and its committed subtransactions.
+ *
+ * This is called right after the transaction has been removed from the
+ * ProcArray, with the CSN assigned then.
+ */
+void
+CSNLogSetCommitSeqNo(TransactionId xid, int nsubxids, TransactionId *subxids,
+					 CommitSeqNo csn)
+{
+	if (!csn_snapshots)
+		return;
+
+	Assert(CommitSeqNoIsNormal(csn));
+
+	CSNLogSetTree(xid, nsubxids, subxids, csn);
+}
+
+/*
+ * Store the same CSN value for a transaction and all the given
+ * subtransactions.  The subtransaction XIDs usually live on the same page as
+ * the parent, so we try to avoid reacquiring the bank lock for each of them.
+ */
+static void
+CSNLogSetTree(TransactionId xid, int nsubxids, TransactionId *subxids,
+			  CommitSeqNo csn)
+{
+	int			pageno = TransactionIdToPage(xid);
+	LWLock	   *lock = SimpleLruGetBankLock(CsnLogCtl, pageno);
+
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+
+	for (int i = -1; i < nsubxids; i++)
+	{
+		TransactionId thisxid = (i < 0) ? xid : subxids[i];
+		int			thispageno = TransactionIdToPage(thisxid);
+		int			slotno;
+		CommitSeqNo *ptr;
+
+		if (thispageno != pageno)
+		{
+			LWLock	   *thislock = SimpleLruGetBankLock(CsnLogCtl, thispageno);
+
+			if (thislock != lock)
+			{
+				LWLockRelease(lock);
+				LWLockAcquire(thislock, LW_EXCLUSIVE);
+				lock = thislock;
+			}
+			pageno = thispageno;
+		}
+
+		slotno = SimpleLruReadPage(CsnLogCtl, pageno, true, thisxid);
+		ptr = (CommitSeqNo *) CsnLogCtl->shared->page_buffer[slotno];
+		ptr += TransactionIdToEntry(thisxid);
+
+		*ptr = csn;
+		CsnLogCtl->shared->page_dirty[slotno] = true;
+	}
+
+	LWLockRelease(lock);
+}
+
+/*
+ * Interrogate the CSN of a transaction in the CSN log.
+ *
+ * Returns InvalidCommitSeqNo if the transaction has not committed, or
+ * committed before the CSN log was started up.  If the transaction is in
+ * the middle of committing, we wait until its CSN has been stored.
+ */
+CommitSeqNo
+CSNLogGetCommitSeqNo(TransactionId xid)
+{
+	int			pageno = TransactionIdToPage(xid);
+	int			entryno = TransactionIdToEntry(xid);
+	CommitSeqNo csn;
+	SpinDelayStatus delayStatus;
+
+	Assert(csn_snapshots);
+
+	/* Can't ask about stuff that might not be around anymore */
+	Assert(TransactionIdFollowsOrEquals(xid, TransactionXmin));
+	Assert(TransactionIdIsNormal(xid));
+
+	if (TransactionIdEquals(xid, cachedFetchXid))
+		return cachedCommitSeqNo;
+
+	init_local_spin_delay(&delayStatus);
+	for (;;)
+	{
+		int			slotno;
+
+		/* lock is acquired by SimpleLruReadPage_ReadOnly */
+		slotno = SimpleLruReadPage_ReadOnly(CsnLogCtl, pageno, xid);
+		csn = ((CommitSeqNo *) CsnLogCtl->shared->page_buffer[slotno])[entryno];
+		LWLockRelease(SimpleLruGetBankLock(CsnLogCtl, pageno));
+
+		if (csn != CommittingCommitSeqNo)
+			break;
+
+		/*
+		 * The committing backend is between marking the transaction as
+		 * committing and storing its CSN, which doesn't involve any waiting
+		 * on its part.  Spin until it's done.
+		 */
+		perform_spin_delay(&delayStatus);
+	}
+	finish_spin_delay(&delayStatus);
+
+	if (CommitSeqNoIsNormal(csn))
+	{
+		cachedFetchXid = xid;
+		cachedCommitSeqNo = csn;
+	}
+
+	return csn;
+}
+
+/*
+ * Return the first XID that was assigned after the CSN log was started up.
+ *
+ * Older XIDs have no CSN even if they committed.  They all finished before
+ * any snapshot using the CSN log was taken, except for prepared transactions
+ * that were recovered at startup.
+ */
+TransactionId
+CSNLogGetStartXid(void)
+{
+	Assert(csn_snapshots);
+
+	return CSNLogControl->startXid;
+}
+
+
+/*
+ * Number of shared CSNLog buffers.
+ *
+ * If asked to autotune, use 4MB for every 1GB of shared buffers, up to 16MB.
+ * Otherwise just cap the configured amount to be between 16 and the maximum
+ * allowed.
+ */
+static int
+CSNLogShmemBuffers(void)
+{
+	/* auto-tune based on shared buffers */
+	if (csn_log_buffers == 0)
+		return SimpleLruAutotuneBuffers(256, 2048);
+
+	return Min(Max(16, csn_log_buffers), SLRU_MAX_ALLOWED_BUFFERS);
+}
+
+/*
+ * Initialization of shared memory for CSNLog
+ */
+Size
+CSNLogShmemSize(void)
+{
+	if (!csn_snapshots)
+		return 0;
+
+	return add_size(SimpleLruShmemSize(CSNLogShmemBuffers(), 0),
+					sizeof(CSNLogControlData));
+}
+
+void
+CSNLogShmemInit(void)
+{
+	bool		found;
+
+	if (!csn_snapshots)
+		return;
+
+	/* If auto-tuning is requested, now is the time to do it */
+	if (csn_log_buffers == 0)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", CSNLogShmemBuffers());
+		SetConfigOption("csn_log_buffers", buf, PGC_POSTMASTER,
+						PGC_S_DYNAMIC_DEFAULT);
+
+		/*
+		 * We prefer to report this value's source as PGC_S_DYNAMIC_DEFAULT.
+		 * However, if the DBA explicitly set csn_log_buffers = 0 in the
+		 * config file, then PGC_S_DYNAMIC_DEFAULT will fail to override that
+		 * and we must force the matter with PGC_S_OVERRIDE.
+		 */
+		if (csn_log_buffers == 0)	/* failed to apply it? */
+			SetConfigOption("csn_log_buffers", buf, PGC_POSTMASTER,
+							PGC_S_OVERRIDE);
+	}
+	Assert(csn_log_buffers != 0);
+
+	CsnLogCtl->PagePrecedes = CSNLogPagePrecedes;
+	SimpleLruInit(CsnLogCtl, "CSNLog", CSNLogShmemBuffers(), 0,
+				  "pg_csn", LWTRANCHE_CSN_LOG_BUFFER,
+				  LWTRANCHE_CSN_LOG_SLRU, SYNC_HANDLER_NONE);
+	SlruPagePrecedesUnitTests(CsnLogCtl, CSNLOG_XACTS_PER_PAGE);
+
+	CSNLogControl = (CSNLogControlData *)
+		ShmemInitStruct("CSNLog Ctl", sizeof(CSNLogControlData), &found);
+	if (!found)
+		CSNLogControl->startXid = InvalidTransactionId;
+}
+
+/*
+ * GUC check_hook for csn_log_buffers
+ */
+bool
+check_csn_log_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("csn_log_buffers", newval);
+}
+
+/*
+ * Initialize (or reinitialize) a page of CSNLog to zeroes.
+ *
+ * The page is not actually written, just set up in shared memory.
+ * The slot number of the new page is returned.
+ *
+ * The bank lock must be held at entry, and will be held at exit.
+ */
+static int
+ZeroCSNLogPage(int pageno)
+{
+	return SimpleLruZeroPage(CsnLogCtl, pageno);
+}
+
+/*
+ * This must be called ONCE at the end of recovery, or during standalone
+ * backend startup, after StartupXLOG has initialized
+ * ShmemVariableCache->nextXid.  The CSN log is not maintained during
+ * recovery.
+ *
+ * oldestActiveXID is the oldest XID of any prepared transaction, or nextXid
+ * if there are none.
+ */
+void
+StartupCSNLog(TransactionId oldestActiveXID)
+{
+	FullTransactionId nextXid;
+	int			startPage;
+	int			endPage;
+	LWLock	   *prevlock;
+	LWLock	   *lock;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * Since we don't expect pg_csn to be valid across crashes, we initialize
+	 * the currently-active page(s) to zeroes during startup.  Prepared
+	 * transactions may still commit, so their pages are needed too.
+	 * Whenever we advance into a new page, ExtendCSNLog will likewise zero
+	 * the new page without regard to whatever was previously on disk.
+	 */
+	startPage = TransactionIdToPage(oldestActiveXID);
+	nextXid = ShmemVariableCache->nextXid;
+	endPage = TransactionIdToPage(XidFromFullTransactionId(nextXid));
+
+	prevlock = SimpleLruGetBankLock(CsnLogCtl, startPage);
+	LWLockAcquire(prevlock, LW_EXCLUSIVE);
+	while (startPage != endPage)
+	{
+		lock = SimpleLruGetBankLock(CsnLogCtl, startPage);
+
+		/*
+		 * Check if we need to acquire the lock on the new bank then release
+		 * the lock on the old bank and acquire on the new bank.
+		 */
+		if (prevlock != lock)
+		{
+			LWLockRelease(prevlock);
+			LWLockAcquire(lock, LW_EXCLUSIVE);
+			prevlock = lock;
+		}
+
+		(void) ZeroCSNLogPage(startPage);
+		startPage++;
+		/* must account for wraparound */
+		if (startPage > TransactionIdToPage(MaxTransactionId))
+			startPage = 0;
+	}
+
+	lock = SimpleLruGetBankLock(CsnLogCtl, startPage);
+
+	/*
+	 * Check if we need to acquire the lock on the new bank then release the
+	 * lock on the old bank and acquire on the new bank.
+	 */
+	if (prevlock != lock)
+	{
+		LWLockRelease(prevlock);
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+	}
+	(void) ZeroCSNLogPage(startPage);
+	LWLockRelease(lock);
+
+	CSNLogControl->startXid = XidFromFullTransactionId(nextXid);
+}
+
+/*
+ * Perform a checkpoint --- either during shutdown, or on-the-fly
+ */
+void
+CheckPointCSNLog(void)
+{
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * Write dirty CSNLog pages to disk
+	 *
+	 * This is not actually necessary from a correctness point of view. We do
+	 * it merely to improve the odds that writing of dirty pages is done by
+	 * the checkpoint process and not by backends.
+	 */
+	SimpleLruWriteAll(CsnLogCtl, true);
+}
+
+
+/*
+ * Make sure that CSNLog has room for a newly-allocated XID.
+ *
+ * NB: this is called while holding XidGenLock.  We want it to be very fast
+ * most of the time; even when it's not so fast, no actual I/O need happen
+ * unless we're forced to write out a dirty CSNLog page to make room
+ * in shared memory.
+ */
+void
+ExtendCSNLog(TransactionId newestXact)
+{
+	int			pageno;
+	LWLock	   *lock;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * No work except at first XID of a page.  But beware: just after
+	 * wraparound, the first XID of page zero is FirstNormalTransactionId.
+	 */
+	if (TransactionIdToEntry(newestXact) != 0 &&
+		!TransactionIdEquals(newestXact, FirstNormalTransactionId))
+		return;
+
+	pageno = TransactionIdToPage(newestXact);
+
+	lock = SimpleLruGetBankLock(CsnLogCtl, pageno);
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+
+	/* Zero the page */
+	ZeroCSNLogPage(pageno);
+
+	LWLockRelease(lock);
+}
+
+
+/*
+ * Remove all CSNLog segments before the one holding the passed transaction ID
+ *
+ * oldestXact is the oldest TransactionXmin of any running transaction.  This
+ * is called only during checkpoint, and not during recovery.
+ */
+void
+TruncateCSNLog(TransactionId oldestXact)
+{
+	int			cutoffPage;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * The cutoff point is the start of the segment containing oldestXact. We
+	 * pass the *page* containing oldestXact to SimpleLruTruncate.  We step
+	 * back one transaction to avoid passing a cutoff page that hasn't been
+	 * created yet in the rare case that oldestXact would be the first item on
+	 * a page and oldestXact == next XID.  In that case, if we didn't subtract
+	 * one, we'd trigger SimpleLruTruncate's wraparound detection.
+	 */
+	TransactionIdRetreat(oldestXact);
+	cutoffPage = TransactionIdToPage(oldestXact);
+
+	SimpleLruTruncate(CsnLogCtl, cutoffPage);
+}
+
+
+/*
+ * Decide whether a CSNLog page number is "older" for truncation purposes.
+ * Analogous to CLOGPagePrecedes().
+ */
+static bool
+CSNLogPagePrecedes(int page1, int page2)
+{
+	TransactionId xid1;
+	TransactionId xid2;
+
+	xid1 = ((TransactionId) page1) * CSNLOG_XACTS_PER_PAGE;
+	xid1 += FirstNormalTransactionId + 1;
+	xid2 = ((TransactionId) page2) * CSNLOG_XACTS_PER_PAGE;
+	xid2 += FirstNormalTransactionId + 1;
+
+	return (TransactionIdPrecedes(xid1, xid2) &&
+			TransactionIdPrecedes(xid1, xid2 + CSNLOG_XACTS_PER_PAGE - 1));
+}
@@ -77,6 +77,7 @@
 #include <unistd.h>
 
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/htup_details.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
@@ -451,6 +452,8 @@ MarkAsPreparingGuts(GlobalTransaction gxact, TransactionId xid, const char *gid,
 					TimestampTz prepared_at, Oid owner, Oid databaseid)
 {
 	PGPROC	   *proc;
+	uint64	   *fpLockBits;
+	Oid		   *fpRelId;
 	int			i;
 
 	Assert(LWLockHeldByMeInMode(TwoPhaseStateLock, LW_EXCLUSIVE));
@@ -458,8 +461,15 @@ MarkAsPreparingGuts(GlobalTransaction gxact, TransactionId xid, const char *gid,
 	Assert(gxact != NULL);
 	proc = &ProcGlobal->allProcs[gxact->pgprocno];
 
-	/* Initialize the PGPROC entry */
+	/*
+	 * Initialize the PGPROC entry.  The fast-path lock arrays live outside
+	 * PGPROC and are set up once by InitProcGlobal, so keep the pointers.
+	 */
+	fpLockBits = proc->fpLockBits;
+	fpRelId = proc->fpRelId;
 	MemSet(proc, 0, sizeof(PGPROC));
+	proc->fpLockBits = fpLockBits;
+	proc->fpRelId = fpRelId;
 	proc->pgprocno = gxact->pgprocno;
 	SHMQueueElemInit(&(proc->links));
 	proc->waitStatus = PROC_WAIT_STATUS_OK;
@@ -1564,7 +1574,18 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 									   abortstats,
 									   gid);
 
-	ProcArrayRemove(proc, latestXid);
+	/* See CommitTransaction() for how the CSN log is maintained */
+	if (isCommit && csn_snapshots)
+	{
+		START_CRIT_SECTION();
+		CSNLogSetCommitting(xid, hdr->nsubxacts, children);
+		ProcArrayRemove(proc, latestXid);
+		CSNLogSetCommitSeqNo(xid, hdr->nsubxacts, children,
+							 proc->commitSeqNo);
+		END_CRIT_SECTION();
+	}
+	else
+		ProcArrayRemove(proc, latestXid);
 
 	/*
 	 * In case we fail while running the callbacks, mark the gxact invalid so
@@ -21,6 +21,7 @@
 #include <unistd.h>
 
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/multixact.h"
 #include "access/parallel.h"
 #include "access/subtrans.h"
@@ -224,6 +225,7 @@ typedef struct SerializedTransactionState
 	FullTransactionId topFullTransactionId;
 	FullTransactionId currentFullTransactionId;
 	CommandId	currentCommandId;
+	bool		currentCommandIdUsed;
 	int			nParallelCurrentXids;
 	TransactionId parallelCurrentXids[FLEXIBLE_ARRAY_MEMBER];
 } SerializedTransactionState;
@@ -818,16 +820,31 @@ GetCurrentCommandId(bool used)
 	{
 		/*
 		 * Forbid setting currentCommandIdUsed in a parallel worker, because
-		 * we have no provision for communicating this back to the leader.  We
-		 * could relax this restriction when currentCommandIdUsed was already
-		 * true at the start of the parallel operation.
+		 * we have no provision for communicating this back to the leader.
+		 * That's harmless if currentCommandIdUsed was already true at the
+		 * start of the parallel operation, as it is for parallel COPY FROM.
 		 */
-		Assert(!IsParallelWorker());
-		currentCommandIdUsed = true;
+		if (IsParallelWorker())
+			Assert(currentCommandIdUsed);
+		else
+			currentCommandIdUsed = true;
 	}
 	return currentCommandId;
 }
 
+/*
+ *	IsCurrentCommandIdUsed
+ *
+ * Report whether the current command ID has been marked as used, either by
+ * this backend or, in a parallel worker, by the leader before the parallel
+ * operation began.
+ */
+bool
+IsCurrentCommandIdUsed(void)
+{
+	return currentCommandIdUsed;
+}
+
 /*
  *	SetParallelStartTimestamps
  *
@@ -2276,8 +2293,27 @@ CommitTransaction(void)
 	 * Let others know about no transaction in progress by me. Note that this
 	 * must be done _before_ releasing locks we hold and _after_
 	 * RecordTransactionCommit.
+	 *
+	 * With csn_snapshots, our XIDs are marked as committing in the CSN log
+	 * first, and get their CSN once we're out of the ProcArray.  Others will
+	 * wait for that, so don't let an error leave them marked as committing.
 	 */
-	ProcArrayEndTransaction(MyProc, latestXid);
+	if (csn_snapshots && TransactionIdIsValid(latestXid))
+	{
+		TransactionId xid = GetTopTransactionIdIfAny();
+		TransactionId *children;
+		int			nchildren;
+
+		nchildren = xactGetCommittedChildren(&children);
+
+		START_CRIT_SECTION();
+		CSNLogSetCommitting(xid, nchildren, children);
+		ProcArrayEndTransaction(MyProc, latestXid);
+		CSNLogSetCommitSeqNo(xid, nchildren, children, MyProc->commitSeqNo);
+		END_CRIT_SECTION();
+	}
+	else
+		ProcArrayEndTransaction(MyProc, latestXid);
 
 	/*
 	 * This is all post-commit cleanup.  Note that if an error is raised here,
@@ -5347,6 +5383,7 @@ SerializeTransactionState(Size maxsize, char *start_address)
 	result->currentFullTransactionId =
 		CurrentTransactionState->fullTransactionId;
 	result->currentCommandId = currentCommandId;
+	result->currentCommandIdUsed = currentCommandIdUsed;
 
 	/*
 	 * If we're running in a parallel worker and launching a parallel worker
@@ -5416,6 +5453,7 @@ StartParallelWorkerTransaction(char *tstatespace)
 	CurrentTransactionState->fullTransactionId =
 		tstate->currentFullTransactionId;
 	currentCommandId = tstate->currentCommandId;
+	currentCommandIdUsed = tstate->currentCommandIdUsed;
 	nParallelCurrentXids = tstate->nParallelCurrentXids;
 	ParallelCurrentXids = &tstate->parallelCurrentXids[0];
 
@@ -48,6 +48,7 @@
 
 #include "access/clog.h"
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/heaptoast.h"
 #include "access/multixact.h"
 #include "access/rewriteheap.h"
@@ -68,11 +69,13 @@
 #include "catalog/pg_database.h"
 #include "common/controldata_utils.h"
 #include "common/file_utils.h"
+#include "common/hashfn.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/startup.h"
@@ -116,6 +119,7 @@ int			max_wal_size_mb = 1024; /* 1 GB */
 int			min_wal_size_mb = 80;	/* 80 MB */
 int			wal_keep_size_mb = 0;
 int			XLOGbuffers = -1;
+int			wal_insertion_locks = 8;
 int			XLogArchiveTimeout = 0;
 int			XLogArchiveMode = ARCHIVE_MODE_OFF;
 char	   *XLogArchiveCommand = NULL;
@@ -143,13 +147,6 @@ bool		XLOG_DEBUG = false;
 
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
-/*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
- */
-#define NUM_XLOGINSERT_LOCKS  8
-
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
  * checkpoint.
@@ -387,6 +384,42 @@ typedef union WALInsertLockPadded
 	char		pad[PG_CACHE_LINE_SIZE];
 } WALInsertLockPadded;
 
+/*
+ * Number of WAL insertion locks to use. A higher value allows more insertions
+ * to happen concurrently, but adds some CPU overhead to flushing the WAL,
+ * which needs to iterate all the locks.
+ */
+#define NUM_XLOGINSERT_LOCKS	wal_insertion_locks
+
+/*
+ * Space in the WAL is reserved by atomically advancing CurrBytePos, without
+ * any lock.  That leaves the problem of finding the start of the previous
+ * record, for the xl_prev link of the new record: its start is only known to
+ * the backend that reserved it.  So each inserter publishes a link from the
+ * end of the record it reserved to its start, and the inserter that reserved
+ * the space right after it looks the link up by its own start position and
+ * removes it.
+ *
+ * The links are kept in a small open-addressing hash table.  A link stays in
+ * the table only until the next record has been reserved, and reservations
+ * happen while holding a WAL insertion lock, so there can be at most
+ * NUM_XLOGINSERT_LOCKS + 1 links at any time.  The table is sized generously
+ * above that, so a free slot can always be found.
+ *
+ * endpos is 0 in a free slot, and XLOG_PREV_LINK_CLAIMED while the publisher
+ * is filling in startpos.
+ */
+typedef struct XLogPrevLink
+{
+	pg_atomic_uint64 endpos;	/* end of a reserved record */
+	uint64		startpos;		/* start of the same record */
+} XLogPrevLink;
+
+#define XLOG_PREV_LINK_CLAIMED	PG_UINT64_MAX
+
+#define NUM_XLOG_PREV_LINKS \
+	pg_nextpower2_32(4 * (NUM_XLOGINSERT_LOCKS + 1))
+
 /*
  * Session status of running backup, used for sanity checks in SQL-callable
  * functions to start and stop backups.
@@ -398,24 +431,22 @@ static SessionBackupState sessionBackupState = SESSION_BACKUP_NONE;
  */
 typedef struct XLogCtlInsert
 {
-	slock_t		insertpos_lck;	/* protects CurrBytePos and PrevBytePos */
-
 	/*
 	 * CurrBytePos is the end of reserved WAL. The next record will be
-	 * inserted at that position. PrevBytePos is the start position of the
-	 * previously inserted (or rather, reserved) record - it is copied to the
-	 * prev-link of the next record. These are stored as "usable byte
-	 * positions" rather than XLogRecPtrs (see XLogBytePosToRecPtr()).
+	 * inserted at that position.  It is advanced with an atomic fetch-add by
+	 * each inserter.  The start position of the previously reserved record,
+	 * which is copied to the prev-link of the next record, is found through
+	 * the PrevLinks table.  Positions are stored as "usable byte positions"
+	 * rather than XLogRecPtrs (see XLogBytePosToRecPtr()).
 	 */
-	uint64		CurrBytePos;
-	uint64		PrevBytePos;
+	pg_atomic_uint64 CurrBytePos;
 
 	/*
-	 * Make sure the above heavily-contended spinlock and byte positions are
-	 * on their own cache line. In particular, the RedoRecPtr and full page
-	 * write variables below should be on a different cache line. They are
-	 * read on every WAL insertion, but updated rarely, and we don't want
-	 * those reads to steal the cache line containing Curr/PrevBytePos.
+	 * Make sure the above heavily-contended byte position is on its own
+	 * cache line. In particular, the RedoRecPtr and full page write variables
+	 * below should be on a different cache line. They are read on every WAL
+	 * insertion, but updated rarely, and we don't want those reads to steal
+	 * the cache line containing CurrBytePos.
 	 */
 	char		pad[PG_CACHE_LINE_SIZE];
 
@@ -447,6 +478,13 @@ typedef struct XLogCtlInsert
 	 * WAL insertion locks.
 	 */
 	WALInsertLockPadded *WALInsertLocks;
+
+	/*
+	 * Links from the end of recently reserved records to their start, see
+	 * XLogPrevLink.  PrevLinksMask is the table size minus one.
+	 */
+	XLogPrevLink *PrevLinks;
+	uint32		PrevLinksMask;
 } XLogCtlInsert;
 
 /*
@@ -684,7 +722,10 @@ static void ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos,
 									  XLogRecPtr *EndPos, XLogRecPtr *PrevPtr);
 static bool ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 							  XLogRecPtr *PrevPtr);
+static void XLogPrevLinkPublish(uint64 endbytepos, uint64 startbytepos);
+static uint64 XLogPrevLinkConsume(uint64 endbytepos);
 static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
+static void XLogFlushGroup(XLogRecPtr upto, TimeLineID insertTLI);
 static char *GetXLogBuffer(XLogRecPtr ptr, TimeLineID tli);
 static XLogRecPtr XLogBytePosToRecPtr(uint64 bytepos);
 static XLogRecPtr XLogBytePosToEndRecPtr(uint64 bytepos);
@@ -763,8 +804,8 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * record to the shared WAL buffer cache is a two-step process:
 	 *
 	 * 1. Reserve the right amount of space from the WAL. The current head of
-	 *	  reserved space is kept in Insert->CurrBytePos, and is protected by
-	 *	  insertpos_lck.
+	 *	  reserved space is kept in Insert->CurrBytePos, and is advanced
+	 *	  atomically without taking a lock.
 	 *
 	 * 2. Copy the record to the reserved WAL space. This involves finding the
 	 *	  correct WAL buffer containing the reserved space, and copying the
@@ -774,7 +815,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
 	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * determined by wal_insertion_locks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1030,9 +1071,9 @@ XLogInsertRecord(XLogRecData *rdata,
  * used to set the xl_prev of this record.
  *
  * This is the performance critical part of XLogInsert that must be serialized
- * across backends. The rest can happen mostly in parallel. Try to keep this
- * section as short as possible, insertpos_lck can be heavily contended on a
- * busy system.
+ * across backends. The rest can happen mostly in parallel.  The reservation
+ * itself is a single atomic fetch-add, and the prev-link is exchanged with
+ * the neighbouring inserters through the PrevLinks table.
  *
  * NB: The space calculation here must match the code in CopyXLogRecordToWAL,
  * where we actually copy the record to the reserved space.
@@ -1052,24 +1093,22 @@ ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 	Assert(size > SizeOfXLogRecord);
 
 	/*
-	 * The duration the spinlock needs to be held is minimized by minimizing
-	 * the calculations that have to be done while holding the lock. The
-	 * current tip of reserved WAL is kept in CurrBytePos, as a byte position
-	 * that only counts "usable" bytes in WAL, that is, it excludes all WAL
-	 * page headers. The mapping between "usable" byte positions and physical
-	 * positions (XLogRecPtrs) can be done outside the locked region, and
-	 * because the usable byte position doesn't include any headers, reserving
-	 * X bytes from WAL is almost as simple as "CurrBytePos += X".
+	 * The current tip of reserved WAL is kept in CurrBytePos, as a byte
+	 * position that only counts "usable" bytes in WAL, that is, it excludes
+	 * all WAL page headers. The mapping between "usable" byte positions and
+	 * physical positions (XLogRecPtrs) can be done after the reservation,
+	 * and because the usable byte position doesn't include any headers,
+	 * reserving X bytes from WAL is as simple as "CurrBytePos += X".
 	 */
-	SpinLockAcquire(&Insert->insertpos_lck);
-
-	startbytepos = Insert->CurrBytePos;
+	startbytepos = pg_atomic_fetch_add_u64(&Insert->CurrBytePos, size);
 	endbytepos = startbytepos + size;
-	prevbytepos = Insert->PrevBytePos;
-	Insert->CurrBytePos = endbytepos;
-	Insert->PrevBytePos = startbytepos;
 
-	SpinLockRelease(&Insert->insertpos_lck);
+	/*
+	 * Publish our own link first, so that the next inserter never waits for
+	 * us while we wait for our predecessor.
+	 */
+	XLogPrevLinkPublish(endbytepos, startbytepos);
+	prevbytepos = XLogPrevLinkConsume(startbytepos);
 
 	*StartPos = XLogBytePosToRecPtr(startbytepos);
 	*EndPos = XLogBytePosToEndRecPtr(endbytepos);
@@ -1105,25 +1144,22 @@ ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos, XLogRecPtr *PrevPtr)
 	uint32		segleft;
 
 	/*
-	 * These calculations are a bit heavy-weight to be done while holding a
-	 * spinlock, but since we're holding all the WAL insertion locks, there
-	 * are no other inserters competing for it. GetXLogInsertRecPtr() does
-	 * compete for it, but that's not called very frequently.
+	 * Since we're holding all the WAL insertion locks, there are no other
+	 * inserters that could advance CurrBytePos concurrently, so we can
+	 * simply read it, do the calculations, and write it back.
 	 */
-	SpinLockAcquire(&Insert->insertpos_lck);
+	Assert(holdingAllLocks);
 
-	startbytepos = Insert->CurrBytePos;
+	startbytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 
 	ptr = XLogBytePosToEndRecPtr(startbytepos);
 	if (XLogSegmentOffset(ptr, wal_segment_size) == 0)
 	{
-		SpinLockRelease(&Insert->insertpos_lck);
 		*EndPos = *StartPos = ptr;
 		return false;
 	}
 
 	endbytepos = startbytepos + size;
-	prevbytepos = Insert->PrevBytePos;
 
 	*StartPos = XLogBytePosToRecPtr(startbytepos);
 	*EndPos = XLogBytePosToEndRecPtr(endbytepos);
@@ -1135,10 +1171,10 @@ ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos, XLogRecPtr *PrevPtr)
 		*EndPos += segleft;
 		endbytepos = XLogRecPtrToBytePos(*EndPos);
 	}
-	Insert->CurrBytePos = endbytepos;
-	Insert->PrevBytePos = startbytepos;
+	pg_atomic_write_u64(&Insert->CurrBytePos, endbytepos);
 
-	SpinLockRelease(&Insert->insertpos_lck);
+	XLogPrevLinkPublish(endbytepos, startbytepos);
+	prevbytepos = XLogPrevLinkConsume(startbytepos);
 
 	*PrevPtr = XLogBytePosToRecPtr(prevbytepos);
 
@@ -1150,6 +1186,87 @@ ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos, XLogRecPtr *PrevPtr)
 	return true;
 }
 
+/*
+ * Publish a link from the end of a record just reserved to its start, for the
+ * inserter of the following record to find.
+ */
+static void
+XLogPrevLinkPublish(uint64 endbytepos, uint64 startbytepos)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	uint32		mask = Insert->PrevLinksMask;
+	uint32		start = murmurhash32((uint32) endbytepos);
+	SpinDelayStatus delayStatus;
+
+	Assert(endbytepos != 0 && endbytepos != XLOG_PREV_LINK_CLAIMED);
+
+	init_local_spin_delay(&delayStatus);
+	for (;;)
+	{
+		for (uint32 i = 0; i <= mask; i++)
+		{
+			XLogPrevLink *link = &Insert->PrevLinks[(start + i) & mask];
+			uint64		expected = 0;
+
+			if (pg_atomic_read_u64(&link->endpos) != 0)
+				continue;
+			if (!pg_atomic_compare_exchange_u64(&link->endpos, &expected,
+												XLOG_PREV_LINK_CLAIMED))
+				continue;
+
+			/* the slot is ours, fill it in before making it visible */
+			link->startpos = startbytepos;
+			pg_write_barrier();
+			pg_atomic_write_u64(&link->endpos, endbytepos);
+			finish_spin_delay(&delayStatus);
+			return;
+		}
+
+		/* can't happen, as the table is larger than the number of links */
+		perform_spin_delay(&delayStatus);
+	}
+}
+
+/*
+ * Find and remove the link for the record that ends at 'endbytepos',
+ * returning that record's start position.
+ *
+ * The previous inserter publishes its link right after reserving its space,
+ * so if it's not there yet, we only have to wait for a few instructions.
+ */
+static uint64
+XLogPrevLinkConsume(uint64 endbytepos)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	uint32		mask = Insert->PrevLinksMask;
+	uint32		start = murmurhash32((uint32) endbytepos);
+	SpinDelayStatus delayStatus;
+
+	init_local_spin_delay(&delayStatus);
+	for (;;)
+	{
+		for (uint32 i = 0; i <= mask; i++)
+		{
+			XLogPrevLink *link = &Insert->PrevLinks[(start + i) & mask];
+			uint64		startbytepos;
+
+			if (pg_atomic_read_u64(&link->endpos) != endbytepos)
+				continue;
+
+			pg_read_barrier();
+			startbytepos = link->startpos;
+
+			/* make sure startpos is read before the slot is reused */
+			pg_memory_barrier();
+			pg_atomic_write_u64(&link->endpos, 0);
+			finish_spin_delay(&delayStatus);
+			return startbytepos;
+		}
+
+		perform_spin_delay(&delayStatus);
+	}
+}
+
 /*
  * Subroutine of XLogInsertRecord.  Copies a WAL record to an already-reserved
  * area in the WAL.
@@ -1443,10 +1560,13 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	if (MyProc == NULL)
 		elog(PANIC, "cannot wait without a PGPROC structure");
 
-	/* Read the current insert position */
-	SpinLockAcquire(&Insert->insertpos_lck);
-	bytepos = Insert->CurrBytePos;
-	SpinLockRelease(&Insert->insertpos_lck);
+	/*
+	 * Read the current insert position.  Every inserter reserves its space
+	 * only after acquiring an insertion lock, and the fetch-add that does it
+	 * is a full barrier, so any reservation we see here is made by a backend
+	 * whose lock we'll see as held below.
+	 */
+	bytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 	reservedUpto = XLogBytePosToEndRecPtr(bytepos);
 
 	/*
@@ -2499,6 +2619,172 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 	LWLockRelease(ControlFileLock);
 }
 
+/*
+ * Flush WAL up to 'upto' as part of a group.
+ *
+ * Committing backends that need WAL flushed add themselves to a list of
+ * pending flush requests.  The first one to arrive becomes the group leader:
+ * it acquires WALWriteLock, and while it waits for the lock (typically
+ * behind the fsync of the previous group), more backends can join the list.
+ * Once it has the lock, the leader detaches the list, writes and flushes WAL
+ * up to the furthest position requested by any member with a single
+ * XLogWrite call, and wakes up the followers.  This is the same scheme as
+ * ProcArrayGroupClearXid and TransactionGroupUpdateXidStatus use.
+ *
+ * The caller must already have waited for all insertions up to 'upto' to
+ * finish, and be in a critical section.
+ */
+static void
+XLogFlushGroup(XLogRecPtr upto, TimeLineID insertTLI)
+{
+	PROC_HDR   *procglobal = ProcGlobal;
+	PGPROC	   *proc = MyProc;
+	uint32		nextidx;
+	uint32		wakeidx;
+	XLogRecPtr	flushupto = InvalidXLogRecPtr;
+	int			nmembers = 0;
+
+	Assert(proc != NULL);
+
+	/* Add ourselves to the list of processes needing a WAL flush. */
+	proc->walFlushGroupMember = true;
+	proc->walFlushGroupLsn = upto;
+
+	nextidx = pg_atomic_read_u32(&procglobal->walFlushGroupFirst);
+
+	while (true)
+	{
+		pg_atomic_write_u32(&proc->walFlushGroupNext, nextidx);
+
+		if (pg_atomic_compare_exchange_u32(&procglobal->walFlushGroupFirst,
+										   &nextidx,
+										   (uint32) proc->pgprocno))
+			break;
+	}
+
+	/*
+	 * If the list was not empty, the leader will flush WAL for us. It is
+	 * impossible to have followers without a leader because the first
+	 * process that has added itself to the list will always have nextidx as
+	 * INVALID_PGPROCNO.
+	 */
+	if (nextidx != INVALID_PGPROCNO)
+	{
+		int			extraWaits = 0;
+
+		/* Sleep until the leader has flushed our WAL. */
+		pgstat_report_wait_start(WAIT_EVENT_WAL_GROUP_FLUSH);
+		for (;;)
+		{
+			/* acts as a read barrier */
+			PGSemaphoreLock(proc->sem);
+			if (!proc->walFlushGroupMember)
+				break;
+			extraWaits++;
+		}
+		pgstat_report_wait_end();
+
+		Assert(pg_atomic_read_u32(&proc->walFlushGroupNext) == INVALID_PGPROCNO);
+
+		/* Fix semaphore count for any absorbed wakeups */
+		while (extraWaits-- > 0)
+			PGSemaphoreUnlock(proc->sem);
+		return;
+	}
+
+	/*
+	 * We are the leader.  Acquire the write lock on behalf of everyone; more
+	 * processes can join the group while we wait for it.
+	 */
+	LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
+
+	/*
+	 * Sleep before flush! By adding a delay here, we may give further
+	 * backends the opportunity to join the group; this can significantly
+	 * improve transaction throughput, at the risk of increasing transaction
+	 * latency.
+	 *
+	 * We do not sleep if enableFsync is not turned on, nor if there are fewer
+	 * than CommitSiblings other backends with active transactions.
+	 */
+	if (CommitDelay > 0 && enableFsync &&
+		MinimumActiveBackends(CommitSiblings))
+		pg_usleep(CommitDelay);
+
+	/*
+	 * Now clear the list of processes waiting for a WAL flush, saving a
+	 * pointer to the head of the list.  Trying to pop elements one at a time
+	 * could lead to an ABA problem.
+	 */
+	nextidx = pg_atomic_exchange_u32(&procglobal->walFlushGroupFirst,
+									 INVALID_PGPROCNO);
+
+	/* Remember head of list so we can perform wakeups after dropping lock. */
+	wakeidx = nextidx;
+
+	/* Walk the list and find out how far the group needs WAL flushed. */
+	while (nextidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &ProcGlobal->allProcs[nextidx];
+
+		if (flushupto < member->walFlushGroupLsn)
+			flushupto = member->walFlushGroupLsn;
+		nmembers++;
+
+		nextidx = pg_atomic_read_u32(&member->walFlushGroupNext);
+	}
+
+	/* Got the lock; recheck whether the request is already satisfied */
+	LogwrtResult = XLogCtl->LogwrtResult;
+	if (flushupto > LogwrtResult.Flush)
+	{
+		XLogwrtRqst WriteRqst;
+
+		/*
+		 * Re-check how far we can flush the WAL. It's generally not safe to
+		 * call WaitXLogInsertionsToFinish while holding WALWriteLock, because
+		 * an in-progress insertion might need to also grab WALWriteLock to
+		 * make progress. But we know that all the insertions up to flushupto
+		 * have already finished, because every member waited for them before
+		 * joining the group.  We're only calling it again to allow the flush
+		 * to be moved further forward, not to actually wait for anyone.
+		 */
+		flushupto = WaitXLogInsertionsToFinish(flushupto);
+
+		/* try to write/flush later additions to XLOG as well */
+		WriteRqst.Write = flushupto;
+		WriteRqst.Flush = flushupto;
+
+		XLogWrite(WriteRqst, insertTLI, false);
+
+		PendingWalStats.wal_group_flush++;
+		PendingWalStats.wal_group_members += nmembers;
+	}
+
+	LWLockRelease(WALWriteLock);
+
+	/*
+	 * Now that we've released the lock, go back and wake everybody up.  We
+	 * don't do this under the lock so as to keep lock hold times to a
+	 * minimum.
+	 */
+	while (wakeidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &ProcGlobal->allProcs[wakeidx];
+
+		wakeidx = pg_atomic_read_u32(&member->walFlushGroupNext);
+		pg_atomic_write_u32(&member->walFlushGroupNext, INVALID_PGPROCNO);
+
+		/* ensure all previous writes are visible before follower continues. */
+		pg_write_barrier();
+
+		member->walFlushGroupMember = false;
+
+		if (member != MyProc)
+			PGSemaphoreUnlock(member->sem);
+	}
+}
+
 /*
  * Ensure that all XLOG data through the given position is flushed to disk.
  *
@@ -2509,7 +2795,6 @@ void
 XLogFlush(XLogRecPtr record)
 {
 	XLogRecPtr	WriteRqstPtr;
-	XLogwrtRqst WriteRqst;
 	TimeLineID	insertTLI = XLogCtl->InsertTimeLineID;
 
 	/*
@@ -2550,92 +2835,32 @@ XLogFlush(XLogRecPtr record)
 	/* initialize to given target; may increase below */
 	WriteRqstPtr = record;
 
-	/*
-	 * Now wait until we get the write lock, or someone else does the flush
-	 * for us.
-	 */
-	for (;;)
+	/* read LogwrtResult and update local state */
+	SpinLockAcquire(&XLogCtl->info_lck);
+	if (WriteRqstPtr < XLogCtl->LogwrtRqst.Write)
+		WriteRqstPtr = XLogCtl->LogwrtRqst.Write;
+	LogwrtResult = XLogCtl->LogwrtResult;
+	SpinLockRelease(&XLogCtl->info_lck);
+
+	if (record > LogwrtResult.Flush)
 	{
 		XLogRecPtr	insertpos;
 
-		/* read LogwrtResult and update local state */
-		SpinLockAcquire(&XLogCtl->info_lck);
-		if (WriteRqstPtr < XLogCtl->LogwrtRqst.Write)
-			WriteRqstPtr = XLogCtl->LogwrtRqst.Write;
-		LogwrtResult = XLogCtl->LogwrtResult;
-		SpinLockRelease(&XLogCtl->info_lck);
-
-		/* done already? */
-		if (record <= LogwrtResult.Flush)
-			break;
-
 		/*
-		 * Before actually performing the write, wait for all in-flight
-		 * insertions to the pages we're about to write to finish.
+		 * Before asking for the write, wait for all in-flight insertions to
+		 * the pages we're about to write to finish.  This must be done
+		 * before joining a flush group, because the group leader performs
+		 * the write while holding WALWriteLock, and an in-progress insertion
+		 * might need WALWriteLock to make progress.
 		 */
 		insertpos = WaitXLogInsertionsToFinish(WriteRqstPtr);
 
-		/*
-		 * Try to get the write lock. If we can't get it immediately, wait
-		 * until it's released, and recheck if we still need to do the flush
-		 * or if the backend that held the lock did it for us already. This
-		 * helps to maintain a good rate of group committing when the system
-		 * is bottlenecked by the speed of fsyncing.
-		 */
-		if (!LWLockAcquireOrWait(WALWriteLock, LW_EXCLUSIVE))
-		{
-			/*
-			 * The lock is now free, but we didn't acquire it yet. Before we
-			 * do, loop back to check if someone else flushed the record for
-			 * us already.
-			 */
-			continue;
-		}
+		XLogFlushGroup(insertpos, insertTLI);
 
-		/* Got the lock; recheck whether request is satisfied */
+		/* update local state with what the group leader did for us */
+		SpinLockAcquire(&XLogCtl->info_lck);
 		LogwrtResult = XLogCtl->LogwrtResult;
-		if (record <= LogwrtResult.Flush)
-		{
-			LWLockRelease(WALWriteLock);
-			break;
-		}
-
-		/*
-		 * Sleep before flush! By adding a delay here, we may give further
-		 * backends the opportunity to join the backlog of group commit
-		 * followers; this can significantly improve transaction throughput,
-		 * at the risk of increasing transaction latency.
-		 *
-		 * We do not sleep if enableFsync is not turned on, nor if there are
-		 * fewer than CommitSiblings other backends with active transactions.
-		 */
-		if (CommitDelay > 0 && enableFsync &&
-			MinimumActiveBackends(CommitSiblings))
-		{
-			pg_usleep(CommitDelay);
-
-			/*
-			 * Re-check how far we can now flush the WAL. It's generally not
-			 * safe to call WaitXLogInsertionsToFinish while holding
-			 * WALWriteLock, because an in-progress insertion might need to
-			 * also grab WALWriteLock to make progress. But we know that all
-			 * the insertions up to insertpos have already finished, because
-			 * that's what the earlier WaitXLogInsertionsToFinish() returned.
-			 * We're only calling it again to allow insertpos to be moved
-			 * further forward, not to actually wait for anyone.
-			 */
-			insertpos = WaitXLogInsertionsToFinish(insertpos);
-		}
-
-		/* try to write/flush later additions to XLOG as well */
-		WriteRqst.Write = insertpos;
-		WriteRqst.Flush = insertpos;
-
-		XLogWrite(WriteRqst, insertTLI, false);
-
-		LWLockRelease(WALWriteLock);
-		/* done */
-		break;
+		SpinLockRelease(&XLogCtl->info_lck);
 	}
 
 	END_CRIT_SECTION();
@@ -2923,6 +3148,7 @@ XLogFileInitInternal(XLogSegNo logsegno, TimeLineID logtli,
 	XLogSegNo	max_segno;
 	int			fd;
 	int			save_errno;
+	int			open_flags = O_RDWR | O_CREAT | O_EXCL | PG_BINARY;
 
 	Assert(logtli != 0);
 
@@ -2955,8 +3181,16 @@ XLogFileInitInternal(XLogSegNo logsegno, TimeLineID logtli,
 
 	unlink(tmppath);
 
+	/*
+	 * Bypass the kernel's page cache for the zero-fill if requested.  That
+	 * only works for whole-block writes, so not when we just write the last
+	 * byte of the file.
+	 */
+	if ((io_direct_flags & IO_DIRECT_WAL_INIT) && wal_init_zero)
+		open_flags |= PG_O_DIRECT;
+
 	/* do not use get_sync_bit() here --- want to fsync only at end of fill */
-	fd = BasicOpenFile(tmppath, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	fd = BasicOpenFile(tmppath, open_flags);
 	if (fd < 0)
 		ereport(ERROR,
 				(errcode_for_file_access(),
@@ -3371,7 +3605,7 @@ XLogFileClose(void)
 	 * use the cache to read the WAL segment.
 	 */
 #if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_DONTNEED)
-	if (!XLogIsNeeded())
+	if (!XLogIsNeeded() && (io_direct_flags & IO_DIRECT_WAL) == 0)
 		(void) posix_fadvise(openLogFile, 0, 0, POSIX_FADV_DONTNEED);
 #endif
 
@@ -4364,6 +4598,8 @@ XLOGShmemSize(void)
 
 	/* WAL insertion locks, plus alignment */
 	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	/* prev-link table */
+	size = add_size(size, mul_size(sizeof(XLogPrevLink), NUM_XLOG_PREV_LINKS));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -4462,6 +4698,17 @@ XLOGShmemInit(void)
 		WALInsertLocks[i].l.lastImportantAt = InvalidXLogRecPtr;
 	}
 
+	/* Prev-link table, see XLogPrevLink */
+	XLogCtl->Insert.PrevLinks = (XLogPrevLink *) allocptr;
+	XLogCtl->Insert.PrevLinksMask = NUM_XLOG_PREV_LINKS - 1;
+	allocptr += sizeof(XLogPrevLink) * NUM_XLOG_PREV_LINKS;
+
+	for (i = 0; i < NUM_XLOG_PREV_LINKS; i++)
+	{
+		pg_atomic_init_u64(&XLogCtl->Insert.PrevLinks[i].endpos, 0);
+		XLogCtl->Insert.PrevLinks[i].startpos = 0;
+	}
+
 	/*
 	 * Align the start of the page buffers to a full xlog block size boundary.
 	 * This simplifies some calculations in XLOG insertion. It is also
@@ -4480,7 +4727,7 @@ XLOGShmemInit(void)
 	XLogCtl->InstallXLogFileSegmentActive = false;
 	XLogCtl->WalWriterSleeping = false;
 
-	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
+	pg_atomic_init_u64(&XLogCtl->Insert.CurrBytePos, 0);
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 }
@@ -5451,8 +5698,11 @@ StartupXLOG(void)
 	 * previous incarnation.
 	 */
 	Insert = &XLogCtl->Insert;
-	Insert->PrevBytePos = XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec);
-	Insert->CurrBytePos = XLogRecPtrToBytePos(EndOfLog);
+	pg_atomic_write_u64(&Insert->CurrBytePos, XLogRecPtrToBytePos(EndOfLog));
+
+	/* the first record we insert links back to the last one replayed */
+	XLogPrevLinkPublish(XLogRecPtrToBytePos(EndOfLog),
+						XLogRecPtrToBytePos(endOfRecoveryInfo->lastRec));
 
 	/*
 	 * Tricky point here: lastPage contains the *last* block that the LastRec
@@ -5521,6 +5771,9 @@ StartupXLOG(void)
 	if (standbyState == STANDBY_DISABLED)
 		StartupSUBTRANS(oldestActiveXID);
 
+	/* The CSN log is never maintained during recovery, start it up now */
+	StartupCSNLog(oldestActiveXID);
+
 	/*
 	 * Perform end of recovery actions for any SLRUs that need it.
 	 */
@@ -6368,7 +6621,7 @@ CreateCheckPoint(int flags)
 	 * determine the checkpoint REDO pointer.
 	 */
 	WALInsertLockAcquireExclusive();
-	curInsert = XLogBytePosToRecPtr(Insert->CurrBytePos);
+	curInsert = XLogBytePosToRecPtr(pg_atomic_read_u64(&Insert->CurrBytePos));
 
 	/*
 	 * If this isn't a shutdown or forced checkpoint, and if there has been no
@@ -6679,14 +6932,17 @@ CreateCheckPoint(int flags)
 		PreallocXlogFiles(recptr, checkPoint.ThisTimeLineID);
 
 	/*
-	 * Truncate pg_subtrans if possible.  We can throw away all data before
-	 * the oldest XMIN of any running transaction.  No future transaction will
-	 * attempt to reference any pg_subtrans entry older than that (see Asserts
-	 * in subtrans.c).  During recovery, though, we mustn't do this because
-	 * StartupSUBTRANS hasn't been called yet.
+	 * Truncate pg_subtrans and pg_csn if possible.  We can throw away all
+	 * data before the oldest XMIN of any running transaction.  No future
+	 * transaction will attempt to reference any entry older than that (see
+	 * Asserts in subtrans.c and csnlog.c).  During recovery, though, we
+	 * mustn't do this because StartupSUBTRANS hasn't been called yet.
 	 */
 	if (!RecoveryInProgress())
+	{
 		TruncateSUBTRANS(GetOldestTransactionIdConsideredRunning());
+		TruncateCSNLog(GetOldestTransactionIdConsideredRunning());
+	}
 
 	/* Real work is done; log and update stats. */
 	LogCheckpointEnd(false);
@@ -6858,6 +7114,7 @@ CheckPointGuts(XLogRecPtr checkPointRedo, int flags)
 	CheckPointCLOG();
 	CheckPointCommitTs();
 	CheckPointSUBTRANS();
+	CheckPointCSNLog();
 	CheckPointMultiXact();
 	CheckPointPredicate();
 	CheckPointBuffers(flags);
@@ -7888,27 +8145,21 @@ get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
 
-	/* If fsync is disabled, never open in sync mode */
-	if (!enableFsync)
-		return 0;
-
 	/*
-	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
-	 * O_SYNC and O_DSYNC.  But only if archiving and streaming are disabled,
-	 * otherwise the archive command or walsender process will read the WAL
-	 * soon after writing it, which is guaranteed to cause a physical read if
-	 * we bypassed the kernel cache. We also skip the
-	 * posix_fadvise(POSIX_FADV_DONTNEED) call in XLogFileClose() for the same
-	 * reason.
-	 *
-	 * Never use O_DIRECT in walreceiver process for similar reasons; the WAL
-	 * written by walreceiver is normally read by the startup process soon
-	 * after it's written. Also, walreceiver performs unaligned writes, which
-	 * don't work with O_DIRECT, so it is required for correctness too.
+	 * Use O_DIRECT if requested by io_direct, except in walreceiver process.
+	 * The WAL written by walreceiver is normally read by the startup process
+	 * soon after it's written, which is guaranteed to cause a physical read
+	 * if we bypassed the kernel cache.  Also, walreceiver performs unaligned
+	 * writes, which don't work with O_DIRECT, so it is required for
+	 * correctness too.
 	 */
-	if (!XLogIsNeeded() && !AmWalReceiverProcess())
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
 		o_direct_flag = PG_O_DIRECT;
 
+	/* If fsync is disabled, never open in sync mode */
+	if (!enableFsync)
+		return o_direct_flag;
+
 	switch (method)
 	{
 			/*
@@ -7920,7 +8171,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return o_direct_flag;
 #ifdef O_SYNC
 		case SYNC_METHOD_OPEN:
 			return O_SYNC | o_direct_flag;
@@ -8819,9 +9070,7 @@ GetXLogInsertRecPtr(void)
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	uint64		current_bytepos;
 
-	SpinLockAcquire(&Insert->insertpos_lck);
-	current_bytepos = Insert->CurrBytePos;
-	SpinLockRelease(&Insert->insertpos_lck);
+	current_bytepos = pg_atomic_read_u64(&Insert->CurrBytePos);
 
 	return XLogBytePosToRecPtr(current_bytepos);
 }
@@ -586,6 +586,18 @@ CopyFrom(CopyFromState cstate)
 							RelationGetRelationName(cstate->rel))));
 	}
 
+	/*
+	 * If parallel loading was requested, hand the input over to parallel
+	 * workers if that's safe.  Otherwise, silently load serially.
+	 */
+	if (cstate->opts.nworkers > 0)
+	{
+		int			nworkers = ParallelCopyComputeWorkers(cstate);
+
+		if (nworkers > 0)
+			return ParallelCopyFrom(cstate, nworkers);
+	}
+
 	/*
 	 * If the target file is new-in-transaction, we assume that checking FSM
 	 * for free space is a waste of time.  This could possibly be wrong, but
@@ -1245,6 +1257,13 @@ BeginCopyFrom(ParseState *pstate,
 	/* Generate or convert list of attributes to process */
 	cstate->attnumlist = CopyGetAttnums(tupDesc, cstate->rel, attnamelist);
 
+	/* Remember the column and option lists for parallel workers */
+	if (cstate->opts.nworkers > 0)
+	{
+		cstate->attnamelist = copyObject(attnamelist);
+		cstate->options = copyObject(options);
+	}
+
 	num_phys_attrs = tupDesc->natts;
 
 	/* Convert FORCE_NOT_NULL name list to per-column flags, check validity */
@@ -0,0 +1,706 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyfromparallel.c
+ *		Parallel COPY FROM for text and CSV input
+ *
+ * In a parallel COPY FROM, the leader reads the input and splits it into
+ * lines, exactly as a serial COPY FROM would.  That includes the handling of
+ * the header line, encoding conversion, and newlines embedded in quoted CSV
+ * fields, so every line handed out is a complete row in the database
+ * encoding.  The lines are collected into batches, each starting with the
+ * line number of its first line, and each batch is sent to one of the
+ * parallel workers through a shm_mq.  The workers parse the lines into
+ * fields, run the input functions, evaluate defaults and constraints, and
+ * insert the tuples using the regular CopyFrom() machinery.
+ *
+ * Workers can neither assign a transaction ID nor mark the command ID as
+ * used, so the leader does both before entering parallel mode.  The target
+ * must also be a plain table with no triggers, and all the expressions the
+ * workers evaluate must be parallel safe; ParallelCopyComputeWorkers()
+ * checks for that and we fall back to a serial load otherwise.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copyfromparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "commands/copy.h"
+#include "commands/copyfrom_internal.h"
+#include "commands/progress.h"
+#include "executor/execParallel.h"
+#include "miscadmin.h"
+#include "optimizer/clauses.h"
+#include "parser/parse_node.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "rewrite/rewriteHandler.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
+#include "utils/lsyscache.h"
+#include "utils/partcache.h"
+#include "utils/rel.h"
+
+/*
+ * DSM keys for parallel COPY FROM.  Unlike other parallel execution code,
+ * since we don't need to worry about DSM keys conflicting with plan_node_id
+ * we can use small integers.
+ */
+#define PARALLEL_COPY_KEY_SHARED			1
+#define PARALLEL_COPY_KEY_NODES				2
+#define PARALLEL_COPY_KEY_QUEUES			3
+#define PARALLEL_COPY_KEY_QUERY_TEXT		4
+#define PARALLEL_COPY_KEY_BUFFER_USAGE		5
+#define PARALLEL_COPY_KEY_WAL_USAGE			6
+
+/*
+ * The leader sends the lines in batches of about this many bytes, and each
+ * worker's queue has room for a few batches, so that the workers don't need
+ * to wait for the leader as long as it keeps up.
+ */
+#define PARALLEL_COPY_BATCH_SIZE			65536
+#define PARALLEL_COPY_QUEUE_SIZE			(4 * PARALLEL_COPY_BATCH_SIZE)
+
+/*
+ * Shared information among the leader and the parallel workers.  This is
+ * allocated in the DSM segment.
+ */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target table */
+
+	/* Number of tuples inserted, summed over all the workers */
+	pg_atomic_uint64 processed;
+} ParallelCopyShared;
+
+/*
+ * Leader's state for handing out the input.  Each worker has its own batch
+ * buffer.  A batch that the worker's queue had no room for yet stays
+ * pending, and the leader moves on to the next worker that's ready for more.
+ */
+typedef struct ParallelCopyLeaderState
+{
+	ParallelContext *pcxt;
+	int			nworkers;		/* number of launched workers */
+	shm_mq_handle **mqh;		/* queue to each worker */
+	StringInfoData *batches;	/* batch being filled or sent, per worker */
+	bool	   *pending;		/* batch not yet completely sent? */
+	int			next_worker;	/* where to start looking for a free worker */
+} ParallelCopyLeaderState;
+
+/*
+ * Worker's state for reading the lines sent by the leader.  A batch consists
+ * of the line number of its first line, followed by each line's length and
+ * data.  The lines don't include the line terminators.
+ */
+struct ParallelCopyWorkerState
+{
+	shm_mq_handle *mqh;			/* queue from the leader */
+	char	   *batch;			/* current batch, or NULL */
+	Size		batch_len;		/* length of the current batch */
+	Size		batch_pos;		/* position of the next line in the batch */
+	uint64		lineno;			/* line number of the next line */
+};
+
+static bool ParallelCopyExprsAreSafe(CopyFromState cstate);
+static int	ParallelCopyNextWorker(ParallelCopyLeaderState *pcls);
+static bool ParallelCopySendBatch(ParallelCopyLeaderState *pcls, int worker,
+								  bool nowait);
+static void ParallelCopyWorkerLost(ParallelCopyLeaderState *pcls);
+static int	ParallelCopyNoData(void *outbuf, int minread, int maxread);
+
+/*
+ * Determine the number of parallel workers to use for a COPY FROM that
+ * requested them.  Returns 0 if the COPY cannot be performed in parallel.
+ */
+int
+ParallelCopyComputeWorkers(CopyFromState cstate)
+{
+	Relation	rel = cstate->rel;
+
+	Assert(cstate->opts.nworkers > 0);
+	Assert(!cstate->opts.binary);
+
+	/*
+	 * We don't allow performing a parallel COPY in a standalone backend, or
+	 * when parallel maintenance operations are disabled.
+	 */
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
+
+	/*
+	 * We can't start a parallel operation from within another one, and
+	 * serializable transactions don't support parallel writes.
+	 */
+	if (IsInParallelMode() || IsolationIsSerializable())
+		return 0;
+
+	/*
+	 * Only plain tables are supported.  Workers can't access the leader's
+	 * local buffers, so temporary tables are out too.
+	 */
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		RelationUsesLocalBuffers(rel))
+		return 0;
+
+	/*
+	 * Triggers, including those implementing foreign keys and deferred
+	 * uniqueness checks, would have to run in the workers and may assign new
+	 * command IDs, so they're not supported.
+	 */
+	if (rel->trigdesc != NULL)
+		return 0;
+
+	/*
+	 * COPY FREEZE, and the optimizations for relation storage created in the
+	 * current transaction, depend on relcache state only the leader has.
+	 */
+	if (cstate->opts.freeze ||
+		rel->rd_createSubid != InvalidSubTransactionId ||
+		rel->rd_firstRelfilelocatorSubid != InvalidSubTransactionId)
+		return 0;
+
+	if (!ParallelCopyExprsAreSafe(cstate))
+		return 0;
+
+	return Min(cstate->opts.nworkers, max_parallel_maintenance_workers);
+}
+
+/*
+ * Check that everything the workers have to evaluate to form and insert a
+ * tuple is parallel safe: the input functions, column defaults, generated
+ * columns, check and partition constraints, index expressions and
+ * predicates, and the WHERE clause.
+ */
+static bool
+ParallelCopyExprsAreSafe(CopyFromState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		result = true;
+
+	if (cstate->whereClause &&
+		!expression_is_parallel_safe(cstate->whereClause))
+		return false;
+
+	for (int attnum = 1; attnum <= tupDesc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+
+		if (att->attisdropped)
+			continue;
+
+		/*
+		 * Domain constraints are checked by the input function, so treat
+		 * domains as parallel-restricted, like the planner does.
+		 */
+		if (list_member_int(cstate->attnumlist, attnum) &&
+			(get_typtype(att->atttypid) == TYPTYPE_DOMAIN ||
+			 func_parallel(cstate->in_functions[attnum - 1].fn_oid) != PROPARALLEL_SAFE))
+			return false;
+
+		if (!list_member_int(cstate->attnumlist, attnum) || att->attgenerated)
+		{
+			Node	   *defexpr = build_column_default(rel, attnum);
+
+			if (defexpr && !expression_is_parallel_safe(defexpr))
+				return false;
+		}
+	}
+
+	if (tupDesc->constr)
+	{
+		for (int i = 0; i < tupDesc->constr->num_check; i++)
+		{
+			Node	   *checkexpr = stringToNode(tupDesc->constr->check[i].ccbin);
+
+			if (!expression_is_parallel_safe(checkexpr))
+				return false;
+		}
+	}
+
+	if (rel->rd_rel->relispartition &&
+		!expression_is_parallel_safe((Node *) RelationGetPartitionQual(rel)))
+		return false;
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Oid			indexoid = lfirst_oid(lc);
+		Relation	indexrel;
+
+		/* Same lock mode as ExecOpenIndices() will use in the workers */
+		indexrel = index_open(indexoid, RowExclusiveLock);
+		if (!expression_is_parallel_safe((Node *) RelationGetIndexExpressions(indexrel)) ||
+			!expression_is_parallel_safe((Node *) RelationGetIndexPredicate(indexrel)))
+			result = false;
+		index_close(indexrel, NoLock);
+
+		if (!result)
+			break;
+	}
+	list_free(indexoidlist);
+
+	return result;
+}
+
+/*
+ * Perform a COPY FROM using 'nworkers' parallel workers.
+ *
+ * The leader reads and splits the input while the workers insert the rows.
+ * If no workers can be launched, the leader loads the data on its own.
+ */
+uint64
+ParallelCopyFrom(CopyFromState cstate, int nworkers)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *shared;
+	ParallelCopyLeaderState pcls;
+	char	   *nodes;
+	char	   *sharednodes;
+	char	   *queuespace;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	Size		nodeslen;
+	int			querylen;
+	bool		done = false;
+	ErrorContextCallback errcallback;
+	uint64		processed;
+
+	Assert(nworkers > 0);
+
+	/*
+	 * Workers can't assign a transaction ID, and they may only use the
+	 * current command ID if it has already been marked as used.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyFromMain", nworkers);
+	Assert(pcxt->nworkers > 0);
+
+	/* Estimate size for shared information -- PARALLEL_COPY_KEY_SHARED */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for the range table, WHERE clause, column list and
+	 * options, which the workers need to set up their own COPY state --
+	 * PARALLEL_COPY_KEY_NODES.
+	 */
+	nodes = nodeToString(list_make4(cstate->range_table, cstate->whereClause,
+									cstate->attnamelist, cstate->options));
+	nodeslen = strlen(nodes) + 1;
+	shm_toc_estimate_chunk(&pcxt->estimator, nodeslen);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for the workers' queues -- PARALLEL_COPY_KEY_QUEUES */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for BufferUsage and WalUsage --
+	 * PARALLEL_COPY_KEY_BUFFER_USAGE and PARALLEL_COPY_KEY_WAL_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgBufferUsage or
+	 * pgWalUsage, so do it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_COPY_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* Prepare shared information */
+	shared = (ParallelCopyShared *) shm_toc_allocate(pcxt->toc,
+													 sizeof(ParallelCopyShared));
+	shared->relid = RelationGetRelid(cstate->rel);
+	pg_atomic_init_u64(&shared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, shared);
+
+	/* Store the serialized nodes */
+	sharednodes = (char *) shm_toc_allocate(pcxt->toc, nodeslen);
+	memcpy(sharednodes, nodes, nodeslen);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_NODES, sharednodes);
+	pfree(nodes);
+
+	/* Create the queues, with the leader as the sender */
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_COPY_QUEUE_SIZE,
+										   pcxt->nworkers));
+	for (int i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + (Size) i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, queuespace);
+
+	/*
+	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
+	 * initialize
+	 */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WAL_USAGE, wal_usage);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		sharedquery[querylen] = '\0';
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_COPY_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were launched, load the data ourselves */
+	if (pcxt->nworkers_launched == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+
+		cstate->opts.nworkers = 0;
+		return CopyFrom(cstate);
+	}
+
+	/* Attach to the queues of the workers that were launched */
+	pcls.pcxt = pcxt;
+	pcls.nworkers = pcxt->nworkers_launched;
+	pcls.mqh = palloc(sizeof(shm_mq_handle *) * pcls.nworkers);
+	pcls.batches = palloc(sizeof(StringInfoData) * pcls.nworkers);
+	pcls.pending = palloc0(sizeof(bool) * pcls.nworkers);
+	pcls.next_worker = 0;
+	for (int i = 0; i < pcls.nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = (shm_mq *) (queuespace + (Size) i * PARALLEL_COPY_QUEUE_SIZE);
+		pcls.mqh[i] = shm_mq_attach(mq, pcxt->seg, pcxt->worker[i].bgwhandle);
+		initStringInfo(&pcls.batches[i]);
+	}
+
+	/*
+	 * Set up callback to identify error line number.  Errors reported by the
+	 * workers carry their own context, since the parallel context was
+	 * created before this callback was pushed.
+	 */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	while (!done)
+	{
+		int			worker = ParallelCopyNextWorker(&pcls);
+		StringInfo	batch = &pcls.batches[worker];
+
+		resetStringInfo(batch);
+		while (batch->len < PARALLEL_COPY_BATCH_SIZE)
+		{
+			uint32		len;
+
+			CHECK_FOR_INTERRUPTS();
+
+			if (!NextCopyFromLine(cstate))
+			{
+				done = true;
+				break;
+			}
+
+			if (batch->len == 0)
+				appendBinaryStringInfo(batch, (char *) &cstate->cur_lineno,
+									   sizeof(uint64));
+			len = cstate->line_buf.len;
+			appendBinaryStringInfo(batch, (char *) &len, sizeof(uint32));
+			appendBinaryStringInfo(batch, cstate->line_buf.data, len);
+		}
+
+		if (batch->len > 0)
+			pcls.pending[worker] = !ParallelCopySendBatch(&pcls, worker, true);
+	}
+
+	error_context_stack = errcallback.previous;
+
+	/*
+	 * Finish sending the remaining batches, then detach from the queues to
+	 * tell the workers that there's no more input.
+	 */
+	for (int i = 0; i < pcls.nworkers; i++)
+	{
+		if (pcls.pending[i])
+			(void) ParallelCopySendBatch(&pcls, i, false);
+		shm_mq_detach(pcls.mqh[i]);
+		pcls.mqh[i] = NULL;
+	}
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	for (int i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	processed = pg_atomic_read_u64(&shared->processed);
+	pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, processed);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return processed;
+}
+
+/*
+ * Return a worker whose batch buffer is free to be filled, waiting for one
+ * if all the workers' queues are full.
+ */
+static int
+ParallelCopyNextWorker(ParallelCopyLeaderState *pcls)
+{
+	for (;;)
+	{
+		for (int i = 0; i < pcls->nworkers; i++)
+		{
+			int			worker = (pcls->next_worker + i) % pcls->nworkers;
+
+			if (pcls->pending[worker])
+				pcls->pending[worker] = !ParallelCopySendBatch(pcls, worker,
+															   true);
+
+			if (!pcls->pending[worker])
+			{
+				pcls->next_worker = (worker + 1) % pcls->nworkers;
+				return worker;
+			}
+		}
+
+		/* The workers set our latch as they consume their queues */
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1,
+						 WAIT_EVENT_MQ_SEND);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Send the given worker's batch.  Returns true if the batch was sent
+ * completely.  With 'nowait', the rest of the batch must be sent by calling
+ * this again later, without modifying the batch in between.
+ */
+static bool
+ParallelCopySendBatch(ParallelCopyLeaderState *pcls, int worker, bool nowait)
+{
+	StringInfo	batch = &pcls->batches[worker];
+	shm_mq_result res;
+
+	res = shm_mq_send(pcls->mqh[worker], batch->len, batch->data, nowait,
+					  true);
+	if (res == SHM_MQ_DETACHED)
+		ParallelCopyWorkerLost(pcls);
+
+	return res == SHM_MQ_SUCCESS;
+}
+
+/*
+ * A worker detached from its queue before we were done sending to it, which
+ * means that it exited, most likely because of an error.  Let the other
+ * workers finish so that the worker's error is reported.
+ */
+static void
+ParallelCopyWorkerLost(ParallelCopyLeaderState *pcls)
+{
+	for (int i = 0; i < pcls->nworkers; i++)
+	{
+		if (pcls->mqh[i] != NULL)
+		{
+			shm_mq_detach(pcls->mqh[i]);
+			pcls->mqh[i] = NULL;
+		}
+	}
+
+	/* This rethrows any error the workers reported */
+	WaitForParallelWorkersToFinish(pcls->pcxt);
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INTERNAL_ERROR),
+			 errmsg("parallel COPY worker exited before consuming all input")));
+}
+
+/*
+ * Read the next line of a batch sent by the leader into line_buf.  Returns
+ * false once the leader has sent all the input.
+ */
+bool
+ParallelCopyReadLine(CopyFromState cstate)
+{
+	ParallelCopyWorkerState *pcws = cstate->pcworker;
+	uint32		len;
+
+	if (pcws->batch == NULL || pcws->batch_pos >= pcws->batch_len)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(pcws->mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_DETACHED)
+		{
+			pcws->batch = NULL;
+			return false;
+		}
+		Assert(res == SHM_MQ_SUCCESS);
+		Assert(nbytes > sizeof(uint64));
+
+		pcws->batch = data;
+		pcws->batch_len = nbytes;
+		memcpy(&pcws->lineno, pcws->batch, sizeof(uint64));
+		pcws->batch_pos = sizeof(uint64);
+	}
+
+	memcpy(&len, pcws->batch + pcws->batch_pos, sizeof(uint32));
+	pcws->batch_pos += sizeof(uint32);
+	Assert(pcws->batch_pos + len <= pcws->batch_len);
+
+	resetStringInfo(&cstate->line_buf);
+	appendBinaryStringInfo(&cstate->line_buf, pcws->batch + pcws->batch_pos,
+						   len);
+	pcws->batch_pos += len;
+
+	cstate->cur_lineno = pcws->lineno++;
+	cstate->line_buf_valid = true;
+
+	return true;
+}
+
+/*
+ * Data source callback for the workers' COPY state.  The workers get their
+ * input from the leader's batches, so this is never called.
+ */
+static int
+ParallelCopyNoData(void *outbuf, int minread, int maxread)
+{
+	elog(ERROR, "unexpected read from COPY data source in parallel worker");
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+ParallelCopyFromMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *shared;
+	ParallelCopyWorkerState pcws;
+	char	   *sharedquery;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	List	   *nodes;
+	Relation	rel;
+	ParseState *pstate;
+	CopyFromState cstate;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	uint64		processed;
+
+	shared = (ParallelCopyShared *) shm_toc_lookup(toc, PARALLEL_COPY_KEY_SHARED,
+												   false);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Attach to our queue as the receiver */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 (Size) ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	pcws.mqh = shm_mq_attach(mq, seg, NULL);
+	pcws.batch = NULL;
+	pcws.batch_len = 0;
+	pcws.batch_pos = 0;
+	pcws.lineno = 0;
+
+	/*
+	 * Open table.  The lock mode is the same as the leader process.  It's
+	 * okay because the lock mode does not conflict among the parallel
+	 * workers.
+	 */
+	rel = table_open(shared->relid, RowExclusiveLock);
+
+	/* Set up a COPY state like the leader's */
+	nodes = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_NODES,
+												 false));
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = debug_query_string;
+	pstate->p_rtable = (List *) linitial(nodes);
+
+	cstate = BeginCopyFrom(pstate, rel, (Node *) lsecond(nodes), NULL, false,
+						   ParallelCopyNoData, (List *) lthird(nodes),
+						   (List *) lfourth(nodes));
+
+	/*
+	 * The leader reports progress, has already checked the header line, and
+	 * hands out the input lines.
+	 */
+	pgstat_progress_end_command();
+	cstate->opts.header_line = COPY_HEADER_FALSE;
+	cstate->opts.nworkers = 0;
+	cstate->pcworker = &pcws;
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	processed = CopyFrom(cstate);
+	pg_atomic_fetch_add_u64(&shared->processed, processed);
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	EndCopyFrom(cstate);
+	free_parsestate(pstate);
+	table_close(rel, RowExclusiveLock);
+}
@@ -67,6 +67,8 @@
 #include "utils/guc.h"
 #include "utils/pg_locale.h"
 #include "utils/relmapper.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -1674,6 +1676,13 @@ dropdb(const char *dbname, bool missing_ok, bool force)
 	 */
 	pgstat_drop_database(db_id);
 
+	/*
+	 * And remove its tuples and plans from the shared catalog and plan
+	 * caches, lest a database created later with the same OID finds them.
+	 */
+	SharedCatCacheDropDatabase(db_id);
+	SharedPlanCacheDropDatabase(db_id);
+
 	/*
 	 * Tell checkpointer to forget any pending fsync and unlink requests for
 	 * files in the database; else the fsyncs will fail at next checkpoint, or
@@ -3171,6 +3180,10 @@ dbase_redo(XLogReaderState *record)
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseSyncRequests(xlrec->db_id);
 
+		/* And the shared catalog and plan caches */
+		SharedCatCacheDropDatabase(xlrec->db_id);
+		SharedPlanCacheDropDatabase(xlrec->db_id);
+
 		/* Clean out the xlog relcache too */
 		XLogDropDatabase(xlrec->db_id);
 
@@ -1773,6 +1773,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (((ScanState *) planstate)->ss_RuntimeFilter)
+				show_instrumentation_count("Rows Removed by Runtime Filter", 3,
+										   planstate, es);
 			break;
 		case T_IndexOnlyScan:
 			show_scan_qual(((IndexOnlyScan *) plan)->indexqual,
@@ -1822,6 +1825,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (((ScanState *) planstate)->ss_RuntimeFilter)
+				show_instrumentation_count("Rows Removed by Runtime Filter", 3,
+										   planstate, es);
 			break;
 		case T_Gather:
 			{
@@ -3434,7 +3440,9 @@ show_instrumentation_count(const char *qlabel, int which,
 	if (!es->analyze || !planstate->instrument)
 		return;
 
-	if (which == 2)
+	if (which == 3)
+		nfiltered = planstate->instrument->nfiltered3;
+	else if (which == 2)
 		nfiltered = planstate->instrument->nfiltered2;
 	else
 		nfiltered = planstate->instrument->nfiltered1;
@@ -1883,6 +1883,34 @@ seq_redo(XLogReaderState *record)
 	pfree(localpage);
 }
 
+/*
+ * Would currval() or lastval() return a value in this session?
+ */
+bool
+HaveSequenceState(void)
+{
+	HASH_SEQ_STATUS status;
+	SeqTable	elm;
+
+	if (last_used_seq != NULL)
+		return true;
+	if (seqhashtab == NULL)
+		return false;
+
+	/* setval() makes currval() work without setting last_used_seq */
+	hash_seq_init(&status, seqhashtab);
+	while ((elm = (SeqTable) hash_seq_search(&status)) != NULL)
+	{
+		if (elm->last_valid)
+		{
+			hash_seq_term(&status);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * Flush cached sequence information.
  */
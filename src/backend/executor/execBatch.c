@@ -0,0 +1,387 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Support routines for processing tuples a batch at a time
+ *
+ * In batch mode, a sequential scan fetches up to EXEC_BATCH_SIZE tuples at
+ * once and deforms the columns that its quals and its parent need into
+ * arrays, one per column.  Simple quals are then evaluated over a whole
+ * column at a time, narrowing down a selection vector of the rows that
+ * passed, without going through the expression interpreter for each row.
+ * The qualifying rows are either returned one at a time, like in the
+ * ordinary tuple-at-a-time mode, or consumed as a whole batch by a parent
+ * node that knows how to, currently a plain aggregate.
+ *
+ * The quals that can be evaluated this way are comparisons of a column with
+ * a constant using a strict and leakproof operator, and IS [NOT] NULL tests
+ * of a column.  Leakproof operators cannot fail on their input, so it does
+ * no harm that they are evaluated before any other quals of the scan.  The
+ * other quals are evaluated for each row that passed these, in the usual
+ * way.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "executor/execBatch.h"
+#include "executor/executor.h"
+#include "storage/bufmgr.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+/* A qual clause that is evaluated over a column of a batch */
+typedef struct BatchQualClause
+{
+	AttrNumber	attno;			/* the column that the clause tests */
+	bool		nulltest;		/* IS [NOT] NULL, rather than an operator? */
+	bool		isnull;			/* for a null test, IS NULL? */
+	int			argno;			/* operator argument the column is passed as */
+	FunctionCallInfo fcinfo;	/* operator call, with the constant set */
+} BatchQualClause;
+
+struct BatchQual
+{
+	int			nclauses;
+	BatchQualClause clauses[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/* GUC variable */
+bool		enable_batch_execution = false;
+
+static Var *batch_qual_var(Node *node, Index scanrelid);
+
+
+/*
+ * If node is a plain column of the scan relation, possibly relabeled,
+ * return the Var; else NULL.
+ */
+static Var *
+batch_qual_var(Node *node, Index scanrelid)
+{
+	Var		   *var;
+
+	if (node && IsA(node, RelabelType))
+		node = (Node *) ((RelabelType *) node)->arg;
+
+	if (node == NULL || !IsA(node, Var))
+		return NULL;
+
+	var = (Var *) node;
+	if (var->varno != scanrelid || var->varattno <= 0 ||
+		var->varlevelsup != 0)
+		return NULL;
+
+	return var;
+}
+
+/*
+ * ExecInitBatchQual
+ *
+ * Prepare the clauses of an implicitly-ANDed scan qual that can be evaluated
+ * a batch at a time.  The other clauses are returned in *residual, and the
+ * attribute numbers of the columns tested are added to *attnos.  Returns
+ * NULL if there are no such clauses.
+ */
+BatchQual *
+ExecInitBatchQual(List *qual, Index scanrelid, List **residual,
+				  Bitmapset **attnos)
+{
+	BatchQual  *bqual;
+	ListCell   *lc;
+
+	bqual = palloc(offsetof(BatchQual, clauses) +
+				   list_length(qual) * sizeof(BatchQualClause));
+	bqual->nclauses = 0;
+	*residual = NIL;
+
+	foreach(lc, qual)
+	{
+		Node	   *clause = (Node *) lfirst(lc);
+		BatchQualClause *bclause = &bqual->clauses[bqual->nclauses];
+
+		if (IsA(clause, NullTest))
+		{
+			NullTest   *ntest = (NullTest *) clause;
+			Var		   *var = batch_qual_var((Node *) ntest->arg, scanrelid);
+
+			/* a row-wise test looks at the fields of a composite value */
+			if (var != NULL && !ntest->argisrow)
+			{
+				bclause->attno = var->varattno;
+				bclause->nulltest = true;
+				bclause->isnull = (ntest->nulltesttype == IS_NULL);
+				bclause->argno = 0;
+				bclause->fcinfo = NULL;
+				*attnos = bms_add_member(*attnos, var->varattno);
+				bqual->nclauses++;
+				continue;
+			}
+		}
+		else if (IsA(clause, OpExpr))
+		{
+			OpExpr	   *opexpr = (OpExpr *) clause;
+			Var		   *var = NULL;
+			Const	   *con = NULL;
+			int			argno = 0;
+
+			if (list_length(opexpr->args) == 2 &&
+				opexpr->opresulttype == BOOLOID && !opexpr->opretset)
+			{
+				Node	   *larg = (Node *) linitial(opexpr->args);
+				Node	   *rarg = (Node *) lsecond(opexpr->args);
+
+				if ((var = batch_qual_var(larg, scanrelid)) != NULL &&
+					IsA(rarg, Const))
+				{
+					con = (Const *) rarg;
+					argno = 0;
+				}
+				else if ((var = batch_qual_var(rarg, scanrelid)) != NULL &&
+						 IsA(larg, Const))
+				{
+					con = (Const *) larg;
+					argno = 1;
+				}
+			}
+
+			if (con != NULL && !con->constisnull &&
+				func_strict(opexpr->opfuncid) &&
+				get_func_leakproof(opexpr->opfuncid))
+			{
+				FmgrInfo   *flinfo = palloc0(sizeof(FmgrInfo));
+
+				bclause->attno = var->varattno;
+				bclause->nulltest = false;
+				bclause->isnull = false;
+				bclause->argno = argno;
+				bclause->fcinfo = palloc0(SizeForFunctionCallInfo(2));
+
+				fmgr_info(opexpr->opfuncid, flinfo);
+				fmgr_info_set_expr((Node *) opexpr, flinfo);
+				InitFunctionCallInfoData(*bclause->fcinfo, flinfo, 2,
+										 opexpr->inputcollid, NULL, NULL);
+				bclause->fcinfo->args[1 - argno].value = con->constvalue;
+				bclause->fcinfo->args[1 - argno].isnull = false;
+
+				*attnos = bms_add_member(*attnos, var->varattno);
+				bqual->nclauses++;
+				continue;
+			}
+		}
+
+		*residual = lappend(*residual, clause);
+	}
+
+	if (bqual->nclauses == 0)
+	{
+		pfree(bqual);
+		return NULL;
+	}
+
+	return bqual;
+}
+
+/*
+ * ExecBatchQual
+ *
+ * Remove the rows that fail the quals from the batch's selection.  Any
+ * memory needed is allocated in the current memory context.
+ */
+void
+ExecBatchQual(BatchQual *bqual, TupleBatch *batch)
+{
+	int		   *selection = batch->selection;
+	int			i;
+
+	for (i = 0; i < bqual->nclauses && batch->nselected > 0; i++)
+	{
+		BatchQualClause *bclause = &bqual->clauses[i];
+		Datum	   *values = batch->values[bclause->attno - 1];
+		bool	   *isnull = batch->isnull[bclause->attno - 1];
+		int			nselected = 0;
+		int			k;
+
+		if (bclause->nulltest)
+		{
+			for (k = 0; k < batch->nselected; k++)
+			{
+				int			row = selection[k];
+
+				if (isnull[row] == bclause->isnull)
+					selection[nselected++] = row;
+			}
+		}
+		else
+		{
+			FunctionCallInfo fcinfo = bclause->fcinfo;
+			int			argno = bclause->argno;
+
+			for (k = 0; k < batch->nselected; k++)
+			{
+				int			row = selection[k];
+				Datum		result;
+
+				/* the operator is strict */
+				if (isnull[row])
+					continue;
+
+				fcinfo->args[argno].value = values[row];
+				fcinfo->args[argno].isnull = false;
+				fcinfo->isnull = false;
+				result = FunctionCallInvoke(fcinfo);
+
+				if (!fcinfo->isnull && DatumGetBool(result))
+					selection[nselected++] = row;
+			}
+		}
+
+		batch->nselected = nselected;
+	}
+}
+
+/*
+ * ExecInitTupleBatch
+ *
+ * Create a batch for tuples of the given relation, deforming the columns
+ * in attnos.  The slots are registered in the executor's tuple table.
+ */
+TupleBatch *
+ExecInitTupleBatch(EState *estate, Relation rel, Bitmapset *attnos)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	const TupleTableSlotOps *tts_ops = table_slot_callbacks(rel);
+	TupleBatch *batch;
+	int			attno;
+	int			i;
+
+	batch = palloc0(sizeof(TupleBatch));
+	batch->maxrows = 1;
+	batch->ncols = bms_num_members(attnos);
+	batch->attnos = palloc(Max(batch->ncols, 1) * sizeof(AttrNumber));
+	batch->values = palloc0(tupdesc->natts * sizeof(Datum *));
+	batch->isnull = palloc0(tupdesc->natts * sizeof(bool *));
+
+	i = 0;
+	attno = -1;
+	while ((attno = bms_next_member(attnos, attno)) >= 0)
+	{
+		Assert(attno > 0 && attno <= tupdesc->natts);
+		batch->attnos[i++] = attno;
+		batch->maxattno = attno;
+		batch->values[attno - 1] = palloc(EXEC_BATCH_SIZE * sizeof(Datum));
+		batch->isnull[attno - 1] = palloc(EXEC_BATCH_SIZE * sizeof(bool));
+	}
+
+	batch->selection = palloc(EXEC_BATCH_SIZE * sizeof(int));
+	batch->slots = palloc(EXEC_BATCH_SIZE * sizeof(TupleTableSlot *));
+	for (i = 0; i < EXEC_BATCH_SIZE; i++)
+		batch->slots[i] = ExecAllocTableSlot(&estate->es_tupleTable,
+											 tupdesc, tts_ops);
+
+	return batch;
+}
+
+/*
+ * ExecFillTupleBatch
+ *
+ * Fetch the next batch of tuples from a forward scan and deform their
+ * columns.  All rows are initially selected.  Returns the number of rows,
+ * which is zero at the end of the scan.  The batch size ramps up from one
+ * row to EXEC_BATCH_SIZE.
+ *
+ * Tuples in buffer slots keep their buffer pinned until the batch is cleared.
+ * The batch ends early when its tuples span EXEC_BATCH_MAX_BUFFERS buffers;
+ * the tuple that would have pinned one more buffer is copied into its slot,
+ * which releases the pin, and becomes the batch's last row.
+ */
+int
+ExecFillTupleBatch(TupleBatch *batch, TableScanDesc scandesc)
+{
+	Buffer		lastbuffer = InvalidBuffer;
+	int			nbuffers = 0;
+	int			nrows = 0;
+	int			row;
+	int			i;
+
+	/* don't call the scan again once it's done, it would start over */
+	while (!batch->done && nrows < batch->maxrows)
+	{
+		TupleTableSlot *slot = batch->slots[nrows];
+
+		if (!table_scan_getnextslot(scandesc, ForwardScanDirection, slot))
+		{
+			batch->done = true;
+			break;
+		}
+		nrows++;
+
+		/* a sequential scan returns the tuples of a page consecutively */
+		if (TTS_IS_BUFFERTUPLE(slot))
+		{
+			Buffer		buffer = ((BufferHeapTupleTableSlot *) slot)->buffer;
+
+			if (BufferIsValid(buffer) && buffer != lastbuffer)
+			{
+				lastbuffer = buffer;
+				if (++nbuffers > EXEC_BATCH_MAX_BUFFERS)
+				{
+					ExecMaterializeSlot(slot);
+					break;
+				}
+			}
+		}
+	}
+
+	for (row = 0; row < nrows; row++)
+	{
+		TupleTableSlot *slot = batch->slots[row];
+
+		if (batch->maxattno > 0)
+			slot_getsomeattrs(slot, batch->maxattno);
+
+		for (i = 0; i < batch->ncols; i++)
+		{
+			int			att = batch->attnos[i] - 1;
+
+			batch->values[att][row] = slot->tts_values[att];
+			batch->isnull[att][row] = slot->tts_isnull[att];
+		}
+
+		batch->selection[row] = row;
+	}
+
+	batch->nrows = nrows;
+	batch->nselected = nrows;
+	batch->next = 0;
+	batch->maxrows = Min(batch->maxrows * 2, EXEC_BATCH_SIZE);
+
+	return nrows;
+}
+
+/*
+ * ExecClearTupleBatch
+ *
+ * Release the tuples of a batch and prepare it for a new scan.
+ */
+void
+ExecClearTupleBatch(TupleBatch *batch)
+{
+	int			row;
+
+	for (row = 0; row < batch->nrows; row++)
+		ExecClearTuple(batch->slots[row]);
+
+	batch->nrows = 0;
+	batch->nselected = 0;
+	batch->next = 0;
+	batch->done = false;
+	batch->maxrows = 1;
+}
@@ -19,6 +19,7 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
 
@@ -162,6 +163,7 @@ ExecScan(ScanState *node,
 	ExprContext *econtext;
 	ExprState  *qual;
 	ProjectionInfo *projInfo;
+	HashRuntimeFilter *filter;
 
 	/*
 	 * Fetch data from node
@@ -169,14 +171,16 @@ ExecScan(ScanState *node,
 	qual = node->ps.qual;
 	projInfo = node->ps.ps_ProjInfo;
 	econtext = node->ps.ps_ExprContext;
+	filter = node->ss_RuntimeFilter;
 
 	/* interrupt checks are in ExecScanFetch */
 
 	/*
-	 * If we have neither a qual to check nor a projection to do, just skip
-	 * all the overhead and return the raw scan tuple.
+	 * If we have neither a qual to check nor a projection to do, nor a
+	 * runtime filter to apply, just skip all the overhead and return the raw
+	 * scan tuple.
 	 */
-	if (!qual && !projInfo)
+	if (!qual && !projInfo && !filter)
 	{
 		ResetExprContext(econtext);
 		return ExecScanFetch(node, accessMtd, recheckMtd);
@@ -217,6 +221,19 @@ ExecScan(ScanState *node,
 		 */
 		econtext->ecxt_scantuple = slot;
 
+		/*
+		 * discard the tuple if the hash join above us has no partner for it;
+		 * that may have to wait until the tuple passed the qual, see
+		 * ExecHashJoinInitRuntimeFilter
+		 */
+		if (filter && filter->before_quals &&
+			!ExecHashRuntimeFilterTest(filter, econtext))
+		{
+			InstrCountFiltered3(node, 1);
+			ResetExprContext(econtext);
+			continue;
+		}
+
 		/*
 		 * check that the current tuple satisfies the qual-clause
 		 *
@@ -226,6 +243,14 @@ ExecScan(ScanState *node,
 		 */
 		if (qual == NULL || ExecQual(qual, econtext))
 		{
+			if (filter && !filter->before_quals &&
+				!ExecHashRuntimeFilterTest(filter, econtext))
+			{
+				InstrCountFiltered3(node, 1);
+				ResetExprContext(econtext);
+				continue;
+			}
+
 			/*
 			 * Found a satisfactory scan tuple.
 			 */
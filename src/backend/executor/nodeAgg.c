@@ -226,6 +226,22 @@
  *	  imposing a limit on the number of groups separately from the amount of
  *	  memory consumed.
  *
+ *	  Parallel Finalize HashAggregate
+ *
+ *	  When the planner expects a very large number of groups, it may put a
+ *	  parallel-aware AGG_HASHED node doing the final combine step below the
+ *	  Gather node, rather than above it.  In that case every participant
+ *	  hashes the partial aggregate states it reads from its outer plan and
+ *	  writes each of them to one of a fixed number of shared tuplestores,
+ *	  chosen by the high bits of the hash value.  Once all participants have
+ *	  finished writing, they claim whole partitions one at a time and
+ *	  process each one as if it were a batch of spilled tuples.  Since all
+ *	  partial states for a given group end up in the same partition, the
+ *	  groups emitted by different participants are disjoint, and the final
+ *	  step is spread across all participants instead of being done by the
+ *	  leader alone.  Partitions that don't fit in hash_mem are spilled to
+ *	  the participant's private tapes as usual, using the remaining hash bits.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -255,9 +271,11 @@
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
+#include "executor/execBatch.h"
 #include "executor/execExpr.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
+#include "executor/nodeSeqscan.h"
 #include "lib/hyperloglog.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -273,8 +291,10 @@
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/sharedtuplestore.h"
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
+#include "utils/wait_event.h"
 
 /*
  * Control how many partitions are created when spilling HashAgg to
@@ -306,6 +326,16 @@
 #define HASHAGG_READ_BUFFER_SIZE BLCKSZ
 #define HASHAGG_WRITE_BUFFER_SIZE BLCKSZ
 
+/*
+ * In a Parallel Finalize HashAggregate, the number of shared partitions is a
+ * small multiple of the number of participants, so that participants that
+ * finish a partition early can pick up another one.  Each participant keeps
+ * a write buffer for every partition while partitioning its input, hence
+ * the upper limit.
+ */
+#define HASHAGG_PARALLEL_PARTITIONS_PER_PARTICIPANT 4
+#define HASHAGG_PARALLEL_MAX_PARTITIONS 64
+
 /*
  * HyperLogLog is used for estimating the cardinality of the spilled tuples in
  * a given partition. 5 bits corresponds to a size of about 32 bytes and a
@@ -353,6 +383,8 @@ typedef struct HashAggBatch
 	int			setno;			/* grouping set */
 	int			used_bits;		/* number of bits of hash already used */
 	LogicalTape *input_tape;	/* input partition tape */
+	SharedTuplestoreAccessor *input_sts;	/* input shared partition, if
+											 * parallel */
 	int64		input_tuples;	/* number of tuples in this batch */
 	double		input_card;		/* estimated group cardinality */
 } HashAggBatch;
@@ -375,6 +407,7 @@ static void advance_transition_function(AggState *aggstate,
 										AggStatePerTrans pertrans,
 										AggStatePerGroup pergroupstate);
 static void advance_aggregates(AggState *aggstate);
+static void advance_aggregates_batch(AggState *aggstate, TupleBatch *batch);
 static void process_ordered_aggregate_single(AggState *aggstate,
 											 AggStatePerTrans pertrans,
 											 AggStatePerGroup pergroupstate);
@@ -418,7 +451,9 @@ static void initialize_hash_entry(AggState *aggstate,
 								  TupleHashEntry entry);
 static void lookup_hash_entries(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_plain_batch(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static void agg_fill_hash_partitions(AggState *aggstate);
 static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
@@ -432,6 +467,12 @@ static HashAggBatch *hashagg_batch_new(LogicalTape *input_tape, int setno,
 									   int64 input_tuples, double input_card,
 									   int used_bits);
 static MinimalTuple hashagg_batch_read(HashAggBatch *batch, uint32 *hashp);
+static bool hashagg_claim_partition(AggState *aggstate);
+static void hashagg_initialize_partitions(AggState *aggstate,
+										  ParallelAggState *pstate,
+										  int participant);
+static void agg_dsm_sizes(AggState *node, int nworkers,
+						  Size *pstate_size, Size *info_size);
 static void hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *lts,
 							   int used_bits, double input_groups,
 							   double hashentrysize);
@@ -439,6 +480,7 @@ static Size hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 								TupleTableSlot *slot, uint32 hash);
 static void hashagg_spill_finish(AggState *aggstate, HashAggSpill *spill,
 								 int setno);
+static void agg_use_batches(AggState *aggstate, Agg *node);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 									  AggState *aggstate, EState *estate,
@@ -826,6 +868,54 @@ advance_aggregates(AggState *aggstate)
 							  &dummynull);
 }
 
+/*
+ * Advance each aggregate transition state for the selected rows of a batch,
+ * in batch mode.  Each transition function is run over the whole batch in
+ * turn, reading its input straight from the batch's column arrays.  Only
+ * plain aggregation without grouping sets uses batch mode, so there's just
+ * the one grouping set.
+ *
+ * When called, CurrentMemoryContext should be the per-query context.
+ */
+static void
+advance_aggregates_batch(AggState *aggstate, TupleBatch *batch)
+{
+	AggStatePerGroup pergroup = aggstate->pergroups[0];
+	int			transno;
+
+	select_current_set(aggstate, 0, false);
+
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		AggStatePerGroup pergroupstate = &pergroup[transno];
+		FunctionCallInfo fcinfo = pertrans->transfn_fcinfo;
+		AttrNumber	attno = aggstate->batch_attnos[transno];
+		int			k;
+
+		if (attno == 0)
+		{
+			/* no inputs, as in count(*) */
+			for (k = 0; k < batch->nselected; k++)
+				advance_transition_function(aggstate, pertrans, pergroupstate);
+		}
+		else
+		{
+			Datum	   *values = batch->values[attno - 1];
+			bool	   *isnull = batch->isnull[attno - 1];
+
+			for (k = 0; k < batch->nselected; k++)
+			{
+				int			row = batch->selection[k];
+
+				fcinfo->args[1].value = values[row];
+				fcinfo->args[1].isnull = isnull[row];
+				advance_transition_function(aggstate, pertrans, pergroupstate);
+			}
+		}
+	}
+}
+
 /*
  * Run the transition function for a DISTINCT or ORDER BY aggregate
  * with only one input.  This is called after we have completed
@@ -1842,6 +1932,28 @@ hash_agg_set_limits(double hashentrysize, double input_groups, int used_bits,
 		*ngroups_limit = 1;
 }
 
+/*
+ * Choose the number of shared partitions for a Parallel Finalize
+ * HashAggregate with the given number of participants.  Always a power of
+ * two, so that a partition can be chosen with the high bits of the hash.
+ *
+ * This is also used by the planner, for costing.
+ */
+int
+hash_agg_parallel_num_partitions(int nparticipants)
+{
+	uint32		npartitions;
+
+	npartitions = pg_nextpower2_32(Max(nparticipants, 1) *
+								   HASHAGG_PARALLEL_PARTITIONS_PER_PARTICIPANT);
+	if (npartitions < HASHAGG_MIN_PARTITIONS)
+		npartitions = HASHAGG_MIN_PARTITIONS;
+	if (npartitions > HASHAGG_PARALLEL_MAX_PARTITIONS)
+		npartitions = HASHAGG_PARALLEL_MAX_PARTITIONS;
+
+	return (int) npartitions;
+}
+
 /*
  * hash_agg_check_limits
  *
@@ -2172,6 +2284,12 @@ ExecAgg(PlanState *pstate)
 				result = agg_retrieve_hash_table(node);
 				break;
 			case AGG_PLAIN:
+				if (node->batch_attnos)
+				{
+					result = agg_retrieve_plain_batch(node);
+					break;
+				}
+				/* FALLTHROUGH */
 			case AGG_SORTED:
 				result = agg_retrieve_direct(node);
 				break;
@@ -2530,6 +2648,45 @@ agg_retrieve_direct(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * ExecAgg for plain aggregation in batch mode: aggregate the outer plan's
+ * batches and return the single result row, if it passes the qual.
+ */
+static TupleTableSlot *
+agg_retrieve_plain_batch(AggState *aggstate)
+{
+	SeqScanState *outerstate = castNode(SeqScanState, outerPlanState(aggstate));
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	TupleBatch *batch;
+
+	/* see agg_retrieve_direct */
+	ReScanExprContext(econtext);
+	ReScanExprContext(aggstate->aggcontexts[0]);
+	aggstate->projected_set = 0;
+
+	initialize_aggregates(aggstate, aggstate->pergroups, 1);
+
+	while ((batch = ExecSeqScanNextBatch(outerstate)) != NULL)
+	{
+		advance_aggregates_batch(aggstate, batch);
+
+		/* Reset per-input-tuple context after each batch */
+		ResetExprContext(tmpcontext);
+	}
+
+	aggstate->agg_done = true;
+
+	/* there can't be any references to non-aggregated input columns */
+	econtext->ecxt_outertuple = aggstate->ss.ss_ScanTupleSlot;
+
+	select_current_set(aggstate, 0, false);
+
+	finalize_aggregates(aggstate, aggstate->peragg, aggstate->pergroups[0]);
+
+	return project_aggregates(aggstate);
+}
+
 /*
  * ExecAgg for hashed case: read input and build hash table
  */
@@ -2539,6 +2696,12 @@ agg_fill_hash_table(AggState *aggstate)
 	TupleTableSlot *outerslot;
 	ExprContext *tmpcontext = aggstate->tmpcontext;
 
+	if (aggstate->parallel_state != NULL)
+	{
+		agg_fill_hash_partitions(aggstate);
+		return;
+	}
+
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
 	 * exhaust the outer plan.
@@ -2575,6 +2738,80 @@ agg_fill_hash_table(AggState *aggstate)
 						   &aggstate->perhash[0].hashiter);
 }
 
+/*
+ * ExecAgg for Parallel Finalize HashAggregate: route each outer-plan tuple to
+ * the shared partition selected by the high bits of its hash value, instead
+ * of building a hash table.  Once all participants are done, the hash table
+ * is filled one claimed partition at a time by agg_refill_hash_table().
+ */
+static void
+agg_fill_hash_partitions(AggState *aggstate)
+{
+	ParallelAggState *pstate = aggstate->parallel_state;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+
+	/* grouping sets are never planned this way */
+	Assert(aggstate->num_hashes == 1);
+
+	/*
+	 * If partitioning is already finished when we attach, the participants
+	 * that did it have consumed all of our parallel-aware outer plan's input,
+	 * so we have nothing to add.  As with a late arrival at a Parallel Hash
+	 * build, we go straight on to finalizing partitions.
+	 */
+	if (BarrierAttach(&pstate->barrier) == PAGG_PHASE_PARTITIONING)
+	{
+		int			shift = 32 - aggstate->partition_bits;
+
+		for (;;)
+		{
+			TupleTableSlot *outerslot;
+			MinimalTuple tuple;
+			bool		shouldFree;
+			uint32		hash;
+			int			partno;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+				break;
+
+			prepare_hash_slot(perhash, outerslot, perhash->hashslot);
+			hash = TupleHashTableHash(perhash->hashtable, perhash->hashslot);
+			partno = hash >> shift;
+
+			tuple = ExecFetchSlotMinimalTuple(outerslot, &shouldFree);
+			sts_puttuple(aggstate->partition_accessors[partno], &hash, tuple);
+			if (shouldFree)
+				pfree(tuple);
+
+			ResetExprContext(tmpcontext);
+		}
+
+		for (int i = 0; i < pstate->npartitions; i++)
+			sts_end_write(aggstate->partition_accessors[i]);
+
+		/* wait for everyone else to finish writing */
+		BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_HASH_AGG_PARTITION);
+	}
+	Assert(BarrierPhase(&pstate->barrier) == PAGG_PHASE_FINALIZING);
+
+	/*
+	 * All of our input is on disk now, much as if we had spilled all of it
+	 * in the first pass.  Any partition that doesn't fit in hash_mem will be
+	 * spilled further to our own tape set.
+	 */
+	aggstate->hash_ever_spilled = true;
+	aggstate->hash_tapeset = LogicalTapeSetCreate(true, NULL, -1);
+	hash_agg_update_metrics(aggstate, false, 0);
+
+	aggstate->table_filled = true;
+	/* Initialize to walk the (empty) first hash table */
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
+						   &aggstate->perhash[0].hashiter);
+}
+
 /*
  * If any data was spilled during hash aggregation, reset the hash table and
  * reprocess one batch of spilled data. After reprocessing a batch, the hash
@@ -2597,7 +2834,15 @@ agg_refill_hash_table(AggState *aggstate)
 	bool		spill_initialized = false;
 
 	if (aggstate->hash_batches == NIL)
-		return false;
+	{
+		/*
+		 * In a Parallel Finalize HashAggregate, move on to the next shared
+		 * partition that no other participant has claimed yet.
+		 */
+		if (aggstate->parallel_state == NULL ||
+			!hashagg_claim_partition(aggstate))
+			return false;
+	}
 
 	/* hash_batches is a stack, with the top item at the end of the list */
 	batch = llast(aggstate->hash_batches);
@@ -2665,7 +2910,8 @@ agg_refill_hash_table(AggState *aggstate)
 		if (tuple == NULL)
 			break;
 
-		ExecStoreMinimalTuple(tuple, spillslot, true);
+		/* tuples read from a shared partition live in the read buffer */
+		ExecStoreMinimalTuple(tuple, spillslot, batch->input_sts == NULL);
 		aggstate->tmpcontext->ecxt_outertuple = spillslot;
 
 		prepare_hash_slot(perhash,
@@ -2706,7 +2952,10 @@ agg_refill_hash_table(AggState *aggstate)
 		ResetExprContext(aggstate->tmpcontext);
 	}
 
-	LogicalTapeClose(batch->input_tape);
+	if (batch->input_sts != NULL)
+		sts_end_parallel_scan(batch->input_sts);
+	else
+		LogicalTapeClose(batch->input_tape);
 
 	/* change back to phase 0 */
 	aggstate->current_phase = 0;
@@ -3012,6 +3261,14 @@ hashagg_batch_read(HashAggBatch *batch, uint32 *hashp)
 	size_t		nread;
 	uint32		hash;
 
+	if (batch->input_sts != NULL)
+	{
+		tuple = sts_parallel_scan_next(batch->input_sts, &hash);
+		if (tuple != NULL && hashp != NULL)
+			*hashp = hash;
+		return tuple;
+	}
+
 	nread = LogicalTapeRead(tape, &hash, sizeof(uint32));
 	if (nread == 0)
 		return NULL;
@@ -3045,6 +3302,48 @@ hashagg_batch_read(HashAggBatch *batch, uint32 *hashp)
 	return tuple;
 }
 
+/*
+ * hashagg_claim_partition
+ *
+ * Claim the next unprocessed shared partition of a Parallel Finalize
+ * HashAggregate, and push a batch for it.  Returns false if all partitions
+ * have been claimed.
+ */
+static bool
+hashagg_claim_partition(AggState *aggstate)
+{
+	ParallelAggState *pstate = aggstate->parallel_state;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	SharedTuplestoreAccessor *accessor;
+	HashAggBatch *batch;
+	uint32		partno;
+
+	partno = pg_atomic_fetch_add_u32(&pstate->next_partition, 1);
+	if (partno >= pstate->npartitions)
+	{
+		/* nothing left to do, and nobody waits for us */
+		BarrierDetach(&pstate->barrier);
+		return false;
+	}
+
+	accessor = aggstate->partition_accessors[partno];
+	sts_begin_parallel_scan(accessor);
+
+	/*
+	 * We don't know how many tuples the partition holds, but only the group
+	 * estimate matters.  If it spills, the remaining hash bits are used.
+	 */
+	batch = hashagg_batch_new(NULL, 0, 0,
+							  perhash->aggnode->numGroups / pstate->npartitions,
+							  aggstate->partition_bits);
+	batch->input_sts = accessor;
+
+	aggstate->hash_batches = lappend(aggstate->hash_batches, batch);
+	aggstate->hash_batches_used++;
+
+	return true;
+}
+
 /*
  * hashagg_finish_initial_spills
  *
@@ -4017,9 +4316,76 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		phase->evaltrans_cache[0][0] = phase->evaltrans;
 	}
 
+	if (enable_batch_execution)
+		agg_use_batches(aggstate, node);
+
 	return aggstate;
 }
 
+/*
+ * Switch a plain aggregate to batch mode if possible, see
+ * advance_aggregates_batch().  That requires the input to come straight from
+ * a sequential scan that can produce batches, and each transition function
+ * to take at most one argument, which must be a plain column of the scanned
+ * relation.
+ */
+static void
+agg_use_batches(AggState *aggstate, Agg *node)
+{
+	PlanState  *outerstate = outerPlanState(aggstate);
+	Plan	   *outerplan = outerPlan(node);
+	AttrNumber *attnos;
+	Bitmapset  *scan_attnos = NULL;
+	int			transno;
+
+	if (node->aggstrategy != AGG_PLAIN || node->groupingSets != NIL ||
+		node->chain != NIL || DO_AGGSPLIT_COMBINE(node->aggsplit) ||
+		aggstate->numtrans == 0 || !IsA(outerstate, SeqScanState))
+		return;
+
+	attnos = palloc0(aggstate->numtrans * sizeof(AttrNumber));
+
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		Aggref	   *aggref = pertrans->aggref;
+		TargetEntry *tle;
+		TargetEntry *scantle;
+		Var		   *var;
+
+		if (aggref->aggkind != AGGKIND_NORMAL || aggref->aggfilter != NULL ||
+			pertrans->numSortCols > 0 || pertrans->numDistinctCols > 0 ||
+			pertrans->numInputs != pertrans->numTransInputs ||
+			pertrans->numInputs > 1)
+			return;
+
+		if (pertrans->numInputs == 0)
+			continue;
+
+		/* the argument must be a column of the outer plan ... */
+		tle = linitial_node(TargetEntry, aggref->args);
+		var = (Var *) tle->expr;
+		if (!IsA(var, Var) || var->varno != OUTER_VAR || var->varattno <= 0 ||
+			var->varattno > list_length(outerplan->targetlist))
+			return;
+
+		/* ... which the scan fetches from the relation as it is */
+		scantle = list_nth_node(TargetEntry, outerplan->targetlist,
+								var->varattno - 1);
+		var = (Var *) scantle->expr;
+		if (!IsA(var, Var) ||
+			var->varno != ((SeqScan *) outerplan)->scan.scanrelid ||
+			var->varattno <= 0 || var->varlevelsup != 0)
+			return;
+
+		attnos[transno] = var->varattno;
+		scan_attnos = bms_add_member(scan_attnos, var->varattno);
+	}
+
+	if (ExecSeqScanUseBatches((SeqScanState *) outerstate, scan_attnos))
+		aggstate->batch_attnos = attnos;
+}
+
 /*
  * Build the state needed to calculate a state value for an aggregate.
  *
@@ -4679,63 +5045,195 @@ AggRegisterCallback(FunctionCallInfo fcinfo,
  * ----------------------------------------------------------------
  */
 
+/*
+ * Set up our accessors for the shared partitions of a Parallel Finalize
+ * HashAggregate.  The leader (participant 0) creates the partitions; workers
+ * attach to them.
+ */
+static void
+hashagg_initialize_partitions(AggState *aggstate, ParallelAggState *pstate,
+							  int participant)
+{
+	aggstate->parallel_state = pstate;
+	aggstate->partition_bits = my_log2(pstate->npartitions);
+	aggstate->partition_accessors =
+		palloc(sizeof(SharedTuplestoreAccessor *) * pstate->npartitions);
+
+	for (int i = 0; i < pstate->npartitions; i++)
+	{
+		SharedTuplestore *sts = ParallelAggPartition(pstate, i);
+
+		if (participant == 0)
+		{
+			char		name[MAXPGPATH];
+
+			snprintf(name, sizeof(name), "p%d", i);
+			aggstate->partition_accessors[i] =
+				sts_initialize(sts, pstate->nparticipants, participant,
+							   sizeof(uint32),
+							   SHARED_TUPLESTORE_SINGLE_PASS,
+							   &pstate->fileset, name);
+		}
+		else
+			aggstate->partition_accessors[i] =
+				sts_attach(sts, participant, &pstate->fileset);
+	}
+}
+
+/*
+ * Compute the space needed in the DSM segment for a parallel-aware
+ * aggregate's shared partitions, and for its instrumentation.  Both live in
+ * one chunk, keyed by the plan node ID.
+ */
+static void
+agg_dsm_sizes(AggState *node, int nworkers,
+			  Size *pstate_size, Size *info_size)
+{
+	*pstate_size = 0;
+	*info_size = 0;
+
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		int			nparticipants = nworkers + 1;
+
+		*pstate_size =
+			MAXALIGN(ParallelAggStateSize(nparticipants,
+										  hash_agg_parallel_num_partitions(nparticipants)));
+	}
+
+	if (node->ss.ps.instrument)
+		*info_size = add_size(offsetof(SharedAggInfo, sinstrument),
+							  mul_size(nworkers,
+									   sizeof(AggregateInstrumentation)));
+}
+
  /* ----------------------------------------------------------------
   *		ExecAggEstimate
   *
-  *		Estimate space required to propagate aggregate statistics.
+  *		Estimate space required for shared partitions and to propagate
+  *		aggregate statistics.
   * ----------------------------------------------------------------
   */
 void
 ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 {
-	Size		size;
+	Size		pstate_size;
+	Size		info_size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if no workers */
+	if (pcxt->nworkers == 0)
 		return;
 
-	size = mul_size(pcxt->nworkers, sizeof(AggregateInstrumentation));
-	size = add_size(size, offsetof(SharedAggInfo, sinstrument));
-	shm_toc_estimate_chunk(&pcxt->estimator, size);
+	agg_dsm_sizes(node, pcxt->nworkers, &pstate_size, &info_size);
+	if (pstate_size + info_size == 0)
+		return;
+
+	shm_toc_estimate_chunk(&pcxt->estimator, add_size(pstate_size, info_size));
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 }
 
 /* ----------------------------------------------------------------
  *		ExecAggInitializeDSM
  *
- *		Initialize DSM space for aggregate statistics.
+ *		Initialize DSM space for shared partitions and aggregate statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 {
-	Size		size;
+	Size		pstate_size;
+	Size		info_size;
+	char	   *ptr;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/*
+	 * Don't need this if no workers.  In particular, if we failed to create
+	 * a real DSM segment no workers will be launched, and a parallel-aware
+	 * aggregate simply runs as a regular one in the leader.
+	 */
+	if (pcxt->nworkers == 0 || pcxt->seg == NULL)
 		return;
 
-	size = offsetof(SharedAggInfo, sinstrument)
-		+ pcxt->nworkers * sizeof(AggregateInstrumentation);
-	node->shared_info = shm_toc_allocate(pcxt->toc, size);
-	/* ensure any unfilled slots will contain zeroes */
-	memset(node->shared_info, 0, size);
-	node->shared_info->num_workers = pcxt->nworkers;
-	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
-				   node->shared_info);
+	agg_dsm_sizes(node, pcxt->nworkers, &pstate_size, &info_size);
+	if (pstate_size + info_size == 0)
+		return;
+
+	ptr = shm_toc_allocate(pcxt->toc, pstate_size + info_size);
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, ptr);
+
+	if (pstate_size > 0)
+	{
+		ParallelAggState *pstate = (ParallelAggState *) ptr;
+
+		BarrierInit(&pstate->barrier, 0);
+		pg_atomic_init_u32(&pstate->next_partition, 0);
+		pstate->nparticipants = pcxt->nworkers + 1;
+		pstate->npartitions =
+			hash_agg_parallel_num_partitions(pstate->nparticipants);
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+
+		hashagg_initialize_partitions(node, pstate, 0);
+	}
+
+	if (info_size > 0)
+	{
+		node->shared_info = (SharedAggInfo *) (ptr + pstate_size);
+		/* ensure any unfilled slots will contain zeroes */
+		memset(node->shared_info, 0, info_size);
+		node->shared_info->num_workers = pcxt->nworkers;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAggReInitializeDSM
+ *
+ *		Reset shared partitions before a rescan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	ParallelAggState *pstate = node->parallel_state;
+
+	if (pstate == NULL)
+		return;
+
+	/* Clear any partition files left over from the last scan. */
+	SharedFileSetDeleteAll(&pstate->fileset);
+
+	/* Go back to PAGG_PHASE_PARTITIONING with fresh partitions. */
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->next_partition, 0);
+	hashagg_initialize_partitions(node, pstate, 0);
 }
 
 /* ----------------------------------------------------------------
  *		ExecAggInitializeWorker
  *
- *		Attach worker to DSM space for aggregate statistics.
+ *		Attach worker to DSM space for shared partitions and aggregate
+ *		statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt)
 {
-	node->shared_info =
-		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	char	   *ptr;
+
+	ptr = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	if (ptr == NULL)
+		return;
+
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelAggState *pstate = (ParallelAggState *) ptr;
+
+		SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+		hashagg_initialize_partitions(node, pstate, ParallelWorkerNumber + 1);
+		ptr += MAXALIGN(ParallelAggStateSize(pstate->nparticipants,
+											 pstate->npartitions));
+	}
+
+	if (node->ss.ps.instrument)
+		node->shared_info = (SharedAggInfo *) ptr;
 }
 
 /* ----------------------------------------------------------------
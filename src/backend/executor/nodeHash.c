@@ -34,6 +34,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
@@ -56,6 +57,11 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 									int bucketNumber);
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
+/* GUC variable */
+bool		enable_hashjoin_prefetch = false;
+
+static bool ExecScanHashBucketCompact(HashJoinState *hjstate,
+									  ExprContext *econtext);
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
 												size_t size,
@@ -144,6 +150,7 @@ MultiExecPrivateHash(HashState *node)
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 	uint32		hashvalue;
+	bloom_filter *bloom = NULL;
 
 	/*
 	 * get state info from node
@@ -157,6 +164,47 @@ MultiExecPrivateHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+	/*
+	 * If the hash join pushed a runtime filter down into its outer side,
+	 * build the Bloom filter along with the hash table.
+	 */
+	if (node->runtime_filter)
+	{
+		HashRuntimeFilter *filter = node->runtime_filter;
+
+		ExecHashRuntimeFilterReset(node);
+
+		if (filter->bloom == NULL)
+		{
+			MemoryContext oldcontext;
+			double		inner_rows = Max(node->ps.plan->plan_rows, 1.0);
+			Size		bytes;
+
+			/*
+			 * The hash table has sized its buckets for the expected number of
+			 * inner tuples.  Aim for two bytes per bucket, as bloom_create()
+			 * does per element, but take no more than an eighth of the hash
+			 * table's memory.
+			 */
+			bytes = Min((Size) hashtable->nbuckets * 2,
+						hashtable->spaceAllowed / 8);
+			filter->bloom_size = pg_prevpower2_size_t(Max(bytes, 1));
+
+			oldcontext = MemoryContextSwitchTo(node->ps.state->es_query_cxt);
+			filter->bloom = bloom_create_sized((int64) inner_rows,
+											   filter->bloom_size, 0);
+			MemoryContextSwitchTo(oldcontext);
+		}
+		else
+			bloom_reset(filter->bloom);
+
+		/* the filter's memory counts against the hash table's budget */
+		if (hashtable->spaceAllowed > filter->bloom_size)
+			hashtable->spaceAllowed -= filter->bloom_size;
+
+		bloom = filter->bloom;
+	}
+
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
 	 * hash table (or temp files).
@@ -174,6 +222,10 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (bloom)
+				bloom_add_element(bloom, (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -201,6 +253,17 @@ MultiExecPrivateHash(HashState *node)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	ExecHashTableCompact(hashtable);
+
+	/*
+	 * Activate the runtime filter, unless so many bits are set, because the
+	 * inner side turned out much larger than estimated, that it would
+	 * hardly filter anything.
+	 */
+	if (bloom)
+		node->runtime_filter->active =
+			(bloom_prop_bits_set(bloom) <= RUNTIME_FILTER_MAX_BITS_SET);
 }
 
 /* ----------------------------------------------------------------
@@ -486,6 +549,9 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->log2_nbuckets = log2_nbuckets;
 	hashtable->log2_nbuckets_optimal = log2_nbuckets;
 	hashtable->buckets.unshared = NULL;
+	hashtable->compact_starts = NULL;
+	hashtable->compact_hashvalues = NULL;
+	hashtable->compact_tuples = NULL;
 	hashtable->keepNulls = keepNulls;
 	hashtable->skewEnabled = false;
 	hashtable->skewBucket = NULL;
@@ -1619,6 +1685,9 @@ ExecHashTableInsert(HashJoinTable hashtable,
 	int			bucketno;
 	int			batchno;
 
+	/* the compact arrays are built only once the table is complete */
+	Assert(hashtable->compact_starts == NULL);
+
 	ExecHashGetBucketAndBatch(hashtable, hashvalue,
 							  &bucketno, &batchno);
 
@@ -1963,6 +2032,10 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	 * If the tuple hashed to a skew bucket then scan the skew bucket
 	 * otherwise scan the standard hashtable bucket.
 	 */
+	if (hashtable->compact_starts != NULL &&
+		hjstate->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
+		return ExecScanHashBucketCompact(hjstate, econtext);
+
 	if (hashTuple != NULL)
 		hashTuple = hashTuple->next.unshared;
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
@@ -1998,6 +2071,60 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	return false;
 }
 
+/*
+ * ExecScanHashBucketCompact
+ *		scan a hash bucket using the table's compact arrays
+ *
+ * Same as ExecScanHashBucket, except that the candidates' hash values are
+ * compared in a dense array, and only the tuples whose hash value matches
+ * are visited.  The position of the tuple last returned is remembered in
+ * hjstate->hj_CurTupleIndex.
+ */
+static bool
+ExecScanHashBucketCompact(HashJoinState *hjstate,
+						  ExprContext *econtext)
+{
+	ExprState  *hjclauses = hjstate->hashclauses;
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	uint32		hashvalue = hjstate->hj_CurHashValue;
+	uint32	   *hashvalues = hashtable->compact_hashvalues;
+	uint32		i;
+	uint32		end;
+
+	if (hjstate->hj_CurTuple != NULL)
+		i = hjstate->hj_CurTupleIndex + 1;
+	else
+		i = hashtable->compact_starts[hjstate->hj_CurBucketNo];
+	end = hashtable->compact_starts[hjstate->hj_CurBucketNo + 1];
+
+	for (; i < end; i++)
+	{
+		if (hashvalues[i] == hashvalue)
+		{
+			HashJoinTuple hashTuple = hashtable->compact_tuples[i];
+			TupleTableSlot *inntuple;
+
+			/* insert hashtable's tuple into exec slot so ExecQual sees it */
+			inntuple = ExecStoreMinimalTuple(HJTUPLE_MINTUPLE(hashTuple),
+											 hjstate->hj_HashTupleSlot,
+											 false);	/* do not pfree */
+			econtext->ecxt_innertuple = inntuple;
+
+			if (ExecQualAndReset(hjclauses, econtext))
+			{
+				hjstate->hj_CurTuple = hashTuple;
+				hjstate->hj_CurTupleIndex = i;
+				return true;
+			}
+		}
+	}
+
+	/*
+	 * no match
+	 */
+	return false;
+}
+
 /*
  * ExecParallelScanHashBucket
  *		scan a hash bucket for matches to the current outer tuple
@@ -2170,6 +2297,9 @@ ExecHashTableReset(HashJoinTable hashtable)
 	/* Reallocate and reinitialize the hash bucket headers. */
 	hashtable->buckets.unshared = (HashJoinTuple *)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
+	hashtable->compact_starts = NULL;
+	hashtable->compact_hashvalues = NULL;
+	hashtable->compact_tuples = NULL;
 
 	hashtable->spaceUsed = 0;
 
@@ -2179,6 +2309,87 @@ ExecHashTableReset(HashJoinTable hashtable)
 	hashtable->chunks = NULL;
 }
 
+/*
+ * ExecHashTableCompact
+ *
+ *		build the compact arrays of a complete in-memory hash table
+ *
+ * The hash values of all the tuples in the main (non-skew) buckets are
+ * copied into one dense array, grouped by bucket number, along with an
+ * array of pointers to the tuples and the starting position of each bucket.
+ * Probing then compares a bucket's hash values in a few adjacent cache lines
+ * instead of chasing the list links from tuple to tuple all over the table,
+ * and the outer side knows where to prefetch for tuples it is about to
+ * probe with.  The bucket lists are left as they are, for the scans for
+ * unmatched tuples.
+ *
+ * Nothing is done unless enable_hashjoin_prefetch is on, or if the arrays
+ * would not fit into the table's memory budget.
+ */
+void
+ExecHashTableCompact(HashJoinTable hashtable)
+{
+	MemoryContext oldcxt;
+	HashJoinTuple *buckets = hashtable->buckets.unshared;
+	int			nbuckets = hashtable->nbuckets;
+	uint32	   *starts;
+	uint32	   *hashvalues;
+	HashJoinTuple *tuples;
+	Size		ntuples = 0;
+	Size		space;
+	uint32		n;
+	int			i;
+
+	if (!enable_hashjoin_prefetch || hashtable->parallel_state != NULL)
+		return;
+
+	for (i = 0; i < nbuckets; i++)
+	{
+		HashJoinTuple hashTuple;
+
+		for (hashTuple = buckets[i]; hashTuple != NULL;
+			 hashTuple = hashTuple->next.unshared)
+			ntuples++;
+	}
+
+	space = (nbuckets + 1) * sizeof(uint32) +
+		ntuples * (sizeof(uint32) + sizeof(HashJoinTuple));
+	if (ntuples == 0 || ntuples >= PG_UINT32_MAX ||
+		ntuples > MaxAllocSize / sizeof(HashJoinTuple) ||
+		hashtable->spaceUsed + space > hashtable->spaceAllowed)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(hashtable->batchCxt);
+	starts = (uint32 *) palloc((nbuckets + 1) * sizeof(uint32));
+	hashvalues = (uint32 *) palloc(ntuples * sizeof(uint32));
+	tuples = (HashJoinTuple *) palloc(ntuples * sizeof(HashJoinTuple));
+	MemoryContextSwitchTo(oldcxt);
+
+	n = 0;
+	for (i = 0; i < nbuckets; i++)
+	{
+		HashJoinTuple hashTuple;
+
+		starts[i] = n;
+		for (hashTuple = buckets[i]; hashTuple != NULL;
+			 hashTuple = hashTuple->next.unshared)
+		{
+			hashvalues[n] = hashTuple->hashvalue;
+			tuples[n] = hashTuple;
+			n++;
+		}
+	}
+	starts[nbuckets] = n;
+
+	hashtable->compact_starts = starts;
+	hashtable->compact_hashvalues = hashvalues;
+	hashtable->compact_tuples = tuples;
+
+	hashtable->spaceUsed += space;
+	if (hashtable->spaceUsed > hashtable->spacePeak)
+		hashtable->spacePeak = hashtable->spaceUsed;
+}
+
 /*
  * ExecHashTableResetMatchFlags
  *		Clear all the HeapTupleHeaderHasMatch flags in the table
@@ -2222,6 +2433,76 @@ ExecReScanHash(HashState *node)
 		ExecReScan(outerPlan);
 }
 
+/*
+ * ExecHashRuntimeFilterReset
+ *
+ *		Deactivate the node's runtime filter, because the hash table it
+ *		was built for is going away.  The Bloom filter's memory is kept, to
+ *		be reused when the hash table is rebuilt.
+ */
+void
+ExecHashRuntimeFilterReset(HashState *node)
+{
+	if (node->runtime_filter)
+		node->runtime_filter->active = false;
+}
+
+/*
+ * ExecHashRuntimeFilterTest
+ *
+ *		Check whether the scan tuple in econtext may have a join partner,
+ *		by computing the hash value that the hash join will compute for it
+ *		(see ExecHashGetHashValue) and looking it up in the runtime filter.
+ *		Returns true if the filter isn't active.
+ */
+bool
+ExecHashRuntimeFilterTest(HashRuntimeFilter *filter, ExprContext *econtext)
+{
+	TupleTableSlot *slot = econtext->ecxt_scantuple;
+	uint32		hashkey = 0;
+	MemoryContext oldContext;
+	int			i;
+
+	if (!filter->active)
+		return true;
+
+	slot_getsomeattrs(slot, filter->maxattno);
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < filter->nkeys; i++)
+	{
+		int			att = filter->attnos[i] - 1;
+
+		/* combine successive hashkeys by rotating */
+		hashkey = pg_rotate_left32(hashkey, 1);
+
+		if (slot->tts_isnull[att])
+		{
+			/* the join never scans its outer side for unmatched tuples */
+			if (filter->hashStrict[i])
+			{
+				MemoryContextSwitchTo(oldContext);
+				return false;	/* cannot match */
+			}
+		}
+		else
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&filter->hashfunctions[i],
+													filter->collations[i],
+													slot->tts_values[att]));
+			hashkey ^= hkey;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return !bloom_lacks_element(filter->bloom, (unsigned char *) &hashkey,
+								sizeof(hashkey));
+}
+
 
 /*
  * ExecHashBuildSkewHash
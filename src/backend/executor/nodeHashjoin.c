@@ -114,6 +114,7 @@
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/sharedtuplestore.h"
 
@@ -136,6 +137,9 @@
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
+static TupleTableSlot *ExecHashJoinOuterGetTuplePrefetch(PlanState *outerNode,
+														 HashJoinState *hjstate,
+														 uint32 *hashvalue);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 														 HashJoinState *hjstate,
 														 uint32 *hashvalue);
@@ -146,6 +150,11 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
 static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
 static void ExecParallelHashJoinPartitionOuter(HashJoinState *node);
+static void ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate,
+										  HashJoin *node);
+
+/* GUC variable */
+bool		enable_hashjoin_runtime_filter = false;
 
 
 /* ----------------------------------------------------------------
@@ -742,6 +751,34 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_CurBucketNo = 0;
 	hjstate->hj_CurSkewBucketNo = INVALID_SKEW_BUCKET_NO;
 	hjstate->hj_CurTuple = NULL;
+	hjstate->hj_CurTupleIndex = 0;
+
+	/*
+	 * If the hash table is going to be compacted, prepare to read ahead in
+	 * the outer plan, see ExecHashJoinOuterGetTuplePrefetch().  That's not
+	 * done for Parallel Hash, whose table isn't compacted.
+	 */
+	hjstate->hj_PrefetchSlots = NULL;
+	hjstate->hj_PrefetchHashValues = NULL;
+	if (enable_hashjoin_prefetch && !hashNode->plan.parallel_aware)
+	{
+		int			i;
+
+		/*
+		 * The slots are handed to the join's expressions as the outer tuple,
+		 * which were compiled for the outer plan's slot type.
+		 */
+		hjstate->hj_PrefetchSlots = (TupleTableSlot **)
+			palloc(HJ_PREFETCH_DISTANCE * sizeof(TupleTableSlot *));
+		for (i = 0; i < HJ_PREFETCH_DISTANCE; i++)
+			hjstate->hj_PrefetchSlots[i] =
+				ExecInitExtraTupleSlot(estate, outerDesc, ops);
+		hjstate->hj_PrefetchHashValues = (uint32 *)
+			palloc(HJ_PREFETCH_DISTANCE * sizeof(uint32));
+	}
+	hjstate->hj_PrefetchHead = 0;
+	hjstate->hj_PrefetchCount = 0;
+	hjstate->hj_PrefetchDone = false;
 
 	hjstate->hj_OuterHashKeys = ExecInitExprList(node->hashkeys,
 												 (PlanState *) hjstate);
@@ -752,9 +789,112 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+	if (enable_hashjoin_runtime_filter)
+		ExecHashJoinInitRuntimeFilter(hjstate, node);
+
 	return hjstate;
 }
 
+/*
+ * ExecHashJoinInitRuntimeFilter
+ *
+ *		Push a runtime filter down into the scan on our outer side, if
+ *		possible.  The Hash node builds the filter along with the hash
+ *		table, and the scan then discards tuples whose hash value the inner
+ *		side doesn't have, before they reach us.  That's only allowed if we
+ *		don't need unmatched outer tuples, and the scan must be able to
+ *		compute the hash value itself, so each outer hash key has to be a
+ *		plain column of the scanned relation.
+ *
+ *		The scan has to call the hash functions on tuples that its quals
+ *		may reject, such as row-level security quals.  So unless they are
+ *		leakproof, the filter only applies to tuples that passed the quals.
+ *
+ *		A Parallel Hash builds its hash table in cooperation with other
+ *		backends, so it doesn't see all inner tuples; no filter then.
+ */
+static void
+ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate, HashJoin *node)
+{
+	PlanState  *outerstate = outerPlanState(hjstate);
+	HashState  *hashstate = castNode(HashState, innerPlanState(hjstate));
+	Plan	   *outerplan = outerstate->plan;
+	Index		scanrelid;
+	HashRuntimeFilter *filter;
+	int			nkeys = list_length(node->hashkeys);
+	ListCell   *lk,
+			   *lo,
+			   *lc;
+	int			i;
+
+	if (HJ_FILL_OUTER(hjstate) ||
+		hashstate->ps.plan->parallel_aware ||
+		hjstate->js.ps.state->es_epq_active != NULL)
+		return;
+
+	if (!IsA(outerstate, SeqScanState) && !IsA(outerstate, IndexScanState))
+		return;
+	scanrelid = ((Scan *) outerplan)->scanrelid;
+
+	filter = palloc0(sizeof(HashRuntimeFilter));
+	filter->nkeys = nkeys;
+	filter->attnos = palloc(nkeys * sizeof(AttrNumber));
+	filter->hashfunctions = palloc(nkeys * sizeof(FmgrInfo));
+	filter->collations = palloc(nkeys * sizeof(Oid));
+	filter->hashStrict = palloc(nkeys * sizeof(bool));
+	filter->before_quals = true;
+
+	i = 0;
+	forthree(lk, node->hashkeys, lo, node->hashoperators,
+			 lc, node->hashcollations)
+	{
+		Node	   *key = (Node *) lfirst(lk);
+		Oid			hashop = lfirst_oid(lo);
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+		TargetEntry *tle;
+		Var		   *var;
+
+		/* a binary-compatible relabeling doesn't change the hash value */
+		if (IsA(key, RelabelType))
+			key = (Node *) ((RelabelType *) key)->arg;
+
+		/* the key must be a column of the outer plan ... */
+		if (!IsA(key, Var) || ((Var *) key)->varno != OUTER_VAR ||
+			((Var *) key)->varattno <= 0 ||
+			((Var *) key)->varattno > list_length(outerplan->targetlist))
+			return;
+
+		/* ... which the scan fetches from the relation as it is */
+		tle = list_nth_node(TargetEntry, outerplan->targetlist,
+							((Var *) key)->varattno - 1);
+		var = (Var *) tle->expr;
+		if (!IsA(var, Var) || var->varno != scanrelid ||
+			var->varattno <= 0 || var->varlevelsup != 0)
+			return;
+
+		if (!get_op_hash_functions(hashop, &left_hashfn, &right_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 hashop);
+
+		filter->attnos[i] = var->varattno;
+		filter->maxattno = Max(filter->maxattno, var->varattno);
+		fmgr_info(left_hashfn, &filter->hashfunctions[i]);
+		if (!get_func_leakproof(left_hashfn))
+			filter->before_quals = false;
+		filter->collations[i] = lfirst_oid(lc);
+		filter->hashStrict[i] = op_strict(hashop);
+		i++;
+	}
+
+	/* with no quals, it makes no difference */
+	if (outerplan->qual == NIL)
+		filter->before_quals = true;
+
+	((ScanState *) outerstate)->ss_RuntimeFilter = filter;
+	hashstate->runtime_filter = filter;
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndHashJoin
  *
@@ -813,7 +953,13 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
-	if (curbatch == 0)			/* if it is the first pass */
+	if (curbatch == 0 && hjstate->hj_PrefetchSlots != NULL &&
+		hashtable->compact_starts != NULL)
+	{
+		return ExecHashJoinOuterGetTuplePrefetch(outerNode, hjstate,
+												 hashvalue);
+	}
+	else if (curbatch == 0)		/* if it is the first pass */
 	{
 		/*
 		 * Check to see if first outer tuple was already fetched by
@@ -875,6 +1021,108 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinOuterGetTuple variant for the first pass over a compact hash
+ * table.
+ *
+ * Probing a hash table much larger than the CPU caches mostly waits for
+ * memory.  To hide that latency, we read up to HJ_PREFETCH_DISTANCE tuples
+ * ahead in the outer plan, keeping copies of them and their hash values in
+ * a ring buffer.  When a tuple enters the ring, we prefetch its bucket's
+ * starting position in the compact table, and halfway through the ring,
+ * once that has arrived, the bucket's hash values.  By the time the tuple
+ * is returned, its probe should find everything in cache.
+ *
+ * The returned slot stays valid until the next call.
+ */
+static TupleTableSlot *
+ExecHashJoinOuterGetTuplePrefetch(PlanState *outerNode,
+								  HashJoinState *hjstate,
+								  uint32 *hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+	uint32	   *hashvalues = hjstate->hj_PrefetchHashValues;
+	int			bucketno;
+	int			batchno;
+	int			head;
+
+	/* Top up the ring, until it's full or the outer plan is exhausted */
+	while (!hjstate->hj_PrefetchDone &&
+		   hjstate->hj_PrefetchCount < HJ_PREFETCH_DISTANCE)
+	{
+		TupleTableSlot *slot;
+		uint32		newhashvalue;
+		int			pos;
+
+		/*
+		 * Check to see if first outer tuple was already fetched by
+		 * ExecHashJoin() and not used yet.
+		 */
+		slot = hjstate->hj_FirstOuterTupleSlot;
+		if (!TupIsNull(slot))
+			hjstate->hj_FirstOuterTupleSlot = NULL;
+		else
+			slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			hjstate->hj_PrefetchDone = true;
+			break;
+		}
+
+		/*
+		 * Discard tuples that couldn't match because of a NULL, as in
+		 * ExecHashJoinOuterGetTuple().
+		 */
+		econtext->ecxt_outertuple = slot;
+		if (!ExecHashGetHashValue(hashtable, econtext,
+								  hjstate->hj_OuterHashKeys,
+								  true, /* outer tuple */
+								  HJ_FILL_OUTER(hjstate),
+								  &newhashvalue))
+			continue;
+
+		/* remember outer relation is not empty for possible rescan */
+		hjstate->hj_OuterNotEmpty = true;
+
+		/* the outer plan may overwrite its slot, so keep a copy */
+		pos = (hjstate->hj_PrefetchHead + hjstate->hj_PrefetchCount) %
+			HJ_PREFETCH_DISTANCE;
+		ExecCopySlot(hjstate->hj_PrefetchSlots[pos], slot);
+		hashvalues[pos] = newhashvalue;
+		hjstate->hj_PrefetchCount++;
+
+		ExecHashGetBucketAndBatch(hashtable, newhashvalue,
+								  &bucketno, &batchno);
+		if (batchno == hashtable->curbatch)
+			hj_prefetch(&hashtable->compact_starts[bucketno]);
+	}
+
+	if (hjstate->hj_PrefetchCount == 0)
+		return NULL;
+
+	head = hjstate->hj_PrefetchHead;
+
+	/* Prefetch the hash values for the tuple halfway through the ring */
+	if (hjstate->hj_PrefetchCount > HJ_PREFETCH_DISTANCE / 2)
+	{
+		int			pos = (head + HJ_PREFETCH_DISTANCE / 2) % HJ_PREFETCH_DISTANCE;
+
+		ExecHashGetBucketAndBatch(hashtable, hashvalues[pos],
+								  &bucketno, &batchno);
+		if (batchno == hashtable->curbatch)
+			hj_prefetch(&hashtable->compact_hashvalues[hashtable->compact_starts[bucketno]]);
+	}
+
+	/* Return the oldest tuple; its slot is not reused until the next call */
+	*hashvalue = hashvalues[head];
+	hjstate->hj_PrefetchHead = (head + 1) % HJ_PREFETCH_DISTANCE;
+	hjstate->hj_PrefetchCount--;
+
+	return hjstate->hj_PrefetchSlots[head];
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -1057,6 +1305,8 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 			ExecHashTableInsert(hashtable, slot, hashvalue);
 		}
 
+		ExecHashTableCompact(hashtable);
+
 		/*
 		 * after we build the hash table, the inner batch file is no longer
 		 * needed
@@ -1349,6 +1599,9 @@ ExecReScanHashJoin(HashJoinState *node)
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
 
+			/* the outer scan may run before the hash table is rebuilt */
+			ExecHashRuntimeFilterReset(hashNode);
+
 			/*
 			 * if chgParam of subnode is not null then plan will be re-scanned
 			 * by first ExecProcNode.
@@ -1363,10 +1616,16 @@ ExecReScanHashJoin(HashJoinState *node)
 	node->hj_CurBucketNo = 0;
 	node->hj_CurSkewBucketNo = INVALID_SKEW_BUCKET_NO;
 	node->hj_CurTuple = NULL;
+	node->hj_CurTupleIndex = 0;
 
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
 
+	/* Forget the outer tuples read ahead */
+	node->hj_PrefetchHead = 0;
+	node->hj_PrefetchCount = 0;
+	node->hj_PrefetchDone = false;
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
@@ -19,6 +19,8 @@
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
+ *		ExecSeqScanUseBatches	switches the scan to batch mode
+ *		ExecSeqScanNextBatch	retrieve next batch of qualifying tuples
  *
  *		ExecSeqScanEstimate		estimates DSM space needed for parallel scan
  *		ExecSeqScanInitializeDSM initialize DSM for parallel scan
@@ -29,11 +31,15 @@
 
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "executor/execBatch.h"
 #include "executor/execdebug.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static TupleBatch *SeqNextBatch(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -82,6 +88,111 @@ SeqNext(SeqScanState *node)
 	return NULL;
 }
 
+/* ----------------------------------------------------------------
+ *		SeqNextBatch
+ *
+ *		Fetch batches of tuples until one has a row that passes the
+ *		quals.  Returns NULL at the end of the scan.
+ * ----------------------------------------------------------------
+ */
+static TupleBatch *
+SeqNextBatch(SeqScanState *node)
+{
+	TableScanDesc scandesc;
+	EState	   *estate;
+	ExprContext *econtext;
+	HashRuntimeFilter *filter = node->ss.ss_RuntimeFilter;
+	TupleBatch *batch;
+
+	scandesc = node->ss.ss_currentScanDesc;
+	estate = node->ss.ps.state;
+	econtext = node->ss.ps.ps_ExprContext;
+
+	Assert(ScanDirectionIsForward(estate->es_direction));
+
+	if (scandesc == NULL)
+	{
+		/* as in SeqNext */
+		scandesc = table_beginscan(node->ss.ss_currentRelation,
+								   estate->es_snapshot,
+								   0, NULL);
+		node->ss.ss_currentScanDesc = scandesc;
+	}
+
+	if (node->batch == NULL)
+	{
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		node->batch = ExecInitTupleBatch(estate, node->ss.ss_currentRelation,
+										 node->batch_attnos);
+		MemoryContextSwitchTo(oldcontext);
+	}
+	batch = node->batch;
+
+	for (;;)
+	{
+		int			nremoved = 0;
+
+		CHECK_FOR_INTERRUPTS();
+
+		ResetExprContext(econtext);
+
+		if (ExecFillTupleBatch(batch, scandesc) == 0)
+			return NULL;
+
+		if (node->batchqual)
+		{
+			MemoryContext oldcontext;
+
+			oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+			ExecBatchQual(node->batchqual, batch);
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		if (node->batch_residual || filter)
+		{
+			int			nselected = 0;
+			int			k;
+
+			for (k = 0; k < batch->nselected; k++)
+			{
+				int			row = batch->selection[k];
+
+				/*
+				 * The batch quals use leakproof operators only, but the
+				 * residual quals may have to run before the runtime filter,
+				 * see ExecHashJoinInitRuntimeFilter.
+				 */
+				econtext->ecxt_scantuple = batch->slots[row];
+				if (filter && filter->before_quals &&
+					!ExecHashRuntimeFilterTest(filter, econtext))
+				{
+					InstrCountFiltered3(node, 1);
+					nremoved++;
+					continue;
+				}
+				if (!ExecQual(node->batch_residual, econtext))
+					continue;
+				if (filter && !filter->before_quals &&
+					!ExecHashRuntimeFilterTest(filter, econtext))
+				{
+					InstrCountFiltered3(node, 1);
+					nremoved++;
+					continue;
+				}
+				batch->selection[nselected++] = row;
+			}
+			batch->nselected = nselected;
+		}
+
+		InstrCountFiltered1(node, batch->nrows - batch->nselected - nremoved);
+
+		if (batch->nselected > 0)
+			return batch;
+	}
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -114,6 +225,55 @@ ExecSeqScan(PlanState *pstate)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Like ExecSeqScan, but fetches and filters tuples a batch at a
+ *		time, returning the qualifying ones one by one.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecSeqScanBatch(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	ProjectionInfo *projInfo = node->ss.ps.ps_ProjInfo;
+	TupleBatch *batch = node->batch;
+	TupleTableSlot *slot;
+
+	ResetExprContext(econtext);
+
+	if (batch == NULL || batch->next >= batch->nselected)
+	{
+		if (batch != NULL && batch->done)
+			batch = NULL;
+		else
+			batch = SeqNextBatch(node);
+		if (batch == NULL)
+		{
+			/* we're no longer positioned on a row */
+			ExecClearTuple(node->ss.ss_ScanTupleSlot);
+			return NULL;
+		}
+	}
+
+	/*
+	 * The returned row is the scan's current tuple, in which WHERE CURRENT
+	 * OF looks for the TID (see execCurrent.c).  The batch's slots have the
+	 * same type as the scan slot, so we just point the scan slot at it.
+	 */
+	slot = batch->slots[batch->selection[batch->next++]];
+	node->ss.ss_ScanTupleSlot = slot;
+
+	if (projInfo)
+	{
+		econtext->ecxt_scantuple = slot;
+		return ExecProject(projInfo);
+	}
+
+	return slot;
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecInitSeqScan
@@ -171,6 +331,35 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.qual =
 		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
 
+	/*
+	 * Batches are only ever fetched forward, and EvalPlanQual rechecks
+	 * single tuples.
+	 */
+	scanstate->batch_capable = enable_batch_execution &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) &&
+		estate->es_epq_active == NULL;
+
+	if (scanstate->batch_capable)
+	{
+		List	   *residual;
+
+		scanstate->batchqual = ExecInitBatchQual(node->scan.plan.qual,
+												 node->scan.scanrelid,
+												 &residual,
+												 &scanstate->batch_attnos);
+		if (scanstate->batchqual)
+		{
+			scanstate->batch_residual =
+				ExecInitQual(residual, (PlanState *) scanstate);
+
+			/* worth it even if the tuples are returned one at a time */
+			scanstate->batch_mode = true;
+			scanstate->ss.ps.ExecProcNode = ExecSeqScanBatch;
+		}
+		else
+			scanstate->batch_residual = scanstate->ss.ps.qual;
+	}
+
 	return scanstate;
 }
 
@@ -201,6 +390,8 @@ ExecEndSeqScan(SeqScanState *node)
 	if (node->ss.ps.ps_ResultTupleSlot)
 		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	if (node->batch)
+		ExecClearTupleBatch(node->batch);
 
 	/*
 	 * close heap scan
@@ -231,9 +422,71 @@ ExecReScanSeqScan(SeqScanState *node)
 		table_rescan(scan,		/* scan desc */
 					 NULL);		/* new scan keys */
 
+	if (node->batch)
+		ExecClearTupleBatch(node->batch);
+
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *						Batch Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanUseBatches
+ *
+ *		Called by a parent node that wants to consume whole batches
+ *		through ExecSeqScanNextBatch, rather than tuples, with the given
+ *		columns deformed.  Returns false if the scan can't do that, in
+ *		which case the parent must use ExecProcNode as usual.  The scan's
+ *		targetlist is not evaluated in batch mode.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSeqScanUseBatches(SeqScanState *node, Bitmapset *attnos)
+{
+	if (!node->batch_capable)
+		return false;
+
+	Assert(node->batch == NULL);
+	node->batch_mode = true;
+	node->batch_attnos = bms_add_members(node->batch_attnos, attnos);
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanNextBatch
+ *
+ *		Returns the next batch with at least one qualifying row, or
+ *		NULL at the end of the scan.  The batch is valid until the next
+ *		call.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecSeqScanNextBatch(SeqScanState *node)
+{
+	TupleBatch *batch;
+
+	Assert(node->batch_mode);
+
+	/* ExecProcNode isn't used, so take care of instrumentation here */
+	if (node->ss.ps.instrument)
+		InstrStartNode(node->ss.ps.instrument);
+
+	if (node->batch != NULL && node->batch->done)
+		batch = NULL;
+	else
+		batch = SeqNextBatch(node);
+
+	if (node->ss.ps.instrument)
+		InstrStopNode(node->ss.ps.instrument,
+					  batch ? batch->nselected : 0);
+
+	return batch;
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Scan Support
  * ----------------------------------------------------------------
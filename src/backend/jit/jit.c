@@ -26,6 +26,7 @@
 #include "jit/jit.h"
 #include "miscadmin.h"
 #include "utils/fmgrprotos.h"
+#include "utils/memutils.h"
 #include "utils/resowner_private.h"
 
 /* GUCs */
@@ -39,6 +40,19 @@ bool		jit_tuple_deforming = true;
 double		jit_above_cost = 100000;
 double		jit_inline_above_cost = 500000;
 double		jit_optimize_above_cost = 500000;
+int			jit_cache_size = 0;
+int			jit_defer_threshold = 0;
+
+/*
+ * State of an expression whose compilation has been deferred, see
+ * jit_compile_expr().
+ */
+typedef struct DeferredJitExpr
+{
+	ExprStateEvalFunc interpfunc;	/* interpreter's evaluation function */
+	int			remaining;		/* evaluations left before compiling */
+	bool		checked;		/* has CheckExprStillValid() been done? */
+} DeferredJitExpr;
 
 static JitProviderCallbacks provider;
 static bool provider_successfully_loaded = false;
@@ -47,6 +61,8 @@ static bool provider_failed_loading = false;
 
 static bool provider_init(void);
 static bool file_exists(const char *name);
+static Datum ExecRunDeferredJitExpr(ExprState *state, ExprContext *econtext,
+									bool *isNull);
 
 
 /*
@@ -173,10 +189,85 @@ jit_compile_expr(struct ExprState *state)
 		return false;
 
 	/* this also takes !jit_enabled into account */
-	if (provider_init())
-		return provider.compile_expr(state);
+	if (!provider_init())
+		return false;
 
-	return false;
+	/*
+	 * If requested, evaluate the expression with the interpreter until it has
+	 * been evaluated often enough to be worth compiling.  That way a query
+	 * that exceeded jit_above_cost, but turns out to process few rows, does
+	 * not wait for code it hardly uses, while long running queries still get
+	 * their expressions compiled.
+	 */
+	if (jit_defer_threshold > 0)
+	{
+		DeferredJitExpr *dexpr = palloc(sizeof(DeferredJitExpr));
+
+		ExecReadyInterpretedExpr(state);
+
+		/*
+		 * The interpreter's evalfunc validates the expression on its first
+		 * call and then switches to the function in evalfunc_private, which
+		 * we now do ourselves.
+		 */
+		dexpr->interpfunc = (ExprStateEvalFunc) state->evalfunc_private;
+		dexpr->remaining = jit_defer_threshold;
+		dexpr->checked = false;
+
+		state->evalfunc = ExecRunDeferredJitExpr;
+		state->evalfunc_private = dexpr;
+
+		return true;
+	}
+
+	return provider.compile_expr(state);
+}
+
+/*
+ * Evaluation function of an expression whose compilation has been deferred.
+ *
+ * Evaluates the expression with the interpreter, until it has been evaluated
+ * jit_defer_threshold times.  Then it is compiled, and the compiled code is
+ * used from there on.  Compilation happens in the backend itself, while the
+ * query is executing: the generated code has to live in the backend's address
+ * space, and JIT providers can't be used concurrently with the executor.
+ */
+static Datum
+ExecRunDeferredJitExpr(ExprState *state, ExprContext *econtext, bool *isNull)
+{
+	DeferredJitExpr *dexpr = (DeferredJitExpr *) state->evalfunc_private;
+	ExprStateEvalFunc interpfunc = dexpr->interpfunc;
+	MemoryContext oldcontext;
+	bool		compiled;
+
+	if (!dexpr->checked)
+	{
+		CheckExprStillValid(state, econtext);
+		dexpr->checked = true;
+	}
+
+	if (dexpr->remaining-- > 0)
+		return interpfunc(state, econtext, isNull);
+
+	/*
+	 * We're called in a short-lived memory context, but whatever the provider
+	 * allocates for the compiled expression has to live as long as the
+	 * expression itself.
+	 */
+	oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(state));
+	compiled = provider.compile_expr(state);
+	MemoryContextSwitchTo(oldcontext);
+
+	if (!compiled)
+	{
+		/* keep using the interpreter */
+		state->evalfunc = interpfunc;
+		state->evalfunc_private = (void *) interpfunc;
+	}
+
+	pfree(dexpr);
+
+	return state->evalfunc(state, econtext, isNull);
 }
 
 /* Aggregate JIT instrumentation information */
@@ -34,8 +34,10 @@
 #include <llvm-c/Transforms/Utils.h>
 #endif
 
+#include "common/hashfn.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "portability/instr_time.h"
 #include "storage/ipc.h"
@@ -54,6 +56,34 @@ typedef struct LLVMJitHandle
 #endif
 } LLVMJitHandle;
 
+/*
+ * A module in the JIT code cache.
+ *
+ * The key is the module's IR, printed before it is optimized, with the
+ * functions defined in it renamed to names that don't depend on the JIT
+ * context.  As the code of cacheable expressions doesn't embed pointers
+ * into the executor state, re-executing the same plan produces the same IR,
+ * and can use the code emitted before.
+ */
+typedef struct LLVMJitCacheEntry
+{
+	dlist_node	node;			/* in llvm_cache, most recently used first */
+	uint64		hash;			/* hash of key */
+	char	   *key;			/* IR of the module, with normalized names */
+	int			flags;			/* PGJIT_* flags the module was compiled with */
+	int			nfuncs;			/* number of functions defined in module */
+	char	  **funcnames;		/* their names in the emitted code */
+	LLVMJitHandle *handle;		/* the emitted code */
+	int			refcount;		/* number of contexts using the code */
+} LLVMJitCacheEntry;
+
+/* A cached module used by a context */
+typedef struct LLVMJitCachedModule
+{
+	LLVMJitCacheEntry *entry;
+	char	  **funcnames;		/* the context's names for entry's functions */
+} LLVMJitCachedModule;
+
 
 /* types & functions commonly needed for JITing */
 LLVMTypeRef TypeSizeT;
@@ -106,8 +136,27 @@ static LLVMOrcJITStackRef llvm_opt0_orc;
 static LLVMOrcJITStackRef llvm_opt3_orc;
 #endif							/* LLVM_VERSION_MAJOR > 11 */
 
+/* the JIT code cache, see llvm_compile_module() */
+static dlist_head llvm_cache = DLIST_STATIC_INIT(llvm_cache);
+static int	llvm_cache_entries = 0;
+static MemoryContext llvm_cache_context = NULL;
+
 
 static void llvm_release_context(JitContext *context);
+static void llvm_release_handle(LLVMJitHandle *jit_handle);
+static void *llvm_lookup_function(LLVMJitContext *context,
+								  LLVMJitHandle *handle,
+								  const char *funcname);
+static char *llvm_cache_key(LLVMModuleRef module, int *nfuncs,
+							char ***funcnames);
+static bool llvm_cache_lookup(LLVMJitContext *context, const char *key,
+							  uint64 hash, int nfuncs, char **funcnames);
+static void llvm_cache_insert(LLVMJitContext *context, LLVMJitHandle *handle,
+							  const char *key, uint64 hash, int nfuncs,
+							  char **funcnames);
+static void llvm_cache_use(LLVMJitContext *context, LLVMJitCacheEntry *entry,
+						   char **funcnames);
+static void llvm_cache_prune(void);
 static void llvm_session_initialize(void);
 static void llvm_shutdown(int code, Datum arg);
 static void llvm_compile_module(LLVMJitContext *context);
@@ -156,6 +205,7 @@ llvm_create_context(int jitFlags)
 	context = MemoryContextAllocZero(TopMemoryContext,
 									 sizeof(LLVMJitContext));
 	context->base.flags = jitFlags;
+	context->cache = (jit_cache_size > 0);
 
 	/* ensure cleanup */
 	context->base.resowner = CurrentResourceOwner;
@@ -193,34 +243,59 @@ llvm_release_context(JitContext *context)
 	{
 		LLVMJitHandle *jit_handle = (LLVMJitHandle *) lfirst(lc);
 
+		llvm_release_handle(jit_handle);
+	}
+	list_free(llvm_context->handles);
+	llvm_context->handles = NIL;
+
+	/* the cached code stays, but may now be evicted */
+	foreach(lc, llvm_context->cached_modules)
+	{
+		LLVMJitCachedModule *cmod = (LLVMJitCachedModule *) lfirst(lc);
+
+		Assert(cmod->entry->refcount > 0);
+		cmod->entry->refcount--;
+		for (int i = 0; i < cmod->entry->nfuncs; i++)
+			pfree(cmod->funcnames[i]);
+		pfree(cmod->funcnames);
+		pfree(cmod);
+	}
+	list_free(llvm_context->cached_modules);
+	llvm_context->cached_modules = NIL;
+
+	llvm_cache_prune();
+}
+
+/*
+ * Release the code emitted for one module.
+ */
+static void
+llvm_release_handle(LLVMJitHandle *jit_handle)
+{
 #if LLVM_VERSION_MAJOR > 11
-		{
-			LLVMOrcExecutionSessionRef ee;
-			LLVMOrcSymbolStringPoolRef sp;
-
-			LLVMOrcResourceTrackerRemove(jit_handle->resource_tracker);
-			LLVMOrcReleaseResourceTracker(jit_handle->resource_tracker);
-
-			/*
-			 * Without triggering cleanup of the string pool, we'd leak
-			 * memory. It'd be sufficient to do this far less often, but in
-			 * experiments the required time was small enough to just always
-			 * do it.
-			 */
-			ee = LLVMOrcLLJITGetExecutionSession(jit_handle->lljit);
-			sp = LLVMOrcExecutionSessionGetSymbolStringPool(ee);
-			LLVMOrcSymbolStringPoolClearDeadEntries(sp);
-		}
+	{
+		LLVMOrcExecutionSessionRef ee;
+		LLVMOrcSymbolStringPoolRef sp;
+
+		LLVMOrcResourceTrackerRemove(jit_handle->resource_tracker);
+		LLVMOrcReleaseResourceTracker(jit_handle->resource_tracker);
+
+		/*
+		 * Without triggering cleanup of the string pool, we'd leak memory.
+		 * It'd be sufficient to do this far less often, but in experiments
+		 * the required time was small enough to just always do it.
+		 */
+		ee = LLVMOrcLLJITGetExecutionSession(jit_handle->lljit);
+		sp = LLVMOrcExecutionSessionGetSymbolStringPool(ee);
+		LLVMOrcSymbolStringPoolClearDeadEntries(sp);
+	}
 #else							/* LLVM_VERSION_MAJOR > 11 */
-		{
-			LLVMOrcRemoveModule(jit_handle->stack, jit_handle->orc_handle);
-		}
+	{
+		LLVMOrcRemoveModule(jit_handle->stack, jit_handle->orc_handle);
+	}
 #endif							/* LLVM_VERSION_MAJOR > 11 */
 
-		pfree(jit_handle);
-	}
-	list_free(llvm_context->handles);
-	llvm_context->handles = NIL;
+	pfree(jit_handle);
 }
 
 /*
@@ -275,10 +350,8 @@ llvm_expand_funcname(struct LLVMJitContext *context, const char *basename)
 void *
 llvm_get_function(LLVMJitContext *context, const char *funcname)
 {
-#if LLVM_VERSION_MAJOR > 11 || \
-	defined(HAVE_DECL_LLVMORCGETSYMBOLADDRESSIN) && HAVE_DECL_LLVMORCGETSYMBOLADDRESSIN
 	ListCell   *lc;
-#endif
+	void	   *addr;
 
 	llvm_assert_in_fatal_section();
 
@@ -291,15 +364,57 @@ llvm_get_function(LLVMJitContext *context, const char *funcname)
 		llvm_compile_module(context);
 	}
 
+	/*
+	 * Code taken from the cache was emitted under the function names of the
+	 * context that compiled it, so translate.
+	 */
+	foreach(lc, context->cached_modules)
+	{
+		LLVMJitCachedModule *cmod = (LLVMJitCachedModule *) lfirst(lc);
+		LLVMJitCacheEntry *entry = cmod->entry;
+
+		for (int i = 0; i < entry->nfuncs; i++)
+		{
+			if (strcmp(cmod->funcnames[i], funcname) != 0)
+				continue;
+
+			addr = llvm_lookup_function(context, entry->handle,
+										entry->funcnames[i]);
+			if (addr)
+				return addr;
+			elog(ERROR, "failed to JIT: %s", funcname);
+		}
+	}
+
+	foreach(lc, context->handles)
+	{
+		LLVMJitHandle *handle = (LLVMJitHandle *) lfirst(lc);
+
+		addr = llvm_lookup_function(context, handle, funcname);
+		if (addr)
+			return addr;
+	}
+
+	elog(ERROR, "failed to JIT: %s", funcname);
+
+	return NULL;
+}
+
+/*
+ * Look up function funcname in the code emitted for one module.  Returns
+ * NULL if it isn't there.
+ */
+static void *
+llvm_lookup_function(LLVMJitContext *context, LLVMJitHandle *handle,
+					 const char *funcname)
+{
 	/*
 	 * ORC's symbol table is of *unmangled* symbols. Therefore we don't need
 	 * to mangle here.
 	 */
 
 #if LLVM_VERSION_MAJOR > 11
-	foreach(lc, context->handles)
 	{
-		LLVMJitHandle *handle = (LLVMJitHandle *) lfirst(lc);
 		instr_time	starttime;
 		instr_time	endtime;
 		LLVMErrorRef error;
@@ -323,20 +438,16 @@ llvm_get_function(LLVMJitContext *context, const char *funcname)
 		INSTR_TIME_ACCUM_DIFF(context->base.instr.emission_counter,
 							  endtime, starttime);
 
-		if (addr)
-			return (void *) (uintptr_t) addr;
+		return (void *) (uintptr_t) addr;
 	}
 #elif defined(HAVE_DECL_LLVMORCGETSYMBOLADDRESSIN) && HAVE_DECL_LLVMORCGETSYMBOLADDRESSIN
-	foreach(lc, context->handles)
 	{
 		LLVMOrcTargetAddress addr;
-		LLVMJitHandle *handle = (LLVMJitHandle *) lfirst(lc);
 
 		addr = 0;
 		if (LLVMOrcGetSymbolAddressIn(handle->stack, &addr, handle->orc_handle, funcname))
 			elog(ERROR, "failed to look up symbol \"%s\"", funcname);
-		if (addr)
-			return (void *) (uintptr_t) addr;
+		return (void *) (uintptr_t) addr;
 	}
 #elif LLVM_VERSION_MAJOR < 5
 	{
@@ -346,6 +457,7 @@ llvm_get_function(LLVMJitContext *context, const char *funcname)
 			return (void *) (uintptr_t) addr;
 		if ((addr = LLVMOrcGetSymbolAddress(llvm_opt3_orc, funcname)))
 			return (void *) (uintptr_t) addr;
+		return NULL;
 	}
 #else
 	{
@@ -357,14 +469,9 @@ llvm_get_function(LLVMJitContext *context, const char *funcname)
 			return (void *) (uintptr_t) addr;
 		if (LLVMOrcGetSymbolAddress(llvm_opt3_orc, &addr, funcname))
 			elog(ERROR, "failed to look up symbol \"%s\"", funcname);
-		if (addr)
-			return (void *) (uintptr_t) addr;
+		return (void *) (uintptr_t) addr;
 	}
 #endif
-
-	elog(ERROR, "failed to JIT: %s", funcname);
-
-	return NULL;
 }
 
 /*
@@ -633,12 +740,39 @@ llvm_compile_module(LLVMJitContext *context)
 	MemoryContext oldcontext;
 	instr_time	starttime;
 	instr_time	endtime;
+	char	   *key = NULL;
+	uint64		hash = 0;
+	int			nfuncs = 0;
+	char	  **funcnames = NULL;
 #if LLVM_VERSION_MAJOR > 11
 	LLVMOrcLLJITRef compile_orc;
 #else
 	LLVMOrcJITStackRef compile_orc;
 #endif
 
+	/*
+	 * If the module may be cached, check whether the same code has been
+	 * emitted before.  If so, use that, and skip the expensive part.
+	 */
+	if (context->cache)
+	{
+		key = llvm_cache_key(context->module, &nfuncs, &funcnames);
+		hash = hash_bytes_extended((const unsigned char *) key, strlen(key),
+								   context->base.flags);
+		if (llvm_cache_lookup(context, key, hash, nfuncs, funcnames))
+		{
+			ereport(DEBUG1,
+					(errmsg_internal("found JIT compiled code in cache"),
+					 errhidestmt(true),
+					 errhidecontext(true)));
+			pfree(key);
+			for (int i = 0; i < nfuncs; i++)
+				pfree(funcnames[i]);
+			pfree(funcnames);
+			return;
+		}
+	}
+
 	if (context->base.flags & PGJIT_OPT3)
 		compile_orc = llvm_opt3_orc;
 	else
@@ -763,9 +897,20 @@ llvm_compile_module(LLVMJitContext *context)
 	context->compiled = true;
 
 	/* remember emitted code for cleanup and lookups */
-	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
-	context->handles = lappend(context->handles, handle);
-	MemoryContextSwitchTo(oldcontext);
+	if (context->cache)
+	{
+		llvm_cache_insert(context, handle, key, hash, nfuncs, funcnames);
+		pfree(key);
+		for (int i = 0; i < nfuncs; i++)
+			pfree(funcnames[i]);
+		pfree(funcnames);
+	}
+	else
+	{
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		context->handles = lappend(context->handles, handle);
+		MemoryContextSwitchTo(oldcontext);
+	}
 
 	ereport(DEBUG1,
 			(errmsg_internal("time to inline: %.3fs, opt: %.3fs, emit: %.3fs",
@@ -776,6 +921,195 @@ llvm_compile_module(LLVMJitContext *context)
 			 errhidecontext(true)));
 }
 
+/*
+ * Compute the JIT code cache key of a module, see LLVMJitCacheEntry.  The
+ * names of the functions defined in the module are returned in *funcnames.
+ */
+static char *
+llvm_cache_key(LLVMModuleRef module, int *nfuncs, char ***funcnames)
+{
+	LLVMValueRef func;
+	char	   *ir;
+	char	   *key;
+	int			n;
+
+	n = 0;
+	for (func = LLVMGetFirstFunction(module); func != NULL;
+		 func = LLVMGetNextFunction(func))
+	{
+		if (!LLVMIsDeclaration(func))
+			n++;
+	}
+
+	*nfuncs = n;
+	*funcnames = palloc(sizeof(char *) * Max(n, 1));
+
+	n = 0;
+	for (func = LLVMGetFirstFunction(module); func != NULL;
+		 func = LLVMGetNextFunction(func))
+	{
+		char		name[32];
+
+		if (LLVMIsDeclaration(func))
+			continue;
+
+		(*funcnames)[n] = pstrdup(LLVMGetValueName(func));
+		snprintf(name, sizeof(name), "pgcache.%d", n);
+		LLVMSetValueName(func, name);
+		n++;
+	}
+
+	ir = LLVMPrintModuleToString(module);
+	key = pstrdup(ir);
+	LLVMDisposeMessage(ir);
+
+	/* restore the original names, which don't conflict with other modules */
+	n = 0;
+	for (func = LLVMGetFirstFunction(module); func != NULL;
+		 func = LLVMGetNextFunction(func))
+	{
+		if (!LLVMIsDeclaration(func))
+			LLVMSetValueName(func, (*funcnames)[n++]);
+	}
+
+	return key;
+}
+
+/*
+ * Let context use the code of a cached module, whose functions it knows by
+ * the given names.
+ */
+static void
+llvm_cache_use(LLVMJitContext *context, LLVMJitCacheEntry *entry,
+			   char **funcnames)
+{
+	MemoryContext oldcontext;
+	LLVMJitCachedModule *cmod;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	cmod = palloc(sizeof(LLVMJitCachedModule));
+	cmod->entry = entry;
+	cmod->funcnames = palloc(sizeof(char *) * Max(entry->nfuncs, 1));
+	for (int i = 0; i < entry->nfuncs; i++)
+		cmod->funcnames[i] = pstrdup(funcnames[i]);
+	context->cached_modules = lappend(context->cached_modules, cmod);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	entry->refcount++;
+}
+
+/*
+ * Look for a module with the given key in the JIT code cache.  If found, let
+ * context use its code instead of the pending module, and return true.
+ */
+static bool
+llvm_cache_lookup(LLVMJitContext *context, const char *key, uint64 hash,
+				  int nfuncs, char **funcnames)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &llvm_cache)
+	{
+		LLVMJitCacheEntry *entry = dlist_container(LLVMJitCacheEntry, node,
+												   iter.cur);
+
+		if (entry->hash != hash || entry->flags != context->base.flags ||
+			entry->nfuncs != nfuncs || strcmp(entry->key, key) != 0)
+			continue;
+
+		dlist_move_head(&llvm_cache, &entry->node);
+		llvm_cache_use(context, entry, funcnames);
+
+		LLVMDisposeModule(context->module);
+		context->module = NULL;
+		context->compiled = true;
+
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Add the code just emitted for context's pending module to the JIT code
+ * cache.
+ */
+static void
+llvm_cache_insert(LLVMJitContext *context, LLVMJitHandle *handle,
+				  const char *key, uint64 hash, int nfuncs, char **funcnames)
+{
+	MemoryContext oldcontext;
+	LLVMJitCacheEntry *entry;
+
+	if (llvm_cache_context == NULL)
+		llvm_cache_context = AllocSetContextCreate(TopMemoryContext,
+												   "LLVM JIT code cache",
+												   ALLOCSET_DEFAULT_SIZES);
+
+	oldcontext = MemoryContextSwitchTo(llvm_cache_context);
+
+	entry = palloc(sizeof(LLVMJitCacheEntry));
+	entry->hash = hash;
+	entry->key = pstrdup(key);
+	entry->flags = context->base.flags;
+	entry->nfuncs = nfuncs;
+	entry->funcnames = palloc(sizeof(char *) * Max(nfuncs, 1));
+	for (int i = 0; i < nfuncs; i++)
+		entry->funcnames[i] = pstrdup(funcnames[i]);
+	entry->handle = handle;
+	entry->refcount = 0;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	dlist_push_head(&llvm_cache, &entry->node);
+	llvm_cache_entries++;
+
+	llvm_cache_use(context, entry, funcnames);
+
+	llvm_cache_prune();
+}
+
+/*
+ * Evict the least recently used modules from the JIT code cache until no
+ * more than jit_cache_size are left.  Modules in use by a context are kept.
+ */
+static void
+llvm_cache_prune(void)
+{
+	dlist_node *node;
+
+	if (dlist_is_empty(&llvm_cache))
+		return;
+
+	node = dlist_tail_node(&llvm_cache);
+	while (node != NULL && llvm_cache_entries > jit_cache_size)
+	{
+		LLVMJitCacheEntry *entry = dlist_container(LLVMJitCacheEntry, node,
+												   node);
+		dlist_node *prev = NULL;
+
+		if (dlist_has_prev(&llvm_cache, node))
+			prev = dlist_prev_node(&llvm_cache, node);
+
+		if (entry->refcount == 0)
+		{
+			dlist_delete(node);
+			llvm_cache_entries--;
+
+			llvm_release_handle(entry->handle);
+			for (int i = 0; i < entry->nfuncs; i++)
+				pfree(entry->funcnames[i]);
+			pfree(entry->funcnames);
+			pfree(entry->key);
+			pfree(entry);
+		}
+
+		node = prev;
+	}
+}
+
 /*
  * Per session initialization.
  */
@@ -51,22 +51,40 @@ typedef struct CompiledExprState
 	const char *funcname;
 } CompiledExprState;
 
+/*
+ * Pointers into the executor state that an expression's code uses.  Usually
+ * they are embedded into the code as constants.  But if the code may be
+ * cached, and used by other ExprStates later, they are collected in a table
+ * instead, which the code loads them from, see build_PtrConst().
+ */
+typedef struct ExprPtrTable
+{
+	LLVMValueRef v_ptrs;		/* the table, or NULL to embed pointers */
+	void	  **ptrs;			/* the pointers collected so far */
+	int			nptrs;
+	int			maxptrs;
+} ExprPtrTable;
+
 
 static Datum ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull);
 
 static LLVMValueRef BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
-								LLVMModuleRef mod, FunctionCallInfo fcinfo,
+								LLVMModuleRef mod, ExprPtrTable *ptrs,
+								FunctionCallInfo fcinfo,
 								LLVMValueRef *v_fcinfo_isnull);
 static LLVMValueRef build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod,
+									   ExprPtrTable *ptrs,
 									   const char *funcname,
 									   LLVMValueRef v_state,
 									   ExprEvalStep *op,
 									   int natts, LLVMValueRef *v_args);
+static LLVMValueRef build_PtrConst(LLVMBuilderRef b, ExprPtrTable *ptrs,
+								   void *ptr, LLVMTypeRef type);
 static LLVMValueRef create_LifetimeEnd(LLVMModuleRef mod);
 
 /* macro making it easier to call ExecEval* functions */
-#define build_EvalXFunc(b, mod, funcname, v_state, op, ...) \
-	build_EvalXFuncInt(b, mod, funcname, v_state, op, \
+#define build_EvalXFunc(b, mod, ptrs, funcname, v_state, op, ...) \
+	build_EvalXFuncInt(b, mod, ptrs, funcname, v_state, op, \
 					   lengthof(((LLVMValueRef[]){__VA_ARGS__})), \
 					   ((LLVMValueRef[]){__VA_ARGS__}))
 
@@ -120,6 +138,9 @@ llvm_compile_expr(ExprState *state)
 	LLVMValueRef v_aggvalues;
 	LLVMValueRef v_aggnulls;
 
+	/* pointers into executor state */
+	ExprPtrTable ptrs;
+
 	instr_time	starttime;
 	instr_time	endtime;
 
@@ -222,6 +243,17 @@ llvm_compile_expr(ExprState *state)
 								   FIELDNO_EXPRCONTEXT_AGGNULLS,
 								   "v.econtext.aggnulls");
 
+	/* if the code may be cached, it must not embed pointers */
+	memset(&ptrs, 0, sizeof(ptrs));
+	if (context->cache)
+	{
+		ptrs.v_ptrs = l_load_struct_gep(b, v_state,
+										FIELDNO_EXPRSTATE_EVALFUNC_PTRS,
+										"v.state.ptrs");
+		ptrs.maxptrs = 2 * state->steps_len;
+		ptrs.ptrs = palloc(sizeof(void *) * ptrs.maxptrs);
+	}
+
 	/* allocate blocks for each op upfront, so we can do jumps easily */
 	opblocks = palloc(sizeof(LLVMBasicBlockRef) * state->steps_len);
 	for (int opno = 0; opno < state->steps_len; opno++)
@@ -242,8 +274,8 @@ llvm_compile_expr(ExprState *state)
 		op = &state->steps[opno];
 		opcode = ExecEvalStepOp(state, op);
 
-		v_resvaluep = l_ptr_const(op->resvalue, l_ptr(TypeSizeT));
-		v_resnullp = l_ptr_const(op->resnull, l_ptr(TypeStorageBool));
+		v_resvaluep = build_PtrConst(b, &ptrs, op->resvalue, l_ptr(TypeSizeT));
+		v_resnullp = build_PtrConst(b, &ptrs, op->resnull, l_ptr(TypeStorageBool));
 
 		switch (opcode)
 		{
@@ -395,7 +427,7 @@ llvm_compile_expr(ExprState *state)
 					else
 						v_slot = v_scanslot;
 
-					build_EvalXFunc(b, mod, "ExecEvalSysVar",
+					build_EvalXFunc(b, mod, &ptrs, "ExecEvalSysVar",
 									v_state, op, v_econtext, v_slot);
 
 					LLVMBuildBr(b, opblocks[opno + 1]);
@@ -403,7 +435,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_WHOLEROW:
-				build_EvalXFunc(b, mod, "ExecEvalWholeRowVar",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalWholeRowVar",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -557,7 +589,7 @@ llvm_compile_expr(ExprState *state)
 							elog(ERROR, "argumentless strict functions are pointless");
 
 						v_fcinfo =
-							l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+							build_PtrConst(b, &ptrs, fcinfo, l_ptr(StructFunctionCallInfoData));
 
 						/*
 						 * set resnull to true, if the function is actually
@@ -607,7 +639,7 @@ llvm_compile_expr(ExprState *state)
 						LLVMPositionBuilderAtEnd(b, b_nonull);
 					}
 
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, b, mod, &ptrs, fcinfo,
 										   &v_fcinfo_isnull);
 					LLVMBuildStore(b, v_retval, v_resvaluep);
 					LLVMBuildStore(b, v_fcinfo_isnull, v_resnullp);
@@ -617,14 +649,14 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_FUNCEXPR_FUSAGE:
-				build_EvalXFunc(b, mod, "ExecEvalFuncExprFusage",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalFuncExprFusage",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 
 			case EEOP_FUNCEXPR_STRICT_FUSAGE:
-				build_EvalXFunc(b, mod, "ExecEvalFuncExprStrictFusage",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalFuncExprStrictFusage",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -659,8 +691,8 @@ llvm_compile_expr(ExprState *state)
 					b_boolcont = l_bb_before_v(opblocks[opno + 1],
 											   "b.%d.boolcont", opno);
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
-												 l_ptr(TypeStorageBool));
+					v_boolanynullp = build_PtrConst(b, &ptrs, op->d.boolexpr.anynull,
+													l_ptr(TypeStorageBool));
 
 					if (opcode == EEOP_BOOL_AND_STEP_FIRST)
 						LLVMBuildStore(b, l_sbool_const(0), v_boolanynullp);
@@ -756,8 +788,8 @@ llvm_compile_expr(ExprState *state)
 					b_boolcont = l_bb_before_v(opblocks[opno + 1],
 											   "b.%d.boolcont", opno);
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
-												 l_ptr(TypeStorageBool));
+					v_boolanynullp = build_PtrConst(b, &ptrs, op->d.boolexpr.anynull,
+													l_ptr(TypeStorageBool));
 
 					if (opcode == EEOP_BOOL_OR_STEP_FIRST)
 						LLVMBuildStore(b, l_sbool_const(0), v_boolanynullp);
@@ -985,13 +1017,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_NULLTEST_ROWISNULL:
-				build_EvalXFunc(b, mod, "ExecEvalRowNull",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalRowNull",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_NULLTEST_ROWISNOTNULL:
-				build_EvalXFunc(b, mod, "ExecEvalRowNotNull",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalRowNotNull",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1062,13 +1094,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_PARAM_EXEC:
-				build_EvalXFunc(b, mod, "ExecEvalParamExec",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalParamExec",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_PARAM_EXTERN:
-				build_EvalXFunc(b, mod, "ExecEvalParamExtern",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalParamExtern",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1084,7 +1116,7 @@ llvm_compile_expr(ExprState *state)
 										 LLVMPointerType(v_functype, 0));
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = build_PtrConst(b, &ptrs, op, l_ptr(StructExprEvalStep));
 					v_params[2] = v_econtext;
 					LLVMBuildCall(b,
 								  v_func,
@@ -1107,7 +1139,7 @@ llvm_compile_expr(ExprState *state)
 										 LLVMPointerType(v_functype, 0));
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = build_PtrConst(b, &ptrs, op, l_ptr(StructExprEvalStep));
 					v_params[2] = v_econtext;
 					v_ret = LLVMBuildCall(b,
 										  v_func,
@@ -1135,7 +1167,7 @@ llvm_compile_expr(ExprState *state)
 										 LLVMPointerType(v_functype, 0));
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = build_PtrConst(b, &ptrs, op, l_ptr(StructExprEvalStep));
 					v_params[2] = v_econtext;
 					LLVMBuildCall(b,
 								  v_func,
@@ -1160,10 +1192,10 @@ llvm_compile_expr(ExprState *state)
 					b_notavail = l_bb_before_v(opblocks[opno + 1],
 											   "op.%d.notavail", opno);
 
-					v_casevaluep = l_ptr_const(op->d.casetest.value,
-											   l_ptr(TypeSizeT));
-					v_casenullp = l_ptr_const(op->d.casetest.isnull,
-											  l_ptr(TypeStorageBool));
+					v_casevaluep = build_PtrConst(b, &ptrs, op->d.casetest.value,
+												  l_ptr(TypeSizeT));
+					v_casenullp = build_PtrConst(b, &ptrs, op->d.casetest.isnull,
+												 l_ptr(TypeStorageBool));
 
 					v_casevaluenull =
 						LLVMBuildICmp(b, LLVMIntEQ,
@@ -1208,8 +1240,8 @@ llvm_compile_expr(ExprState *state)
 					b_notnull = l_bb_before_v(opblocks[opno + 1],
 											  "op.%d.readonly.notnull", opno);
 
-					v_nullp = l_ptr_const(op->d.make_readonly.isnull,
-										  l_ptr(TypeStorageBool));
+					v_nullp = build_PtrConst(b, &ptrs, op->d.make_readonly.isnull,
+											 l_ptr(TypeStorageBool));
 
 					v_null = LLVMBuildLoad(b, v_nullp, "");
 
@@ -1225,8 +1257,8 @@ llvm_compile_expr(ExprState *state)
 					/* if value is not null, convert to RO datum */
 					LLVMPositionBuilderAtEnd(b, b_notnull);
 
-					v_valuep = l_ptr_const(op->d.make_readonly.value,
-										   l_ptr(TypeSizeT));
+					v_valuep = build_PtrConst(b, &ptrs, op->d.make_readonly.value,
+											  l_ptr(TypeSizeT));
 
 					v_value = LLVMBuildLoad(b, v_valuep, "");
 
@@ -1276,8 +1308,8 @@ llvm_compile_expr(ExprState *state)
 
 					v_fn_out = llvm_function_reference(context, b, mod, fcinfo_out);
 					v_fn_in = llvm_function_reference(context, b, mod, fcinfo_in);
-					v_fcinfo_out = l_ptr_const(fcinfo_out, l_ptr(StructFunctionCallInfoData));
-					v_fcinfo_in = l_ptr_const(fcinfo_in, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo_out = build_PtrConst(b, &ptrs, fcinfo_out, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo_in = build_PtrConst(b, &ptrs, fcinfo_in, l_ptr(StructFunctionCallInfoData));
 
 					v_fcinfo_in_isnullp =
 						LLVMBuildStructGEP(b, v_fcinfo_in,
@@ -1399,7 +1431,7 @@ llvm_compile_expr(ExprState *state)
 					b_bothargnull = l_bb_before_v(opblocks[opno + 1], "op.%d.bothargnull", opno);
 					b_anyargnull = l_bb_before_v(opblocks[opno + 1], "op.%d.anyargnull", opno);
 
-					v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo = build_PtrConst(b, &ptrs, fcinfo, l_ptr(StructFunctionCallInfoData));
 
 					/* load args[0|1].isnull for both arguments */
 					v_argnull0 = l_funcnull(b, v_fcinfo, 0);
@@ -1450,7 +1482,7 @@ llvm_compile_expr(ExprState *state)
 					/* neither argument is null: compare */
 					LLVMPositionBuilderAtEnd(b, b_noargnull);
 
-					v_result = BuildV1Call(context, b, mod, fcinfo,
+					v_result = BuildV1Call(context, b, mod, &ptrs, fcinfo,
 										   &v_fcinfo_isnull);
 
 					if (opcode == EEOP_DISTINCT)
@@ -1494,7 +1526,7 @@ llvm_compile_expr(ExprState *state)
 					b_argsequal = l_bb_before_v(opblocks[opno + 1],
 												"b.%d.argsequal", opno);
 
-					v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo = build_PtrConst(b, &ptrs, fcinfo, l_ptr(StructFunctionCallInfoData));
 
 					/* if either argument is NULL they can't be equal */
 					v_argnull0 = l_funcnull(b, v_fcinfo, 0);
@@ -1520,7 +1552,7 @@ llvm_compile_expr(ExprState *state)
 					/* build block to invoke function and check result */
 					LLVMPositionBuilderAtEnd(b, b_nonull);
 
-					v_retval = BuildV1Call(context, b, mod, fcinfo, &v_fcinfo_isnull);
+					v_retval = BuildV1Call(context, b, mod, &ptrs, fcinfo, &v_fcinfo_isnull);
 
 					/*
 					 * If result not null, and arguments are equal return null
@@ -1550,37 +1582,37 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_SQLVALUEFUNCTION:
-				build_EvalXFunc(b, mod, "ExecEvalSQLValueFunction",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalSQLValueFunction",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_CURRENTOFEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalCurrentOfExpr",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalCurrentOfExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_NEXTVALUEEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalNextValueExpr",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalNextValueExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_ARRAYEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalArrayExpr",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalArrayExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_ARRAYCOERCE:
-				build_EvalXFunc(b, mod, "ExecEvalArrayCoerce",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalArrayCoerce",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_ROW:
-				build_EvalXFunc(b, mod, "ExecEvalRow",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalRow",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1615,8 +1647,8 @@ llvm_compile_expr(ExprState *state)
 						LLVMValueRef v_argnull1;
 						LLVMValueRef v_anyargisnull;
 
-						v_fcinfo = l_ptr_const(fcinfo,
-											   l_ptr(StructFunctionCallInfoData));
+						v_fcinfo = build_PtrConst(b, &ptrs, fcinfo,
+												  l_ptr(StructFunctionCallInfoData));
 
 						v_argnull0 = l_funcnull(b, v_fcinfo, 0);
 						v_argnull1 = l_funcnull(b, v_fcinfo, 1);
@@ -1644,7 +1676,7 @@ llvm_compile_expr(ExprState *state)
 					LLVMPositionBuilderAtEnd(b, b_compare);
 
 					/* call function */
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, b, mod, &ptrs, fcinfo,
 										   &v_fcinfo_isnull);
 					LLVMBuildStore(b, v_retval, v_resvaluep);
 
@@ -1735,25 +1767,25 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_MINMAX:
-				build_EvalXFunc(b, mod, "ExecEvalMinMax",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalMinMax",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_FIELDSELECT:
-				build_EvalXFunc(b, mod, "ExecEvalFieldSelect",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalFieldSelect",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_FIELDSTORE_DEFORM:
-				build_EvalXFunc(b, mod, "ExecEvalFieldStoreDeForm",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalFieldStoreDeForm",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_FIELDSTORE_FORM:
-				build_EvalXFunc(b, mod, "ExecEvalFieldStoreForm",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalFieldStoreForm",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1773,10 +1805,10 @@ llvm_compile_expr(ExprState *state)
 					b_notavail = l_bb_before_v(opblocks[opno + 1],
 											   "op.%d.notavail", opno);
 
-					v_casevaluep = l_ptr_const(op->d.casetest.value,
-											   l_ptr(TypeSizeT));
-					v_casenullp = l_ptr_const(op->d.casetest.isnull,
-											  l_ptr(TypeStorageBool));
+					v_casevaluep = build_PtrConst(b, &ptrs, op->d.casetest.value,
+												  l_ptr(TypeSizeT));
+					v_casenullp = build_PtrConst(b, &ptrs, op->d.casetest.isnull,
+												 l_ptr(TypeStorageBool));
 
 					v_casevaluenull =
 						LLVMBuildICmp(b, LLVMIntEQ,
@@ -1813,37 +1845,37 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_DOMAIN_NOTNULL:
-				build_EvalXFunc(b, mod, "ExecEvalConstraintNotNull",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalConstraintNotNull",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_DOMAIN_CHECK:
-				build_EvalXFunc(b, mod, "ExecEvalConstraintCheck",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalConstraintCheck",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_CONVERT_ROWTYPE:
-				build_EvalXFunc(b, mod, "ExecEvalConvertRowtype",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalConvertRowtype",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_SCALARARRAYOP:
-				build_EvalXFunc(b, mod, "ExecEvalScalarArrayOp",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalScalarArrayOp",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_HASHED_SCALARARRAYOP:
-				build_EvalXFunc(b, mod, "ExecEvalHashedScalarArrayOp",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalHashedScalarArrayOp",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_XMLEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalXmlExpr",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalXmlExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1869,7 +1901,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_GROUPING_FUNC:
-				build_EvalXFunc(b, mod, "ExecEvalGroupingFunc",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalGroupingFunc",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1887,8 +1919,8 @@ llvm_compile_expr(ExprState *state)
 					 * up in ExecInitWindowAgg() after initializing the
 					 * expression). So load it from memory each time round.
 					 */
-					v_wfuncnop = l_ptr_const(&wfunc->wfuncno,
-											 l_ptr(LLVMInt32Type()));
+					v_wfuncnop = build_PtrConst(b, &ptrs, &wfunc->wfuncno,
+												l_ptr(LLVMInt32Type()));
 					v_wfuncno = LLVMBuildLoad(b, v_wfuncnop, "v_wfuncno");
 
 					/* load window func value / null */
@@ -1905,7 +1937,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_SUBPLAN:
-				build_EvalXFunc(b, mod, "ExecEvalSubPlan",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalSubPlan",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1930,8 +1962,8 @@ llvm_compile_expr(ExprState *state)
 						b_deserialize = l_bb_before_v(opblocks[opno + 1],
 													  "op.%d.deserialize", opno);
 
-						v_fcinfo = l_ptr_const(fcinfo,
-											   l_ptr(StructFunctionCallInfoData));
+						v_fcinfo = build_PtrConst(b, &ptrs, fcinfo,
+												  l_ptr(StructFunctionCallInfoData));
 						v_argnull0 = l_funcnull(b, v_fcinfo, 0);
 
 						LLVMBuildCondBr(b,
@@ -1949,10 +1981,10 @@ llvm_compile_expr(ExprState *state)
 					fcinfo = op->d.agg_deserialize.fcinfo_data;
 
 					v_tmpcontext =
-						l_ptr_const(aggstate->tmpcontext->ecxt_per_tuple_memory,
-									l_ptr(StructMemoryContextData));
+						build_PtrConst(b, &ptrs, aggstate->tmpcontext->ecxt_per_tuple_memory,
+									   l_ptr(StructMemoryContextData));
 					v_oldcontext = l_mcxt_switch(mod, b, v_tmpcontext);
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, b, mod, &ptrs, fcinfo,
 										   &v_fcinfo_isnull);
 					l_mcxt_switch(mod, b, v_oldcontext);
 
@@ -1978,8 +2010,8 @@ llvm_compile_expr(ExprState *state)
 					Assert(nargs > 0);
 
 					jumpnull = op->d.agg_strict_input_check.jumpnull;
-					v_argsp = l_ptr_const(args, l_ptr(StructNullableDatum));
-					v_nullsp = l_ptr_const(nulls, l_ptr(TypeStorageBool));
+					v_argsp = build_PtrConst(b, &ptrs, args, l_ptr(StructNullableDatum));
+					v_nullsp = build_PtrConst(b, &ptrs, nulls, l_ptr(TypeStorageBool));
 
 					/* create blocks for checking args */
 					b_checknulls = palloc(sizeof(LLVMBasicBlockRef *) * nargs);
@@ -2110,8 +2142,8 @@ llvm_compile_expr(ExprState *state)
 
 					v_aggstatep =
 						LLVMBuildBitCast(b, v_parent, l_ptr(StructAggState), "");
-					v_pertransp = l_ptr_const(pertrans,
-											  l_ptr(StructAggStatePerTransData));
+					v_pertransp = build_PtrConst(b, &ptrs, pertrans,
+												 l_ptr(StructAggStatePerTransData));
 
 					/*
 					 * pergroup = &aggstate->all_pergroups
@@ -2159,8 +2191,8 @@ llvm_compile_expr(ExprState *state)
 
 							LLVMPositionBuilderAtEnd(b, b_init);
 
-							v_aggcontext = l_ptr_const(op->d.agg_trans.aggcontext,
-													   l_ptr(StructExprContext));
+							v_aggcontext = build_PtrConst(b, &ptrs, op->d.agg_trans.aggcontext,
+														  l_ptr(StructExprContext));
 
 							params[0] = v_aggstatep;
 							params[1] = v_pertransp;
@@ -2203,10 +2235,10 @@ llvm_compile_expr(ExprState *state)
 					}
 
 
-					v_fcinfo = l_ptr_const(fcinfo,
-										   l_ptr(StructFunctionCallInfoData));
-					v_aggcontext = l_ptr_const(op->d.agg_trans.aggcontext,
-											   l_ptr(StructExprContext));
+					v_fcinfo = build_PtrConst(b, &ptrs, fcinfo,
+											  l_ptr(StructFunctionCallInfoData));
+					v_aggcontext = build_PtrConst(b, &ptrs, op->d.agg_trans.aggcontext,
+												  l_ptr(StructExprContext));
 
 					v_current_setp =
 						LLVMBuildStructGEP(b,
@@ -2232,8 +2264,8 @@ llvm_compile_expr(ExprState *state)
 
 					/* invoke transition function in per-tuple context */
 					v_tmpcontext =
-						l_ptr_const(aggstate->tmpcontext->ecxt_per_tuple_memory,
-									l_ptr(StructMemoryContextData));
+						build_PtrConst(b, &ptrs, aggstate->tmpcontext->ecxt_per_tuple_memory,
+									   l_ptr(StructMemoryContextData));
 					v_oldcontext = l_mcxt_switch(mod, b, v_tmpcontext);
 
 					/* store transvalue in fcinfo->args[0] */
@@ -2254,7 +2286,7 @@ llvm_compile_expr(ExprState *state)
 								   l_funcnullp(b, v_fcinfo, 0));
 
 					/* and invoke transition function */
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, b, mod, &ptrs, fcinfo,
 										   &v_fcinfo_isnull);
 
 					/*
@@ -2345,8 +2377,8 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_args[2];
 					LLVMValueRef v_ret;
 
-					v_args[0] = l_ptr_const(aggstate, l_ptr(StructAggState));
-					v_args[1] = l_ptr_const(pertrans, l_ptr(StructAggStatePerTransData));
+					v_args[0] = build_PtrConst(b, &ptrs, aggstate, l_ptr(StructAggState));
+					v_args[1] = build_PtrConst(b, &ptrs, pertrans, l_ptr(StructAggStatePerTransData));
 
 					v_ret = LLVMBuildCall(b, v_fn, v_args, 2, "");
 					v_ret = LLVMBuildZExt(b, v_ret, TypeStorageBool, "");
@@ -2369,8 +2401,8 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_args[2];
 					LLVMValueRef v_ret;
 
-					v_args[0] = l_ptr_const(aggstate, l_ptr(StructAggState));
-					v_args[1] = l_ptr_const(pertrans, l_ptr(StructAggStatePerTransData));
+					v_args[0] = build_PtrConst(b, &ptrs, aggstate, l_ptr(StructAggState));
+					v_args[1] = build_PtrConst(b, &ptrs, pertrans, l_ptr(StructAggStatePerTransData));
 
 					v_ret = LLVMBuildCall(b, v_fn, v_args, 2, "");
 					v_ret = LLVMBuildZExt(b, v_ret, TypeStorageBool, "");
@@ -2384,31 +2416,31 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_AGG_ORDERED_TRANS_DATUM:
-				build_EvalXFunc(b, mod, "ExecEvalAggOrderedTransDatum",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalAggOrderedTransDatum",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_AGG_ORDERED_TRANS_TUPLE:
-				build_EvalXFunc(b, mod, "ExecEvalAggOrderedTransTuple",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalAggOrderedTransTuple",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_JSON_CONSTRUCTOR:
-				build_EvalXFunc(b, mod, "ExecEvalJsonConstructor",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalJsonConstructor",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_IS_JSON:
-				build_EvalXFunc(b, mod, "ExecEvalJsonIsPredicate",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalJsonIsPredicate",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_JSONEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalJson",
+				build_EvalXFunc(b, mod, &ptrs, "ExecEvalJson",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -2436,6 +2468,7 @@ llvm_compile_expr(ExprState *state)
 
 		state->evalfunc = ExecRunCompiledExpr;
 		state->evalfunc_private = cstate;
+		state->evalfunc_ptrs = ptrs.ptrs;
 	}
 
 	llvm_leave_fatal_on_oom();
@@ -2477,8 +2510,8 @@ ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull)
 
 static LLVMValueRef
 BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
-			LLVMModuleRef mod, FunctionCallInfo fcinfo,
-			LLVMValueRef *v_fcinfo_isnull)
+			LLVMModuleRef mod, ExprPtrTable *ptrs,
+			FunctionCallInfo fcinfo, LLVMValueRef *v_fcinfo_isnull)
 {
 	LLVMValueRef v_fn;
 	LLVMValueRef v_fcinfo_isnullp;
@@ -2487,7 +2520,7 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
 
 	v_fn = llvm_function_reference(context, b, mod, fcinfo);
 
-	v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+	v_fcinfo = build_PtrConst(b, ptrs, fcinfo, l_ptr(StructFunctionCallInfoData));
 	v_fcinfo_isnullp = LLVMBuildStructGEP(b, v_fcinfo,
 										  FIELDNO_FUNCTIONCALLINFODATA_ISNULL,
 										  "v_fcinfo_isnull");
@@ -2507,11 +2540,11 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
 		LLVMValueRef params[2];
 
 		params[0] = l_int64_const(sizeof(NullableDatum) * fcinfo->nargs);
-		params[1] = l_ptr_const(fcinfo->args, l_ptr(LLVMInt8Type()));
+		params[1] = build_PtrConst(b, ptrs, fcinfo->args, l_ptr(LLVMInt8Type()));
 		LLVMBuildCall(b, v_lifetime, params, lengthof(params), "");
 
 		params[0] = l_int64_const(sizeof(fcinfo->isnull));
-		params[1] = l_ptr_const(&fcinfo->isnull, l_ptr(LLVMInt8Type()));
+		params[1] = build_PtrConst(b, ptrs, &fcinfo->isnull, l_ptr(LLVMInt8Type()));
 		LLVMBuildCall(b, v_lifetime, params, lengthof(params), "");
 	}
 
@@ -2522,9 +2555,9 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
  * Implement an expression step by calling the function funcname.
  */
 static LLVMValueRef
-build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
-				   LLVMValueRef v_state, ExprEvalStep *op,
-				   int nargs, LLVMValueRef *v_args)
+build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod, ExprPtrTable *ptrs,
+				   const char *funcname, LLVMValueRef v_state,
+				   ExprEvalStep *op, int nargs, LLVMValueRef *v_args)
 {
 	LLVMValueRef v_fn = llvm_pg_func(mod, funcname);
 	LLVMValueRef *params;
@@ -2539,7 +2572,7 @@ build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
 	params = palloc(sizeof(LLVMValueRef) * (2 + nargs));
 
 	params[argno++] = v_state;
-	params[argno++] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+	params[argno++] = build_PtrConst(b, ptrs, op, l_ptr(StructExprEvalStep));
 
 	for (int i = 0; i < nargs; i++)
 		params[argno++] = v_args[i];
@@ -2551,6 +2584,43 @@ build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
 	return v_ret;
 }
 
+/*
+ * Return a pointer into the executor state, for the expression being
+ * compiled.  Unless the code may be cached, the pointer is simply embedded
+ * as a constant.  Otherwise, it's added to the expression's pointer table,
+ * and loaded from there at runtime, so the code doesn't depend on it.
+ */
+static LLVMValueRef
+build_PtrConst(LLVMBuilderRef b, ExprPtrTable *ptrs, void *ptr,
+			   LLVMTypeRef type)
+{
+	LLVMValueRef v_ptrp;
+	LLVMValueRef v_ptr;
+	LLVMValueRef v_idx;
+
+	if (ptrs->v_ptrs == NULL)
+		return l_ptr_const(ptr, type);
+
+	if (ptrs->nptrs >= ptrs->maxptrs)
+	{
+		ptrs->maxptrs *= 2;
+		ptrs->ptrs = repalloc(ptrs->ptrs, sizeof(void *) * ptrs->maxptrs);
+	}
+	ptrs->ptrs[ptrs->nptrs] = ptr;
+
+	v_idx = l_int32_const(ptrs->nptrs);
+	v_ptrp = LLVMBuildGEP(b, ptrs->v_ptrs, &v_idx, 1, "");
+	v_ptr = LLVMBuildLoad(b, v_ptrp, "");
+
+	/* the table doesn't change, which allows the loads to be combined */
+	LLVMSetMetadata(v_ptr, LLVMGetMDKindID("invariant.load", 14),
+					LLVMMDNode(NULL, 0));
+
+	ptrs->nptrs++;
+
+	return LLVMBuildBitCast(b, v_ptr, type, "");
+}
+
 static LLVMValueRef
 create_LifetimeEnd(LLVMModuleRef mod)
 {
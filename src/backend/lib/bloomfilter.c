@@ -86,10 +86,7 @@ static inline uint32 mod_m(uint32 a, uint64 m);
 bloom_filter *
 bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
 {
-	bloom_filter *filter;
-	int			bloom_power;
 	uint64		bitset_bytes;
-	uint64		bitset_bits;
 
 	/*
 	 * Aim for two bytes per element; this is sufficient to get a false
@@ -101,11 +98,30 @@ bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
 	bitset_bytes = Min(bloom_work_mem * UINT64CONST(1024), total_elems * 2);
 	bitset_bytes = Max(1024 * 1024, bitset_bytes);
 
+	return bloom_create_sized(total_elems, bitset_bytes, seed);
+}
+
+/*
+ * Create Bloom filter in caller's memory context, with a bitset of at most
+ * bitset_bytes.
+ *
+ * Unlike bloom_create(), this leaves the size of the bitset entirely up to
+ * the caller, which may well choose less than 1MB, for example to account for
+ * the filter's memory in a budget of its own.  The bitset is the largest power
+ * of two number of bits that fits, but at least one byte.
+ */
+bloom_filter *
+bloom_create_sized(int64 total_elems, uint64 bitset_bytes, uint64 seed)
+{
+	bloom_filter *filter;
+	int			bloom_power;
+	uint64		bitset_bits;
+
 	/*
 	 * Size in bits should be the highest power of two <= target.  bitset_bits
 	 * is uint64 because PG_UINT32_MAX is 2^32 - 1, not 2^32
 	 */
-	bloom_power = my_bloom_power(bitset_bytes * BITS_PER_BYTE);
+	bloom_power = my_bloom_power(Max(bitset_bytes, 1) * BITS_PER_BYTE);
 	bitset_bits = UINT64CONST(1) << bloom_power;
 	bitset_bytes = bitset_bits / BITS_PER_BYTE;
 
@@ -128,6 +144,16 @@ bloom_free(bloom_filter *filter)
 	pfree(filter);
 }
 
+/*
+ * Remove all elements from Bloom filter, so that it can be reused for a new
+ * set of about the same size
+ */
+void
+bloom_reset(bloom_filter *filter)
+{
+	memset(filter->bitset, 0, filter->m / BITS_PER_BYTE);
+}
+
 /*
  * Add element to Bloom filter
  */
@@ -0,0 +1,1153 @@
+/*-------------------------------------------------------------------------
+ *
+ * radixtree.c
+ *		Implementation of an adaptive radix tree.
+ *
+ * A radix tree maps 64-bit integer keys to 64-bit values.  The key is
+ * consumed 8 bits (a "chunk") at a time, most significant chunk first, so a
+ * lookup visits at most eight nodes regardless of the number of keys stored.
+ * Compared to a hash table, a radix tree keeps the keys in order, and it
+ * stores keys that share a prefix -- such as consecutive block numbers --
+ * very compactly.
+ *
+ * The design follows "The Adaptive Radix Tree: ARTful Indexing for
+ * Main-Memory Databases" by Viktor Leis, Alfons Kemper and Thomas Neumann,
+ * 2013.  A node can have up to 256 children, but to avoid wasting space on
+ * sparse nodes each node is of one of four kinds, by capacity:
+ *
+ * node-4 and node-16 hold a sorted array of chunks alongside an array of
+ * child slots.  node-48 has a 256-entry array mapping each chunk to a
+ * position in its array of 48 slots.  node-256 is indexed directly by chunk.
+ * When a node runs out of room it is replaced by a node of the next larger
+ * kind.  Nodes are not shrunk when keys are deleted, but nodes that become
+ * empty are freed.
+ *
+ * The path compression and lazy expansion techniques of the paper are not
+ * implemented.  Instead, the height of the tree is just what is needed for
+ * the largest key stored: the root dispatches on the most significant
+ * non-zero chunk of that key, and inserting a larger key adds new levels on
+ * top of the root.  Values are stored directly in the slots of the nodes at
+ * the lowest level, so there are no separately allocated leaves.
+ *
+ * The tree can live in backend-local memory, or in a DSA area, in which case
+ * other backends can attach to it using the handle returned by
+ * rt_get_handle().  Nodes refer to each other through rt_pointers, which
+ * hold either a local pointer or a dsa_pointer.  The tree does no locking of
+ * its own: the caller must ensure that nobody reads a shared tree while
+ * another backend is modifying it.
+ *
+ * Iteration returns the keys in ascending order.  The tree must not be
+ * modified while an iteration is in progress.
+ *
+ * Portions Copyright (c) 2022, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/lib/radixtree.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "lib/radixtree.h"
+#include "port/pg_bitutils.h"
+#include "port/simd.h"
+#include "utils/memutils.h"
+
+/* The number of key bits consumed by each level of the tree */
+#define RT_SPAN					BITS_PER_BYTE
+
+/* The maximum number of children of a node */
+#define RT_NODE_MAX_SLOTS		(1 << RT_SPAN)
+
+/* Mask for extracting a chunk from the key */
+#define RT_CHUNK_MASK			((1 << RT_SPAN) - 1)
+
+/* The maximum number of levels of the tree */
+#define RT_MAX_LEVEL			((sizeof(uint64) * BITS_PER_BYTE) / RT_SPAN)
+
+/* Get the chunk of the key that a node at the given shift dispatches on */
+#define RT_GET_KEY_CHUNK(key, shift) \
+	((uint8) (((key) >> (shift)) & RT_CHUNK_MASK))
+
+/*
+ * An rt_pointer is a local pointer in a backend-local tree, and a dsa_pointer
+ * in a shared tree.  Zero is invalid in both cases.
+ */
+typedef uint64 rt_pointer;
+
+#define InvalidRTPointer		((rt_pointer) 0)
+#define RTPointerIsValid(p)		((p) != InvalidRTPointer)
+
+#define RT_IS_SHARED(tree)		((tree)->dsa != NULL)
+
+/* Node kinds */
+#define RT_NODE_KIND_4			0
+#define RT_NODE_KIND_16			1
+#define RT_NODE_KIND_48			2
+#define RT_NODE_KIND_256		3
+#define RT_NODE_KIND_COUNT		4
+
+/* Common header of all node kinds */
+typedef struct rt_node
+{
+	/* Number of children, up to 256 */
+	uint16		count;
+
+	/* One of the RT_NODE_KIND_* values */
+	uint8		kind;
+
+	/*
+	 * Bit position in the key of the chunk this node dispatches on.  The
+	 * slots of a node with shift 0 hold values rather than child pointers.
+	 */
+	uint8		shift;
+} rt_node;
+
+#define NODE_IS_LEAF(n)			((n)->shift == 0)
+#define NODE_IS_EMPTY(n)		((n)->count == 0)
+
+typedef struct rt_node_4
+{
+	rt_node		base;
+
+	/* chunks[i] is the chunk of slots[i]; sorted in ascending order */
+	uint8		chunks[4];
+	rt_pointer	slots[4];
+} rt_node_4;
+
+typedef struct rt_node_16
+{
+	rt_node		base;
+
+	/* chunks[i] is the chunk of slots[i]; sorted in ascending order */
+	uint8		chunks[16];
+	rt_pointer	slots[16];
+} rt_node_16;
+
+/* Marks unused entries in rt_node_48->slot_idxs */
+#define RT_NODE_48_INVALID_IDX	0xFF
+
+typedef struct rt_node_48
+{
+	rt_node		base;
+
+	/* Position in slots[] of the child for each chunk, or invalid */
+	uint8		slot_idxs[RT_NODE_MAX_SLOTS];
+
+	/* Bitmap of the used positions in slots[] */
+	uint64		isset;
+
+	rt_pointer	slots[48];
+} rt_node_48;
+
+typedef struct rt_node_256
+{
+	rt_node		base;
+
+	/* Bitmap of the chunks that have a child */
+	uint64		isset[RT_NODE_MAX_SLOTS / 64];
+
+	rt_pointer	slots[RT_NODE_MAX_SLOTS];
+} rt_node_256;
+
+typedef struct rt_node_kind_info_elem
+{
+	const char *name;
+	int			fanout;
+	Size		size;
+} rt_node_kind_info_elem;
+
+static const rt_node_kind_info_elem rt_node_kind_info[RT_NODE_KIND_COUNT] = {
+	[RT_NODE_KIND_4] = {"radix tree node 4", 4, sizeof(rt_node_4)},
+	[RT_NODE_KIND_16] = {"radix tree node 16", 16, sizeof(rt_node_16)},
+	[RT_NODE_KIND_48] = {"radix tree node 48", 48, sizeof(rt_node_48)},
+	[RT_NODE_KIND_256] = {"radix tree node 256", 256, sizeof(rt_node_256)},
+};
+
+/*
+ * Block size of the slab contexts holding the nodes of a local tree: room
+ * for at least 32 nodes, and no less than the default slab block size.
+ */
+#define RT_SLAB_BLOCK_SIZE(size) \
+	Max((SLAB_DEFAULT_BLOCK_SIZE / (size)) * (size), (size) * 32)
+
+#define RT_RADIX_TREE_MAGIC		0x54A48167
+
+/*
+ * The part of the tree state that is shared among all backends using the
+ * tree.  For a local tree it lives in local memory.
+ */
+typedef struct rt_control
+{
+	/* Handle of this struct in a shared tree, else InvalidDsaPointer */
+	rt_handle	handle;
+	uint32		magic;
+
+	rt_pointer	root;
+
+	/* The largest key that can be stored without adding levels */
+	uint64		max_val;
+
+	uint64		num_keys;
+} rt_control;
+
+struct radix_tree
+{
+	/*
+	 * For a local tree, a context owned by the tree which holds everything
+	 * including this struct.  For a shared tree, the context this struct was
+	 * allocated in.
+	 */
+	MemoryContext context;
+
+	rt_control *ctl;
+
+	/* DSA area holding a shared tree; NULL for a local tree */
+	dsa_area   *dsa;
+
+	/* Slab contexts for each node kind of a local tree */
+	MemoryContext node_slabs[RT_NODE_KIND_COUNT];
+};
+
+/* Iteration state for one level of the tree */
+typedef struct rt_node_iter
+{
+	rt_node    *node;
+
+	/* Position to continue from, as understood by rt_node_iterate_next() */
+	int			idx;
+} rt_node_iter;
+
+struct rt_iter
+{
+	radix_tree *tree;
+
+	/* One entry per level, indexed by node shift / RT_SPAN */
+	rt_node_iter stack[RT_MAX_LEVEL];
+
+	/* Level of the root, or -1 if the tree was empty */
+	int			top_level;
+
+	/* Level of the node we are currently returning children from */
+	int			cur_level;
+
+	/* The key built up from the chunks of the nodes on the current path */
+	uint64		key;
+};
+
+/*
+ * Return the shift of a node that can dispatch on the most significant
+ * non-zero chunk of the key.
+ */
+static inline int
+key_get_shift(uint64 key)
+{
+	if (key == 0)
+		return 0;
+
+	return (pg_leftmost_one_pos64(key) / RT_SPAN) * RT_SPAN;
+}
+
+/* Return the largest key that a tree whose root has the given shift can hold */
+static inline uint64
+shift_get_max_val(int shift)
+{
+	if (shift == (RT_MAX_LEVEL - 1) * RT_SPAN)
+		return PG_UINT64_MAX;
+
+	return (UINT64CONST(1) << (shift + RT_SPAN)) - 1;
+}
+
+/* Convert an rt_pointer to a pointer usable in this backend */
+static inline rt_node *
+rt_ptr_get_local(radix_tree *tree, rt_pointer ptr)
+{
+	if (RT_IS_SHARED(tree))
+		return (rt_node *) dsa_get_address(tree->dsa, (dsa_pointer) ptr);
+
+	return (rt_node *) (uintptr_t) ptr;
+}
+
+/*
+ * Allocate an empty node of the given kind and shift.  Returns its
+ * rt_pointer, and the local address in *node_p.
+ */
+static rt_pointer
+rt_alloc_node(radix_tree *tree, int kind, int shift, rt_node **node_p)
+{
+	Size		size = rt_node_kind_info[kind].size;
+	rt_pointer	ptr;
+	rt_node    *node;
+
+	if (RT_IS_SHARED(tree))
+	{
+		dsa_pointer dp = dsa_allocate(tree->dsa, size);
+
+		node = (rt_node *) dsa_get_address(tree->dsa, dp);
+		ptr = (rt_pointer) dp;
+	}
+	else
+	{
+		node = (rt_node *) MemoryContextAlloc(tree->node_slabs[kind], size);
+		ptr = (rt_pointer) (uintptr_t) node;
+	}
+
+	node->count = 0;
+	node->kind = kind;
+	node->shift = shift;
+
+	switch (kind)
+	{
+		case RT_NODE_KIND_4:
+		case RT_NODE_KIND_16:
+			break;
+		case RT_NODE_KIND_48:
+			{
+				rt_node_48 *n48 = (rt_node_48 *) node;
+
+				memset(n48->slot_idxs, RT_NODE_48_INVALID_IDX,
+					   sizeof(n48->slot_idxs));
+				n48->isset = 0;
+				break;
+			}
+		case RT_NODE_KIND_256:
+			{
+				rt_node_256 *n256 = (rt_node_256 *) node;
+
+				memset(n256->isset, 0, sizeof(n256->isset));
+				break;
+			}
+	}
+
+	*node_p = node;
+	return ptr;
+}
+
+static void
+rt_free_node(radix_tree *tree, rt_pointer ptr)
+{
+	if (RT_IS_SHARED(tree))
+		dsa_free(tree->dsa, (dsa_pointer) ptr);
+	else
+		pfree((void *) (uintptr_t) ptr);
+}
+
+/* Return the position of the chunk in a node-16, or -1 if not present */
+static inline int
+rt_node_16_search_eq(rt_node_16 *n16, uint8 chunk)
+{
+	int			count = n16->base.count;
+#ifndef USE_NO_SIMD
+	Vector8		haystack;
+	uint32		bitfield;
+
+	StaticAssertStmt(sizeof(Vector8) == sizeof(n16->chunks),
+					 "node-16 chunks must fill one vector");
+
+	/* unused entries past count may hold garbage, so mask them off */
+	vector8_load(&haystack, n16->chunks);
+	bitfield = vector8_highbit_mask(vector8_eq(haystack,
+											   vector8_broadcast(chunk)));
+	bitfield &= ((uint32) 1 << count) - 1;
+
+	return bitfield != 0 ? pg_rightmost_one_pos32(bitfield) : -1;
+#else
+	for (int i = 0; i < count; i++)
+	{
+		if (n16->chunks[i] == chunk)
+			return i;
+	}
+
+	return -1;
+#endif
+}
+
+/*
+ * Return the address of the slot for the given chunk in the node, or NULL if
+ * the node has no such child.
+ */
+static inline rt_pointer *
+rt_node_search(rt_node *node, uint8 chunk)
+{
+	switch (node->kind)
+	{
+		case RT_NODE_KIND_4:
+			{
+				rt_node_4  *n4 = (rt_node_4 *) node;
+
+				for (int i = 0; i < n4->base.count; i++)
+				{
+					if (n4->chunks[i] == chunk)
+						return &n4->slots[i];
+				}
+				return NULL;
+			}
+		case RT_NODE_KIND_16:
+			{
+				rt_node_16 *n16 = (rt_node_16 *) node;
+				int			idx = rt_node_16_search_eq(n16, chunk);
+
+				return idx >= 0 ? &n16->slots[idx] : NULL;
+			}
+		case RT_NODE_KIND_48:
+			{
+				rt_node_48 *n48 = (rt_node_48 *) node;
+				int			idx = n48->slot_idxs[chunk];
+
+				return idx != RT_NODE_48_INVALID_IDX ? &n48->slots[idx] : NULL;
+			}
+		case RT_NODE_KIND_256:
+			{
+				rt_node_256 *n256 = (rt_node_256 *) node;
+
+				if ((n256->isset[chunk / 64] & (UINT64CONST(1) << (chunk % 64))) == 0)
+					return NULL;
+				return &n256->slots[chunk];
+			}
+	}
+
+	pg_unreachable();
+	return NULL;
+}
+
+/*
+ * Insert a chunk and slot into the sorted arrays of a node-4 or node-16,
+ * which must have room for it.
+ */
+static inline void
+rt_chunk_array_insert(uint8 *chunks, rt_pointer *slots, int count,
+					  uint8 chunk, rt_pointer slot)
+{
+	int			idx;
+
+	for (idx = 0; idx < count; idx++)
+	{
+		Assert(chunks[idx] != chunk);
+		if (chunks[idx] > chunk)
+			break;
+	}
+
+	memmove(&chunks[idx + 1], &chunks[idx], sizeof(uint8) * (count - idx));
+	memmove(&slots[idx + 1], &slots[idx], sizeof(rt_pointer) * (count - idx));
+	chunks[idx] = chunk;
+	slots[idx] = slot;
+}
+
+/* Remove the element at position idx from the sorted arrays of a node */
+static inline void
+rt_chunk_array_delete(uint8 *chunks, rt_pointer *slots, int count, int idx)
+{
+	memmove(&chunks[idx], &chunks[idx + 1], sizeof(uint8) * (count - idx - 1));
+	memmove(&slots[idx], &slots[idx + 1], sizeof(rt_pointer) * (count - idx - 1));
+}
+
+/*
+ * Add a child to a node that has room for it.  The chunk must not already
+ * be present.
+ */
+static void
+rt_node_add_child(rt_node *node, uint8 chunk, rt_pointer slot)
+{
+	Assert(node->count < rt_node_kind_info[node->kind].fanout);
+
+	switch (node->kind)
+	{
+		case RT_NODE_KIND_4:
+			{
+				rt_node_4  *n4 = (rt_node_4 *) node;
+
+				rt_chunk_array_insert(n4->chunks, n4->slots, n4->base.count,
+									  chunk, slot);
+				break;
+			}
+		case RT_NODE_KIND_16:
+			{
+				rt_node_16 *n16 = (rt_node_16 *) node;
+
+				rt_chunk_array_insert(n16->chunks, n16->slots, n16->base.count,
+									  chunk, slot);
+				break;
+			}
+		case RT_NODE_KIND_48:
+			{
+				rt_node_48 *n48 = (rt_node_48 *) node;
+				int			idx;
+
+				Assert(n48->slot_idxs[chunk] == RT_NODE_48_INVALID_IDX);
+
+				/* use the first unused position */
+				idx = pg_rightmost_one_pos64(~n48->isset);
+				Assert(idx < 48);
+
+				n48->isset |= UINT64CONST(1) << idx;
+				n48->slot_idxs[chunk] = idx;
+				n48->slots[idx] = slot;
+				break;
+			}
+		case RT_NODE_KIND_256:
+			{
+				rt_node_256 *n256 = (rt_node_256 *) node;
+
+				n256->isset[chunk / 64] |= UINT64CONST(1) << (chunk % 64);
+				n256->slots[chunk] = slot;
+				break;
+			}
+	}
+
+	node->count++;
+}
+
+/* Remove the child for the given chunk, which must be present, from a node */
+static void
+rt_node_remove_child(rt_node *node, uint8 chunk)
+{
+	switch (node->kind)
+	{
+		case RT_NODE_KIND_4:
+			{
+				rt_node_4  *n4 = (rt_node_4 *) node;
+				int			idx;
+
+				for (idx = 0; n4->chunks[idx] != chunk; idx++)
+					Assert(idx < n4->base.count);
+				rt_chunk_array_delete(n4->chunks, n4->slots, n4->base.count, idx);
+				break;
+			}
+		case RT_NODE_KIND_16:
+			{
+				rt_node_16 *n16 = (rt_node_16 *) node;
+				int			idx = rt_node_16_search_eq(n16, chunk);
+
+				Assert(idx >= 0);
+				rt_chunk_array_delete(n16->chunks, n16->slots, n16->base.count, idx);
+				break;
+			}
+		case RT_NODE_KIND_48:
+			{
+				rt_node_48 *n48 = (rt_node_48 *) node;
+				int			idx = n48->slot_idxs[chunk];
+
+				Assert(idx != RT_NODE_48_INVALID_IDX);
+				n48->isset &= ~(UINT64CONST(1) << idx);
+				n48->slot_idxs[chunk] = RT_NODE_48_INVALID_IDX;
+				break;
+			}
+		case RT_NODE_KIND_256:
+			{
+				rt_node_256 *n256 = (rt_node_256 *) node;
+
+				n256->isset[chunk / 64] &= ~(UINT64CONST(1) << (chunk % 64));
+				break;
+			}
+	}
+
+	node->count--;
+}
+
+/*
+ * Copy a full node into a new node of the next larger kind.  Returns the
+ * new node's rt_pointer, and its local address in *newnode_p.
+ */
+static rt_pointer
+rt_grow_node(radix_tree *tree, rt_node *node, rt_node **newnode_p)
+{
+	rt_node    *newnode;
+	rt_pointer	newptr;
+
+	Assert(node->kind < RT_NODE_KIND_256);
+
+	newptr = rt_alloc_node(tree, node->kind + 1, node->shift, &newnode);
+
+	switch (node->kind)
+	{
+		case RT_NODE_KIND_4:
+			{
+				rt_node_4  *n4 = (rt_node_4 *) node;
+				rt_node_16 *n16 = (rt_node_16 *) newnode;
+
+				memcpy(n16->chunks, n4->chunks, sizeof(uint8) * n4->base.count);
+				memcpy(n16->slots, n4->slots, sizeof(rt_pointer) * n4->base.count);
+				break;
+			}
+		case RT_NODE_KIND_16:
+			{
+				rt_node_16 *n16 = (rt_node_16 *) node;
+				rt_node_48 *n48 = (rt_node_48 *) newnode;
+
+				for (int i = 0; i < n16->base.count; i++)
+				{
+					n48->slot_idxs[n16->chunks[i]] = i;
+					n48->slots[i] = n16->slots[i];
+				}
+				n48->isset = (UINT64CONST(1) << n16->base.count) - 1;
+				break;
+			}
+		case RT_NODE_KIND_48:
+			{
+				rt_node_48 *n48 = (rt_node_48 *) node;
+				rt_node_256 *n256 = (rt_node_256 *) newnode;
+
+				for (int chunk = 0; chunk < RT_NODE_MAX_SLOTS; chunk++)
+				{
+					int			idx = n48->slot_idxs[chunk];
+
+					if (idx == RT_NODE_48_INVALID_IDX)
+						continue;
+
+					n256->isset[chunk / 64] |= UINT64CONST(1) << (chunk % 64);
+					n256->slots[chunk] = n48->slots[idx];
+				}
+				break;
+			}
+	}
+
+	newnode->count = node->count;
+
+	*newnode_p = newnode;
+	return newptr;
+}
+
+/*
+ * Add a child to a node, first replacing the node with a larger one if it's
+ * full.  parent_slot is the slot pointing to the node, which is updated if
+ * the node is replaced.
+ */
+static void
+rt_node_insert(radix_tree *tree, rt_pointer *parent_slot, rt_pointer nodeptr,
+			   rt_node *node, uint8 chunk, rt_pointer slot)
+{
+	if (node->count == rt_node_kind_info[node->kind].fanout)
+	{
+		rt_node    *newnode;
+
+		*parent_slot = rt_grow_node(tree, node, &newnode);
+		rt_free_node(tree, nodeptr);
+		node = newnode;
+	}
+
+	rt_node_add_child(node, chunk, slot);
+}
+
+/*
+ * Return the slot of the next child of the node in chunk order, starting at
+ * position *idx, and advance *idx past it.  The chunk of the child is
+ * returned in *chunk_p.  Returns NULL when there are no more children.
+ */
+static rt_pointer *
+rt_node_iterate_next(rt_node *node, int *idx, uint8 *chunk_p)
+{
+	switch (node->kind)
+	{
+		case RT_NODE_KIND_4:
+			{
+				rt_node_4  *n4 = (rt_node_4 *) node;
+
+				if (*idx >= n4->base.count)
+					return NULL;
+				*chunk_p = n4->chunks[*idx];
+				return &n4->slots[(*idx)++];
+			}
+		case RT_NODE_KIND_16:
+			{
+				rt_node_16 *n16 = (rt_node_16 *) node;
+
+				if (*idx >= n16->base.count)
+					return NULL;
+				*chunk_p = n16->chunks[*idx];
+				return &n16->slots[(*idx)++];
+			}
+		case RT_NODE_KIND_48:
+			{
+				rt_node_48 *n48 = (rt_node_48 *) node;
+
+				for (int chunk = *idx; chunk < RT_NODE_MAX_SLOTS; chunk++)
+				{
+					int			slotpos = n48->slot_idxs[chunk];
+
+					if (slotpos == RT_NODE_48_INVALID_IDX)
+						continue;
+
+					*idx = chunk + 1;
+					*chunk_p = chunk;
+					return &n48->slots[slotpos];
+				}
+				*idx = RT_NODE_MAX_SLOTS;
+				return NULL;
+			}
+		case RT_NODE_KIND_256:
+			{
+				rt_node_256 *n256 = (rt_node_256 *) node;
+
+				while (*idx < RT_NODE_MAX_SLOTS)
+				{
+					int			chunk = *idx;
+					uint64		word;
+
+					/* skip the unset bits below chunk in the current word */
+					word = n256->isset[chunk / 64] & (PG_UINT64_MAX << (chunk % 64));
+					if (word == 0)
+					{
+						*idx = (chunk / 64 + 1) * 64;
+						continue;
+					}
+
+					chunk = (chunk / 64) * 64 + pg_rightmost_one_pos64(word);
+					*idx = chunk + 1;
+					*chunk_p = chunk;
+					return &n256->slots[chunk];
+				}
+				return NULL;
+			}
+	}
+
+	pg_unreachable();
+	return NULL;
+}
+
+/* Create the root of an empty tree, tall enough for the given key */
+static void
+rt_new_root(radix_tree *tree, uint64 key)
+{
+	int			shift = key_get_shift(key);
+	rt_node    *node;
+
+	tree->ctl->root = rt_alloc_node(tree, RT_NODE_KIND_4, shift, &node);
+	tree->ctl->max_val = shift_get_max_val(shift);
+}
+
+/* Add levels on top of the root until the tree can hold the given key */
+static void
+rt_extend_up(radix_tree *tree, uint64 key)
+{
+	rt_control *ctl = tree->ctl;
+	int			target_shift = key_get_shift(key);
+	int			shift = rt_ptr_get_local(tree, ctl->root)->shift;
+
+	while (shift < target_shift)
+	{
+		rt_node    *node;
+		rt_pointer	ptr;
+
+		shift += RT_SPAN;
+		ptr = rt_alloc_node(tree, RT_NODE_KIND_4, shift, &node);
+		rt_node_add_child(node, 0, ctl->root);
+		ctl->root = ptr;
+	}
+
+	ctl->max_val = shift_get_max_val(target_shift);
+}
+
+/*
+ * Build a chain of nodes from the given shift down to the lowest level,
+ * holding only the given key and value.  Returns the top node.
+ */
+static rt_pointer
+rt_extend_down(radix_tree *tree, uint64 key, uint64 val, int shift)
+{
+	rt_node    *node;
+	rt_pointer	top;
+
+	top = rt_alloc_node(tree, RT_NODE_KIND_4, shift, &node);
+
+	while (shift > 0)
+	{
+		rt_node    *child;
+		rt_pointer	childptr;
+
+		childptr = rt_alloc_node(tree, RT_NODE_KIND_4, shift - RT_SPAN, &child);
+		rt_node_add_child(node, RT_GET_KEY_CHUNK(key, shift), childptr);
+
+		node = child;
+		shift -= RT_SPAN;
+	}
+
+	rt_node_add_child(node, RT_GET_KEY_CHUNK(key, 0), (rt_pointer) val);
+
+	return top;
+}
+
+/*
+ * Create a radix tree.  If dsa is not NULL, the tree is allocated in it and
+ * can be shared with other backends.  Local memory is allocated in ctx.
+ */
+radix_tree *
+rt_create(MemoryContext ctx, dsa_area *dsa)
+{
+	radix_tree *tree;
+
+	if (dsa != NULL)
+	{
+		dsa_pointer dp;
+
+		tree = (radix_tree *) MemoryContextAllocZero(ctx, sizeof(radix_tree));
+		tree->context = ctx;
+		tree->dsa = dsa;
+
+		dp = dsa_allocate0(dsa, sizeof(rt_control));
+		tree->ctl = (rt_control *) dsa_get_address(dsa, dp);
+		tree->ctl->handle = dp;
+	}
+	else
+	{
+		MemoryContext tree_ctx;
+
+		tree_ctx = AllocSetContextCreate(ctx, "radix tree",
+										 ALLOCSET_SMALL_SIZES);
+
+		tree = (radix_tree *) MemoryContextAllocZero(tree_ctx,
+													 sizeof(radix_tree));
+		tree->context = tree_ctx;
+		tree->ctl = (rt_control *) MemoryContextAllocZero(tree_ctx,
+														  sizeof(rt_control));
+		tree->ctl->handle = InvalidDsaPointer;
+
+		for (int i = 0; i < RT_NODE_KIND_COUNT; i++)
+		{
+			Size		size = rt_node_kind_info[i].size;
+
+			tree->node_slabs[i] = SlabContextCreate(tree_ctx,
+													rt_node_kind_info[i].name,
+													RT_SLAB_BLOCK_SIZE(size),
+													size);
+		}
+	}
+
+	tree->ctl->magic = RT_RADIX_TREE_MAGIC;
+	tree->ctl->root = InvalidRTPointer;
+	tree->ctl->max_val = 0;
+	tree->ctl->num_keys = 0;
+
+	return tree;
+}
+
+/* Free a node of a shared tree and everything below it */
+static void
+rt_free_recurse(radix_tree *tree, rt_pointer ptr)
+{
+	rt_node    *node = rt_ptr_get_local(tree, ptr);
+
+	if (!NODE_IS_LEAF(node))
+	{
+		rt_pointer *slot;
+		uint8		chunk;
+		int			idx = 0;
+
+		while ((slot = rt_node_iterate_next(node, &idx, &chunk)) != NULL)
+			rt_free_recurse(tree, *slot);
+	}
+
+	rt_free_node(tree, ptr);
+}
+
+/*
+ * Free the tree, including the memory in the DSA area for a shared tree.
+ * Nobody must be attached to a shared tree at this point.
+ */
+void
+rt_free(radix_tree *tree)
+{
+	if (RT_IS_SHARED(tree))
+	{
+		rt_control *ctl = tree->ctl;
+
+		Assert(ctl->magic == RT_RADIX_TREE_MAGIC);
+
+		if (RTPointerIsValid(ctl->root))
+			rt_free_recurse(tree, ctl->root);
+
+		ctl->magic = 0;
+		dsa_free(tree->dsa, ctl->handle);
+		pfree(tree);
+	}
+	else
+		MemoryContextDelete(tree->context);
+}
+
+/*
+ * Search for the given key.  If found, store its value in *val_p and return
+ * true.
+ */
+bool
+rt_search(radix_tree *tree, uint64 key, uint64 *val_p)
+{
+	rt_control *ctl = tree->ctl;
+	rt_pointer	ptr;
+
+	Assert(ctl->magic == RT_RADIX_TREE_MAGIC);
+
+	if (!RTPointerIsValid(ctl->root) || key > ctl->max_val)
+		return false;
+
+	ptr = ctl->root;
+	for (;;)
+	{
+		rt_node    *node = rt_ptr_get_local(tree, ptr);
+		rt_pointer *slot;
+
+		slot = rt_node_search(node, RT_GET_KEY_CHUNK(key, node->shift));
+		if (slot == NULL)
+			return false;
+
+		if (NODE_IS_LEAF(node))
+		{
+			*val_p = (uint64) *slot;
+			return true;
+		}
+
+		ptr = *slot;
+	}
+}
+
+/*
+ * Set the value of the given key, inserting it if it doesn't exist yet.
+ * Returns true if the key already existed.
+ */
+bool
+rt_set(radix_tree *tree, uint64 key, uint64 val)
+{
+	rt_control *ctl = tree->ctl;
+	rt_pointer *parent_slot;
+	rt_pointer	ptr;
+
+	Assert(ctl->magic == RT_RADIX_TREE_MAGIC);
+
+	if (!RTPointerIsValid(ctl->root))
+		rt_new_root(tree, key);
+	else if (key > ctl->max_val)
+		rt_extend_up(tree, key);
+
+	parent_slot = &ctl->root;
+	ptr = ctl->root;
+	for (;;)
+	{
+		rt_node    *node = rt_ptr_get_local(tree, ptr);
+		uint8		chunk = RT_GET_KEY_CHUNK(key, node->shift);
+		rt_pointer *slot;
+
+		slot = rt_node_search(node, chunk);
+
+		if (slot == NULL)
+		{
+			rt_pointer	child;
+
+			if (NODE_IS_LEAF(node))
+				child = (rt_pointer) val;
+			else
+				child = rt_extend_down(tree, key, val, node->shift - RT_SPAN);
+
+			rt_node_insert(tree, parent_slot, ptr, node, chunk, child);
+			ctl->num_keys++;
+			return false;
+		}
+
+		if (NODE_IS_LEAF(node))
+		{
+			*slot = (rt_pointer) val;
+			return true;
+		}
+
+		parent_slot = slot;
+		ptr = *slot;
+	}
+}
+
+/*
+ * Delete the given key.  Returns true if it was found.
+ */
+bool
+rt_delete(radix_tree *tree, uint64 key)
+{
+	rt_control *ctl = tree->ctl;
+	rt_node    *stack[RT_MAX_LEVEL];
+	rt_pointer	stack_ptr[RT_MAX_LEVEL];
+	rt_pointer	ptr;
+	int			level = -1;
+
+	Assert(ctl->magic == RT_RADIX_TREE_MAGIC);
+
+	if (!RTPointerIsValid(ctl->root) || key > ctl->max_val)
+		return false;
+
+	/* Descend to the lowest level, remembering the path */
+	ptr = ctl->root;
+	for (;;)
+	{
+		rt_node    *node = rt_ptr_get_local(tree, ptr);
+		rt_pointer *slot;
+
+		level++;
+		stack[level] = node;
+		stack_ptr[level] = ptr;
+
+		slot = rt_node_search(node, RT_GET_KEY_CHUNK(key, node->shift));
+		if (slot == NULL)
+			return false;
+
+		if (NODE_IS_LEAF(node))
+			break;
+
+		ptr = *slot;
+	}
+
+	ctl->num_keys--;
+
+	/*
+	 * Remove the key from the lowest level node, and then remove and free any
+	 * nodes on the path that become empty.
+	 */
+	for (; level >= 0; level--)
+	{
+		rt_node    *node = stack[level];
+
+		rt_node_remove_child(node, RT_GET_KEY_CHUNK(key, node->shift));
+		if (!NODE_IS_EMPTY(node))
+			break;
+
+		rt_free_node(tree, stack_ptr[level]);
+	}
+
+	/* The tree is now empty if we freed the root */
+	if (level < 0)
+	{
+		ctl->root = InvalidRTPointer;
+		ctl->max_val = 0;
+	}
+
+	return true;
+}
+
+/*
+ * Begin iterating over the keys of the tree, in ascending order.
+ */
+rt_iter *
+rt_begin_iterate(radix_tree *tree)
+{
+	rt_iter    *iter;
+
+	iter = (rt_iter *) palloc0(sizeof(rt_iter));
+	iter->tree = tree;
+
+	if (RTPointerIsValid(tree->ctl->root))
+	{
+		rt_node    *root = rt_ptr_get_local(tree, tree->ctl->root);
+
+		iter->top_level = root->shift / RT_SPAN;
+		iter->stack[iter->top_level].node = root;
+		iter->stack[iter->top_level].idx = 0;
+	}
+	else
+		iter->top_level = -1;
+
+	iter->cur_level = iter->top_level;
+
+	return iter;
+}
+
+/*
+ * Return the next key and its value.  Returns false when there are no more
+ * keys.
+ */
+bool
+rt_iterate_next(rt_iter *iter, uint64 *key_p, uint64 *val_p)
+{
+	if (iter->top_level < 0)
+		return false;
+
+	for (;;)
+	{
+		rt_node_iter *niter = &iter->stack[iter->cur_level];
+		rt_node    *node = niter->node;
+		rt_pointer *slot;
+		uint8		chunk;
+
+		slot = rt_node_iterate_next(node, &niter->idx, &chunk);
+
+		if (slot == NULL)
+		{
+			/* This node is exhausted, continue with its parent */
+			if (iter->cur_level == iter->top_level)
+				return false;
+			iter->cur_level++;
+			continue;
+		}
+
+		iter->key &= ~(((uint64) RT_CHUNK_MASK) << node->shift);
+		iter->key |= ((uint64) chunk) << node->shift;
+
+		if (NODE_IS_LEAF(node))
+		{
+			*key_p = iter->key;
+			*val_p = (uint64) *slot;
+			return true;
+		}
+
+		/* Descend to the child */
+		iter->cur_level--;
+		iter->stack[iter->cur_level].node = rt_ptr_get_local(iter->tree, *slot);
+		iter->stack[iter->cur_level].idx = 0;
+	}
+}
+
+void
+rt_end_iterate(rt_iter *iter)
+{
+	pfree(iter);
+}
+
+/* Return the number of keys in the tree */
+uint64
+rt_num_entries(radix_tree *tree)
+{
+	return tree->ctl->num_keys;
+}
+
+/*
+ * Return the amount of memory used by the tree.  For a shared tree, this is
+ * the size of the whole DSA area, which may hold other objects too.
+ */
+uint64
+rt_memory_usage(radix_tree *tree)
+{
+	if (RT_IS_SHARED(tree))
+		return dsa_get_total_size(tree->dsa);
+
+	return MemoryContextMemAllocated(tree->context, true);
+}
+
+/* Return a handle that other backends can use to attach to a shared tree */
+rt_handle
+rt_get_handle(radix_tree *tree)
+{
+	Assert(RT_IS_SHARED(tree));
+	Assert(tree->ctl->magic == RT_RADIX_TREE_MAGIC);
+
+	return tree->ctl->handle;
+}
+
+/*
+ * Attach to a shared tree created by another backend.  The local state is
+ * allocated in CurrentMemoryContext.
+ */
+radix_tree *
+rt_attach(dsa_area *dsa, rt_handle handle)
+{
+	radix_tree *tree;
+
+	tree = (radix_tree *) palloc0(sizeof(radix_tree));
+	tree->context = CurrentMemoryContext;
+	tree->dsa = dsa;
+	tree->ctl = (rt_control *) dsa_get_address(dsa, handle);
+	Assert(tree->ctl->magic == RT_RADIX_TREE_MAGIC);
+
+	return tree;
+}
+
+/* Release the local state of a shared tree, leaving the tree intact */
+void
+rt_detach(radix_tree *tree)
+{
+	Assert(RT_IS_SHARED(tree));
+	Assert(tree->ctl->magic == RT_RADIX_TREE_MAGIC);
+
+	pfree(tree);
+}
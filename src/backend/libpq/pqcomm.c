@@ -140,6 +140,7 @@ static bool PqCommReadingMsg;	/* in the middle of reading a message */
 /* Internal functions */
 static void socket_comm_reset(void);
 static void socket_close(int code, Datum arg);
+static void socket_create_wait_set(void);
 static void socket_set_nonblocking(bool nonblocking);
 static int	socket_flush(void);
 static int	socket_flush_if_writable(void);
@@ -175,9 +176,6 @@ WaitEventSet *FeBeWaitSet;
 void
 pq_init(void)
 {
-	int			socket_pos PG_USED_FOR_ASSERTS_ONLY;
-	int			latch_pos PG_USED_FOR_ASSERTS_ONLY;
-
 	/* initialize state variables */
 	PqSendBufferSize = PQ_SEND_BUFFER_SIZE;
 	PqSendBuffer = MemoryContextAlloc(TopMemoryContext, PqSendBufferSize);
@@ -204,6 +202,45 @@ pq_init(void)
 				(errmsg("could not set socket to nonblocking mode: %m")));
 #endif
 
+	socket_create_wait_set();
+}
+
+/* --------------------------------
+ *		pq_replace_socket - talk to the client through a different socket
+ *
+ * This is used to make a backend talk to a connection proxy, which relays
+ * the client's messages, instead of directly to the client.  The old socket
+ * is closed.  There mustn't be any buffered data.
+ * --------------------------------
+ */
+void
+pq_replace_socket(pgsocket sock)
+{
+	Assert(PqRecvPointer == PqRecvLength);
+	Assert(PqSendStart == PqSendPointer);
+
+	FreeWaitEventSet(FeBeWaitSet);
+	closesocket(MyProcPort->sock);
+	MyProcPort->sock = sock;
+
+#ifndef WIN32
+	if (!pg_set_noblock(MyProcPort->sock))
+		ereport(COMMERROR,
+				(errmsg("could not set socket to nonblocking mode: %m")));
+#endif
+
+	socket_create_wait_set();
+}
+
+/*
+ * Set up FeBeWaitSet for MyProcPort->sock.
+ */
+static void
+socket_create_wait_set(void)
+{
+	int			socket_pos PG_USED_FOR_ASSERTS_ONLY;
+	int			latch_pos PG_USED_FOR_ASSERTS_ONLY;
+
 	FeBeWaitSet = CreateWaitEventSet(TopMemoryContext, FeBeWaitSetNEvents);
 	socket_pos = AddWaitEventToSet(FeBeWaitSet, WL_SOCKET_WRITEABLE,
 								   MyProcPort->sock, NULL, NULL);
@@ -150,6 +150,7 @@ bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = false;
 bool		enable_partition_pruning = true;
 bool		enable_async_append = true;
 
@@ -3124,6 +3125,53 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_parallel_hashagg
+ *		Determines and returns the cost of performing a Parallel Finalize
+ *		HashAggregate, as seen by one participant, including the cost of its
+ *		(partial) input.
+ *
+ * Each participant writes all of its input tuples to shared partitions and
+ * reads back about its share of them, then combines and finalizes about its
+ * share of the groups.  numGroups is the total number of groups; input_tuples
+ * is per participant, as usual for a partial path.  path->parallel_workers
+ * must be set already.
+ */
+void
+cost_parallel_hashagg(Path *path, PlannerInfo *root,
+					  const AggClauseCosts *aggcosts,
+					  int numGroupCols, double numGroups,
+					  List *quals,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double input_tuples, double input_width)
+{
+	double		parallel_divisor = get_parallel_divisor(path);
+	int			npartitions;
+	double		pages;
+	Cost		partition_cost;
+
+	cost_agg(path, root, AGG_HASHED, aggcosts,
+			 numGroupCols, clamp_row_est(numGroups / parallel_divisor),
+			 quals,
+			 input_startup_cost, input_total_cost,
+			 input_tuples, input_width);
+
+	/*
+	 * Every input tuple is written out once and read back once, before any
+	 * output can be produced.  A participant writes at least one page to
+	 * each partition, so charge at least that much.
+	 */
+	npartitions = hash_agg_parallel_num_partitions(path->parallel_workers + 1);
+	pages = relation_byte_size(input_tuples, input_width) / BLCKSZ;
+	pages = Max(pages, npartitions);
+
+	partition_cost = 2.0 * pages * seq_page_cost;
+	partition_cost += 2.0 * cpu_tuple_cost * input_tuples;
+
+	path->startup_cost += partition_cost;
+	path->total_cost += partition_cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -6276,7 +6276,8 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (which must be of an index AM
+ * that supports parallel builds).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -6811,6 +6812,31 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 agg_final_costs,
 									 dNumGroups));
 		}
+
+		/*
+		 * Also consider finalizing the cheapest partially grouped partial
+		 * path below the Gather, with the groups repartitioned by hash among
+		 * the workers, so that the final phase is done in parallel too.
+		 * That's only likely to pay off with a very large number of groups,
+		 * so it's off by default.
+		 */
+		if (enable_parallel_hashagg && !parse->groupingSets &&
+			grouped_rel->consider_parallel &&
+			partially_grouped_rel &&
+			partially_grouped_rel->partial_pathlist != NIL)
+		{
+			Path	   *path = linitial(partially_grouped_rel->partial_pathlist);
+
+			add_partial_path(grouped_rel, (Path *)
+							 create_parallel_hashagg_path(root,
+														  grouped_rel,
+														  path,
+														  grouped_rel->reltarget,
+														  parse->groupClause,
+														  havingQual,
+														  agg_final_costs,
+														  dNumGroups));
+		}
 	}
 
 	/*
@@ -719,6 +719,28 @@ is_parallel_safe(PlannerInfo *root, Node *node)
 	return !max_parallel_hazard_walker(node, &context);
 }
 
+/*
+ * expression_is_parallel_safe
+ *		Detect whether the given expr contains only parallel-safe functions,
+ *		for callers outside the planner
+ *
+ * This is used by utility commands that evaluate expressions in parallel
+ * workers, such as parallel COPY FROM.  Unlike is_parallel_safe(), there is
+ * no planner state to consult, so all PARAM_EXEC Params are treated as
+ * parallel-restricted.
+ */
+bool
+expression_is_parallel_safe(Node *node)
+{
+	max_parallel_hazard_context context;
+
+	context.max_hazard = PROPARALLEL_SAFE;
+	context.max_interesting = PROPARALLEL_RESTRICTED;
+	context.safe_param_ids = NIL;
+
+	return !max_parallel_hazard_walker(node, &context);
+}
+
 /* core logic for all parallel-hazard checks */
 static bool
 max_parallel_hazard_test(char proparallel, max_parallel_hazard_context *context)
@@ -116,6 +116,7 @@
 #include "postmaster/interrupt.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "postmaster/syslogger.h"
 #include "replication/logicallauncher.h"
 #include "replication/walsender.h"
@@ -222,6 +223,9 @@ int			ReservedBackends;
 #define MAXLISTEN	64
 static pgsocket ListenSocket[MAXLISTEN];
 
+/* Which of them belong to the connection proxy port? */
+static bool ListenSocketProxied[MAXLISTEN];
+
 /*
  * These globals control the behavior of the postmaster in case some
  * backend dumps core.  Normally, it kills all peers of the dead backend
@@ -257,6 +261,9 @@ static pid_t StartupPID = 0,
 			PgArchPID = 0,
 			SysLoggerPID = 0;
 
+/* PIDs of connection proxies; 0 when not running */
+static pid_t ProxyPIDs[MAX_CONNECTION_PROXIES];
+
 /* Startup process's status */
 typedef enum
 {
@@ -419,6 +426,10 @@ static bool RandomCancelKey(int32 *cancel_key);
 static void signal_child(pid_t pid, int signal);
 static bool SignalSomeChildren(int signal, int targets);
 static void TerminateChildren(int signal);
+static void ListenOnProxyPort(void);
+static bool CleanupConnectionProxy(int pid, int exitstatus);
+static void StartConnectionProxies(void);
+static void SignalConnectionProxies(int signal);
 
 #define SignalChildren(sig)			   SignalSomeChildren(sig, BACKEND_TYPE_ALL)
 
@@ -517,6 +528,7 @@ typedef struct
 	bool		query_id_enabled;
 	int			max_safe_fds;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -1036,9 +1048,10 @@ PostmasterMain(int argc, char *argv[])
 
 	/*
 	 * Now that loadable modules have had their chance to alter any GUCs,
-	 * calculate MaxBackends.
+	 * calculate MaxBackends and the number of fast-path lock slots.
 	 */
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	/*
 	 * Give preloaded libraries a chance to request additional shared memory.
@@ -1367,6 +1380,16 @@ PostmasterMain(int argc, char *argv[])
 	if (!listen_addr_saved)
 		AddToDataDirLockFile(LOCK_FILE_LINE_LISTEN_ADDR, "");
 
+	/*
+	 * Open the sockets of the connection proxy port, and the channels the
+	 * backends use to hand their clients over to the proxies.
+	 */
+	if (ConnectionProxies > 0)
+	{
+		ListenOnProxyPort();
+		ProxyCreateHandoverSockets();
+	}
+
 	/*
 	 * Record postmaster options.  We delay this till now to avoid recording
 	 * bogus options (eg, unusable port number).
@@ -1466,6 +1489,9 @@ PostmasterMain(int argc, char *argv[])
 	if (BgWriterPID == 0)
 		BgWriterPID = StartBackgroundWriter();
 
+	/* Connection proxies don't depend on the state of the database */
+	StartConnectionProxies();
+
 	/*
 	 * We're ready to rock and roll...
 	 */
@@ -1805,6 +1831,7 @@ ServerLoop(void)
 					port = ConnCreate(ListenSocket[i]);
 					if (port)
 					{
+						port->proxied = ListenSocketProxied[i];
 						BackendStartup(port);
 
 						/*
@@ -1822,6 +1849,10 @@ ServerLoop(void)
 		if (SysLoggerPID == 0 && Logging_collector)
 			SysLoggerPID = SysLogger_Start();
 
+		/* Likewise for the connection proxies, unless we're shutting down */
+		if (Shutdown == NoShutdown)
+			StartConnectionProxies();
+
 		/*
 		 * If no background writer process is running, and we are not in a
 		 * state that prevents it, start one.  It doesn't matter if this
@@ -2087,8 +2118,12 @@ ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done)
 		char		SSLok;
 
 #ifdef USE_SSL
-		/* No SSL when disabled or on Unix sockets */
-		if (!LoadedSSL || port->laddr.addr.ss_family == AF_UNIX)
+		/*
+		 * No SSL when disabled or on Unix sockets, nor on the connection
+		 * proxy port, since the proxy relays the client's traffic in clear.
+		 */
+		if (!LoadedSSL || port->laddr.addr.ss_family == AF_UNIX ||
+			port->proxied)
 			SSLok = 'N';
 		else
 			SSLok = 'S';		/* Support for SSL */
@@ -2136,8 +2171,8 @@ retry1:
 		char		GSSok = 'N';
 
 #ifdef ENABLE_GSS
-		/* No GSSAPI encryption when on Unix socket */
-		if (port->laddr.addr.ss_family != AF_UNIX)
+		/* No GSSAPI encryption when on Unix socket or the proxy port */
+		if (port->laddr.addr.ss_family != AF_UNIX && !port->proxied)
 			GSSok = 'G';
 #endif
 
@@ -2485,6 +2520,19 @@ processCancelRequest(Port *port, void *pkt)
 #endif
 		if (bp->pid == backendPID)
 		{
+			/*
+			 * A backend serving a connection proxy runs the queries of
+			 * whichever client it is bound to at the moment, so we can't
+			 * tell whose query a cancel request would hit.
+			 */
+			if (bp->child_slot > 0 && IsPostmasterChildPooled(bp->child_slot))
+			{
+				ereport(LOG,
+						(errmsg("ignoring cancel request for pooled process %d",
+								backendPID)));
+				return;
+			}
+
 			if (bp->cancel_key == cancelAuthCode)
 			{
 				/* Found a match; signal that backend to cancel current op */
@@ -2656,6 +2704,9 @@ ClosePostmasterPorts(bool am_syslogger)
 		}
 	}
 
+	/* Likewise the connection proxies' ends of the handover channels */
+	ProxyClosePostmasterSockets();
+
 	/*
 	 * If using syslogger, close the read side of the pipe.  We don't bother
 	 * tracking this in fd.c, either.
@@ -2764,6 +2815,7 @@ SIGHUP_handler(SIGNAL_ARGS)
 			signal_child(PgArchPID, SIGHUP);
 		if (SysLoggerPID != 0)
 			signal_child(SysLoggerPID, SIGHUP);
+		SignalConnectionProxies(SIGHUP);
 
 		/* Reload authentication config files too */
 		if (!load_hba())
@@ -2853,7 +2905,15 @@ pmdie(SIGNAL_ARGS)
 			 * later state, do not change it.
 			 */
 			if (pmState == PM_RUN || pmState == PM_HOT_STANDBY)
+			{
 				connsAllowed = false;
+
+				/*
+				 * Have the connection proxies release their idle backends
+				 * once the last client of each pool is gone.
+				 */
+				SignalConnectionProxies(SIGUSR2);
+			}
 			else if (pmState == PM_STARTUP || pmState == PM_RECOVERY)
 			{
 				/* There should be no clients, so proceed to stop children */
@@ -3243,6 +3303,14 @@ reaper(SIGNAL_ARGS)
 			continue;
 		}
 
+		/*
+		 * Was it a connection proxy?  ServerLoop will start a new one.  Its
+		 * clients are gone with it, but the backends it had pooled notice
+		 * that by themselves and exit.
+		 */
+		if (CleanupConnectionProxy(pid, exitstatus))
+			continue;
+
 		/* Was it one of our background workers? */
 		if (CleanupBackgroundWorker(pid, exitstatus))
 		{
@@ -3809,6 +3877,8 @@ PostmasterStateMachine(void)
 			signal_child(StartupPID, SIGTERM);
 		if (WalReceiverPID != 0)
 			signal_child(WalReceiverPID, SIGTERM);
+		/* the connection proxies have no more sessions to serve */
+		SignalConnectionProxies(SIGTERM);
 		/* checkpointer, archiver, stats, and syslogger may continue for now */
 
 		/* Now transition to PM_WAIT_BACKENDS state to wait for them to die */
@@ -4129,6 +4199,149 @@ TerminateChildren(int signal)
 		signal_child(AutoVacPID, signal);
 	if (PgArchPID != 0)
 		signal_child(PgArchPID, signal);
+	SignalConnectionProxies(signal);
+}
+
+/*
+ * Open the listen sockets of the connection proxy port, on the same
+ * addresses and in the same socket directories as the main port.  Clients
+ * connecting to them are served by a backend as usual until authentication
+ * is complete; the backend then hands the session over to a connection
+ * proxy (see postmaster/proxy.c).
+ */
+static void
+ListenOnProxyPort(void)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			first;
+	int			i;
+
+	for (first = 0; first < MAXLISTEN; first++)
+	{
+		if (ListenSocket[first] == PGINVALID_SOCKET)
+			break;
+	}
+
+	if (ProxyPortNumber == PostPortNumber)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"proxy_port\" must be different from \"port\"")));
+
+	if (ListenAddresses)
+	{
+		/* The syntax was checked when opening the main port */
+		rawstring = pstrdup(ListenAddresses);
+		(void) SplitGUCList(rawstring, ',', &elemlist);
+
+		foreach(l, elemlist)
+		{
+			char	   *curhost = (char *) lfirst(l);
+
+			if (StreamServerPort(AF_UNSPEC,
+								 strcmp(curhost, "*") == 0 ? NULL : curhost,
+								 (unsigned short) ProxyPortNumber,
+								 NULL,
+								 ListenSocket, MAXLISTEN) != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create listen socket for \"%s\"",
+								curhost)));
+		}
+
+		list_free(elemlist);
+		pfree(rawstring);
+	}
+
+#ifdef HAVE_UNIX_SOCKETS
+	if (Unix_socket_directories)
+	{
+		rawstring = pstrdup(Unix_socket_directories);
+		(void) SplitDirectoriesString(rawstring, ',', &elemlist);
+
+		foreach(l, elemlist)
+		{
+			char	   *socketdir = (char *) lfirst(l);
+
+			if (StreamServerPort(AF_UNIX, NULL,
+								 (unsigned short) ProxyPortNumber,
+								 socketdir,
+								 ListenSocket, MAXLISTEN) != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create Unix-domain socket in directory \"%s\"",
+								socketdir)));
+		}
+
+		list_free_deep(elemlist);
+		pfree(rawstring);
+	}
+#endif
+
+	for (i = first; i < MAXLISTEN; i++)
+	{
+		if (ListenSocket[i] == PGINVALID_SOCKET)
+			break;
+		ListenSocketProxied[i] = true;
+	}
+
+	if (i == first)
+		ereport(FATAL,
+				(errmsg("no socket created for listening on the connection proxy port")));
+}
+
+/*
+ * Start the connection proxies that are not running.
+ */
+static void
+StartConnectionProxies(void)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ProxyPIDs[i] == 0)
+			ProxyPIDs[i] = ProxyStart(i);
+	}
+}
+
+/*
+ * Send a signal to all running connection proxies.
+ */
+static void
+SignalConnectionProxies(int signal)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ProxyPIDs[i] != 0)
+			signal_child(ProxyPIDs[i], signal);
+	}
+}
+
+/*
+ * CleanupConnectionProxy -- forget a connection proxy that exited
+ *
+ * Returns true if the process was a connection proxy.
+ */
+static bool
+CleanupConnectionProxy(int pid, int exitstatus)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ProxyPIDs[i] != pid)
+			continue;
+
+		ProxyPIDs[i] = 0;
+		if (!EXIT_STATUS_0(exitstatus))
+			LogChildExit(LOG, _("connection proxy process"),
+						 pid, exitstatus);
+		return true;
+	}
+
+	return false;
 }
 
 /*
@@ -6151,6 +6364,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6384,6 +6598,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
@@ -0,0 +1,1446 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.c
+ *
+ * The connection proxy lets many client sessions share a bounded pool of
+ * backends.  Clients that connect to proxy_port are authenticated by a
+ * regular backend, forked as usual.  Once that backend is ready for its
+ * first query, it hands the client's socket over to one of the
+ * connection_proxies proxy processes, and from then on talks to the proxy
+ * through a socket pair instead of to the client.  The backend joins the
+ * proxy's pool for the client's database, user, startup options, address
+ * and authenticated identity, unless that pool already holds
+ * session_pool_size backends, in which case the proxy lets it exit.
+ *
+ * The proxy binds a client to an idle backend of its pool when the client
+ * starts a transaction, and releases the backend again when the backend
+ * reports that it is idle outside a transaction block.  Sessions that
+ * create state that can't be moved to another backend (temporary tables,
+ * prepared statements, SET, LISTEN, session-level advisory locks, holdable
+ * cursors, values for currval() and lastval()) are pinned to their backend
+ * until the client disconnects; the backend tells the proxy about that by
+ * reporting PROXY_PINNED_STATUS in ReadyForQuery.  When a client with an
+ * open transaction or a pinned session disconnects, the proxy rolls back and
+ * discards the session state before giving the backend to another client.
+ *
+ * Like the syslogger, the proxies don't attach to shared memory, and are
+ * restarted by the postmaster if they die.  The datagram sockets through
+ * which backends hand over their clients are created by the postmaster,
+ * which keeps them open so that a new proxy can take over from a dead one.
+ *
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/proxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "catalog/namespace.h"
+#include "commands/async.h"
+#include "commands/prepare.h"
+#include "commands/sequence.h"
+#include "lib/ilist.h"
+#include "lib/stringinfo.h"
+#include "libpq/libpq.h"
+#include "libpq/libpq-be.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_bswap.h"
+#include "postmaster/fork_process.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lock.h"
+#include "storage/pg_shmem.h"
+#include "storage/pmsignal.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/portal.h"
+#include "utils/ps_status.h"
+
+/* Size of the input and output buffers of each connection */
+#define PROXY_BUFFER_SIZE	8192
+
+/* Fixed positions in the proxy's wait event set */
+#define PROXY_LATCH_POS		0
+#define PROXY_PM_DEATH_POS	1
+#define PROXY_HANDOVER_POS	2
+#define PROXY_FIRST_CONN_POS	3
+
+/* Minimum number of positions in the proxy's wait event set */
+#define PROXY_MIN_WAIT_EVENTS	64
+
+/* Maximum number of events to process per wait */
+#define PROXY_MAX_EVENTS	64
+
+/* Maximum length of a pool key; clients with longer keys aren't pooled */
+#define PROXY_MAX_POOL_KEY	(2 * MAX_STARTUP_PACKET_LENGTH)
+
+/*
+ * Clients that share the same database, user, startup options, address and
+ * authenticated identity, and the backends serving them.
+ */
+typedef struct ProxyPool
+{
+	char	   *key;			/* see ProxyBuildPoolKey() */
+	int			keylen;
+	int			nbackends;		/* number of backends in the pool */
+	int			nclients;		/* number of clients of the pool */
+	dlist_head	idle_backends;	/* backends not bound to a client */
+	dlist_head	waiting_clients;	/* clients waiting for a backend */
+	dlist_node	node;			/* link in ProxyPools */
+} ProxyPool;
+
+/*
+ * A client or backend connection of the proxy.
+ */
+typedef struct ProxyConn
+{
+	pgsocket	sock;
+	bool		is_backend;
+	bool		closed;			/* waiting to be freed? */
+	ProxyPool  *pool;
+	struct ProxyConn *peer;		/* bound client or backend, or NULL */
+	dlist_node	node;			/* link in pool's idle_backends or
+								 * waiting_clients, or in ProxyClosedConns */
+	bool		listed;			/* is "node" in use? */
+	int			wait_pos;		/* position in ProxyWaitSet */
+	uint32		wait_events;	/* events we want to wait for */
+
+	/*
+	 * Bytes of the protocol message that is being relayed from this
+	 * connection still to be relayed, or 0 at a message boundary.
+	 */
+	uint32		msg_remaining;
+
+	/* State of a backend */
+	char		xact_status;	/* status reported in last ReadyForQuery */
+	int			pending_ready;	/* number of ReadyForQuery messages due */
+	bool		unsynced;		/* relayed messages that no pending
+								 * ReadyForQuery will answer? */
+	bool		resetting;		/* discarding a departed client's state? */
+
+	/* Data read from the socket, not yet relayed */
+	int			in_start;
+	int			in_end;
+	char		inbuf[PROXY_BUFFER_SIZE];
+
+	/* Data to be written to the socket */
+	int			out_start;
+	int			out_end;
+	char		outbuf[PROXY_BUFFER_SIZE];
+} ProxyConn;
+
+/* GUC variables */
+int			ConnectionProxies = 0;
+int			ProxyPortNumber = 6543;
+int			SessionPoolSize = 10;
+
+bool		ProxyPooledBackend = false;
+
+/*
+ * Datagram socket pairs through which backends hand their clients over to
+ * the proxies.  Backends write into [i][0], proxy number i reads from
+ * [i][1].  NULL if connection_proxies is 0.
+ */
+static pgsocket (*ProxyHandoverSockets)[2] = NULL;
+
+/* Number of this proxy process, or -1 if we're not a proxy */
+static int	MyProxyId = -1;
+
+/* Private state of a proxy process */
+static MemoryContext ProxyContext;
+static dlist_head ProxyPools = DLIST_STATIC_INIT(ProxyPools);
+static dlist_head ProxyClosedConns = DLIST_STATIC_INIT(ProxyClosedConns);
+static bool ProxyPoolsToFree = false;
+static volatile sig_atomic_t ProxyDrainPending = false;
+static bool ProxyDraining = false;
+
+/*
+ * The proxy's wait event set.  Since a WaitEventSet can't forget about a
+ * socket, the positions of closed connections stay in use until the set is
+ * rebuilt; ProxyWaitConns has the connection at each position, or NULL.
+ */
+static WaitEventSet *ProxyWaitSet = NULL;
+static ProxyConn **ProxyWaitConns = NULL;
+static int	ProxyWaitSetSize = 0;
+static int	ProxyWaitSetUsed = 0;
+static int	ProxyWaitSetDead = 0;
+static bool ProxyWaitSetRebuild = false;
+static int	ProxyNumConns = 0;
+
+static void ProxyMain(void) pg_attribute_noreturn();
+static void proxy_drain_handler(SIGNAL_ARGS);
+static void proxy_handle_interrupts(void);
+static void proxy_rebuild_wait_set(void);
+static void proxy_receive_handovers(void);
+static ProxyPool *proxy_get_pool(const char *key, int keylen);
+static ProxyConn *proxy_add_conn(pgsocket sock, ProxyPool *pool,
+								 bool is_backend);
+static void proxy_close(ProxyConn *conn);
+static void proxy_update_events(ProxyConn *conn);
+static void proxy_read(ProxyConn *conn);
+static void proxy_flush(ProxyConn *conn);
+static int	proxy_out_space(ProxyConn *conn);
+static void proxy_relay(ProxyConn *conn);
+static void proxy_relay_from_client(ProxyConn *client);
+static void proxy_relay_from_backend(ProxyConn *backend);
+static bool proxy_bind(ProxyConn *client);
+static void proxy_backend_idle(ProxyConn *backend);
+static void proxy_reset_backend(ProxyConn *backend, ProxyConn *client);
+static bool proxy_queue_query(ProxyConn *backend, const char *query);
+static void proxy_close_idle_backends(ProxyPool *pool, int count);
+static void proxy_fail_client(ProxyConn *client, const char *message);
+static void ProxyBuildPoolKey(StringInfo key, Port *port);
+
+
+/* --------------------------------
+ *		postmaster routines
+ * --------------------------------
+ */
+
+/*
+ * Create the sockets through which backends hand over their clients.
+ * Called by the postmaster at startup.
+ *
+ * We don't bother counting these in fd.c, like the syslogger pipe.
+ */
+void
+ProxyCreateHandoverSockets(void)
+{
+	int			i;
+
+	Assert(ConnectionProxies > 0);
+
+	ProxyHandoverSockets =
+		MemoryContextAlloc(TopMemoryContext,
+						   sizeof(pgsocket[2]) * ConnectionProxies);
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, ProxyHandoverSockets[i]) < 0)
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not create socket pair for connection proxy: %m")));
+	}
+}
+
+/*
+ * Close the ends of the handover sockets that a postmaster child has no use
+ * for.  Called from ClosePostmasterPorts().
+ */
+void
+ProxyClosePostmasterSockets(void)
+{
+	int			i;
+
+	if (ProxyHandoverSockets == NULL)
+		return;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (i == MyProxyId)
+			continue;
+		if (ProxyHandoverSockets[i][1] != PGINVALID_SOCKET)
+			closesocket(ProxyHandoverSockets[i][1]);
+		ProxyHandoverSockets[i][1] = PGINVALID_SOCKET;
+	}
+}
+
+/*
+ * Postmaster subroutine to start connection proxy number "id".
+ *
+ * Returns the proxy's PID, or 0 if it couldn't be started.
+ */
+int
+ProxyStart(int id)
+{
+	pid_t		proxyPid;
+
+	Assert(id >= 0 && id < ConnectionProxies);
+
+	switch ((proxyPid = fork_process()))
+	{
+		case -1:
+			ereport(LOG,
+					(errmsg("could not fork connection proxy: %m")));
+			return 0;
+
+		case 0:
+			/* in postmaster child ... */
+			InitPostmasterChild();
+
+			/* Close the postmaster's sockets, except our handover socket */
+			MyProxyId = id;
+			ClosePostmasterPorts(false);
+
+			/* Drop our connection to postmaster's shared memory, as well */
+			dsm_detach_all();
+			PGSharedMemoryDetach();
+
+			/* do the work */
+			ProxyMain();
+			break;
+
+		default:
+			/* success, in postmaster */
+			return (int) proxyPid;
+	}
+
+	/* we should never reach here */
+	return 0;
+}
+
+/*
+ * GUC check_hook for connection_proxies
+ */
+bool
+check_connection_proxies(int *newval, void **extra, GucSource source)
+{
+#ifdef EXEC_BACKEND
+	if (*newval != 0)
+	{
+		GUC_check_errdetail("Connection proxies are not supported on this platform.");
+		return false;
+	}
+#endif
+	return true;
+}
+
+
+/* --------------------------------
+ *		backend routines
+ * --------------------------------
+ */
+
+/*
+ * Hand this backend's client connection over to a connection proxy.
+ *
+ * Called by a backend started for a connection to the proxy port, once it
+ * has sent its first ReadyForQuery.  The client's socket is sent to the
+ * proxy together with one end of a new socket pair, whose other end replaces
+ * the client socket in this backend.  From then on, the backend serves
+ * whichever client the proxy assigns to it.
+ *
+ * If the handover fails, the backend just goes on serving its client.
+ */
+void
+ProxyHandOverClient(void)
+{
+	StringInfoData key;
+	pgsocket	chan[2];
+	int			proxy;
+	struct msghdr msg;
+	struct iovec iov;
+	union
+	{
+		struct cmsghdr cmsg;
+		char		buf[CMSG_SPACE(2 * sizeof(int))];
+	}			cmsgbuf;
+	struct cmsghdr *cmsg;
+	int		   *fds;
+
+	Assert(MyProcPort->proxied && !ProxyPooledBackend);
+
+	/*
+	 * Input that we have already read from the client would be lost.  Normal
+	 * clients wait for ReadyForQuery before sending anything, though.
+	 */
+	if (pq_buffer_has_data())
+		return;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, chan) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for connection proxy: %m")));
+		return;
+	}
+
+	ProxyBuildPoolKey(&key, MyProcPort);
+	if (key.len > PROXY_MAX_POOL_KEY)
+	{
+		closesocket(chan[0]);
+		closesocket(chan[1]);
+		pfree(key.data);
+		return;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = key.data;
+	iov.iov_len = key.len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+	fds = (int *) CMSG_DATA(cmsg);
+	fds[0] = MyProcPort->sock;
+	fds[1] = chan[1];
+
+	/*
+	 * Spread the clients over the proxies.  Don't wait for a proxy that
+	 * isn't keeping up; we can just as well keep serving the client.
+	 */
+	proxy = MyProcPid % ConnectionProxies;
+	if (sendmsg(ProxyHandoverSockets[proxy][0], &msg, MSG_DONTWAIT) != key.len)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not hand over connection to connection proxy: %m")));
+		closesocket(chan[0]);
+		closesocket(chan[1]);
+		pfree(key.data);
+		return;
+	}
+
+	closesocket(chan[1]);
+	pfree(key.data);
+
+	/* From now on, we talk to the proxy instead of the client */
+	pq_replace_socket(chan[0]);
+	MarkPostmasterChildPooled();
+	ProxyPooledBackend = true;
+
+	ereport(DEBUG1,
+			(errmsg_internal("handed over client connection to connection proxy %d",
+							 proxy)));
+}
+
+/*
+ * Does the current session hold state that a different client must not see,
+ * and that would be lost if the client went on in another backend?
+ *
+ * Called at every ReadyForQuery of a pooled backend that is not in a
+ * transaction block.  Objects in the temporary namespace are not tracked
+ * individually, so a session that has used temporary tables stays pinned.
+ */
+bool
+ProxySessionIsPinned(void)
+{
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+
+	return OidIsValid(tempNamespaceId) ||
+		HavePreparedStatements() ||
+		HaveSessionGUCSettings() ||
+		IsListeningOnAnyChannel() ||
+		HaveSessionLocks(USER_LOCKMETHOD) ||
+		ThereAreHoldablePortals() ||
+		HaveSequenceState();
+}
+
+/*
+ * Build the key identifying the pool a client belongs in: the database and
+ * user name, the client's host address and authenticated identity, followed
+ * by the other options from the startup packet, each with its terminating
+ * null byte.  Clients only share backends with clients that connected from
+ * the same host, authenticated the same way and with the same settings, so
+ * that functions like inet_client_addr() report their own values.  Only the
+ * client port differs; inet_client_port() reports the port of the client
+ * that the backend was started for.
+ */
+static void
+ProxyBuildPoolKey(StringInfo key, Port *port)
+{
+	ListCell   *lc;
+
+	initStringInfo(key);
+	appendBinaryStringInfo(key, port->database_name,
+						   strlen(port->database_name) + 1);
+	appendBinaryStringInfo(key, port->user_name,
+						   strlen(port->user_name) + 1);
+	appendBinaryStringInfo(key, port->remote_host,
+						   strlen(port->remote_host) + 1);
+	if (port->authn_id)
+		appendBinaryStringInfo(key, port->authn_id,
+							   strlen(port->authn_id) + 1);
+	else
+		appendBinaryStringInfo(key, "", 1);
+	if (port->cmdline_options)
+		appendBinaryStringInfo(key, port->cmdline_options,
+							   strlen(port->cmdline_options) + 1);
+	else
+		appendBinaryStringInfo(key, "", 1);
+
+	foreach(lc, port->guc_options)
+	{
+		char	   *str = (char *) lfirst(lc);
+
+		appendBinaryStringInfo(key, str, strlen(str) + 1);
+	}
+}
+
+
+/* --------------------------------
+ *		proxy process routines
+ * --------------------------------
+ */
+
+/*
+ * Main entry point for a connection proxy process
+ */
+static void
+ProxyMain(void)
+{
+	WaitEvent	events[PROXY_MAX_EVENTS];
+
+	MyBackendType = B_CONN_PROXY;
+	init_ps_display(NULL);
+
+	/*
+	 * Properly accept or ignore signals the postmaster might send us.
+	 * SIGUSR2 asks us to let backends go as soon as their pool has no more
+	 * clients, so that a smart shutdown can proceed.
+	 */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGINT, SIG_IGN);
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	pqsignal(SIGQUIT, SignalHandlerForCrashExit);
+	pqsignal(SIGALRM, SIG_IGN);
+	pqsignal(SIGPIPE, SIG_IGN);
+	pqsignal(SIGUSR1, SIG_IGN);
+	pqsignal(SIGUSR2, proxy_drain_handler);
+
+	/*
+	 * Reset some signals that are accepted by postmaster but not here
+	 */
+	pqsignal(SIGCHLD, SIG_DFL);
+
+	PG_SETMASK(&UnBlockSig);
+
+	/* Don't send log messages to any client */
+	whereToSendOutput = DestNone;
+
+	ProxyContext = AllocSetContextCreate(TopMemoryContext,
+										 "Connection Proxy",
+										 ALLOCSET_DEFAULT_SIZES);
+	MemoryContextSwitchTo(ProxyContext);
+
+	if (!pg_set_noblock(ProxyHandoverSockets[MyProxyId][1]))
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+
+	proxy_rebuild_wait_set();
+
+	/* main worker loop */
+	for (;;)
+	{
+		int			nevents;
+		int			i;
+
+		proxy_handle_interrupts();
+
+		/* Free what the previous round of events left behind */
+		while (!dlist_is_empty(&ProxyClosedConns))
+			pfree(dlist_container(ProxyConn, node,
+								  dlist_pop_head_node(&ProxyClosedConns)));
+
+		if (ProxyPoolsToFree)
+		{
+			dlist_mutable_iter iter;
+
+			dlist_foreach_modify(iter, &ProxyPools)
+			{
+				ProxyPool  *pool = dlist_container(ProxyPool, node, iter.cur);
+
+				if (pool->nbackends == 0 && pool->nclients == 0)
+				{
+					dlist_delete(&pool->node);
+					pfree(pool->key);
+					pfree(pool);
+				}
+			}
+			ProxyPoolsToFree = false;
+		}
+
+		if (ProxyWaitSetRebuild)
+			proxy_rebuild_wait_set();
+
+		nevents = WaitEventSetWait(ProxyWaitSet, -1, events, lengthof(events),
+								   WAIT_EVENT_CONNECTION_PROXY_MAIN);
+
+		for (i = 0; i < nevents; i++)
+		{
+			WaitEvent  *event = &events[i];
+			ProxyConn  *conn;
+
+			if (event->pos == PROXY_LATCH_POS)
+			{
+				ResetLatch(MyLatch);
+				continue;
+			}
+			if (event->pos == PROXY_HANDOVER_POS)
+			{
+				proxy_receive_handovers();
+				continue;
+			}
+
+			conn = ProxyWaitConns[event->pos];
+			if (conn == NULL)
+			{
+				/*
+				 * An event for a connection we have closed; the descriptor
+				 * must still be registered under its old position.
+				 */
+				ProxyWaitSetRebuild = true;
+				continue;
+			}
+			if (conn->closed)
+				continue;
+
+			if (event->events & WL_SOCKET_WRITEABLE)
+			{
+				proxy_flush(conn);
+				/* Make use of the space in the output buffer */
+				if (!conn->closed && conn->peer)
+					proxy_relay(conn->peer);
+			}
+			if (!conn->closed && (event->events & WL_SOCKET_READABLE))
+				proxy_read(conn);
+			if (!conn->closed && (event->events & WL_SOCKET_CLOSED))
+			{
+				/* The peer went away while we weren't reading from it */
+				proxy_relay(conn);
+				proxy_close(conn);
+			}
+		}
+	}
+}
+
+/*
+ * SIGUSR2: start draining the pools
+ */
+static void
+proxy_drain_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	ProxyDrainPending = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Process any requests or signals received recently.
+ */
+static void
+proxy_handle_interrupts(void)
+{
+	dlist_iter	iter;
+
+	if (ShutdownRequestPending)
+		proc_exit(0);
+
+	if (ConfigReloadPending)
+	{
+		ConfigReloadPending = false;
+		ProcessConfigFile(PGC_SIGHUP);
+
+		/* Shrink the pools if session_pool_size was lowered */
+		dlist_foreach(iter, &ProxyPools)
+		{
+			ProxyPool  *pool = dlist_container(ProxyPool, node, iter.cur);
+
+			if (pool->nbackends > SessionPoolSize)
+				proxy_close_idle_backends(pool,
+										  pool->nbackends - SessionPoolSize);
+		}
+	}
+
+	if (ProxyDrainPending && !ProxyDraining)
+	{
+		ProxyDraining = true;
+		dlist_foreach(iter, &ProxyPools)
+		{
+			ProxyPool  *pool = dlist_container(ProxyPool, node, iter.cur);
+
+			if (pool->nclients == 0)
+				proxy_close_idle_backends(pool, pool->nbackends);
+		}
+	}
+}
+
+/*
+ * (Re)create the wait event set, leaving out the positions of closed
+ * connections and making room for more.
+ */
+static void
+proxy_rebuild_wait_set(void)
+{
+	ProxyConn **oldconns = ProxyWaitConns;
+	int			oldused = ProxyWaitSetUsed;
+	int			size;
+	int			i;
+
+	size = Max(PROXY_MIN_WAIT_EVENTS,
+			   2 * (PROXY_FIRST_CONN_POS + ProxyNumConns));
+
+	if (ProxyWaitSet)
+		FreeWaitEventSet(ProxyWaitSet);
+	ProxyWaitSet = CreateWaitEventSet(ProxyContext, size);
+	ProxyWaitConns = palloc0(sizeof(ProxyConn *) * size);
+
+	AddWaitEventToSet(ProxyWaitSet, WL_LATCH_SET, PGINVALID_SOCKET,
+					  MyLatch, NULL);
+	AddWaitEventToSet(ProxyWaitSet, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+					  NULL, NULL);
+	AddWaitEventToSet(ProxyWaitSet, WL_SOCKET_READABLE,
+					  ProxyHandoverSockets[MyProxyId][1], NULL, NULL);
+	ProxyWaitSetUsed = PROXY_FIRST_CONN_POS;
+
+	for (i = PROXY_FIRST_CONN_POS; i < oldused; i++)
+	{
+		ProxyConn  *conn = oldconns[i];
+
+		if (conn == NULL)
+			continue;
+		conn->wait_pos = AddWaitEventToSet(ProxyWaitSet, conn->wait_events,
+										   conn->sock, NULL, NULL);
+		ProxyWaitConns[conn->wait_pos] = conn;
+		ProxyWaitSetUsed++;
+	}
+
+	if (oldconns)
+		pfree(oldconns);
+	ProxyWaitSetSize = size;
+	ProxyWaitSetDead = 0;
+	ProxyWaitSetRebuild = false;
+}
+
+/*
+ * Accept the clients that backends have handed over to us.
+ */
+static void
+proxy_receive_handovers(void)
+{
+	pgsocket	sock = ProxyHandoverSockets[MyProxyId][1];
+	static char keybuf[PROXY_MAX_POOL_KEY];
+
+	/*
+	 * Each handover adds up to two connections.  If the wait event set is
+	 * full, leave the rest for after it has been rebuilt.
+	 */
+	while (ProxyWaitSetUsed + 2 <= ProxyWaitSetSize)
+	{
+		struct msghdr msg;
+		struct iovec iov;
+		union
+		{
+			struct cmsghdr cmsg;
+			char		buf[CMSG_SPACE(2 * sizeof(int))];
+		}			cmsgbuf;
+		struct cmsghdr *cmsg;
+		ssize_t		len;
+		pgsocket	client_sock;
+		pgsocket	backend_sock;
+		ProxyPool  *pool;
+
+		memset(&msg, 0, sizeof(msg));
+		iov.iov_base = keybuf;
+		iov.iov_len = sizeof(keybuf);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgbuf.buf;
+		msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+		len = recvmsg(sock, &msg, 0);
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("could not receive connection from backend: %m")));
+			return;
+		}
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+			cmsg->cmsg_type != SCM_RIGHTS ||
+			cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int)))
+		{
+			ereport(LOG,
+					(errmsg("invalid connection handover message from backend")));
+			continue;
+		}
+		memcpy(&client_sock, CMSG_DATA(cmsg), sizeof(int));
+		memcpy(&backend_sock, CMSG_DATA(cmsg) + sizeof(int), sizeof(int));
+
+		if ((msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0)
+		{
+			ereport(LOG,
+					(errmsg("invalid connection handover message from backend")));
+			closesocket(client_sock);
+			closesocket(backend_sock);
+			continue;
+		}
+
+		pool = proxy_get_pool(keybuf, len);
+
+		/*
+		 * The client only gets a backend once it sends a query.  The backend
+		 * that brought it joins the pool if there's room; otherwise closing
+		 * its socket tells it to exit.
+		 */
+		(void) proxy_add_conn(client_sock, pool, false);
+		if (pool->nbackends < SessionPoolSize && !ProxyDraining)
+			proxy_backend_idle(proxy_add_conn(backend_sock, pool, true));
+		else
+			closesocket(backend_sock);
+	}
+
+	ProxyWaitSetRebuild = true;
+}
+
+/*
+ * Find the pool with the given key, creating it if necessary.
+ */
+static ProxyPool *
+proxy_get_pool(const char *key, int keylen)
+{
+	dlist_iter	iter;
+	ProxyPool  *pool;
+
+	dlist_foreach(iter, &ProxyPools)
+	{
+		pool = dlist_container(ProxyPool, node, iter.cur);
+
+		if (pool->keylen == keylen && memcmp(pool->key, key, keylen) == 0)
+			return pool;
+	}
+
+	pool = palloc0(sizeof(ProxyPool));
+	pool->key = palloc(keylen);
+	memcpy(pool->key, key, keylen);
+	pool->keylen = keylen;
+	dlist_init(&pool->idle_backends);
+	dlist_init(&pool->waiting_clients);
+	dlist_push_tail(&ProxyPools, &pool->node);
+
+	return pool;
+}
+
+/*
+ * Start relaying data for a new client or backend connection.
+ */
+static ProxyConn *
+proxy_add_conn(pgsocket sock, ProxyPool *pool, bool is_backend)
+{
+	ProxyConn  *conn;
+
+	Assert(ProxyWaitSetUsed < ProxyWaitSetSize);
+
+	if (!pg_set_noblock(sock))
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+
+	conn = palloc0(sizeof(ProxyConn));
+	conn->sock = sock;
+	conn->is_backend = is_backend;
+	conn->pool = pool;
+	conn->xact_status = 'I';
+	conn->wait_events = WL_SOCKET_READABLE;
+	conn->wait_pos = AddWaitEventToSet(ProxyWaitSet, conn->wait_events,
+									   sock, NULL, NULL);
+	ProxyWaitConns[conn->wait_pos] = conn;
+	ProxyWaitSetUsed++;
+	ProxyNumConns++;
+
+	if (is_backend)
+		pool->nbackends++;
+	else
+		pool->nclients++;
+
+	return conn;
+}
+
+/*
+ * Close a connection.
+ *
+ * If a backend goes away, so does the client bound to it.  If a client goes
+ * away, its backend is cleaned up for use by other clients.  The memory is
+ * freed later, since callers up the stack may still look at "closed".
+ */
+static void
+proxy_close(ProxyConn *conn)
+{
+	ProxyPool  *pool = conn->pool;
+	ProxyConn  *peer = conn->peer;
+
+	if (conn->closed)
+		return;
+	conn->closed = true;
+
+	closesocket(conn->sock);
+	ProxyWaitConns[conn->wait_pos] = NULL;
+	ProxyWaitSetDead++;
+	ProxyNumConns--;
+	if (ProxyWaitSetDead > ProxyNumConns)
+		ProxyWaitSetRebuild = true;
+
+	if (conn->listed)
+		dlist_delete(&conn->node);
+	conn->listed = false;
+	dlist_push_tail(&ProxyClosedConns, &conn->node);
+
+	if (peer)
+	{
+		peer->peer = NULL;
+		conn->peer = NULL;
+	}
+
+	if (conn->is_backend)
+	{
+		pool->nbackends--;
+
+		/* Pass on whatever the backend told the client before exiting */
+		if (peer)
+		{
+			proxy_flush(peer);
+			proxy_close(peer);
+		}
+
+		/* Nothing will come of clients waiting for a backend now */
+		if (pool->nbackends == 0)
+		{
+			while (!dlist_is_empty(&pool->waiting_clients))
+				proxy_fail_client(dlist_container(ProxyConn, node,
+												  dlist_head_node(&pool->waiting_clients)),
+								  _("no server process is available for this session"));
+		}
+	}
+	else
+	{
+		pool->nclients--;
+
+		if (peer)
+			proxy_reset_backend(peer, conn);
+
+		if (ProxyDraining && pool->nclients == 0)
+			proxy_close_idle_backends(pool, pool->nbackends);
+	}
+
+	if (pool->nbackends == 0 && pool->nclients == 0)
+		ProxyPoolsToFree = true;
+}
+
+/*
+ * Update the events we wait for on a connection: we read while there's room
+ * in the input buffer, and wait for the socket to become writable while
+ * there's data in the output buffer.
+ */
+static void
+proxy_update_events(ProxyConn *conn)
+{
+	uint32		events = 0;
+
+	if (conn->closed)
+		return;
+
+	if (conn->in_end < PROXY_BUFFER_SIZE)
+		events |= WL_SOCKET_READABLE;
+	if (conn->out_end > conn->out_start)
+		events |= WL_SOCKET_WRITEABLE;
+
+	/*
+	 * Watch for the peer going away even if we don't want to read.  Where
+	 * that can't be reported, we'll just keep getting woken up until the
+	 * input buffer drains.
+	 */
+	if (events == 0)
+		events = WL_SOCKET_CLOSED;
+
+	if (events != conn->wait_events)
+	{
+		ModifyWaitEvent(ProxyWaitSet, conn->wait_pos, events, NULL);
+		conn->wait_events = events;
+	}
+}
+
+/*
+ * Read what we can from a connection, and relay it.
+ */
+static void
+proxy_read(ProxyConn *conn)
+{
+	bool		eof = false;
+
+	while (conn->in_end < PROXY_BUFFER_SIZE)
+	{
+		ssize_t		n;
+
+		n = recv(conn->sock, conn->inbuf + conn->in_end,
+				 PROXY_BUFFER_SIZE - conn->in_end, 0);
+		if (n > 0)
+			conn->in_end += n;
+		else if (n == 0)
+		{
+			eof = true;
+			break;
+		}
+		else if (errno == EINTR)
+			continue;
+		else if (errno == EAGAIN || errno == EWOULDBLOCK)
+			break;
+		else
+		{
+			/* Not worth logging; the peer will have reported the problem */
+			eof = true;
+			break;
+		}
+	}
+
+	proxy_relay(conn);
+
+	if (eof)
+		proxy_close(conn);
+	else
+		proxy_update_events(conn);
+}
+
+/*
+ * Write what we can of a connection's output buffer.
+ */
+static void
+proxy_flush(ProxyConn *conn)
+{
+	while (!conn->closed && conn->out_start < conn->out_end)
+	{
+		ssize_t		n;
+
+		n = send(conn->sock, conn->outbuf + conn->out_start,
+				 conn->out_end - conn->out_start, 0);
+		if (n > 0)
+			conn->out_start += n;
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		else
+		{
+			proxy_close(conn);
+			return;
+		}
+	}
+
+	if (conn->out_start == conn->out_end)
+		conn->out_start = conn->out_end = 0;
+
+	proxy_update_events(conn);
+}
+
+/*
+ * Return the free space in a connection's output buffer.
+ */
+static int
+proxy_out_space(ProxyConn *conn)
+{
+	if (conn->out_start > 0)
+	{
+		memmove(conn->outbuf, conn->outbuf + conn->out_start,
+				conn->out_end - conn->out_start);
+		conn->out_end -= conn->out_start;
+		conn->out_start = 0;
+	}
+
+	return PROXY_BUFFER_SIZE - conn->out_end;
+}
+
+/*
+ * Relay as much of a connection's input as we can.
+ */
+static void
+proxy_relay(ProxyConn *conn)
+{
+	if (conn->closed)
+		return;
+
+	if (conn->is_backend)
+		proxy_relay_from_backend(conn);
+	else
+		proxy_relay_from_client(conn);
+
+	if (!conn->closed && conn->in_start > 0)
+	{
+		memmove(conn->inbuf, conn->inbuf + conn->in_start,
+				conn->in_end - conn->in_start);
+		conn->in_end -= conn->in_start;
+		conn->in_start = 0;
+	}
+
+	proxy_update_events(conn);
+}
+
+/*
+ * Relay protocol messages from a client to its backend, binding the client
+ * to a backend first if necessary.
+ */
+static void
+proxy_relay_from_client(ProxyConn *client)
+{
+	while (!client->closed && client->in_start < client->in_end)
+	{
+		char	   *p = client->inbuf + client->in_start;
+		int			avail = client->in_end - client->in_start;
+		ProxyConn  *backend;
+		int			n;
+
+		if (client->msg_remaining == 0)
+		{
+			uint32		len;
+
+			/* Need the message type and length */
+			if (avail < 5)
+				break;
+			memcpy(&len, p + 1, 4);
+			len = pg_ntoh32(len);
+			if (len < 4 || len > PQ_LARGE_MESSAGE_LIMIT)
+			{
+				ereport(COMMERROR,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("invalid message length from client")));
+				proxy_close(client);
+				return;
+			}
+
+			/* Terminate is a disconnect as far as we are concerned */
+			if (p[0] == 'X')
+			{
+				proxy_close(client);
+				return;
+			}
+
+			/* Messages can only go to a backend at a message boundary */
+			if (client->peer == NULL && !proxy_bind(client))
+				break;
+
+			backend = client->peer;
+			client->msg_remaining = len + 1;
+
+			/* Each of these will be answered by one ReadyForQuery */
+			if (p[0] == 'Q' || p[0] == 'S' || p[0] == 'F')
+			{
+				backend->pending_ready++;
+				backend->unsynced = false;
+			}
+			else
+				backend->unsynced = true;
+		}
+
+		backend = client->peer;
+		n = Min(avail, client->msg_remaining);
+		n = Min(n, proxy_out_space(backend));
+		if (n == 0)
+			break;
+		memcpy(backend->outbuf + backend->out_end, p, n);
+		backend->out_end += n;
+		client->in_start += n;
+		client->msg_remaining -= n;
+	}
+
+	if (!client->closed && client->peer)
+		proxy_flush(client->peer);
+}
+
+/*
+ * Relay protocol messages from a backend to its client.  At ReadyForQuery
+ * outside a transaction block, the backend is released for other clients,
+ * unless the session is pinned to it.
+ */
+static void
+proxy_relay_from_backend(ProxyConn *backend)
+{
+	ProxyConn  *released = NULL;
+
+	while (!backend->closed && backend->in_start < backend->in_end)
+	{
+		char	   *p = backend->inbuf + backend->in_start;
+		int			avail = backend->in_end - backend->in_start;
+		ProxyConn  *client = backend->resetting ? NULL : backend->peer;
+		int			n;
+
+		if (backend->msg_remaining == 0)
+		{
+			uint32		len;
+
+			if (avail < 5)
+				break;
+			memcpy(&len, p + 1, 4);
+			len = pg_ntoh32(len);
+			if (len < 4 || (p[0] == 'Z' && len != 5))
+			{
+				ereport(LOG,
+						(errmsg("invalid message length from server process")));
+				proxy_close(backend);
+				return;
+			}
+
+			if (p[0] == 'Z')
+			{
+				char		status;
+
+				if (avail < 6)
+					break;
+				status = p[5];
+
+				if (backend->pending_ready > 0)
+					backend->pending_ready--;
+
+				if (backend->resetting || client == NULL)
+				{
+					backend->in_start += 6;
+					if (backend->resetting && backend->pending_ready == 0)
+					{
+						/* Done discarding the state of the departed client */
+						if (status == 'I')
+							proxy_backend_idle(backend);
+						else
+							proxy_close(backend);
+					}
+					continue;
+				}
+
+				if (proxy_out_space(client) < 6)
+					break;
+				memcpy(client->outbuf + client->out_end, p, 6);
+				if (status == PROXY_PINNED_STATUS)
+					client->outbuf[client->out_end + 5] = 'I';
+				client->out_end += 6;
+				backend->in_start += 6;
+				backend->xact_status = status;
+
+				if (status == 'I' && backend->pending_ready == 0 &&
+					!backend->unsynced && client->msg_remaining == 0)
+				{
+					/* Let the client look for a backend for its next query */
+					proxy_flush(client);
+					client->peer = NULL;
+					backend->peer = NULL;
+					released = client;
+					proxy_backend_idle(backend);
+				}
+				continue;
+			}
+
+			backend->msg_remaining = len + 1;
+		}
+
+		n = Min(avail, backend->msg_remaining);
+		if (client)
+		{
+			n = Min(n, proxy_out_space(client));
+			if (n == 0)
+				break;
+			memcpy(client->outbuf + client->out_end, p, n);
+			client->out_end += n;
+		}
+		/* else there's no one to tell, so just discard the data */
+		backend->in_start += n;
+		backend->msg_remaining -= n;
+	}
+
+	if (!backend->closed && backend->peer && !backend->resetting)
+		proxy_flush(backend->peer);
+
+	/* The client may have sent its next query already */
+	if (released)
+		proxy_relay(released);
+}
+
+/*
+ * Bind a client to an idle backend of its pool.  If there is none, queue
+ * the client to wait for one, and return false.
+ */
+static bool
+proxy_bind(ProxyConn *client)
+{
+	ProxyPool  *pool = client->pool;
+	ProxyConn  *backend;
+
+	Assert(client->peer == NULL);
+
+	if (dlist_is_empty(&pool->idle_backends))
+	{
+		if (!client->listed)
+		{
+			dlist_push_tail(&pool->waiting_clients, &client->node);
+			client->listed = true;
+		}
+		return false;
+	}
+
+	backend = dlist_container(ProxyConn, node,
+							  dlist_pop_head_node(&pool->idle_backends));
+	backend->listed = false;
+	if (client->listed)
+		dlist_delete(&client->node);
+	client->listed = false;
+
+	client->peer = backend;
+	backend->peer = client;
+	backend->unsynced = false;
+	return true;
+}
+
+/*
+ * A backend is ready to serve a new client: give it to a waiting client, or
+ * put it on the idle list.  Backends that have become superfluous exit.
+ */
+static void
+proxy_backend_idle(ProxyConn *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	backend->resetting = false;
+	backend->peer = NULL;
+	backend->xact_status = 'I';
+	backend->unsynced = false;
+
+	if (pool->nbackends > SessionPoolSize ||
+		(ProxyDraining && pool->nclients == 0))
+	{
+		proxy_close(backend);
+		return;
+	}
+
+	/* Most recently used first, since its caches are warmest */
+	dlist_push_head(&pool->idle_backends, &backend->node);
+	backend->listed = true;
+
+	if (!dlist_is_empty(&pool->waiting_clients))
+		proxy_relay(dlist_container(ProxyConn, node,
+									dlist_head_node(&pool->waiting_clients)));
+}
+
+/*
+ * The client bound to a backend has gone away.  If the backend is between
+ * queries, roll back any open transaction and discard the session state, so
+ * that the backend can serve other clients; otherwise let it exit.
+ */
+static void
+proxy_reset_backend(ProxyConn *backend, ProxyConn *client)
+{
+	backend->peer = NULL;
+
+	if (backend->pending_ready > 0 || backend->unsynced ||
+		client->msg_remaining > 0)
+	{
+		proxy_close(backend);
+		return;
+	}
+
+	if (backend->xact_status == 'I')
+	{
+		proxy_backend_idle(backend);
+		return;
+	}
+
+	if (backend->xact_status != PROXY_PINNED_STATUS &&
+		!proxy_queue_query(backend, "ROLLBACK"))
+		return;
+	if (!proxy_queue_query(backend, "DISCARD ALL"))
+		return;
+	backend->resetting = true;
+
+	proxy_flush(backend);
+}
+
+/*
+ * Send a simple Query message to a backend on behalf of the proxy.  Returns
+ * false if the backend had to be closed instead.
+ */
+static bool
+proxy_queue_query(ProxyConn *backend, const char *query)
+{
+	int			len = strlen(query) + 1;
+	uint32		n32 = pg_hton32(len + 4);
+
+	if (proxy_out_space(backend) < len + 5)
+	{
+		proxy_close(backend);
+		return false;
+	}
+
+	backend->outbuf[backend->out_end] = 'Q';
+	memcpy(backend->outbuf + backend->out_end + 1, &n32, 4);
+	memcpy(backend->outbuf + backend->out_end + 5, query, len);
+	backend->out_end += len + 5;
+	backend->pending_ready++;
+
+	return true;
+}
+
+/*
+ * Close up to "count" idle backends of a pool.
+ */
+static void
+proxy_close_idle_backends(ProxyPool *pool, int count)
+{
+	while (count-- > 0 && !dlist_is_empty(&pool->idle_backends))
+		proxy_close(dlist_container(ProxyConn, node,
+									dlist_tail_node(&pool->idle_backends)));
+}
+
+/*
+ * Send a FATAL error to a client and disconnect it.
+ */
+static void
+proxy_fail_client(ProxyConn *client, const char *message)
+{
+	StringInfoData buf;
+	uint32		n32;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, 'E');
+	appendBinaryStringInfo(&buf, "\0\0\0\0", 4);
+	appendStringInfoChar(&buf, PG_DIAG_SEVERITY);
+	appendStringInfoString(&buf, _("FATAL"));
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_SEVERITY_NONLOCALIZED);
+	appendStringInfoString(&buf, "FATAL");
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_SQLSTATE);
+	appendStringInfoString(&buf, unpack_sql_state(ERRCODE_CONNECTION_FAILURE));
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_MESSAGE_PRIMARY);
+	appendStringInfoString(&buf, message);
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, '\0');
+	n32 = pg_hton32(buf.len - 1);
+	memcpy(buf.data + 1, &n32, 4);
+
+	if (proxy_out_space(client) >= buf.len)
+	{
+		memcpy(client->outbuf + client->out_end, buf.data, buf.len);
+		client->out_end += buf.len;
+		proxy_flush(client);
+	}
+	pfree(buf.data);
+
+	proxy_close(client);
+}
@@ -1078,9 +1078,16 @@ ReplicationOriginExitCleanup(int code, Datum arg)
  * Obviously only one such cached origin can exist per process and the current
  * cached value can only be set again after the previous value is torn down
  * with replorigin_session_reset().
+ *
+ * Normally only one process can acquire a given origin.  A parallel apply
+ * worker of logical replication, however, needs to share the origin with its
+ * leader apply worker so that commits of the transactions it applies advance
+ * the same origin.  In that case, acquired_by is the PID of the process that
+ * has already acquired the origin, and we only attach to it.  Pass 0 to
+ * acquire the origin for ourselves.
  */
 void
-replorigin_session_setup(RepOriginId node)
+replorigin_session_setup(RepOriginId node, int acquired_by)
 {
 	static bool registered_cleanup;
 	int			i;
@@ -1122,7 +1129,7 @@ replorigin_session_setup(RepOriginId node)
 		if (curstate->roident != node)
 			continue;
 
-		else if (curstate->acquired_by != 0)
+		else if (curstate->acquired_by != 0 && acquired_by == 0)
 		{
 			ereport(ERROR,
 					(errcode(ERRCODE_OBJECT_IN_USE),
@@ -1130,6 +1137,14 @@ replorigin_session_setup(RepOriginId node)
 							curstate->roident, curstate->acquired_by)));
 		}
 
+		else if (curstate->acquired_by != acquired_by && acquired_by != 0)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_IN_USE),
+					 errmsg("could not find replication state slot for replication origin with OID %u which was acquired by %d",
+							node, acquired_by)));
+		}
+
 		/* ok, found slot */
 		session_replication_state = curstate;
 	}
@@ -1143,6 +1158,12 @@ replorigin_session_setup(RepOriginId node)
 				 errhint("Increase max_replication_slots and try again.")));
 	else if (session_replication_state == NULL)
 	{
+		if (acquired_by != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("cannot use PID %d for inactive replication origin with OID %u",
+							acquired_by, node)));
+
 		/* initialize new slot */
 		session_replication_state = &replication_states[free_slot];
 		Assert(session_replication_state->remote_lsn == InvalidXLogRecPtr);
@@ -1153,7 +1174,10 @@ replorigin_session_setup(RepOriginId node)
 
 	Assert(session_replication_state->roident != InvalidRepOriginId);
 
-	session_replication_state->acquired_by = MyProcPid;
+	if (acquired_by == 0)
+		session_replication_state->acquired_by = MyProcPid;
+	else
+		Assert(session_replication_state->acquired_by == acquired_by);
 
 	LWLockRelease(ReplicationOriginLock);
 
@@ -1181,7 +1205,9 @@ replorigin_session_reset(void)
 
 	LWLockAcquire(ReplicationOriginLock, LW_EXCLUSIVE);
 
-	session_replication_state->acquired_by = 0;
+	/* Don't release an origin we only share with the process owning it. */
+	if (session_replication_state->acquired_by == MyProcPid)
+		session_replication_state->acquired_by = 0;
 	cv = &session_replication_state->origin_cv;
 	session_replication_state = NULL;
 
@@ -1337,7 +1363,7 @@ pg_replication_origin_session_setup(PG_FUNCTION_ARGS)
 
 	name = text_to_cstring((text *) DatumGetPointer(PG_GETARG_DATUM(0)));
 	origin = replorigin_by_name(name, false);
-	replorigin_session_setup(origin);
+	replorigin_session_setup(origin, 0);
 
 	replorigin_session_origin = origin;
 
@@ -47,14 +47,17 @@
 #include "postmaster/bgwriter.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/spccache.h"
 #include "utils/timestamp.h"
 
 
@@ -130,6 +133,45 @@ typedef struct SMgrSortArray
 	SMgrRelation srel;
 } SMgrSortArray;
 
+/*
+ * State of a streaming read; see StreamingReadBegin().
+ *
+ * Blocks returned by the callback but not yet handed to the consumer are kept
+ * in a circular queue.  The entries at the front of the queue may already be
+ * pinned (they were read together with the oldest entry as part of a single
+ * vectored read); all later entries are not pinned yet, and may have been the
+ * subject of a prefetch hint.  Consecutive queued blocks are accumulated into
+ * a pending advice range, so that each future vectored read is hinted with a
+ * single request.
+ */
+struct StreamingRead
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	BufferAccessStrategy strategy;
+	StreamingReadBlockCB callback;
+	void	   *callback_private_data;
+	size_t		per_buffer_data_size;
+
+	int			max_combine;	/* max number of blocks per vectored read */
+	int			max_distance;	/* max number of queued blocks */
+	int			distance;		/* current target number of queued blocks */
+	bool		advice_enabled; /* issue prefetch hints? */
+	bool		finished;		/* callback has reported end of stream */
+
+	/* range of queued blocks not yet hinted */
+	BlockNumber advice_start;
+	int			advice_nblocks;
+
+	/* the look-ahead queue */
+	int			queue_size;
+	int			oldest;			/* index of oldest queued entry */
+	int			nqueued;		/* number of queued entries */
+	BlockNumber *blocknums;
+	Buffer	   *buffers;		/* InvalidBuffer if not pinned yet */
+	char	   *per_buffer_data;
+};
+
 /* GUC variables */
 bool		zero_damaged_pages = false;
 int			bgwriter_lru_maxpages = 100;
@@ -151,6 +193,12 @@ int			effective_io_concurrency = 0;
  */
 int			maintenance_io_concurrency = 0;
 
+/*
+ * Maximum number of consecutive blocks that are combined into a single
+ * vectored read or write.
+ */
+int			io_combine_limit = DEFAULT_IO_COMBINE_LIMIT;
+
 /*
  * GUC variables about triggering kernel writeback for buffers written; OS
  * dependent defaults are set via the GUC mechanism.
@@ -159,9 +207,21 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * A backend can have I/O in progress on several buffers at once, when it
+ * reads or writes a run of consecutive blocks with a single vectored system
+ * call.  The number of such buffers is bounded by MAX_IO_COMBINE_LIMIT.
+ */
+typedef struct InProgressIO
+{
+	BufferDesc *buf;
+	bool		forInput;
+} InProgressIO;
+
+static InProgressIO InProgressIOs[MAX_IO_COMBINE_LIMIT];
+static int	NumInProgressIOs = 0;
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -463,15 +523,25 @@ static Buffer ReadBuffer_common(SMgrRelation reln, char relpersistence,
 								ForkNumber forkNum, BlockNumber blockNum,
 								ReadBufferMode mode, BufferAccessStrategy strategy,
 								bool *hit);
+static int	ReadBuffersVectored(Relation reln, ForkNumber forkNum,
+								BlockNumber blockNum, int nblocks,
+								BufferAccessStrategy strategy, Buffer *buffers);
+static void StreamingReadFlushAdvice(StreamingRead *stream);
+static void StreamingReadAdvise(StreamingRead *stream, BlockNumber blocknum);
+static void StreamingReadLookAhead(StreamingRead *stream);
+static void StreamingReadPinRun(StreamingRead *stream);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
 static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
-						  WritebackContext *wb_context);
+						  int max_blocks, WritebackContext *wb_context,
+						  int *num_written);
+static int	StartBufferWriteRun(BufferDesc *first, bool skip_recently_used,
+								int max_blocks, BufferDesc **run);
 static void WaitIO(BufferDesc *buf);
-static bool StartBufferIO(BufferDesc *buf, bool forInput);
+static bool StartBufferIO(BufferDesc *buf, bool forInput, bool nowait);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
 							  uint32 set_flag_bits);
 static void shared_buffer_write_error_callback(void *arg);
@@ -482,7 +552,10 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   BlockNumber blockNum,
 							   BufferAccessStrategy strategy,
 							   bool *foundPtr);
-static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static void FlushBuffer(BufferDesc *buf, SMgrRelation reln,
+						IOObject io_object, IOContext io_context);
+static void FlushBufferRun(BufferDesc **bufs, int nbufs, SMgrRelation reln,
+						   IOObject io_object, IOContext io_context);
 static void FindAndDropRelationBuffers(RelFileLocator rlocator,
 									   ForkNumber forkNum,
 									   BlockNumber nForkBlock,
@@ -535,7 +608,7 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
 		 * Try to initiate an asynchronous read.  This returns false in
 		 * recovery if the relation file doesn't exist.
 		 */
-		if (smgrprefetch(smgr_reln, forkNum, blockNum))
+		if (smgrprefetch(smgr_reln, forkNum, blockNum, 1))
 			result.initiated_io = true;
 #endif							/* USE_PREFETCH */
 	}
@@ -823,6 +896,8 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	BufferDesc *bufHdr;
 	Block		bufBlock;
 	bool		found;
+	IOContext	io_context;
+	IOObject	io_object;
 	bool		isExtend;
 	bool		isLocalBuf = SmgrIsTemp(smgr);
 
@@ -855,6 +930,15 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isLocalBuf)
 	{
+		/*
+		 * LocalBufferAlloc() will set the io_context to IOCONTEXT_NORMAL. We
+		 * do not use a BufferAccessStrategy for I/O of temporary tables.
+		 * However, in some cases, the "strategy" may not be NULL, so we can't
+		 * rely on IOContextForStrategy() to set the right IOContext for us.
+		 * This may happen in cases like CREATE TEMPORARY TABLE AS...
+		 */
+		io_context = IOCONTEXT_NORMAL;
+		io_object = IOOBJECT_TEMP_RELATION;
 		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, &found);
 		if (found)
 			pgBufferUsage.local_blks_hit++;
@@ -867,11 +951,18 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	else
 	{
 		/*
-		 * lookup the buffer.  IO_IN_PROGRESS is set if the requested block is
-		 * not currently in memory.
+		 * lookup the buffer, and if it's not valid try to obtain the right
+		 * to read it in.  If StartBufferIO returns false, then someone else
+		 * managed to read it before we did (possibly after we waited for
+		 * them), and we can treat it as found.  Otherwise IO_IN_PROGRESS is
+		 * now set.
 		 */
+		io_context = IOContextForStrategy(strategy);
+		io_object = IOOBJECT_RELATION;
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
 							 strategy, &found);
+		if (!found && !StartBufferIO(bufHdr, true, false))
+			found = true;
 		if (found)
 			pgBufferUsage.shared_blks_hit++;
 		else if (isExtend)
@@ -891,6 +982,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			/* Just need to update stats before we exit */
 			*hit = true;
 			VacuumPageHit++;
+			pgstat_count_io_op(io_object, io_context, IOOP_HIT);
 
 			if (VacuumCostActive)
 				VacuumCostBalance += VacuumCostPageHit;
@@ -968,7 +1060,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				Assert(buf_state & BM_VALID);
 				buf_state &= ~BM_VALID;
 				UnlockBufHdr(bufHdr, buf_state);
-			} while (!StartBufferIO(bufHdr, true));
+			} while (!StartBufferIO(bufHdr, true, false));
 		}
 	}
 
@@ -990,10 +1082,15 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isExtend)
 	{
+		instr_time	io_start;
+
 		/* new buffers are zero-filled */
 		MemSet((char *) bufBlock, 0, BLCKSZ);
+		io_start = pgstat_prepare_io_time();
 		/* don't set checksum for all-zero page */
 		smgrextend(smgr, forkNum, blockNum, (char *) bufBlock, false);
+		pgstat_count_io_op_time(io_object, io_context, IOOP_EXTEND,
+								io_start, 1);
 
 		/*
 		 * NB: we're *not* doing a ScheduleBufferTagForWriteback here;
@@ -1012,21 +1109,12 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			MemSet((char *) bufBlock, 0, BLCKSZ);
 		else
 		{
-			instr_time	io_start,
-						io_time;
-
-			if (track_io_timing)
-				INSTR_TIME_SET_CURRENT(io_start);
+			instr_time	io_start = pgstat_prepare_io_time();
 
 			smgrread(smgr, forkNum, blockNum, (char *) bufBlock);
 
-			if (track_io_timing)
-			{
-				INSTR_TIME_SET_CURRENT(io_time);
-				INSTR_TIME_SUBTRACT(io_time, io_start);
-				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
-				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
-			}
+			pgstat_count_io_op_time(io_object, io_context, IOOP_READ,
+									io_start, 1);
 
 			/* check for garbage data */
 			if (!PageIsVerifiedExtended((Page) bufBlock, blockNum,
@@ -1096,6 +1184,539 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	return BufferDescriptorGetBuffer(bufHdr);
 }
 
+/*
+ * ReadBuffersVectored -- pin a run of consecutive blocks, reading any that
+ *		are not already valid with vectored I/O
+ *
+ * On return, buffers[0 .. nblocks - 1] hold pins on blocks blockNum ..
+ * blockNum + nblocks - 1 of the given fork, and their contents are valid, as
+ * if each had been read with ReadBufferExtended() in RBM_NORMAL mode.  All the
+ * buffers are pinned before any I/O is started, so that each maximal sub-run
+ * of consecutive misses can be read with a single smgrreadv() call.  To avoid
+ * deadlocks, we only ever wait for another backend's I/O on the first buffer
+ * of such a sub-run, while we hold no I/O of our own.
+ *
+ * Returns the number of blocks that had to be read from disk.  Only works on
+ * shared buffers.
+ */
+static int
+ReadBuffersVectored(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+					int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	SMgrRelation smgr = RelationGetSmgr(reln);
+	IOContext	io_context = IOContextForStrategy(strategy);
+	BufferDesc *bufHdrs[MAX_IO_COMBINE_LIMIT];
+	bool		valid[MAX_IO_COMBINE_LIMIT];
+	int			nread = 0;
+	int			i;
+
+	Assert(nblocks > 0 && nblocks <= MAX_IO_COMBINE_LIMIT);
+	Assert(!RelationUsesLocalBuffers(reln));
+
+	/* Pin all the buffers first; no I/O has been started yet */
+	for (i = 0; i < nblocks; i++)
+	{
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		TRACE_POSTGRESQL_BUFFER_READ_START(forkNum, blockNum + i,
+										   smgr->smgr_rlocator.locator.spcOid,
+										   smgr->smgr_rlocator.locator.dbOid,
+										   smgr->smgr_rlocator.locator.relNumber,
+										   smgr->smgr_rlocator.backend,
+										   false);
+
+		pgstat_count_buffer_read(reln);
+		bufHdrs[i] = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+								 blockNum + i, strategy, &valid[i]);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdrs[i]);
+	}
+
+	i = 0;
+	while (i < nblocks)
+	{
+		char	   *blocks[MAX_IO_COMBINE_LIMIT];
+		int			nios;
+		instr_time	io_start;
+
+		/*
+		 * If the buffer was valid when we pinned it, or someone else read it
+		 * in while we waited for their I/O, it's a hit.
+		 */
+		if (valid[i] || !StartBufferIO(bufHdrs[i], true, false))
+		{
+			pgstat_count_buffer_hit(reln);
+			pgstat_count_io_op(IOOBJECT_RELATION, io_context, IOOP_HIT);
+			pgBufferUsage.shared_blks_hit++;
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+
+			TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+											  smgr->smgr_rlocator.locator.spcOid,
+											  smgr->smgr_rlocator.locator.dbOid,
+											  smgr->smgr_rlocator.locator.relNumber,
+											  smgr->smgr_rlocator.backend,
+											  false,
+											  true);
+			i++;
+			continue;
+		}
+
+		/*
+		 * Extend the sub-run over the following misses, as long as we can
+		 * start I/O on them without waiting.
+		 */
+		blocks[0] = (char *) BufHdrGetBlock(bufHdrs[i]);
+		nios = 1;
+		while (i + nios < nblocks && !valid[i + nios] &&
+			   StartBufferIO(bufHdrs[i + nios], true, true))
+		{
+			blocks[nios] = (char *) BufHdrGetBlock(bufHdrs[i + nios]);
+			nios++;
+		}
+
+		io_start = pgstat_prepare_io_time();
+
+		smgrreadv(smgr, forkNum, blockNum + i, blocks, nios);
+
+		pgstat_count_io_op_time(IOOBJECT_RELATION, io_context, IOOP_READ,
+								io_start, nios);
+
+		for (int j = 0; j < nios; j++)
+		{
+			BlockNumber blkno = blockNum + i + j;
+
+			/* check for garbage data */
+			if (!PageIsVerifiedExtended((Page) blocks[j], blkno,
+										PIV_LOG_WARNING | PIV_REPORT_STAT))
+			{
+				if (zero_damaged_pages)
+				{
+					ereport(WARNING,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s; zeroing out page",
+									blkno,
+									relpath(smgr->smgr_rlocator, forkNum))));
+					MemSet(blocks[j], 0, BLCKSZ);
+				}
+				else
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s",
+									blkno,
+									relpath(smgr->smgr_rlocator, forkNum))));
+			}
+
+			/* Set BM_VALID, terminate IO, and wake up any waiters */
+			TerminateBufferIO(bufHdrs[i + j], false, BM_VALID);
+
+			pgBufferUsage.shared_blks_read++;
+			VacuumPageMiss++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageMiss;
+
+			TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blkno,
+											  smgr->smgr_rlocator.locator.spcOid,
+											  smgr->smgr_rlocator.locator.dbOid,
+											  smgr->smgr_rlocator.locator.relNumber,
+											  smgr->smgr_rlocator.backend,
+											  false,
+											  false);
+		}
+
+		nread += nios;
+		i += nios;
+	}
+
+	return nread;
+}
+
+/*
+ * StreamingReadBegin -- set up a streaming read of a relation fork
+ *
+ * A streaming read returns a sequence of pinned buffers, for the blocks
+ * chosen one at a time by the given callback.  The callback returns
+ * InvalidBlockNumber to signal the end of the stream.  It is called ahead of
+ * the consumer, which allows us to
+ *
+ * 1.  combine runs of consecutive blocks that are not in the buffer pool
+ * into single vectored reads of up to io_combine_limit blocks, and
+ *
+ * 2.  issue prefetch hints (posix_fadvise) for the blocks that are queued
+ * behind the one being read, up to effective_io_concurrency (or
+ * maintenance_io_concurrency, if STREAMING_READ_MAINTENANCE is given) blocks
+ * ahead.  Each future vectored read is hinted with a single request, so the
+ * kernel can have several of them in flight while we wait for the current
+ * one, which its own read-ahead heuristics wouldn't achieve.
+ *
+ * The look-ahead distance starts out small and grows only while we keep
+ * finding blocks that need to be read, so that streams over cached data, or
+ * whose consumer stops early, don't pin or read more than necessary.
+ *
+ * If per_buffer_data_size is not zero, the callback is passed a pointer to
+ * that much space, in which it can store information about the block it
+ * returns; StreamingReadNextBuffer() hands that back along with the buffer.
+ */
+StreamingRead *
+StreamingReadBegin(Relation rel, ForkNumber forknum,
+				   BufferAccessStrategy strategy, int flags,
+				   StreamingReadBlockCB callback, void *callback_private_data,
+				   size_t per_buffer_data_size)
+{
+	StreamingRead *stream;
+	int			io_concurrency;
+	int			max_pins;
+
+	/* see comments in ReadBufferExtended */
+	if (RELATION_IS_OTHER_TEMP(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	/*
+	 * Catalog scans must not look up tablespace settings: the lookup could
+	 * need to scan the very same catalog, and spccache.c isn't usable before
+	 * we're connected to a database anyway.
+	 */
+	if (!OidIsValid(MyDatabaseId) || IsCatalogRelation(rel))
+		io_concurrency = (flags & STREAMING_READ_MAINTENANCE) ?
+			maintenance_io_concurrency : effective_io_concurrency;
+	else if (flags & STREAMING_READ_MAINTENANCE)
+		io_concurrency = get_tablespace_maintenance_io_concurrency(rel->rd_rel->reltablespace);
+	else
+		io_concurrency = get_tablespace_io_concurrency(rel->rd_rel->reltablespace);
+
+	stream = (StreamingRead *) palloc0(sizeof(StreamingRead));
+	stream->rel = rel;
+	stream->forknum = forknum;
+	stream->strategy = strategy;
+	stream->callback = callback;
+	stream->callback_private_data = callback_private_data;
+	stream->per_buffer_data_size = MAXALIGN(per_buffer_data_size);
+
+	/*
+	 * Local buffers are read one at a time, so there is no point in
+	 * combining, but we can still issue prefetch hints for them.
+	 *
+	 * Every block in the look-ahead queue holds a pin, so don't let a single
+	 * stream pin more than its fair share of the buffer pool.  Otherwise a
+	 * high I/O concurrency setting combined with a small pool could leave no
+	 * unpinned buffers for anyone else.
+	 */
+	if (RelationUsesLocalBuffers(rel))
+	{
+		stream->max_combine = 1;
+		max_pins = num_temp_buffers / 4;
+	}
+	else
+	{
+		stream->max_combine = Min(Max(io_combine_limit, 1), MAX_IO_COMBINE_LIMIT);
+		max_pins = NBuffers / (MaxBackends + NUM_AUXILIARY_PROCS);
+	}
+	max_pins = Max(max_pins, 1);
+	stream->max_combine = Min(stream->max_combine, max_pins);
+#ifdef USE_PREFETCH
+	/* Under direct I/O, advice would only fill the kernel's page cache. */
+	stream->advice_enabled = io_concurrency > 0 &&
+		(io_direct_flags & IO_DIRECT_DATA) == 0;
+#else
+	stream->advice_enabled = false;
+	io_concurrency = 0;
+#endif
+	stream->max_distance = Min(stream->max_combine + io_concurrency, max_pins);
+
+	stream->queue_size = stream->max_distance;
+	stream->blocknums = (BlockNumber *)
+		palloc(sizeof(BlockNumber) * stream->queue_size);
+	stream->buffers = (Buffer *)
+		palloc(sizeof(Buffer) * stream->queue_size);
+	if (stream->per_buffer_data_size > 0)
+		stream->per_buffer_data =
+			palloc(stream->per_buffer_data_size * stream->queue_size);
+
+	StreamingReadReset(stream);
+
+	return stream;
+}
+
+/*
+ * Hint the kernel about the pending advice range, skipping any blocks that
+ * are already in the buffer pool.
+ */
+static void
+StreamingReadFlushAdvice(StreamingRead *stream)
+{
+	BlockNumber blocknum = stream->advice_start;
+	int			nblocks = stream->advice_nblocks;
+	SMgrRelation smgr;
+	BlockNumber miss_start = InvalidBlockNumber;
+	int			nmisses = 0;
+
+	stream->advice_nblocks = 0;
+	if (nblocks == 0)
+		return;
+
+	/*
+	 * A range that starts at the oldest queued block is about to be read by
+	 * StreamingReadPinRun(), so hinting it would only cost a system call.
+	 */
+	if (stream->nqueued > 0 &&
+		blocknum == stream->blocknums[stream->oldest] &&
+		!BufferIsValid(stream->buffers[stream->oldest]))
+		return;
+
+	/* Local buffers are never combined, so this is a single block */
+	if (RelationUsesLocalBuffers(stream->rel))
+	{
+		Assert(nblocks == 1);
+		(void) PrefetchBuffer(stream->rel, stream->forknum, blocknum);
+		return;
+	}
+
+	smgr = RelationGetSmgr(stream->rel);
+	for (int i = 0; i <= nblocks; i++)
+	{
+		bool		cached = true;
+
+		if (i < nblocks)
+		{
+			BufferTag	tag;
+			uint32		hash;
+			LWLock	   *partitionLock;
+
+			InitBufferTag(&tag, &smgr->smgr_rlocator.locator,
+						  stream->forknum, blocknum + i);
+			hash = BufTableHashCode(&tag);
+			partitionLock = BufMappingPartitionLock(hash);
+
+			LWLockAcquire(partitionLock, LW_SHARED);
+			cached = BufTableLookup(&tag, hash) >= 0;
+			LWLockRelease(partitionLock);
+		}
+
+		if (!cached)
+		{
+			if (nmisses++ == 0)
+				miss_start = blocknum + i;
+		}
+		else if (nmisses > 0)
+		{
+			(void) smgrprefetch(smgr, stream->forknum, miss_start, nmisses);
+			nmisses = 0;
+		}
+	}
+}
+
+/*
+ * Add a newly queued block to the pending advice range, hinting the range
+ * once it can't grow any further.
+ */
+static void
+StreamingReadAdvise(StreamingRead *stream, BlockNumber blocknum)
+{
+	if (stream->advice_nblocks > 0 &&
+		blocknum == stream->advice_start + stream->advice_nblocks)
+		stream->advice_nblocks++;
+	else
+	{
+		StreamingReadFlushAdvice(stream);
+		stream->advice_start = blocknum;
+		stream->advice_nblocks = 1;
+	}
+
+	if (stream->advice_nblocks >= stream->max_combine)
+		StreamingReadFlushAdvice(stream);
+}
+
+/*
+ * Call the callback until the look-ahead queue holds as many blocks as the
+ * current look-ahead distance calls for, or the callback reports the end of
+ * the stream.
+ */
+static void
+StreamingReadLookAhead(StreamingRead *stream)
+{
+	while (!stream->finished && stream->nqueued < stream->distance)
+	{
+		int			slot = (stream->oldest + stream->nqueued) % stream->queue_size;
+		void	   *per_buffer_data = NULL;
+		BlockNumber blocknum;
+
+		if (stream->per_buffer_data_size > 0)
+			per_buffer_data = stream->per_buffer_data +
+				slot * stream->per_buffer_data_size;
+
+		blocknum = stream->callback(stream->callback_private_data,
+									per_buffer_data);
+		if (!BlockNumberIsValid(blocknum))
+		{
+			stream->finished = true;
+			if (stream->advice_enabled)
+				StreamingReadFlushAdvice(stream);
+			break;
+		}
+
+		stream->blocknums[slot] = blocknum;
+		stream->buffers[slot] = InvalidBuffer;
+		stream->nqueued++;
+
+		if (stream->advice_enabled)
+			StreamingReadAdvise(stream, blocknum);
+	}
+}
+
+/*
+ * Pin the oldest queued block, along with any immediately following queued
+ * blocks that are consecutive with it, up to the combine limit.
+ */
+static void
+StreamingReadPinRun(StreamingRead *stream)
+{
+	Buffer		run_buffers[MAX_IO_COMBINE_LIMIT];
+	BlockNumber first_block = stream->blocknums[stream->oldest];
+	int			nblocks = 1;
+	int			nread;
+
+	Assert(stream->nqueued > 0);
+	Assert(!BufferIsValid(stream->buffers[stream->oldest]));
+
+	while (nblocks < stream->max_combine && nblocks < stream->nqueued)
+	{
+		int			slot = (stream->oldest + nblocks) % stream->queue_size;
+
+		if (stream->blocknums[slot] != first_block + nblocks)
+			break;
+		Assert(!BufferIsValid(stream->buffers[slot]));
+		nblocks++;
+	}
+
+	if (RelationUsesLocalBuffers(stream->rel))
+	{
+		Assert(nblocks == 1);
+		run_buffers[0] = ReadBufferExtended(stream->rel, stream->forknum,
+											first_block, RBM_NORMAL,
+											stream->strategy);
+		/* we can't tell hits from misses here, so just look ahead fully */
+		nread = 1;
+	}
+	else
+		nread = ReadBuffersVectored(stream->rel, stream->forknum, first_block,
+									nblocks, stream->strategy, run_buffers);
+
+	/* Don't hint about blocks we've just read */
+	if (stream->advice_nblocks > 0 &&
+		stream->advice_start >= first_block &&
+		stream->advice_start < first_block + nblocks)
+	{
+		int			overlap = first_block + nblocks - stream->advice_start;
+
+		overlap = Min(overlap, stream->advice_nblocks);
+		stream->advice_start += overlap;
+		stream->advice_nblocks -= overlap;
+	}
+
+	for (int i = 0; i < nblocks; i++)
+		stream->buffers[(stream->oldest + i) % stream->queue_size] = run_buffers[i];
+
+	/*
+	 * Look further ahead while we're finding blocks that need I/O, and back
+	 * off again while everything is found in the buffer pool.
+	 */
+	if (nread > 0)
+		stream->distance = Min(stream->distance * 2, stream->max_distance);
+	else if (stream->distance > 1)
+		stream->distance--;
+}
+
+/*
+ * StreamingReadNextBuffer -- return the next buffer of a streaming read
+ *
+ * The buffer is pinned, and its contents are valid; the caller is
+ * responsible for releasing the pin.  Returns InvalidBuffer at the end of the
+ * stream.  If per_buffer_data is not NULL, *per_buffer_data is set to point
+ * to the data the callback stored for this block; it remains valid only until
+ * the next call.
+ */
+Buffer
+StreamingReadNextBuffer(StreamingRead *stream, void **per_buffer_data)
+{
+	Buffer		buffer;
+	int			slot;
+
+	StreamingReadLookAhead(stream);
+
+	if (stream->nqueued == 0)
+	{
+		Assert(stream->finished);
+		return InvalidBuffer;
+	}
+
+	slot = stream->oldest;
+	if (!BufferIsValid(stream->buffers[slot]))
+		StreamingReadPinRun(stream);
+
+	buffer = stream->buffers[slot];
+	Assert(BufferIsValid(buffer));
+	stream->buffers[slot] = InvalidBuffer;
+
+	if (per_buffer_data)
+		*per_buffer_data = stream->per_buffer_data_size > 0 ?
+			stream->per_buffer_data + slot * stream->per_buffer_data_size :
+			NULL;
+
+	stream->oldest = (stream->oldest + 1) % stream->queue_size;
+	stream->nqueued--;
+
+	return buffer;
+}
+
+/*
+ * StreamingReadReset -- forget the look-ahead state of a streaming read
+ *
+ * Releases any buffers that were pinned ahead of the consumer.  The next call
+ * to StreamingReadNextBuffer() starts calling the callback again, which is
+ * useful if the callback's idea of what comes next has changed (for example,
+ * because a scan changed direction) or after it reported the end of the
+ * stream.
+ */
+void
+StreamingReadReset(StreamingRead *stream)
+{
+	while (stream->nqueued > 0)
+	{
+		Buffer		buffer = stream->buffers[stream->oldest];
+
+		if (BufferIsValid(buffer))
+			ReleaseBuffer(buffer);
+		stream->oldest = (stream->oldest + 1) % stream->queue_size;
+		stream->nqueued--;
+	}
+
+	stream->oldest = 0;
+	stream->finished = false;
+	stream->advice_nblocks = 0;
+	if (RelationUsesLocalBuffers(stream->rel))
+		stream->distance = stream->max_distance;
+	else
+		stream->distance = 1;
+}
+
+/*
+ * StreamingReadEnd -- release all resources of a streaming read
+ */
+void
+StreamingReadEnd(StreamingRead *stream)
+{
+	StreamingReadReset(stream);
+
+	pfree(stream->blocknums);
+	pfree(stream->buffers);
+	if (stream->per_buffer_data)
+		pfree(stream->per_buffer_data);
+	pfree(stream);
+}
+
 /*
  * BufferAlloc -- subroutine for ReadBuffer.  Handles lookup of a shared
  *		buffer.  If no buffer exists already, selects a replacement
@@ -1106,12 +1727,12 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
  * using the default strategy, but otherwise possibly not (see PinBuffer).
  *
  * The returned buffer is pinned and is already marked as holding the
- * desired page.  If it already did have the desired page, *foundPtr is
- * set true.  Otherwise, *foundPtr is set false and the buffer is marked
- * as IO_IN_PROGRESS; ReadBuffer will now need to do I/O to fill it.
- *
- * *foundPtr is actually redundant with the buffer's BM_VALID flag, but
- * we keep it for simplicity in ReadBuffer.
+ * desired page.  If it already did have the desired page and its contents
+ * were valid when we pinned it, *foundPtr is set true.  Otherwise, *foundPtr
+ * is set false, and the caller must use StartBufferIO to obtain the right to
+ * fill it (which may turn out to be unnecessary, if another backend is
+ * concurrently reading the same page).  Leaving that to the caller allows a
+ * run of buffers to be pinned first and then read with a single I/O.
  *
  * No locks are held either at entry or exit.
  */
@@ -1132,6 +1753,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	BufferDesc *buf;
 	bool		valid;
 	uint32		buf_state;
+	bool		from_ring;
+	IOContext	io_context = IOContextForStrategy(strategy);
 
 	/* create a tag so we can lookup the buffer */
 	InitBufferTag(&newTag, &smgr->smgr_rlocator.locator, forkNum, blockNum);
@@ -1157,26 +1780,12 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		/* Can release the mapping lock as soon as we've pinned it */
 		LWLockRelease(newPartitionLock);
 
-		*foundPtr = true;
-
-		if (!valid)
-		{
-			/*
-			 * We can only get here if (a) someone else is still reading in
-			 * the page, or (b) a previous read attempt failed.  We have to
-			 * wait for any active read attempt to finish, and then set up our
-			 * own read attempt if the page is still not BM_VALID.
-			 * StartBufferIO does it all.
-			 */
-			if (StartBufferIO(buf, true))
-			{
-				/*
-				 * If we get here, previous attempts to read the buffer must
-				 * have failed ... but we shall bravely try again.
-				 */
-				*foundPtr = false;
-			}
-		}
+		/*
+		 * If the buffer isn't valid, either (a) someone else is still
+		 * reading in the page, or (b) a previous read attempt failed.  The
+		 * caller's StartBufferIO call will sort that out.
+		 */
+		*foundPtr = valid;
 
 		return buf;
 	}
@@ -1200,7 +1809,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * Select a victim buffer.  The buffer is returned with its header
 		 * spinlock still held!
 		 */
-		buf = StrategyGetBuffer(strategy, &buf_state);
+		buf = StrategyGetBuffer(strategy, &buf_state, &from_ring);
 
 		Assert(BUF_STATE_GET_REFCOUNT(buf_state) == 0);
 
@@ -1254,7 +1863,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 					UnlockBufHdr(buf, buf_state);
 
 					if (XLogNeedsFlush(lsn) &&
-						StrategyRejectBuffer(strategy, buf))
+						StrategyRejectBuffer(strategy, buf, from_ring))
 					{
 						/* Drop lock/pin and loop around for another buffer */
 						LWLockRelease(BufferDescriptorGetContentLock(buf));
@@ -1269,11 +1878,11 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 														  smgr->smgr_rlocator.locator.dbOid,
 														  smgr->smgr_rlocator.locator.relNumber);
 
-				FlushBuffer(buf, NULL);
+				FlushBuffer(buf, NULL, IOOBJECT_RELATION, io_context);
 				LWLockRelease(BufferDescriptorGetContentLock(buf));
 
 				ScheduleBufferTagForWriteback(&BackendWritebackContext,
-											  &buf->tag);
+											  &buf->tag, 1);
 
 				TRACE_POSTGRESQL_BUFFER_WRITE_DIRTY_DONE(forkNum, blockNum,
 														 smgr->smgr_rlocator.locator.spcOid,
@@ -1369,26 +1978,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			/* Can release the mapping lock as soon as we've pinned it */
 			LWLockRelease(newPartitionLock);
 
-			*foundPtr = true;
-
-			if (!valid)
-			{
-				/*
-				 * We can only get here if (a) someone else is still reading
-				 * in the page, or (b) a previous read attempt failed.  We
-				 * have to wait for any active read attempt to finish, and
-				 * then set up our own read attempt if the page is still not
-				 * BM_VALID.  StartBufferIO does it all.
-				 */
-				if (StartBufferIO(buf, true))
-				{
-					/*
-					 * If we get here, previous attempts to read the buffer
-					 * must have failed ... but we shall bravely try again.
-					 */
-					*foundPtr = false;
-				}
-			}
+			/* See comments at the top of the routine */
+			*foundPtr = valid;
 
 			return buf;
 		}
@@ -1450,16 +2041,26 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	LWLockRelease(newPartitionLock);
 
+	if (oldFlags & BM_VALID)
+	{
+		/*
+		 * When a BufferAccessStrategy is in use, blocks evicted from shared
+		 * buffers are counted as IOOP_EVICT in the corresponding context
+		 * (e.g. IOCONTEXT_BULKWRITE).  Blocks evicted from buffers already in
+		 * the strategy ring are counted as IOOP_REUSE instead.
+		 *
+		 * Only count once the valid buffer has been successfully claimed;
+		 * before that we may have had to give it up to a concurrent pinner.
+		 */
+		pgstat_count_io_op(IOOBJECT_RELATION, io_context,
+						   from_ring ? IOOP_REUSE : IOOP_EVICT);
+	}
+
 	/*
-	 * Buffer contents are currently invalid.  Try to obtain the right to
-	 * start I/O.  If StartBufferIO returns false, then someone else managed
-	 * to read it before we did, so there's nothing left for BufferAlloc() to
-	 * do.
+	 * Buffer contents are currently invalid.  The caller must obtain the
+	 * right to start I/O with StartBufferIO.
 	 */
-	if (StartBufferIO(buf, true))
-		*foundPtr = false;
-	else
-		*foundPtr = true;
+	*foundPtr = false;
 
 	return buf;
 }
@@ -1963,9 +2564,6 @@ BufferSync(int flags)
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
 
-	/* Make sure we can handle the pin inside SyncOneBuffer */
-	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
-
 	/*
 	 * Unless this is a shutdown checkpoint or we have been explicitly told,
 	 * we write only permanent, dirty buffers.  But at shutdown or end of
@@ -2161,11 +2759,20 @@ BufferSync(int flags)
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			int			run_written;
+
+			/*
+			 * The buffers holding the following blocks of the relation are
+			 * likely to be next in line, as CkptBufferIds is sorted; write
+			 * them along with this one.  When we get to them, they won't
+			 * need writing anymore.
+			 */
+			if (SyncOneBuffer(buf_id, false, io_combine_limit, &wb_context,
+							  &run_written) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
-				PendingCheckpointerStats.buf_written_checkpoints++;
-				num_written++;
+				PendingCheckpointerStats.buf_written_checkpoints += run_written;
+				num_written += run_written;
 			}
 		}
 
@@ -2439,9 +3046,6 @@ BgBufferSync(WritebackContext *wb_context)
 	 * requirements, or hit the bgwriter_lru_maxpages limit.
 	 */
 
-	/* Make sure we can handle the pin inside SyncOneBuffer */
-	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
-
 	num_to_scan = bufs_to_lap;
 	num_written = 0;
 	reusable_buffers = reusable_buffers_est;
@@ -2449,8 +3053,11 @@ BgBufferSync(WritebackContext *wb_context)
 	/* Execute the LRU scan */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
+		int			run_written;
 		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+											   Min(io_combine_limit,
+												   bgwriter_lru_maxpages - num_written),
+											   wb_context, &run_written);
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -2461,8 +3068,9 @@ BgBufferSync(WritebackContext *wb_context)
 
 		if (sync_state & BUF_WRITTEN)
 		{
-			reusable_buffers++;
-			if (++num_written >= bgwriter_lru_maxpages)
+			reusable_buffers += run_written;
+			num_written += run_written;
+			if (num_written >= bgwriter_lru_maxpages)
 			{
 				PendingBgWriterStats.maxwritten_clean++;
 				break;
@@ -2516,24 +3124,37 @@ BgBufferSync(WritebackContext *wb_context)
  * If skip_recently_used is true, we don't write currently-pinned buffers, nor
  * buffers marked recently used, as these are not replacement candidates.
  *
+ * If the buffer needs writing, the dirty buffers holding the blocks that
+ * immediately follow it are written along with it in a single vectored
+ * write, up to max_blocks blocks in total.  Those are subject to the same
+ * skip_recently_used test; when called for a checkpoint (skip_recently_used
+ * false), only buffers that are marked BM_CHECKPOINT_NEEDED are included.
+ *
  * Returns a bitmask containing the following flag bits:
  *	BUF_WRITTEN: we wrote the buffer.
  *	BUF_REUSABLE: buffer is available for replacement, ie, it has
  *		pin count 0 and usage count 0.
  *
+ * If BUF_WRITTEN is set, *num_written is set to the number of buffers
+ * written, including the given one.
+ *
  * (BUF_WRITTEN could be set in error if FlushBuffer finds the buffer clean
  * after locking it, but we don't care all that much.)
- *
- * Note: caller must have done ResourceOwnerEnlargeBuffers.
  */
 static int
-SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
+SyncOneBuffer(int buf_id, bool skip_recently_used, int max_blocks,
+			  WritebackContext *wb_context, int *num_written)
 {
 	BufferDesc *bufHdr = GetBufferDescriptor(buf_id);
+	BufferDesc *run[MAX_IO_COMBINE_LIMIT];
+	int			nrun = 0;
 	int			result = 0;
 	uint32		buf_state;
 	BufferTag	tag;
 
+	*num_written = 0;
+
+	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
 	ReservePrivateRefCountEntry();
 
 	/*
@@ -2567,25 +3188,120 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	}
 
 	/*
-	 * Pin it, share-lock it, write it.  (FlushBuffer will do nothing if the
-	 * buffer is clean by the time we've locked it.)
+	 * Pin it, share-lock it, write it, together with any neighbors we can
+	 * get hold of without waiting.  (There is nothing to do if the buffer is
+	 * clean by the time we've locked it.)
 	 */
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
-
-	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+	run[0] = bufHdr;
+	nrun = 1;
+	if (StartBufferIO(bufHdr, false, false))
+	{
+		nrun += StartBufferWriteRun(bufHdr, skip_recently_used,
+									Min(max_blocks, MAX_IO_COMBINE_LIMIT) - 1,
+									&run[1]);
+		FlushBufferRun(run, nrun, NULL, IOOBJECT_RELATION, IOCONTEXT_NORMAL);
+	}
 
 	tag = bufHdr->tag;
 
-	UnpinBuffer(bufHdr, true);
+	for (int i = 0; i < nrun; i++)
+	{
+		LWLockRelease(BufferDescriptorGetContentLock(run[i]));
+		UnpinBuffer(run[i], true);
+	}
+
+	/* The run holds consecutive blocks, so a single request covers it */
+	ScheduleBufferTagForWriteback(wb_context, &tag, nrun);
 
-	ScheduleBufferTagForWriteback(wb_context, &tag);
+	*num_written = nrun;
 
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * StartBufferWriteRun -- collect buffers to be written along with another
+ *
+ * Looks up the buffers holding the up to max_blocks blocks that follow the
+ * block held by 'first', which the caller has pinned, share-locked and
+ * started output I/O on.  We stop at the first block that isn't in the
+ * buffer pool, isn't dirty, doesn't pass the test described in
+ * SyncOneBuffer(), or that we couldn't pin, share-lock and start I/O on
+ * without waiting.  Waiting could deadlock, since we already have I/O in
+ * progress.
+ *
+ * The buffers collected are stored in run[] in block order, in the same
+ * state as 'first'.  Returns the number of buffers collected.
+ */
+static int
+StartBufferWriteRun(BufferDesc *first, bool skip_recently_used,
+					int max_blocks, BufferDesc **run)
+{
+	BufferTag	tag = first->tag;
+	int			nrun = 0;
+
+	while (nrun < max_blocks && tag.blockNum < MaxBlockNumber)
+	{
+		uint32		hash;
+		LWLock	   *partitionLock;
+		int			buf_id;
+		BufferDesc *bufHdr;
+		uint32		buf_state;
+
+		tag.blockNum++;
+
+		/* See if the block is in the buffer pool */
+		hash = BufTableHashCode(&tag);
+		partitionLock = BufMappingPartitionLock(hash);
+		LWLockAcquire(partitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&tag, hash);
+		LWLockRelease(partitionLock);
+
+		if (buf_id < 0)
+			break;
+
+		bufHdr = GetBufferDescriptor(buf_id);
+
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		ReservePrivateRefCountEntry();
+
+		/* Recheck the tag now that we have the header lock */
+		buf_state = LockBufHdr(bufHdr);
+		if (!BufferTagsEqual(&tag, &bufHdr->tag) ||
+			!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY) ||
+			(skip_recently_used ?
+			 (BUF_STATE_GET_REFCOUNT(buf_state) != 0 ||
+			  BUF_STATE_GET_USAGECOUNT(buf_state) != 0) :
+			 !(buf_state & BM_CHECKPOINT_NEEDED)))
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			break;
+		}
+
+		PinBuffer_Locked(bufHdr);
+
+		if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(bufHdr),
+									  LW_SHARED))
+		{
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		if (!StartBufferIO(bufHdr, false, true))
+		{
+			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		run[nrun++] = bufHdr;
+	}
+
+	return nrun;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2819,57 +3535,91 @@ BufferGetTag(Buffer buffer, RelFileLocator *rlocator, ForkNumber *forknum,
  * written.)
  *
  * If the caller has an smgr reference for the buffer's relation, pass it
- * as the second parameter.  If not, pass NULL.
+ * as the second parameter.  If not, pass NULL.  io_object and io_context
+ * say how the write is counted in pg_stat_io.
  */
 static void
-FlushBuffer(BufferDesc *buf, SMgrRelation reln)
+FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOObject io_object,
+			IOContext io_context)
 {
-	XLogRecPtr	recptr;
-	ErrorContextCallback errcallback;
-	instr_time	io_start,
-				io_time;
-	Block		bufBlock;
-	char	   *bufToWrite;
-	uint32		buf_state;
-
 	/*
 	 * Try to start an I/O operation.  If StartBufferIO returns false, then
 	 * someone else flushed the buffer before we could, so we need not do
 	 * anything.
 	 */
-	if (!StartBufferIO(buf, false))
+	if (!StartBufferIO(buf, false, false))
 		return;
 
+	FlushBufferRun(&buf, 1, reln, io_object, io_context);
+}
+
+/*
+ * FlushBufferRun
+ *		Physically write out a run of shared buffers holding consecutive
+ *		blocks of the same relation fork, with a single vectored write.
+ *
+ * The caller must hold a pin and a share-lock on each of the buffers, as for
+ * FlushBuffer(), and must already have started output I/O on them with
+ * StartBufferIO().  The I/O is terminated here.
+ */
+static void
+FlushBufferRun(BufferDesc **bufs, int nbufs, SMgrRelation reln,
+			   IOObject io_object, IOContext io_context)
+{
+	XLogRecPtr	recptr = InvalidXLogRecPtr;
+	bool		permanent = false;
+	ErrorContextCallback errcallback;
+	instr_time	io_start;
+	char	   *bufToWrite[MAX_IO_COMBINE_LIMIT];
+	BlockNumber blockNum = bufs[0]->tag.blockNum;
+	ForkNumber	forkNum = bufs[0]->tag.forkNum;
+	static char *runCopies = NULL;
+
+	Assert(nbufs > 0 && nbufs <= MAX_IO_COMBINE_LIMIT);
+
 	/* Setup error traceback support for ereport() */
 	errcallback.callback = shared_buffer_write_error_callback;
-	errcallback.arg = (void *) buf;
+	errcallback.arg = (void *) bufs[0];
 	errcallback.previous = error_context_stack;
 	error_context_stack = &errcallback;
 
 	/* Find smgr relation for buffer */
 	if (reln == NULL)
-		reln = smgropen(buf->tag.rlocator, InvalidBackendId);
+		reln = smgropen(bufs[0]->tag.rlocator, InvalidBackendId);
 
-	TRACE_POSTGRESQL_BUFFER_FLUSH_START(buf->tag.forkNum,
-										buf->tag.blockNum,
-										reln->smgr_rlocator.locator.spcOid,
-										reln->smgr_rlocator.locator.dbOid,
-										reln->smgr_rlocator.locator.relNumber);
+	for (int i = 0; i < nbufs; i++)
+	{
+		BufferDesc *buf = bufs[i];
+		uint32		buf_state;
 
-	buf_state = LockBufHdr(buf);
+		Assert(buf->tag.forkNum == forkNum &&
+			   buf->tag.blockNum == blockNum + i);
 
-	/*
-	 * Run PageGetLSN while holding header lock, since we don't have the
-	 * buffer locked exclusively in all cases.
-	 */
-	recptr = BufferGetLSN(buf);
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(buf->tag.forkNum,
+											buf->tag.blockNum,
+											reln->smgr_rlocator.locator.spcOid,
+											reln->smgr_rlocator.locator.dbOid,
+											reln->smgr_rlocator.locator.relNumber);
 
-	/* To check if block content changes while flushing. - vadim 01/17/97 */
-	buf_state &= ~BM_JUST_DIRTIED;
-	UnlockBufHdr(buf, buf_state);
+		buf_state = LockBufHdr(buf);
+
+		/*
+		 * Run PageGetLSN while holding header lock, since we don't have the
+		 * buffer locked exclusively in all cases.
+		 */
+		if (buf_state & BM_PERMANENT)
+		{
+			recptr = Max(recptr, BufferGetLSN(buf));
+			permanent = true;
+		}
+
+		/* To check if block content changes while flushing. - vadim 01/17/97 */
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(buf, buf_state);
+	}
 
 	/*
-	 * Force XLOG flush up to buffer's LSN.  This implements the basic WAL
+	 * Force XLOG flush up to the buffers' LSN.  This implements the basic WAL
 	 * rule that log updates must hit disk before any of the data-file changes
 	 * they describe do.
 	 *
@@ -2885,56 +3635,72 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	 * disastrous system-wide consequences.  To make sure that can't happen,
 	 * skip the flush if the buffer isn't permanent.
 	 */
-	if (buf_state & BM_PERMANENT)
+	if (permanent)
 		XLogFlush(recptr);
 
 	/*
 	 * Now it's safe to write buffer to disk. Note that no one else should
 	 * have been able to write it while we were busy with log flushing because
 	 * only one process at a time can set the BM_IO_IN_PROGRESS bit.
-	 */
-	bufBlock = BufHdrGetBlock(buf);
-
-	/*
+	 *
 	 * Update page checksum if desired.  Since we have only shared lock on the
 	 * buffer, other processes might be updating hint bits in it, so we must
-	 * copy the page to private storage if we do checksumming.
+	 * copy the page to private storage if we do checksumming.  A run of
+	 * several pages needs a copy of each; the space for that is allocated on
+	 * first use, which normally happens only in the checkpointer and the
+	 * background writer.
 	 */
-	bufToWrite = PageSetChecksumCopy((Page) bufBlock, buf->tag.blockNum);
+	if (nbufs == 1)
+		bufToWrite[0] = PageSetChecksumCopy((Page) BufHdrGetBlock(bufs[0]),
+											blockNum);
+	else
+	{
+		for (int i = 0; i < nbufs; i++)
+		{
+			Page		page = (Page) BufHdrGetBlock(bufs[i]);
+
+			if (PageIsNew(page) || !DataChecksumsEnabled())
+				bufToWrite[i] = (char *) page;
+			else
+			{
+				if (runCopies == NULL)
+					runCopies = MemoryContextAlloc(TopMemoryContext,
+												   MAX_IO_COMBINE_LIMIT * BLCKSZ);
+				bufToWrite[i] = runCopies + i * BLCKSZ;
+				memcpy(bufToWrite[i], page, BLCKSZ);
+				PageSetChecksumInplace((Page) bufToWrite[i], blockNum + i);
+			}
+		}
+	}
 
-	if (track_io_timing)
-		INSTR_TIME_SET_CURRENT(io_start);
+	io_start = pgstat_prepare_io_time();
 
 	/*
-	 * bufToWrite is either the shared buffer or a copy, as appropriate.
+	 * bufToWrite[] holds either the shared buffers or copies, as appropriate.
 	 */
-	smgrwrite(reln,
-			  buf->tag.forkNum,
-			  buf->tag.blockNum,
-			  bufToWrite,
-			  false);
+	smgrwritev(reln, forkNum, blockNum, bufToWrite, nbufs, false);
 
-	if (track_io_timing)
-	{
-		INSTR_TIME_SET_CURRENT(io_time);
-		INSTR_TIME_SUBTRACT(io_time, io_start);
-		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
-		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
-	}
+	pgstat_count_io_op_time(io_object, io_context, IOOP_WRITE, io_start,
+							nbufs);
 
-	pgBufferUsage.shared_blks_written++;
+	pgBufferUsage.shared_blks_written += nbufs;
 
-	/*
-	 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set) and
-	 * end the BM_IO_IN_PROGRESS state.
-	 */
-	TerminateBufferIO(buf, true, 0);
+	for (int i = 0; i < nbufs; i++)
+	{
+		BufferDesc *buf = bufs[i];
 
-	TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(buf->tag.forkNum,
-									   buf->tag.blockNum,
-									   reln->smgr_rlocator.locator.spcOid,
-									   reln->smgr_rlocator.locator.dbOid,
-									   reln->smgr_rlocator.locator.relNumber);
+		/*
+		 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set)
+		 * and end the BM_IO_IN_PROGRESS state.
+		 */
+		TerminateBufferIO(buf, true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(buf->tag.forkNum,
+										   buf->tag.blockNum,
+										   reln->smgr_rlocator.locator.spcOid,
+										   reln->smgr_rlocator.locator.dbOid,
+										   reln->smgr_rlocator.locator.relNumber);
+	}
 
 	/* Pop the error context stack */
 	error_context_stack = errcallback.previous;
@@ -3532,6 +4298,7 @@ FlushRelationBuffers(Relation rel)
 			{
 				ErrorContextCallback errcallback;
 				Page		localpage;
+				instr_time	io_start;
 
 				localpage = (char *) LocalBufHdrGetBlock(bufHdr);
 
@@ -3543,12 +4310,18 @@ FlushRelationBuffers(Relation rel)
 
 				PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
 
+				io_start = pgstat_prepare_io_time();
+
 				smgrwrite(RelationGetSmgr(rel),
 						  bufHdr->tag.forkNum,
 						  bufHdr->tag.blockNum,
 						  localpage,
 						  false);
 
+				pgstat_count_io_op_time(IOOBJECT_TEMP_RELATION,
+										IOCONTEXT_NORMAL, IOOP_WRITE,
+										io_start, 1);
+
 				buf_state &= ~(BM_DIRTY | BM_JUST_DIRTIED);
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
 
@@ -3584,7 +4357,8 @@ FlushRelationBuffers(Relation rel)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, RelationGetSmgr(rel));
+			FlushBuffer(bufHdr, RelationGetSmgr(rel), IOOBJECT_RELATION,
+						IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3679,7 +4453,8 @@ FlushRelationsAllBuffers(SMgrRelation *smgrs, int nrels)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, srelent->srel);
+			FlushBuffer(bufHdr, srelent->srel, IOOBJECT_RELATION,
+						IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3887,7 +4662,7 @@ FlushDatabaseBuffers(Oid dbid)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, NULL);
+			FlushBuffer(bufHdr, NULL, IOOBJECT_RELATION, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3914,7 +4689,7 @@ FlushOneBuffer(Buffer buffer)
 
 	Assert(LWLockHeldByMe(BufferDescriptorGetContentLock(bufHdr)));
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOOBJECT_RELATION, IOCONTEXT_NORMAL);
 }
 
 /*
@@ -4496,8 +5271,11 @@ IsBufferCleanupOK(Buffer buffer)
 /*
  *	Functions for buffer I/O handling
  *
- *	Note: We assume that nested buffer I/O never occurs.
- *	i.e at most one BM_IO_IN_PROGRESS bit is set per proc.
+ *	Note: A process may have BM_IO_IN_PROGRESS set on several buffers at
+ *	once, but only while performing a single vectored read or write of
+ *	consecutive blocks (see ReadBuffersVectored).  It must never wait for
+ *	another process's I/O while it holds I/O in progress on some buffer,
+ *	except in StartBufferIO for the first buffer of such a run.
  *
  *	Also note that these are used only for shared buffers, not local ones.
  */
@@ -4533,27 +5311,31 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is executing no IO, unless nowait is true
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
  * could attempt the same I/O operation concurrently.  If someone else
  * has already started I/O on this buffer then we will block on the
- * I/O condition variable until he's done.
+ * I/O condition variable until he's done.  If nowait is true, we instead
+ * return false immediately; the caller must then recheck the buffer later.
+ * This is how the later buffers of a multi-block I/O are started, since
+ * waiting while holding I/O on other buffers could deadlock.
  *
  * Input operations are only attempted on buffers that are not BM_VALID,
  * and output operations only on buffers that are BM_VALID and BM_DIRTY,
  * so we can always tell if the work is already done.
  *
  * Returns true if we successfully marked the buffer as I/O busy,
- * false if someone else already did the work.
+ * false if someone else already did (or, with nowait, is doing) the work.
  */
 static bool
-StartBufferIO(BufferDesc *buf, bool forInput)
+StartBufferIO(BufferDesc *buf, bool forInput, bool nowait)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressIOs < MAX_IO_COMBINE_LIMIT);
+	Assert(NumInProgressIOs == 0 || nowait);
 
 	for (;;)
 	{
@@ -4562,6 +5344,8 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 		if (!(buf_state & BM_IO_IN_PROGRESS))
 			break;
 		UnlockBufHdr(buf, buf_state);
+		if (nowait)
+			return false;
 		WaitIO(buf);
 	}
 
@@ -4577,8 +5361,9 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressIOs[NumInProgressIOs].buf = buf;
+	InProgressIOs[NumInProgressIOs].forInput = forInput;
+	NumInProgressIOs++;
 
 	return true;
 }
@@ -4603,8 +5388,18 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	/* Forget the buffer; searching from the end is fastest in practice */
+	for (i = NumInProgressIOs - 1; i >= 0; i--)
+	{
+		if (InProgressIOs[i].buf == buf)
+			break;
+	}
+	Assert(i >= 0);
+	NumInProgressIOs--;
+	memmove(&InProgressIOs[i], &InProgressIOs[i + 1],
+			(NumInProgressIOs - i) * sizeof(InProgressIO));
 
 	buf_state = LockBufHdr(buf);
 
@@ -4617,8 +5412,6 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
-
 	ConditionVariableBroadcast(BufferDescriptorGetIOCV(buf));
 }
 
@@ -4634,15 +5427,15 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressIOs > 0)
 	{
+		BufferDesc *buf = InProgressIOs[NumInProgressIOs - 1].buf;
+		bool		forInput = InProgressIOs[NumInProgressIOs - 1].forInput;
 		uint32		buf_state;
 
 		buf_state = LockBufHdr(buf);
 		Assert(buf_state & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (forInput)
 		{
 			Assert(!(buf_state & BM_DIRTY));
 
@@ -4883,16 +5676,28 @@ WritebackContextInit(WritebackContext *context, int *max_pending)
 
 	context->max_pending = max_pending;
 	context->nr_pending = 0;
+	context->nr_pending_blocks = 0;
 }
 
 /*
  * Add buffer to list of pending writeback requests.
+ *
+ * nblocks is the number of consecutive blocks, starting at the one in tag,
+ * that have been written; a run written with a single vectored write needs
+ * only one request.
  */
 void
-ScheduleBufferTagForWriteback(WritebackContext *context, BufferTag *tag)
+ScheduleBufferTagForWriteback(WritebackContext *context, BufferTag *tag,
+							  int nblocks)
 {
 	PendingWriteback *pending;
 
+	Assert(nblocks > 0);
+
+	/* With direct I/O the kernel holds no dirty data for us to flush. */
+	if (io_direct_flags & IO_DIRECT_DATA)
+		return;
+
 	/*
 	 * Add buffer to the pending writeback array, unless writeback control is
 	 * disabled.
@@ -4904,14 +5709,17 @@ ScheduleBufferTagForWriteback(WritebackContext *context, BufferTag *tag)
 		pending = &context->pending_writebacks[context->nr_pending++];
 
 		pending->tag = *tag;
+		pending->nblocks = nblocks;
+		context->nr_pending_blocks += nblocks;
 	}
 
 	/*
 	 * Perform pending flushes if the writeback limit is exceeded. This
 	 * includes the case where previously an item has been added, but control
-	 * is now disabled.
+	 * is now disabled.  The limit is measured in blocks, so there's always
+	 * room for another request in the array.
 	 */
-	if (context->nr_pending >= *context->max_pending)
+	if (context->nr_pending_blocks >= *context->max_pending)
 		IssuePendingWritebacks(context);
 }
 
@@ -4932,6 +5740,7 @@ ScheduleBufferTagForWriteback(WritebackContext *context, BufferTag *tag)
 void
 IssuePendingWritebacks(WritebackContext *context)
 {
+	instr_time	io_start;
 	int			i;
 
 	if (context->nr_pending == 0)
@@ -4943,6 +5752,8 @@ IssuePendingWritebacks(WritebackContext *context)
 	 */
 	sort_pending_writebacks(context->pending_writebacks, context->nr_pending);
 
+	io_start = pgstat_prepare_io_time();
+
 	/*
 	 * Coalesce neighbouring writes, but nothing else. For that we iterate
 	 * through the, now sorted, array of pending flushes, and look forward to
@@ -4955,10 +5766,11 @@ IssuePendingWritebacks(WritebackContext *context)
 		SMgrRelation reln;
 		int			ahead;
 		BufferTag	tag;
-		Size		nblocks = 1;
+		BlockNumber end;
 
 		cur = &context->pending_writebacks[i];
 		tag = cur->tag;
+		end = tag.blockNum + cur->nblocks;
 
 		/*
 		 * Peek ahead, into following writeback requests, to see if they can
@@ -4973,15 +5785,11 @@ IssuePendingWritebacks(WritebackContext *context)
 				cur->tag.forkNum != next->tag.forkNum)
 				break;
 
-			/* ok, block queued twice, skip */
-			if (cur->tag.blockNum == next->tag.blockNum)
-				continue;
-
-			/* only merge consecutive writes */
-			if (cur->tag.blockNum + 1 != next->tag.blockNum)
+			/* only merge overlapping or consecutive writes */
+			if (next->tag.blockNum > end)
 				break;
 
-			nblocks++;
+			end = Max(end, next->tag.blockNum + next->nblocks);
 			cur = next;
 		}
 
@@ -4989,10 +5797,19 @@ IssuePendingWritebacks(WritebackContext *context)
 
 		/* and finally tell the kernel to write the data to storage */
 		reln = smgropen(tag.rlocator, InvalidBackendId);
-		smgrwriteback(reln, tag.forkNum, tag.blockNum, nblocks);
+		smgrwriteback(reln, tag.forkNum, tag.blockNum, end - tag.blockNum);
 	}
 
+	/*
+	 * Writebacks are counted per block, so that they can be compared with
+	 * the number of blocks written.
+	 */
+	pgstat_count_io_op_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+							IOOP_WRITEBACK, io_start,
+							context->nr_pending_blocks);
+
 	context->nr_pending = 0;
+	context->nr_pending_blocks = 0;
 }
 
 
@@ -16,6 +16,7 @@
 
 #include "access/clog.h"
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
@@ -47,6 +48,8 @@
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 
 /* GUCs */
@@ -119,6 +122,7 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, CLOGShmemSize());
 	size = add_size(size, CommitTsShmemSize());
 	size = add_size(size, SUBTRANSShmemSize());
+	size = add_size(size, CSNLogShmemSize());
 	size = add_size(size, TwoPhaseShmemSize());
 	size = add_size(size, BackgroundWorkerShmemSize());
 	size = add_size(size, MultiXactShmemSize());
@@ -141,6 +145,8 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, SyncScanShmemSize());
 	size = add_size(size, AsyncShmemSize());
 	size = add_size(size, StatsShmemSize());
+	size = add_size(size, SharedCatCacheShmemSize());
+	size = add_size(size, SharedPlanCacheShmemSize());
 #ifdef EXEC_BACKEND
 	size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -243,6 +249,7 @@ CreateSharedMemoryAndSemaphores(void)
 	CLOGShmemInit();
 	CommitTsShmemInit();
 	SUBTRANSShmemInit();
+	CSNLogShmemInit();
 	MultiXactShmemInit();
 	InitBufferPool();
 
@@ -293,6 +300,8 @@ CreateSharedMemoryAndSemaphores(void)
 	SyncScanShmemInit();
 	AsyncShmemInit();
 	StatsShmemInit();
+	SharedCatCacheShmemInit();
+	SharedPlanCacheShmemInit();
 
 #ifdef EXEC_BACKEND
 
@@ -55,6 +55,8 @@
  * but carries the extra information that the child is a WAL sender.
  * WAL senders too start in ACTIVE state, but switch to WALSENDER once they
  * start streaming the WAL (and they never go back to ACTIVE after that).
+ * Similarly, POOLED marks a backend that has handed its client over to a
+ * connection proxy, and now serves the proxy's sessions.
  *
  * We also have a shared-memory field that is used for communication in
  * the opposite direction, from postmaster to children: it tells why the
@@ -65,6 +67,7 @@
 #define PM_CHILD_ASSIGNED	1
 #define PM_CHILD_ACTIVE		2
 #define PM_CHILD_WALSENDER	3
+#define PM_CHILD_POOLED		4
 
 /* "typedef struct PMSignalData PMSignalData" appears in pmsignal.h */
 struct PMSignalData
@@ -283,6 +286,22 @@ IsPostmasterChildWalSender(int slot)
 		return false;
 }
 
+/*
+ * IsPostmasterChildPooled - check if given slot is in use by a backend
+ * serving a connection proxy.
+ */
+bool
+IsPostmasterChildPooled(int slot)
+{
+	Assert(slot > 0 && slot <= PMSignalState->num_child_flags);
+	slot--;
+
+	if (PMSignalState->PMChildFlags[slot] == PM_CHILD_POOLED)
+		return true;
+	else
+		return false;
+}
+
 /*
  * MarkPostmasterChildActive - mark a postmaster child as about to begin
  * actively using shared memory.  This is called in the child process.
@@ -316,6 +335,22 @@ MarkPostmasterChildWalSender(void)
 	PMSignalState->PMChildFlags[slot] = PM_CHILD_WALSENDER;
 }
 
+/*
+ * MarkPostmasterChildPooled - mark a postmaster child as a backend serving a
+ * connection proxy.  This is called in the child process, after it has
+ * handed its client over to the proxy.
+ */
+void
+MarkPostmasterChildPooled(void)
+{
+	int			slot = MyPMChildSlot;
+
+	Assert(slot > 0 && slot <= PMSignalState->num_child_flags);
+	slot--;
+	Assert(PMSignalState->PMChildFlags[slot] == PM_CHILD_ACTIVE);
+	PMSignalState->PMChildFlags[slot] = PM_CHILD_POOLED;
+}
+
 /*
  * MarkPostmasterChildInactive - mark a postmaster child as done using
  * shared memory.  This is called in the child process.
@@ -328,7 +363,8 @@ MarkPostmasterChildInactive(void)
 	Assert(slot > 0 && slot <= PMSignalState->num_child_flags);
 	slot--;
 	Assert(PMSignalState->PMChildFlags[slot] == PM_CHILD_ACTIVE ||
-		   PMSignalState->PMChildFlags[slot] == PM_CHILD_WALSENDER);
+		   PMSignalState->PMChildFlags[slot] == PM_CHILD_WALSENDER ||
+		   PMSignalState->PMChildFlags[slot] == PM_CHILD_POOLED);
 	PMSignalState->PMChildFlags[slot] = PM_CHILD_ASSIGNED;
 }
 
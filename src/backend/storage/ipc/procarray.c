@@ -48,6 +48,7 @@
 #include <signal.h>
 
 #include "access/clog.h"
+#include "access/csnlog.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -584,6 +585,9 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		/* Same with xactCompletionCount  */
 		ShmemVariableCache->xactCompletionCount++;
 
+		/* The new count is the transaction's CSN, see csnlog.c */
+		proc->commitSeqNo = ShmemVariableCache->xactCompletionCount;
+
 		ProcGlobal->xids[myoff] = InvalidTransactionId;
 		ProcGlobal->subxidStates[myoff].overflowed = false;
 		ProcGlobal->subxidStates[myoff].count = 0;
@@ -765,6 +769,9 @@ ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId latestXid)
 
 	/* Same with xactCompletionCount  */
 	ShmemVariableCache->xactCompletionCount++;
+
+	/* The new count is the transaction's CSN, see csnlog.c */
+	proc->commitSeqNo = ShmemVariableCache->xactCompletionCount;
 }
 
 /*
@@ -2191,6 +2198,12 @@ GetSnapshotDataReuse(Snapshot snapshot)
  * *may* need to be done to determine what's running (see XidInMVCCSnapshot()
  * in heapam_visibility.c).
  *
+ * With csn_snapshots enabled, subtransaction XIDs are not collected at all.
+ * Instead, the snapshot records the current xactCompletionCount as its CSN,
+ * and XidInMVCCSnapshot() consults the CSN log for XIDs between xmin and
+ * xmax.  The top-level XIDs are still collected, for the benefit of callers
+ * that look at xip[] directly.
+ *
  * We also update the following backend-global variables:
  *		TransactionXmin: the oldest xmin of any snapshot in use in the
  *			current transaction (this is the same as MyProc->xmin).
@@ -2369,8 +2382,11 @@ GetSnapshotData(Snapshot snapshot)
 			 * xmax.)
 			 *
 			 * Again, our own XIDs are not included in the snapshot.
+			 *
+			 * With csn_snapshots, subtransactions are checked using the CSN
+			 * log, so there is no need to collect them.
 			 */
-			if (!suboverflowed)
+			if (!suboverflowed && !csn_snapshots)
 			{
 
 				if (subxidStates[pgxactoff].overflowed)
@@ -2541,6 +2557,16 @@ GetSnapshotData(Snapshot snapshot)
 	snapshot->suboverflowed = suboverflowed;
 	snapshot->snapXactCompletionCount = curXactCompletionCount;
 
+	/*
+	 * Transactions that completed before this snapshot was taken have a CSN
+	 * of at most the current completion count, see csnlog.c.  The CSN log
+	 * is not maintained during recovery.
+	 */
+	if (csn_snapshots && !snapshot->takenDuringRecovery)
+		snapshot->snapshotCsn = curXactCompletionCount;
+	else
+		snapshot->snapshotCsn = InvalidCommitSeqNo;
+
 	snapshot->curcid = GetCurrentCommandId(false);
 
 	/*
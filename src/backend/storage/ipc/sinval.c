@@ -21,6 +21,8 @@
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -48,7 +50,35 @@ volatile sig_atomic_t catchupInterruptPending = false;
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
-	SIInsertDataEntries(msgs, n);
+	/*
+	 * Remove outdated tuples from the shared catalog cache first, so that a
+	 * backend that has processed the messages can't find them there.
+	 */
+	SharedCatCacheInvalidate(msgs, n);
+
+	/*
+	 * Outdated plans are removed from the shared plan cache only once the
+	 * messages are queued, so that a backend that plans concurrently either
+	 * sees the messages or has its plan removed.  Until then, the plans are
+	 * hidden.  If we fail halfway, all plans stay hidden until the next
+	 * invalidation has removed them.
+	 */
+	SharedPlanCacheInvalidateBegin();
+
+	PG_TRY();
+	{
+		SIInsertDataEntries(msgs, n);
+
+		SharedPlanCacheInvalidate(msgs, n);
+	}
+	PG_CATCH();
+	{
+		SharedPlanCacheInvalidateEnd(false);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	SharedPlanCacheInvalidateEnd(true);
 }
 
 /*
@@ -143,6 +143,8 @@ static const char *const BuiltinTrancheNames[] = {
 	"NotifyBuffer",
 	/* LWTRANCHE_SERIAL_BUFFER: */
 	"SerialBuffer",
+	/* LWTRANCHE_CSN_LOG_BUFFER: */
+	"CSNLogBuffer",
 	/* LWTRANCHE_WAL_INSERT: */
 	"WALInsert",
 	/* LWTRANCHE_BUFFER_CONTENT: */
@@ -183,6 +185,34 @@ static const char *const BuiltinTrancheNames[] = {
 	"PgStatsHash",
 	/* LWTRANCHE_PGSTATS_DATA: */
 	"PgStatsData",
+	/* LWTRANCHE_PARALLEL_VACUUM_DSA: */
+	"ParallelVacuumDSA",
+	/* LWTRANCHE_XACT_SLRU: */
+	"XactSLRU",
+	/* LWTRANCHE_COMMITTS_SLRU: */
+	"CommitTsSLRU",
+	/* LWTRANCHE_SUBTRANS_SLRU: */
+	"SubtransSLRU",
+	/* LWTRANCHE_MULTIXACTOFFSET_SLRU: */
+	"MultiXactOffsetSLRU",
+	/* LWTRANCHE_MULTIXACTMEMBER_SLRU: */
+	"MultiXactMemberSLRU",
+	/* LWTRANCHE_NOTIFY_SLRU: */
+	"NotifySLRU",
+	/* LWTRANCHE_SERIAL_SLRU: */
+	"SerialSLRU",
+	/* LWTRANCHE_CSN_LOG_SLRU: */
+	"CSNLogSLRU",
+	/* LWTRANCHE_SHARED_CATCACHE_DSA: */
+	"SharedCatCacheDSA",
+	/* LWTRANCHE_SHARED_CATCACHE_HASH: */
+	"SharedCatCacheHash",
+	/* LWTRANCHE_SHARED_PLANCACHE_DSA: */
+	"SharedPlanCacheDSA",
+	/* LWTRANCHE_SHARED_PLANCACHE_HASH: */
+	"SharedPlanCacheHash",
+	/* LWTRANCHE_SHARED_PLANCACHE_DEPS: */
+	"SharedPlanCacheDeps",
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -93,6 +93,7 @@ static void RemoveProcFromArray(int code, Datum arg);
 static void ProcKill(int code, Datum arg);
 static void AuxiliaryProcKill(int code, Datum arg);
 static void CheckDeadLock(void);
+static Size FastPathLockShmemSize(void);
 
 
 /*
@@ -114,9 +115,22 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->subxidStates)));
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->statusFlags)));
 
+	/* fast-path lock arrays */
+	size = add_size(size, mul_size(TotalProcs, FastPathLockShmemSize()));
+
 	return size;
 }
 
+/*
+ * Size of the fast-path lock arrays of a single PGPROC.
+ */
+static Size
+FastPathLockShmemSize(void)
+{
+	return add_size(MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64)),
+					MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid)));
+}
+
 /*
  * Report number of semaphores needed by InitProcGlobal.
  */
@@ -163,6 +177,9 @@ InitProcGlobal(void)
 				j;
 	bool		found;
 	uint32		TotalProcs = MaxBackends + NUM_AUXILIARY_PROCS + max_prepared_xacts;
+	char	   *fpPtr;
+	Size		fpLockBitsSize,
+				fpRelIdSize;
 
 	/* Create the ProcGlobal shared structure */
 	ProcGlobal = (PROC_HDR *)
@@ -182,6 +199,7 @@ InitProcGlobal(void)
 	ProcGlobal->checkpointerLatch = NULL;
 	pg_atomic_init_u32(&ProcGlobal->procArrayGroupFirst, INVALID_PGPROCNO);
 	pg_atomic_init_u32(&ProcGlobal->clogGroupFirst, INVALID_PGPROCNO);
+	pg_atomic_init_u32(&ProcGlobal->walFlushGroupFirst, INVALID_PGPROCNO);
 
 	/*
 	 * Create and initialize all the PGPROC structures we'll need.  There are
@@ -212,10 +230,28 @@ InitProcGlobal(void)
 	ProcGlobal->statusFlags = (uint8 *) ShmemAlloc(TotalProcs * sizeof(*ProcGlobal->statusFlags));
 	MemSet(ProcGlobal->statusFlags, 0, TotalProcs * sizeof(*ProcGlobal->statusFlags));
 
+	/*
+	 * Allocate the fast-path lock arrays.  Their size depends on
+	 * max_locks_per_transaction, so they can't be embedded in PGPROC; carve
+	 * them out of one chunk instead, each array MAXALIGN'd.
+	 */
+	fpLockBitsSize = MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64));
+	fpRelIdSize = MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid));
+	Assert(fpLockBitsSize + fpRelIdSize == FastPathLockShmemSize());
+
+	fpPtr = ShmemAlloc(TotalProcs * (fpLockBitsSize + fpRelIdSize));
+	MemSet(fpPtr, 0, TotalProcs * (fpLockBitsSize + fpRelIdSize));
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		/* Point to this PGPROC's share of the fast-path lock arrays. */
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		fpPtr += fpLockBitsSize;
+		procs[i].fpRelId = (Oid *) fpPtr;
+		fpPtr += fpRelIdSize;
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and fpInfoLock.  Prepared xact
 		 * dummy PGPROCs don't need these though - they're never associated
@@ -279,6 +315,7 @@ InitProcGlobal(void)
 		 */
 		pg_atomic_init_u32(&(procs[i].procArrayGroupNext), INVALID_PGPROCNO);
 		pg_atomic_init_u32(&(procs[i].clogGroupNext), INVALID_PGPROCNO);
+		pg_atomic_init_u32(&(procs[i].walFlushGroupNext), INVALID_PGPROCNO);
 		pg_atomic_init_u64(&(procs[i].waitStart), 0);
 	}
 
@@ -438,6 +475,11 @@ InitProcess(void)
 	MyProc->clogGroupMemberLsn = InvalidXLogRecPtr;
 	Assert(pg_atomic_read_u32(&MyProc->clogGroupNext) == INVALID_PGPROCNO);
 
+	/* Initialize fields for group WAL flush. */
+	MyProc->walFlushGroupMember = false;
+	MyProc->walFlushGroupLsn = InvalidXLogRecPtr;
+	Assert(pg_atomic_read_u32(&MyProc->walFlushGroupNext) == INVALID_PGPROCNO);
+
 	/*
 	 * Acquire ownership of the PGPROC's latch, so that we can use WaitLatch
 	 * on it.  That allows us to repoint the process latch, which so far
@@ -609,6 +651,11 @@ InitAuxiliaryProcess(void)
 	Assert(MyProc->lockGroupLeader == NULL);
 	Assert(dlist_is_empty(&MyProc->lockGroupMembers));
 
+	/* Initialize fields for group WAL flush. */
+	MyProc->walFlushGroupMember = false;
+	MyProc->walFlushGroupLsn = InvalidXLogRecPtr;
+	Assert(pg_atomic_read_u32(&MyProc->walFlushGroupNext) == INVALID_PGPROCNO);
+
 	/*
 	 * We might be reusing a semaphore that belonged to a failed process. So
 	 * be careful and reinitialize its value here.  (This is not strictly
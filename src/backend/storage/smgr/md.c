@@ -31,6 +31,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -142,6 +143,32 @@ static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forkno,
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 							  MdfdVec *seg);
 
+/*
+ * Under io_direct=data, the kernel may reject I/O on buffers that aren't
+ * suitably aligned.  Shared and local buffers always are, but some callers
+ * (index builds, for example) pass palloc'd pages to mdextend() and mdwrite().
+ * Those are copied through this bounce buffer.
+ */
+static PGIOAlignedBlock md_bounce_buffer;
+
+static inline int
+_mdfd_open_flags(void)
+{
+	int			flags = O_RDWR | PG_BINARY;
+
+	if (io_direct_flags & IO_DIRECT_DATA)
+		flags |= PG_O_DIRECT;
+
+	return flags;
+}
+
+static inline bool
+_mdfd_needs_bounce(const char *buffer)
+{
+	return (io_direct_flags & IO_DIRECT_DATA) != 0 &&
+		(uintptr_t) buffer != TYPEALIGN(PG_IO_ALIGN_SIZE, buffer);
+}
+
 
 /*
  *	mdinit() -- Initialize private state for magnetic disk storage manager.
@@ -205,14 +232,14 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rlocator, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags() | O_CREAT | O_EXCL);
 
 	if (fd < 0)
 	{
 		int			save_errno = errno;
 
 		if (isRedo)
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+			fd = PathNameOpenFile(path, _mdfd_open_flags());
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -463,6 +490,12 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
+	if (_mdfd_needs_bounce(buffer))
+	{
+		memcpy(md_bounce_buffer.data, buffer, BLCKSZ);
+		buffer = md_bounce_buffer.data;
+	}
+
 	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
@@ -509,7 +542,7 @@ mdopenfork(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	path = relpath(reln->smgr_rlocator, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags());
 
 	if (fd < 0)
 	{
@@ -571,25 +604,46 @@ mdclose(SMgrRelation reln, ForkNumber forknum)
 }
 
 /*
- *	mdprefetch() -- Initiate asynchronous read of the specified block of a relation
+ *	mdprefetch() -- Initiate asynchronous read of the specified blocks of a relation
+ *
+ * The range is split at segment boundaries, but otherwise each segment's
+ * share is hinted with a single request.
  */
 bool
-mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   int nblocks)
 {
 #ifdef USE_PREFETCH
-	off_t		seekpos;
-	MdfdVec    *v;
+	while (nblocks > 0)
+	{
+		off_t		seekpos;
+		MdfdVec    *v;
+		int			nblocks_this_segment;
 
-	v = _mdfd_getseg(reln, forknum, blocknum, false,
-					 InRecovery ? EXTENSION_RETURN_NULL : EXTENSION_FAIL);
-	if (v == NULL)
-		return false;
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 InRecovery ? EXTENSION_RETURN_NULL : EXTENSION_FAIL);
+		if (v == NULL)
+			return false;
 
-	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+		/* Advice would only pull the blocks into the kernel's page cache. */
+		if (io_direct_flags & IO_DIRECT_DATA)
+			return true;
 
-	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	(void) FilePrefetch(v->mdfd_vfd, seekpos, BLCKSZ, WAIT_EVENT_DATA_FILE_PREFETCH);
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		(void) FilePrefetch(v->mdfd_vfd, seekpos,
+							(off_t) BLCKSZ * nblocks_this_segment,
+							WAIT_EVENT_DATA_FILE_PREFETCH);
+
+		blocknum += nblocks_this_segment;
+		nblocks -= nblocks_this_segment;
+	}
 #endif							/* USE_PREFETCH */
 
 	return true;
@@ -605,6 +659,9 @@ void
 mdwriteback(SMgrRelation reln, ForkNumber forknum,
 			BlockNumber blocknum, BlockNumber nblocks)
 {
+	/* bufmgr.c doesn't schedule writeback under direct I/O */
+	Assert((io_direct_flags & IO_DIRECT_DATA) == 0);
+
 	/*
 	 * Issue flush requests in as few requests as possible; have to split at
 	 * segment boundaries though, since those are actually separate files.
@@ -660,6 +717,7 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuf = buffer;
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
 										reln->smgr_rlocator.locator.spcOid,
@@ -674,7 +732,13 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+	if (_mdfd_needs_bounce(buffer))
+		iobuf = md_bounce_buffer.data;
+
+	nbytes = FileRead(v->mdfd_vfd, iobuf, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+
+	if (iobuf != buffer && nbytes == BLCKSZ)
+		memcpy(buffer, iobuf, BLCKSZ);
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rlocator.locator.spcOid,
@@ -711,6 +775,142 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read the specified blocks from a relation.
+ *
+ * The blocks are consecutive, starting at blocknum, and are scattered into
+ * the given buffers.  Runs that cross a segment boundary are split, but
+ * otherwise each segment's share is read with a single vectored read.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, BlockNumber nblocks)
+{
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		size_t		size_this_segment;
+		size_t		transferred_this_segment;
+		BlockNumber nblocks_this_segment;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, lengthof(iov));
+
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+		{
+			/* vectored I/O only ever targets shared or local buffers */
+			Assert(!_mdfd_needs_bounce(buffers[iovcnt]));
+			iov[iovcnt].iov_base = buffers[iovcnt];
+			iov[iovcnt].iov_len = BLCKSZ;
+		}
+		size_this_segment = (size_t) nblocks_this_segment * BLCKSZ;
+		transferred_this_segment = 0;
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+											reln->smgr_rlocator.locator.spcOid,
+											reln->smgr_rlocator.locator.dbOid,
+											reln->smgr_rlocator.locator.relNumber,
+											reln->smgr_rlocator.backend);
+
+		/*
+		 * Loop until all the blocks of this segment have been read, since
+		 * preadv() is allowed to return a short read at any point.
+		 */
+		for (;;)
+		{
+			struct iovec *iovp = iov;
+			int			iovleft = iovcnt;
+			size_t		skip = transferred_this_segment;
+			ssize_t		nbytes;
+
+			/* Skip over the iovecs that have been fully transferred */
+			while (skip >= iovp->iov_len)
+			{
+				skip -= iovp->iov_len;
+				iovp++;
+				iovleft--;
+			}
+			iovp->iov_base = (char *) iovp->iov_base + skip;
+			iovp->iov_len -= skip;
+
+			nbytes = FileReadV(v->mdfd_vfd, iovp, iovleft,
+							   seekpos + (off_t) transferred_this_segment,
+							   WAIT_EVENT_DATA_FILE_READ);
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+								blocknum,
+								blocknum + nblocks_this_segment - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			if (nbytes == 0)
+			{
+				/*
+				 * We are at or past EOF, or we read a partial block at EOF.
+				 * Normally this is an error; upper levels should never try to
+				 * read a nonexistent block.  However, if zero_damaged_pages
+				 * is ON or we are InRecovery, we should instead return zeroes
+				 * without complaining, just like mdread().
+				 */
+				if (zero_damaged_pages || InRecovery)
+				{
+					for (int i = transferred_this_segment / BLCKSZ;
+						 i < nblocks_this_segment;
+						 i++)
+						MemSet(buffers[i], 0, BLCKSZ);
+					break;
+				}
+				else
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("could not read blocks %u..%u in file \"%s\": read only %zu of %zu bytes",
+									blocknum,
+									blocknum + nblocks_this_segment - 1,
+									FilePathName(v->mdfd_vfd),
+									transferred_this_segment,
+									size_this_segment)));
+			}
+
+			transferred_this_segment += nbytes;
+			if (transferred_this_segment >= size_this_segment)
+				break;
+
+			/* Restore the iovec we adjusted, then go around for the rest */
+			for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+			{
+				iov[iovcnt].iov_base = buffers[iovcnt];
+				iov[iovcnt].iov_len = BLCKSZ;
+			}
+		}
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
+										   reln->smgr_rlocator.locator.spcOid,
+										   reln->smgr_rlocator.locator.dbOid,
+										   reln->smgr_rlocator.locator.relNumber,
+										   reln->smgr_rlocator.backend,
+										   (int) transferred_this_segment,
+										   (int) size_this_segment);
+
+		nblocks -= nblocks_this_segment;
+		buffers += nblocks_this_segment;
+		blocknum += nblocks_this_segment;
+	}
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -744,6 +944,12 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
+	if (_mdfd_needs_bounce(buffer))
+	{
+		memcpy(md_bounce_buffer.data, buffer, BLCKSZ);
+		buffer = md_bounce_buffer.data;
+	}
+
 	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
@@ -775,6 +981,134 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdwritev() -- Write the supplied blocks at the appropriate location.
+ *
+ * The blocks are consecutive, starting at blocknum, and are gathered from the
+ * given buffers.  As with mdwrite(), they must all exist already.  Runs that
+ * cross a segment boundary are split, but otherwise each segment's share is
+ * written with a single vectored write.
+ */
+void
+mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		 char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum + nblocks <= mdnblocks(reln, forknum));
+#endif
+
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		size_t		size_this_segment;
+		size_t		transferred_this_segment;
+		BlockNumber nblocks_this_segment;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, lengthof(iov));
+
+		size_this_segment = (size_t) nblocks_this_segment * BLCKSZ;
+		transferred_this_segment = 0;
+
+		TRACE_POSTGRESQL_SMGR_MD_WRITE_START(forknum, blocknum,
+											 reln->smgr_rlocator.locator.spcOid,
+											 reln->smgr_rlocator.locator.dbOid,
+											 reln->smgr_rlocator.locator.relNumber,
+											 reln->smgr_rlocator.backend);
+
+#ifdef USE_ASSERT_CHECKING
+		/* vectored I/O only ever targets shared or local buffers */
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+			Assert(!_mdfd_needs_bounce(buffers[iovcnt]));
+#endif
+
+		/*
+		 * Loop until all the blocks of this segment have been written, since
+		 * pwritev() is allowed to return a short write at any point.
+		 */
+		do
+		{
+			struct iovec *iovp = iov;
+			int			iovleft;
+			size_t		skip = transferred_this_segment;
+			ssize_t		nbytes;
+
+			for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+			{
+				iov[iovcnt].iov_base = buffers[iovcnt];
+				iov[iovcnt].iov_len = BLCKSZ;
+			}
+			iovleft = iovcnt;
+
+			/* Skip over what has been written already */
+			while (skip >= iovp->iov_len)
+			{
+				skip -= iovp->iov_len;
+				iovp++;
+				iovleft--;
+			}
+			iovp->iov_base = (char *) iovp->iov_base + skip;
+			iovp->iov_len -= skip;
+
+			nbytes = FileWriteV(v->mdfd_vfd, iovp, iovleft,
+								seekpos + (off_t) transferred_this_segment,
+								WAIT_EVENT_DATA_FILE_WRITE);
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write blocks %u..%u in file \"%s\": %m",
+								blocknum,
+								blocknum + nblocks_this_segment - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			if (nbytes == 0)
+			{
+				/* no progress: complain appropriately, like mdwrite() */
+				ereport(ERROR,
+						(errcode(ERRCODE_DISK_FULL),
+						 errmsg("could not write blocks %u..%u in file \"%s\": wrote only %zu of %zu bytes",
+								blocknum,
+								blocknum + nblocks_this_segment - 1,
+								FilePathName(v->mdfd_vfd),
+								transferred_this_segment,
+								size_this_segment),
+						 errhint("Check free disk space.")));
+			}
+
+			transferred_this_segment += nbytes;
+		} while (transferred_this_segment < size_this_segment);
+
+		TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
+											reln->smgr_rlocator.locator.spcOid,
+											reln->smgr_rlocator.locator.dbOid,
+											reln->smgr_rlocator.locator.relNumber,
+											reln->smgr_rlocator.backend,
+											(int) transferred_this_segment,
+											(int) size_this_segment);
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		nblocks -= nblocks_this_segment;
+		buffers += nblocks_this_segment;
+		blocknum += nblocks_this_segment;
+	}
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -1007,14 +1341,29 @@ register_dirty_segment(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 
 	if (!RegisterSyncRequest(&tag, SYNC_REQUEST, false /* retryOnError */ ))
 	{
+		instr_time	io_start;
+
 		ereport(DEBUG1,
 				(errmsg_internal("could not forward fsync request because request queue is full")));
 
+		io_start = pgstat_prepare_io_time();
+
 		if (FileSync(seg->mdfd_vfd, WAIT_EVENT_DATA_FILE_SYNC) < 0)
 			ereport(data_sync_elevel(ERROR),
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
 							FilePathName(seg->mdfd_vfd))));
+
+		/*
+		 * We have no way of knowing if the current IOContext is
+		 * IOCONTEXT_NORMAL or IOCONTEXT_[BULKREAD, BULKWRITE, VACUUM] at this
+		 * point, so count the fsync as being in the IOCONTEXT_NORMAL
+		 * IOContext.  This is probably okay, because the number of backend
+		 * fsyncs doesn't say anything about the efficacy of the
+		 * BufferAccessStrategy.
+		 */
+		pgstat_count_io_op_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+								IOOP_FSYNC, io_start, 1);
 	}
 }
 
@@ -1174,7 +1523,7 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags);
+	fd = PathNameOpenFile(fullpath, _mdfd_open_flags() | oflags);
 
 	pfree(fullpath);
 
@@ -1365,6 +1714,7 @@ mdsyncfiletag(const FileTag *ftag, char *path)
 	SMgrRelation reln = smgropen(ftag->rlocator, InvalidBackendId);
 	File		file;
 	bool		need_to_close;
+	instr_time	io_start;
 	int			result,
 				save_errno;
 
@@ -1389,6 +1739,8 @@ mdsyncfiletag(const FileTag *ftag, char *path)
 		need_to_close = true;
 	}
 
+	io_start = pgstat_prepare_io_time();
+
 	/* Sync the file. */
 	result = FileSync(file, WAIT_EVENT_DATA_FILE_SYNC);
 	save_errno = errno;
@@ -1396,6 +1748,10 @@ mdsyncfiletag(const FileTag *ftag, char *path)
 	if (need_to_close)
 		FileClose(file);
 
+	if (result >= 0)
+		pgstat_count_io_op_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+								IOOP_FSYNC, io_start, 1);
+
 	errno = save_errno;
 	return result;
 }
@@ -39,6 +39,7 @@
 #include "executor/tstoreReceiver.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
+#include "postmaster/proxy.h"
 #include "utils/portal.h"
 
 
@@ -277,9 +278,15 @@ ReadyForQuery(CommandDest dest)
 		case DestRemoteSimple:
 			{
 				StringInfoData buf;
+				char		status = TransactionBlockStatusCode();
+
+				/* Tell the connection proxy if the session can't be shared */
+				if (ProxyPooledBackend && status == 'I' &&
+					ProxySessionIsPinned())
+					status = PROXY_PINNED_STATUS;
 
 				pq_beginmessage(&buf, 'Z');
-				pq_sendbyte(&buf, TransactionBlockStatusCode());
+				pq_sendbyte(&buf, status);
 				pq_endmessage(&buf);
 			}
 			/* Flush output at end of cycle in any case. */
@@ -105,6 +105,8 @@ pgstat_flush_wal(bool nowait)
 	WALSTAT_ACC(wal_sync);
 	WALSTAT_ACC(wal_write_time);
 	WALSTAT_ACC(wal_sync_time);
+	WALSTAT_ACC(wal_group_flush);
+	WALSTAT_ACC(wal_group_members);
 #undef WALSTAT_ACC
 
 	LWLockRelease(&stats_shmem->lock);
@@ -136,16 +138,17 @@ pgstat_init_wal(void)
 /*
  * To determine whether any WAL activity has occurred since last time, not
  * only the number of generated WAL records but also the numbers of WAL
- * writes and syncs need to be checked. Because even transaction that
- * generates no WAL records can write or sync WAL data when flushing the
- * data pages.
+ * writes, syncs and group flushes need to be checked. Because even
+ * transaction that generates no WAL records can write or sync WAL data when
+ * flushing the data pages, or flush WAL on behalf of other backends.
  */
 bool
 pgstat_have_pending_wal(void)
 {
 	return pgWalUsage.wal_records != prevWalUsage.wal_records ||
 		PendingWalStats.wal_write != 0 ||
-		PendingWalStats.wal_sync != 0;
+		PendingWalStats.wal_sync != 0 ||
+		PendingWalStats.wal_group_flush != 0;
 }
 
 void
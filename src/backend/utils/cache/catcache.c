@@ -38,6 +38,8 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
 
@@ -64,6 +66,9 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC variable: memory limit for all catcache entries in kB, 0 if none */
+int			catalog_cache_memory_limit = 0;
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
@@ -89,6 +94,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static void CatCacheEnforceMemoryLimit(CatCTup *keep);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 										Datum *arguments,
@@ -99,6 +105,9 @@ static void CatCacheFreeKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 							 Datum *keys);
 static void CatCacheCopyKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 							 Datum *srckeys, Datum *dstkeys);
+static HeapTuple SearchSharedCatCache(CatCache *cache, int nkeys,
+									  Oid dbId, uint32 hashValue,
+									  Datum *arguments);
 
 
 /*
@@ -393,6 +402,7 @@ CatCachePrintStats(int code, Datum arg)
 	long		cc_neg_hits = 0;
 	long		cc_newloads = 0;
 	long		cc_invals = 0;
+	long		cc_evictions = 0;
 	long		cc_lsearches = 0;
 	long		cc_lhits = 0;
 
@@ -402,7 +412,7 @@ CatCachePrintStats(int code, Datum arg)
 
 		if (cache->cc_ntup == 0 && cache->cc_searches == 0)
 			continue;			/* don't print unused caches */
-		elog(DEBUG2, "catcache %s/%u: %d tup, %ld srch, %ld+%ld=%ld hits, %ld+%ld=%ld loads, %ld invals, %ld lsrch, %ld lhits",
+		elog(DEBUG2, "catcache %s/%u: %d tup, %ld srch, %ld+%ld=%ld hits, %ld+%ld=%ld loads, %ld invals, %ld evicts, %ld lsrch, %ld lhits",
 			 cache->cc_relname,
 			 cache->cc_indexoid,
 			 cache->cc_ntup,
@@ -414,6 +424,7 @@ CatCachePrintStats(int code, Datum arg)
 			 cache->cc_searches - cache->cc_hits - cache->cc_neg_hits - cache->cc_newloads,
 			 cache->cc_searches - cache->cc_hits - cache->cc_neg_hits,
 			 cache->cc_invals,
+			 cache->cc_evictions,
 			 cache->cc_lsearches,
 			 cache->cc_lhits);
 		cc_searches += cache->cc_searches;
@@ -421,10 +432,11 @@ CatCachePrintStats(int code, Datum arg)
 		cc_neg_hits += cache->cc_neg_hits;
 		cc_newloads += cache->cc_newloads;
 		cc_invals += cache->cc_invals;
+		cc_evictions += cache->cc_evictions;
 		cc_lsearches += cache->cc_lsearches;
 		cc_lhits += cache->cc_lhits;
 	}
-	elog(DEBUG2, "catcache totals: %d tup, %ld srch, %ld+%ld=%ld hits, %ld+%ld=%ld loads, %ld invals, %ld lsrch, %ld lhits",
+	elog(DEBUG2, "catcache totals: %d tup, %ld srch, %ld+%ld=%ld hits, %ld+%ld=%ld loads, %ld invals, %ld evicts, %ld lsrch, %ld lhits",
 		 CacheHdr->ch_ntup,
 		 cc_searches,
 		 cc_hits,
@@ -434,6 +446,7 @@ CatCachePrintStats(int code, Datum arg)
 		 cc_searches - cc_hits - cc_neg_hits - cc_newloads,
 		 cc_searches - cc_hits - cc_neg_hits,
 		 cc_invals,
+		 cc_evictions,
 		 cc_lsearches,
 		 cc_lhits);
 }
@@ -477,12 +490,79 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		CatCacheFreeKeys(cache->cc_tupdesc, cache->cc_nkeys,
 						 cache->cc_keyno, ct->keys);
 
+	dlist_delete(&ct->lru_elem);
+	CacheHdr->ch_memsize -= GetMemoryChunkSpace(ct);
+
 	pfree(ct);
 
 	--cache->cc_ntup;
 	--CacheHdr->ch_ntup;
 }
 
+/*
+ *		CatCacheEnforceMemoryLimit
+ *
+ * Evict the least recently used entries until the memory used by all
+ * catcache entries is within catalog_cache_memory_limit.  Referenced
+ * entries, and "keep" which the caller is about to use, are not evicted.
+ * An entry that belongs to a CatCList is evicted together with the list,
+ * if the list isn't referenced.
+ */
+static void
+CatCacheEnforceMemoryLimit(CatCTup *keep)
+{
+	Size		limit;
+	dlist_node *cur;
+
+	if (catalog_cache_memory_limit == 0)
+		return;
+
+	limit = (Size) catalog_cache_memory_limit * 1024;
+
+restart:
+	if (CacheHdr->ch_memsize <= limit || dlist_is_empty(&CacheHdr->ch_lru))
+		return;
+
+	cur = dlist_tail_node(&CacheHdr->ch_lru);
+	for (;;)
+	{
+		CatCTup    *ct = dlist_container(CatCTup, lru_elem, cur);
+		dlist_node *prev;
+
+		/* Everything in front of "keep" was used more recently */
+		if (ct == keep)
+			break;
+
+		prev = dlist_has_prev(&CacheHdr->ch_lru, cur) ?
+			dlist_prev_node(&CacheHdr->ch_lru, cur) : NULL;
+
+		if (ct->refcount == 0)
+		{
+			if (ct->c_list == NULL)
+			{
+#ifdef CATCACHE_STATS
+				ct->my_cache->cc_evictions++;
+#endif
+				CatCacheRemoveCTup(ct->my_cache, ct);
+			}
+			else if (ct->c_list->refcount == 0)
+			{
+				/*
+				 * Removing the list may remove other entries, including the
+				 * one we'd look at next, so start over.  The entry itself is
+				 * no list member anymore then.
+				 */
+				CatCacheRemoveCList(ct->my_cache, ct->c_list);
+				goto restart;
+			}
+		}
+
+		if (CacheHdr->ch_memsize <= limit || prev == NULL)
+			break;
+		cur = prev;
+	}
+}
+
 /*
  *		CatCacheRemoveCList
  *
@@ -521,6 +601,7 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	CatCacheFreeKeys(cache->cc_tupdesc, cl->nkeys,
 					 cache->cc_keyno, cl->keys);
 
+	CacheHdr->ch_memsize -= GetMemoryChunkSpace(cl);
 	pfree(cl);
 }
 
@@ -797,6 +878,16 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		dlist_init(&CacheHdr->ch_lru);
+		CacheHdr->ch_memsize = 0;
+
+		/*
+		 * Keep the cache entries in a context of their own, which makes their
+		 * memory usage visible in pg_backend_memory_contexts.
+		 */
+		CacheHdr->ch_context = AllocSetContextCreate(CacheMemoryContext,
+													 "CatCacheMemoryContext",
+													 ALLOCSET_DEFAULT_SIZES);
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1260,6 +1351,7 @@ SearchCatCacheInternal(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		dlist_move_head(&CacheHdr->ch_lru, &ct->lru_elem);
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1319,6 +1411,9 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	bool		use_shared;
+	Oid			dbId = InvalidOid;
+	uint64		invalCount = 0;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1326,6 +1421,43 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * If another backend has loaded the tuple into the shared catalog cache,
+	 * make our entry from that copy rather than reading the catalog.
+	 */
+	use_shared = SharedCatCacheUsable(cache->cc_relisshared);
+	if (use_shared)
+	{
+		dbId = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+
+		ntp = SearchSharedCatCache(cache, nkeys, dbId, hashValue, arguments);
+		if (ntp != NULL)
+		{
+			ct = CatalogCacheCreateEntry(cache, ntp, arguments,
+										 hashValue, hashIndex,
+										 false);
+			heap_freetuple(ntp);
+
+			ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+			ct->refcount++;
+			ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+			/* not CACHE_elog, so that shared cache hits can be observed */
+			elog(DEBUG2, "SearchCatCache(%s): put shared tuple in bucket %d",
+				 cache->cc_relname, hashIndex);
+
+			return &ct->tuple;
+		}
+
+		/*
+		 * The tuple we read may only go to the shared cache if no
+		 * invalidation happened since before our catalog snapshot was
+		 * taken; so make sure it's taken after reading the counter.
+		 */
+		invalCount = SharedCatCacheGetInvalCount();
+		InvalidateCatalogSnapshot();
+	}
+
 	/*
 	 * Ok, need to make a lookup in the relation, copy the scankey and fill
 	 * out any per-call fields.
@@ -1378,6 +1510,11 @@ SearchCatCacheMiss(CatCache *cache,
 
 	table_close(relation, AccessShareLock);
 
+	/* Share the tuple with other backends, now that it's flattened */
+	if (ct != NULL && use_shared)
+		SharedCatCacheInsert(cache->id, dbId, hashValue, &ct->tuple,
+							 invalCount);
+
 	/*
 	 * If tuple was not found, we need to build a negative cache entry
 	 * containing a fake tuple.  The fake tuple has the correct key columns,
@@ -1422,6 +1559,43 @@ SearchCatCacheMiss(CatCache *cache,
 	return &ct->tuple;
 }
 
+/*
+ * SearchSharedCatCache
+ *
+ * Look for a tuple in the shared catalog cache.  Returns a palloc'd copy of
+ * the tuple if found.
+ */
+static HeapTuple
+SearchSharedCatCache(CatCache *cache, int nkeys, Oid dbId, uint32 hashValue,
+					 Datum *arguments)
+{
+	HeapTuple	ntp;
+	Datum		keys[CATCACHE_MAXKEYS];
+	int			i;
+
+	ntp = SharedCatCacheLookup(cache->id, dbId, hashValue);
+	if (ntp == NULL)
+		return NULL;
+
+	/* Entries are found by hash value, so check for a collision */
+	for (i = 0; i < nkeys; i++)
+	{
+		bool		isnull;
+
+		keys[i] = heap_getattr(ntp, cache->cc_keyno[i], cache->cc_tupdesc,
+							   &isnull);
+		Assert(!isnull);
+	}
+
+	if (!CatalogCacheCompareTuple(cache, nkeys, keys, arguments))
+	{
+		heap_freetuple(ntp);
+		return NULL;
+	}
+
+	return ntp;
+}
+
 /*
  *	ReleaseCatCache
  *
@@ -1694,7 +1868,7 @@ SearchCatCacheList(CatCache *cache,
 		table_close(relation, AccessShareLock);
 
 		/* Now we can build the CatCList entry. */
-		oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+		oldcxt = MemoryContextSwitchTo(CacheHdr->ch_context);
 		nmembers = list_length(ctlist);
 		cl = (CatCList *)
 			palloc(offsetof(CatCList, members) + nmembers * sizeof(CatCTup *));
@@ -1758,6 +1932,7 @@ SearchCatCacheList(CatCache *cache,
 	Assert(i == nmembers);
 
 	dlist_push_head(&cache->cc_lists, &cl->cache_elem);
+	CacheHdr->ch_memsize += GetMemoryChunkSpace(cl);
 
 	/* Finally, bump the list's refcount and return it */
 	cl->refcount++;
@@ -1826,7 +2001,7 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 			dtp = ntp;
 
 		/* Allocate memory for CatCTup and the cached tuple in one go */
-		oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+		oldcxt = MemoryContextSwitchTo(CacheHdr->ch_context);
 
 		ct = (CatCTup *) palloc(sizeof(CatCTup) +
 								MAXIMUM_ALIGNOF + dtp->t_len);
@@ -1861,7 +2036,7 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	else
 	{
 		Assert(negative);
-		oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+		oldcxt = MemoryContextSwitchTo(CacheHdr->ch_context);
 		ct = (CatCTup *) palloc(sizeof(CatCTup));
 
 		/*
@@ -1886,9 +2061,11 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	dlist_push_head(&CacheHdr->ch_lru, &ct->lru_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	CacheHdr->ch_memsize += GetMemoryChunkSpace(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -1897,6 +2074,9 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	if (cache->cc_ntup > cache->cc_nbuckets * 2)
 		RehashCatCache(cache);
 
+	/* Make room for the new entry, if we're over the memory limit */
+	CatCacheEnforceMemoryLimit(ct);
+
 	return ct;
 }
 
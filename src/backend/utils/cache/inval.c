@@ -1192,6 +1192,18 @@ CommandEndInvalidationMessages(void)
 }
 
 
+/*
+ * HavePendingInvalidations
+ *		Has the current transaction registered any invalidations, ie,
+ *		modified any catalogs?
+ */
+bool
+HavePendingInvalidations(void)
+{
+	return transInvalInfo != NULL;
+}
+
+
 /*
  * CacheInvalidateHeapTuple
  *		Register the given tuple for invalidation at end of command
@@ -71,6 +71,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -87,16 +88,23 @@
  * This is the head of the backend's list of "saved" CachedPlanSources (i.e.,
  * those that are in long-lived storage and are examined for sinval events).
  * We use a dlist instead of separate List cells so that we can guarantee
- * to save a CachedPlanSource without error.
+ * to save a CachedPlanSource without error.  The list is kept in order of
+ * use, most recently used first, so that the generic plans of the least
+ * recently used entries can be discarded when catalog_cache_memory_limit is
+ * exceeded.
  */
 static dlist_head saved_plan_list = DLIST_STATIC_INIT(saved_plan_list);
 
+/* Memory used by the generic plans of saved CachedPlanSources */
+static Size saved_generic_plan_memsize = 0;
+
 /*
  * This is the head of the backend's list of CachedExpressions.
  */
 static dlist_head cached_expression_list = DLIST_STATIC_INIT(cached_expression_list);
 
 static void ReleaseGenericPlan(CachedPlanSource *plansource);
+static void EnforceGenericPlanMemoryLimit(CachedPlanSource *keep);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
 static bool CheckCachedPlan(CachedPlanSource *plansource);
@@ -481,7 +489,7 @@ SaveCachedPlan(CachedPlanSource *plansource)
 	/*
 	 * Add the entry to the global list of cached plans.
 	 */
-	dlist_push_tail(&saved_plan_list, &plansource->node);
+	dlist_push_head(&saved_plan_list, &plansource->node);
 
 	plansource->is_saved = true;
 }
@@ -533,10 +541,55 @@ ReleaseGenericPlan(CachedPlanSource *plansource)
 
 		Assert(plan->magic == CACHEDPLAN_MAGIC);
 		plansource->gplan = NULL;
+		if (plan->is_saved)
+			saved_generic_plan_memsize -=
+				MemoryContextMemAllocated(plan->context, true);
 		ReleaseCachedPlan(plan, NULL);
 	}
 }
 
+/*
+ * EnforceGenericPlanMemoryLimit: discard the generic plans of the least
+ * recently used saved CachedPlanSources, until the memory used by generic
+ * plans is within catalog_cache_memory_limit.
+ *
+ * Plans that are in use, and the plan of "keep", are not discarded.  The
+ * CachedPlanSources themselves stay; their generic plans will be rebuilt
+ * when they are needed again.
+ */
+static void
+EnforceGenericPlanMemoryLimit(CachedPlanSource *keep)
+{
+	Size		limit;
+	dlist_node *cur;
+
+	if (catalog_cache_memory_limit == 0)
+		return;
+
+	limit = (Size) catalog_cache_memory_limit * 1024;
+	if (saved_generic_plan_memsize <= limit)
+		return;
+
+	cur = dlist_tail_node(&saved_plan_list);
+	for (;;)
+	{
+		CachedPlanSource *plansource;
+
+		plansource = dlist_container(CachedPlanSource, node, cur);
+		Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
+
+		/* Only the plansource's own reference may remain */
+		if (plansource != keep && plansource->gplan &&
+			plansource->gplan->refcount == 1)
+			ReleaseGenericPlan(plansource);
+
+		if (saved_generic_plan_memsize <= limit ||
+			!dlist_has_prev(&saved_plan_list, cur))
+			break;
+		cur = dlist_prev_node(&saved_plan_list, cur);
+	}
+}
+
 /*
  * RevalidateCachedQuery: ensure validity of analyzed-and-rewritten query tree.
  *
@@ -880,13 +933,29 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 				ParamListInfo boundParams, QueryEnvironment *queryEnv)
 {
 	CachedPlan *plan;
-	List	   *plist;
+	List	   *plist = NIL;
 	bool		snapshot_set;
 	bool		is_transient;
+	bool		use_shared;
+	uint64		shared_inval_count = 0;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	ListCell   *lc;
 
+	/*
+	 * A generic plan may be found in, and is added to, the shared plan cache.
+	 * Before we look there or build the plan, we must have processed the
+	 * invalidation messages sent before we read the counter that protects
+	 * the shared cache from outdated plans.
+	 */
+	use_shared = (boundParams == NULL &&
+				  SharedPlanCacheUsable(plansource, queryEnv));
+	if (use_shared)
+	{
+		shared_inval_count = SharedPlanCacheGetInvalCount();
+		AcceptInvalidationMessages();
+	}
+
 	/*
 	 * Normally the querytree should be valid already, but if it's not,
 	 * rebuild it.
@@ -901,43 +970,58 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	 * let's treat it as real and redo the RevalidateCachedQuery call.
 	 */
 	if (!plansource->is_valid)
-		qlist = RevalidateCachedQuery(plansource, queryEnv);
-
-	/*
-	 * If we don't already have a copy of the querytree list that can be
-	 * scribbled on by the planner, make one.  For a one-shot plan, we assume
-	 * it's okay to scribble on the original query_list.
-	 */
-	if (qlist == NIL)
 	{
-		if (!plansource->is_oneshot)
-			qlist = copyObject(plansource->query_list);
-		else
-			qlist = plansource->query_list;
+		qlist = RevalidateCachedQuery(plansource, queryEnv);
+		/* the new querytree may not be shareable, e.g. due to RLS */
+		use_shared = use_shared && SharedPlanCacheUsable(plansource, queryEnv);
 	}
 
-	/*
-	 * If a snapshot is already set (the normal case), we can just use that
-	 * for planning.  But if it isn't, and we need one, install one.
-	 */
-	snapshot_set = false;
-	if (!ActiveSnapshotSet() &&
-		plansource->raw_parse_tree &&
-		analyze_requires_snapshot(plansource->raw_parse_tree))
+	/* Try to use a generic plan that another backend built */
+	if (use_shared)
+		plist = SharedPlanCacheLookup(plansource);
+
+	if (plist == NIL)
 	{
-		PushActiveSnapshot(GetTransactionSnapshot());
-		snapshot_set = true;
-	}
+		/*
+		 * If we don't already have a copy of the querytree list that can be
+		 * scribbled on by the planner, make one.  For a one-shot plan, we
+		 * assume it's okay to scribble on the original query_list.
+		 */
+		if (qlist == NIL)
+		{
+			if (!plansource->is_oneshot)
+				qlist = copyObject(plansource->query_list);
+			else
+				qlist = plansource->query_list;
+		}
 
-	/*
-	 * Generate the plan.
-	 */
-	plist = pg_plan_queries(qlist, plansource->query_string,
-							plansource->cursor_options, boundParams);
+		/*
+		 * If a snapshot is already set (the normal case), we can just use
+		 * that for planning.  But if it isn't, and we need one, install one.
+		 */
+		snapshot_set = false;
+		if (!ActiveSnapshotSet() &&
+			plansource->raw_parse_tree &&
+			analyze_requires_snapshot(plansource->raw_parse_tree))
+		{
+			PushActiveSnapshot(GetTransactionSnapshot());
+			snapshot_set = true;
+		}
 
-	/* Release snapshot if we got one */
-	if (snapshot_set)
-		PopActiveSnapshot();
+		/*
+		 * Generate the plan.
+		 */
+		plist = pg_plan_queries(qlist, plansource->query_string,
+								plansource->cursor_options, boundParams);
+
+		/* Release snapshot if we got one */
+		if (snapshot_set)
+			PopActiveSnapshot();
+
+		/* Offer the new generic plan to other backends */
+		if (use_shared)
+			SharedPlanCacheInsert(plansource, plist, shared_inval_count);
+	}
 
 	/*
 	 * Normally we make a dedicated memory context for the CachedPlan and its
@@ -1155,6 +1239,10 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	/* Make sure the querytree list is valid and we have parse-time locks */
 	qlist = RevalidateCachedQuery(plansource, queryEnv);
 
+	/* Remember that the entry was used recently */
+	if (plansource->is_saved)
+		dlist_move_head(&saved_plan_list, &plansource->node);
+
 	/* Decide whether to use a custom plan */
 	customplan = choose_custom_plan(plansource, boundParams);
 
@@ -1181,6 +1269,9 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 				/* saved plans all live under CacheMemoryContext */
 				MemoryContextSetParent(plan->context, CacheMemoryContext);
 				plan->is_saved = true;
+				saved_generic_plan_memsize +=
+					MemoryContextMemAllocated(plan->context, true);
+				EnforceGenericPlanMemoryLimit(plansource);
 			}
 			else
 			{
@@ -129,10 +129,19 @@ typedef struct relidcacheent
 {
 	Oid			reloid;
 	Relation	reldesc;
+	dlist_node	lru_node;		/* list member of RelationLRUList */
+	Size		memsize;		/* estimated memory used by reldesc */
 } RelIdCacheEnt;
 
 static HTAB *RelationIdCache;
 
+/*
+ * All entries of RelationIdCache, most recently used first, and the estimated
+ * memory used by them.  Used to enforce catalog_cache_memory_limit.
+ */
+static dlist_head RelationLRUList = DLIST_STATIC_INIT(RelationLRUList);
+static Size RelationCacheMemSize = 0;
+
 /*
  * This flag is false until we have prepared the critical relcache entries
  * that are needed to do indexscans on the tables read by relcache building.
@@ -223,9 +232,15 @@ do { \
 		else if (!IsBootstrapProcessingMode()) \
 			elog(WARNING, "leaking still-referenced relcache entry for \"%s\"", \
 				 RelationGetRelationName(_old_rel)); \
+		dlist_move_head(&RelationLRUList, &hentry->lru_node); \
 	} \
 	else \
+	{ \
 		hentry->reldesc = (RELATION); \
+		hentry->memsize = 0; \
+		dlist_push_head(&RelationLRUList, &hentry->lru_node); \
+	} \
+	RelationCacheUpdateMemSize(hentry); \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
@@ -249,6 +264,11 @@ do { \
 	if (hentry == NULL) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+	{ \
+		dlist_delete(&hentry->lru_node); \
+		RelationCacheMemSize -= hentry->memsize; \
+	} \
 } while(0)
 
 
@@ -273,6 +293,8 @@ static HTAB *OpClassCache = NULL;
 
 /* non-export function prototypes */
 
+static void RelationCacheUpdateMemSize(RelIdCacheEnt *hentry);
+static void RelationCacheEnforceMemoryLimit(void);
 static void RelationDestroyRelation(Relation relation, bool remember_tupdesc);
 static void RelationClearRelation(Relation relation, bool rebuild);
 
@@ -2053,6 +2075,7 @@ formrdesc(const char *relationName, Oid relationReltype,
 Relation
 RelationIdGetRelation(Oid relationId)
 {
+	RelIdCacheEnt *hentry;
 	Relation	rd;
 
 	/* Make sure we're in an xact, even if this ends up being a cache hit */
@@ -2061,10 +2084,17 @@ RelationIdGetRelation(Oid relationId)
 	/*
 	 * first try to find reldesc in the cache
 	 */
-	RelationIdCacheLookup(relationId, rd);
+	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
+										   (void *) &relationId,
+										   HASH_FIND, NULL);
 
-	if (RelationIsValid(rd))
+	if (hentry != NULL)
 	{
+		rd = hentry->reldesc;
+
+		/* remember that the entry was used recently */
+		dlist_move_head(&RelationLRUList, &hentry->lru_node);
+
 		/* return NULL for dropped relations */
 		if (rd->rd_droppedSubid != InvalidSubTransactionId)
 		{
@@ -2626,6 +2656,7 @@ RelationClearRelation(Relation relation, bool rebuild)
 		bool		keep_rules;
 		bool		keep_policies;
 		bool		keep_partkey;
+		RelIdCacheEnt *hentry;
 
 		/* Build temporary entry, but don't link it into hashtable */
 		newrel = RelationBuildDesc(save_relid, false);
@@ -2779,6 +2810,102 @@ RelationClearRelation(Relation relation, bool rebuild)
 
 		/* And now we can throw away the temporary entry */
 		RelationDestroyRelation(newrel, !keep_tupdesc);
+
+		/* The rebuilt entry may be larger or smaller than before */
+		hentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
+											   (void *) &save_relid,
+											   HASH_FIND, NULL);
+		if (hentry != NULL)
+			RelationCacheUpdateMemSize(hentry);
+	}
+}
+
+/*
+ * RelationEstimateMemSize
+ *
+ *	 Estimate the memory used by a relcache entry, including the subsidiary
+ *	 data held in its private memory contexts.
+ */
+static Size
+RelationEstimateMemSize(Relation relation)
+{
+	Size		size;
+
+	size = GetMemoryChunkSpace(relation);
+	if (relation->rd_rel)
+		size += GetMemoryChunkSpace(relation->rd_rel);
+	if (relation->rd_att)
+		size += GetMemoryChunkSpace(relation->rd_att);
+	if (relation->rd_indexcxt)
+		size += MemoryContextMemAllocated(relation->rd_indexcxt, true);
+	if (relation->rd_rulescxt)
+		size += MemoryContextMemAllocated(relation->rd_rulescxt, true);
+	if (relation->rd_pdcxt)
+		size += MemoryContextMemAllocated(relation->rd_pdcxt, true);
+	if (relation->rd_pddcxt)
+		size += MemoryContextMemAllocated(relation->rd_pddcxt, true);
+	if (relation->rd_partkeycxt)
+		size += MemoryContextMemAllocated(relation->rd_partkeycxt, true);
+	if (relation->rd_partcheckcxt)
+		size += MemoryContextMemAllocated(relation->rd_partcheckcxt, true);
+
+	return size;
+}
+
+/*
+ * RelationCacheUpdateMemSize
+ *
+ *	 Recompute the memory accounted for a relcache hashtable entry.
+ */
+static void
+RelationCacheUpdateMemSize(RelIdCacheEnt *hentry)
+{
+	RelationCacheMemSize -= hentry->memsize;
+	hentry->memsize = RelationEstimateMemSize(hentry->reldesc);
+	RelationCacheMemSize += hentry->memsize;
+}
+
+/*
+ * RelationCacheEnforceMemoryLimit
+ *
+ *	 Remove the least recently used relcache entries until the estimated
+ *	 memory used by the relcache is within catalog_cache_memory_limit.
+ *
+ *	 Only entries that nobody references, and that carry no transaction
+ *	 state, can be removed.  This is called at the end of a transaction, so
+ *	 that no caller can hold an unreferenced pointer to an entry.
+ */
+static void
+RelationCacheEnforceMemoryLimit(void)
+{
+	Size		limit;
+	dlist_node *cur;
+
+	if (catalog_cache_memory_limit == 0 || IsBootstrapProcessingMode())
+		return;
+
+	limit = (Size) catalog_cache_memory_limit * 1024;
+	if (RelationCacheMemSize <= limit || dlist_is_empty(&RelationLRUList))
+		return;
+
+	cur = dlist_tail_node(&RelationLRUList);
+	while (cur != NULL && RelationCacheMemSize > limit)
+	{
+		RelIdCacheEnt *hentry = dlist_container(RelIdCacheEnt, lru_node, cur);
+		Relation	relation = hentry->reldesc;
+
+		/* fetch the next entry now, since this one may be removed */
+		cur = dlist_has_prev(&RelationLRUList, cur) ?
+			dlist_prev_node(&RelationLRUList, cur) : NULL;
+
+		if (!RelationHasReferenceCountZero(relation) ||
+			relation->rd_isnailed ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_firstRelfilelocatorSubid != InvalidSubTransactionId ||
+			relation->rd_droppedSubid != InvalidSubTransactionId)
+			continue;
+
+		RelationClearRelation(relation, false);
 	}
 }
 
@@ -3225,6 +3352,9 @@ AtEOXact_RelationCache(bool isCommit)
 	eoxact_list_overflowed = false;
 	NextEOXactTupleDescNum = 0;
 	EOXactTupleDescArrayLen = 0;
+
+	/* Make room if the relcache has grown too large */
+	RelationCacheEnforceMemoryLimit();
 }
 
 /*
@@ -0,0 +1,461 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Catalog tuples cached in shared memory for all backends.
+ *
+ * When shared_catalog_cache_size is set, the catalog tuples that backends
+ * load into their catcaches are also stored in a dshash table in shared
+ * memory, where other backends find them on a catcache miss instead of
+ * scanning the catalog again.  This saves the catalog scans that fill the
+ * caches of each new backend, which dominate the first queries of a new
+ * session in databases with many relations.  The backend-local catcache is
+ * still built, as are the relcache and plancache; only the catalog tuples
+ * themselves are shared.  Negative entries and catcache lists are not
+ * shared.
+ *
+ * Entries are keyed the same way as catcache invalidation messages: by
+ * database (InvalidOid for shared catalogs), cache ID and hash value of the
+ * lookup keys, so SendSharedInvalidMessages() can remove an entry before
+ * the message that invalidates the backends' local copies is queued.  A
+ * tuple that a backend read from the catalog may be outdated by the time it
+ * is inserted, though.  To catch that, an invalidation counter is bumped
+ * before entries are removed.  A backend reads the counter before taking
+ * the snapshot for its catalog scan, and only inserts the tuple it found
+ * if the counter is still unchanged.  Since invalidation messages are only
+ * sent once the transaction that made the change is visible to new
+ * snapshots, an unchanged counter means that the scan saw the current
+ * version of the tuple, or that the invalidation will remove the entry
+ * after we've inserted it.
+ *
+ * A backend mustn't share tuples that its own transaction inserted or
+ * updated and hasn't committed yet, and mustn't prefer a shared tuple over
+ * its own version of it either, so the shared cache isn't used at all by
+ * transactions that modified catalogs.
+ *
+ * The memory for the cached tuples is limited by shared_catalog_cache_size;
+ * once that is exhausted, new tuples are only cached locally until
+ * invalidations make room again.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+
+/* Hash key of a shared catalog cache entry, like catcache inval messages */
+typedef struct SharedCatCacheKey
+{
+	Oid			dbId;			/* database ID, or 0 if a shared relation */
+	int			cacheId;		/* cache ID */
+	uint32		hashValue;		/* hash value of the lookup keys */
+} SharedCatCacheKey;
+
+/* A cached tuple */
+typedef struct SharedCatCacheEntry
+{
+	SharedCatCacheKey key;		/* hash key; must be first */
+	dsa_pointer data;			/* tuple header and data */
+	uint32		t_len;			/* length of tuple */
+	ItemPointerData t_self;		/* TID of tuple in the catalog */
+	Oid			t_tableOid;		/* OID of the catalog */
+} SharedCatCacheEntry;
+
+/* Shared memory state */
+typedef struct SharedCatCacheCtl
+{
+	dshash_table_handle hash_handle;	/* handle of the dshash table */
+	pg_atomic_uint64 inval_count;	/* bumped before removing entries */
+	pg_atomic_uint64 used;		/* bytes used by cached tuples */
+	char		raw_dsa_area[FLEXIBLE_ARRAY_MEMBER];	/* DSA area in place */
+} SharedCatCacheCtl;
+
+/* GUC variable */
+int			shared_catalog_cache_size = 0;
+
+static SharedCatCacheCtl *SharedCatCache = NULL;
+
+/* This backend's references to the DSA area and the hash table */
+static dsa_area *SharedCatCacheArea = NULL;
+static dshash_table *SharedCatCacheHash = NULL;
+
+static const dshash_parameters SharedCatCacheParams = {
+	sizeof(SharedCatCacheKey),
+	sizeof(SharedCatCacheEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_CATCACHE_HASH
+};
+
+static void SharedCatCacheAttach(void);
+static void SharedCatCacheRemove(SharedCatCacheEntry *entry);
+
+
+/*
+ * Size of the DSA area that is created in the main shared memory segment.
+ * We make room for the tuples there, so as not to depend on dynamic shared
+ * memory unless the hash table's own overhead needs more space.
+ */
+static Size
+SharedCatCacheDSASize(void)
+{
+	Size		sz;
+
+	sz = mul_size((Size) shared_catalog_cache_size, 1024);
+	sz = Max(sz, dsa_minimum_size());
+	return MAXALIGN(sz);
+}
+
+/*
+ * Compute shared memory space needed for the shared catalog cache
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	Size		sz;
+
+	if (shared_catalog_cache_size == 0)
+		return 0;
+
+	sz = offsetof(SharedCatCacheCtl, raw_dsa_area);
+	sz = add_size(MAXALIGN(sz), SharedCatCacheDSASize());
+
+	return sz;
+}
+
+/*
+ * Initialize the shared catalog cache during startup
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_catalog_cache_size == 0)
+		return;
+
+	SharedCatCache = (SharedCatCacheCtl *)
+		ShmemInitStruct("Shared Catalog Cache", SharedCatCacheShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *dsh;
+
+		Assert(!found);
+
+		/*
+		 * The postmaster can't use dsm segments, so the DSA area and the
+		 * dshash table have to be created in plain shared memory, as for
+		 * the cumulative statistics.
+		 */
+		dsa = dsa_create_in_place(SharedCatCache->raw_dsa_area,
+								  SharedCatCacheDSASize(),
+								  LWTRANCHE_SHARED_CATCACHE_DSA, 0);
+		dsa_pin(dsa);
+
+		dsa_set_size_limit(dsa, SharedCatCacheDSASize());
+		dsh = dshash_create(dsa, &SharedCatCacheParams, 0);
+		SharedCatCache->hash_handle = dshash_get_hash_table_handle(dsh);
+		dsa_set_size_limit(dsa, -1);
+
+		dshash_detach(dsh);
+		dsa_detach(dsa);
+
+		pg_atomic_init_u64(&SharedCatCache->inval_count, 0);
+		pg_atomic_init_u64(&SharedCatCache->used, 0);
+	}
+	else
+	{
+		Assert(found);
+	}
+}
+
+/*
+ * Attach to the DSA area and the hash table, if we haven't yet.
+ */
+static void
+SharedCatCacheAttach(void)
+{
+	MemoryContext oldcontext;
+
+	if (SharedCatCacheHash != NULL)
+		return;
+
+	/* we keep the references for the lifetime of the process */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	SharedCatCacheArea = dsa_attach_in_place(SharedCatCache->raw_dsa_area,
+											 NULL);
+	dsa_pin_mapping(SharedCatCacheArea);
+
+	SharedCatCacheHash = dshash_attach(SharedCatCacheArea,
+									   &SharedCatCacheParams,
+									   SharedCatCache->hash_handle, 0);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * SharedCatCacheUsable
+ *
+ * Can a catcache of this backend use the shared catalog cache right now?
+ */
+bool
+SharedCatCacheUsable(bool relisshared)
+{
+	if (SharedCatCache == NULL)
+		return false;
+
+	/*
+	 * Outside of normal processing, invalidation doesn't work or isn't
+	 * needed.
+	 */
+	if (!IsUnderPostmaster || !IsNormalProcessingMode())
+		return false;
+
+	/* Entries of non-shared catalogs belong to a database */
+	if (!relisshared && !OidIsValid(MyDatabaseId))
+		return false;
+
+	/* Logical decoding looks at catalogs as of a point in the past */
+	if (HistoricSnapshotActive())
+		return false;
+
+	/* Our own uncommitted catalog changes must stay private */
+	if (HavePendingInvalidations())
+		return false;
+
+	return true;
+}
+
+/*
+ * SharedCatCacheGetInvalCount
+ *
+ * Returns the counter to pass to SharedCatCacheInsert().  The caller must
+ * take the snapshot for its catalog scan after calling this.
+ */
+uint64
+SharedCatCacheGetInvalCount(void)
+{
+	return pg_atomic_read_u64(&SharedCatCache->inval_count);
+}
+
+/*
+ * SharedCatCacheLookup
+ *
+ * Returns a palloc'd copy of the cached tuple with the given hash value, or
+ * NULL if there is none.  The caller must check that the tuple matches its
+ * lookup keys.
+ */
+HeapTuple
+SharedCatCacheLookup(int cacheId, Oid dbId, uint32 hashValue)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	HeapTuple	tuple;
+
+	SharedCatCacheAttach();
+
+	key.dbId = dbId;
+	key.cacheId = cacheId;
+	key.hashValue = hashValue;
+
+	entry = dshash_find(SharedCatCacheHash, &key, false);
+	if (entry == NULL)
+		return NULL;
+
+	tuple = (HeapTuple) palloc(HEAPTUPLESIZE + entry->t_len);
+	tuple->t_len = entry->t_len;
+	tuple->t_self = entry->t_self;
+	tuple->t_tableOid = entry->t_tableOid;
+	tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+	memcpy(tuple->t_data, dsa_get_address(SharedCatCacheArea, entry->data),
+		   entry->t_len);
+
+	dshash_release_lock(SharedCatCacheHash, entry);
+
+	return tuple;
+}
+
+/*
+ * SharedCatCacheInsert
+ *
+ * Store a tuple that was just read from the catalog, unless the shared
+ * cache is full or the tuple may have been invalidated since invalCount was
+ * obtained.  The tuple must not contain out-of-line values.
+ */
+void
+SharedCatCacheInsert(int cacheId, Oid dbId, uint32 hashValue,
+					 HeapTuple tuple, uint64 invalCount)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	dsa_pointer data;
+	bool		found;
+
+	Assert(!HeapTupleHasExternal(tuple));
+
+	if (pg_atomic_read_u64(&SharedCatCache->used) + tuple->t_len >
+		(uint64) shared_catalog_cache_size * 1024)
+		return;
+
+	SharedCatCacheAttach();
+
+	data = dsa_allocate_extended(SharedCatCacheArea, tuple->t_len,
+								 DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(data))
+		return;
+	memcpy(dsa_get_address(SharedCatCacheArea, data), tuple->t_data,
+		   tuple->t_len);
+
+	key.dbId = dbId;
+	key.cacheId = cacheId;
+	key.hashValue = hashValue;
+
+	entry = dshash_find_or_insert(SharedCatCacheHash, &key, &found);
+
+	/*
+	 * With the partition lock held, an invalidation of this entry either
+	 * bumped the counter already, or will remove what we insert now.
+	 */
+	if (pg_atomic_read_u64(&SharedCatCache->inval_count) != invalCount)
+	{
+		if (found)
+			dshash_release_lock(SharedCatCacheHash, entry);
+		else
+			dshash_delete_entry(SharedCatCacheHash, entry);
+		dsa_free(SharedCatCacheArea, data);
+		return;
+	}
+
+	/* On a hash collision, the newer tuple wins */
+	if (found)
+	{
+		dsa_free(SharedCatCacheArea, entry->data);
+		pg_atomic_sub_fetch_u64(&SharedCatCache->used, entry->t_len);
+	}
+
+	entry->data = data;
+	entry->t_len = tuple->t_len;
+	entry->t_self = tuple->t_self;
+	entry->t_tableOid = tuple->t_tableOid;
+	pg_atomic_add_fetch_u64(&SharedCatCache->used, tuple->t_len);
+
+	dshash_release_lock(SharedCatCacheHash, entry);
+}
+
+/*
+ * Free the tuple of an entry, before the caller deletes the entry.
+ */
+static void
+SharedCatCacheRemove(SharedCatCacheEntry *entry)
+{
+	dsa_free(SharedCatCacheArea, entry->data);
+	pg_atomic_sub_fetch_u64(&SharedCatCache->used, entry->t_len);
+}
+
+/*
+ * SharedCatCacheInvalidate
+ *
+ * Remove the entries that invalidation messages are about to invalidate.
+ * Called by SendSharedInvalidMessages() before the messages are queued.
+ */
+void
+SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	bool		bumped = false;
+	int			i;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+		{
+			SharedCatCacheKey key;
+			SharedCatCacheEntry *entry;
+
+			SharedCatCacheAttach();
+
+			/* bump the counter first; see SharedCatCacheInsert() */
+			if (!bumped)
+			{
+				pg_atomic_fetch_add_u64(&SharedCatCache->inval_count, 1);
+				bumped = true;
+			}
+
+			key.dbId = msg->cc.dbId;
+			key.cacheId = msg->cc.id;
+			key.hashValue = msg->cc.hashValue;
+
+			entry = dshash_find(SharedCatCacheHash, &key, true);
+			if (entry != NULL)
+			{
+				SharedCatCacheRemove(entry);
+				dshash_delete_entry(SharedCatCacheHash, entry);
+			}
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+		{
+			/*
+			 * The whole catalog was rewritten, which is rare enough that we
+			 * just forget about all entries of the database.
+			 */
+			SharedCatCacheDropDatabase(msg->cat.dbId);
+		}
+	}
+}
+
+/*
+ * SharedCatCacheDropDatabase
+ *
+ * Remove all entries of a database, or of the shared catalogs if dbId is
+ * InvalidOid.  This is also called when a database is dropped, so that a
+ * new database reusing its OID doesn't find its entries.
+ */
+void
+SharedCatCacheDropDatabase(Oid dbId)
+{
+	dshash_seq_status status;
+	SharedCatCacheEntry *entry;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	SharedCatCacheAttach();
+
+	pg_atomic_fetch_add_u64(&SharedCatCache->inval_count, 1);
+
+	dshash_seq_init(&status, SharedCatCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->key.dbId != dbId)
+			continue;
+
+		SharedCatCacheRemove(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
@@ -0,0 +1,1383 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Generic plans cached in shared memory for all backends.
+ *
+ * When shared_plan_cache_size is set, the generic plans that backends build
+ * for their cached plans are also stored in a dshash table in shared memory,
+ * from where other backends executing the same statement can take them
+ * instead of planning the statement again.  Each backend still parses,
+ * analyzes and rewrites its statements and keeps its own CachedPlanSource
+ * and CachedPlan; only the planner's output, the list of PlannedStmts, is
+ * shared.  Custom plans are never shared, since they depend on the
+ * parameter values of one execution.
+ *
+ * Entries are keyed by database, current user, and the query IDs computed
+ * by query jumbling for the analyzed querytrees, which identify the objects
+ * the statement refers to.  Since the query ID disregards constants, the
+ * query string and the node string of the analyzed querytrees are compared
+ * too.  The latter covers settings such as TimeZone, DateStyle,
+ * IntervalStyle and standard_conforming_strings, which change the constants
+ * that parse analysis produces from the same query string.  The parameter
+ * types, the cursor options and the effective search path, which may matter
+ * to the planner when it inlines SQL functions, must match as well.  Plans
+ * are stored as node strings, which the reader converts back with
+ * stringToNode().
+ *
+ * A PlannedStmt also carries decisions that take effect when it's executed:
+ * whether and how to JIT-compile it, and how many parallel workers to
+ * request.  The settings that these decisions are based on are part of the
+ * key, see SharedPlanSettings.  The remaining planner settings only choose
+ * between plans that give the same results, and are not part of the key, so
+ * a session may use a plan that was built by a session with, for instance,
+ * different cost parameters or enable_* settings.
+ *
+ * Every entry remembers the relations and the other objects the plan
+ * depends on, like the PlanInvalItems of a CachedPlan.  A second dshash
+ * table indexes the entries by these dependencies, so that the entries that
+ * an invalidation message for a relation or a function or type outdates are
+ * found without a scan of the whole table.  Only messages that outdate
+ * broader sets of plans, like those for schemas or operators, need a full
+ * scan.  Messages for catalogs that no plan depends on cost nothing.
+ *
+ * A backend that looks up a plan must not find an entry that an
+ * invalidation message it has already processed outdates, and a backend
+ * that planned a statement based on outdated catalog contents must not
+ * insert the plan.  Therefore, SendSharedInvalidMessages() marks an
+ * invalidation as in progress and bumps an invalidation counter before it
+ * queues the messages, then removes the outdated entries, bumps the counter
+ * again and clears the mark.  Entries are neither returned nor inserted
+ * while an invalidation is in progress.  A backend that wants to share the
+ * plan it's about to build reads the counter before processing the pending
+ * invalidation messages, and only inserts the plan if the counter is still
+ * unchanged.  If removing the outdated entries fails, the whole cache is
+ * hidden until the next invalidation has emptied it.
+ *
+ * Plans that depend on the session beyond that aren't shared: plans of
+ * sessions that use temporary objects, of querytrees that row-level
+ * security applied to, of transactions that modified catalogs, and plans
+ * that are only valid for the current transaction.
+ *
+ * The memory for the cached plans is limited by shared_plan_cache_size;
+ * once that is exhausted, new plans are only cached locally until
+ * invalidations make room again.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/namespace.h"
+#include "common/hashfn.h"
+#include "jit/jit.h"
+#include "lib/dshash.h"
+#include "lib/qunique.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/dsa.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/queryjumble.h"
+#include "utils/sharedplancache.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+
+
+/* Longest search path for which plans are shared */
+#define SHARED_PLAN_MAX_SEARCH_PATH 32
+
+/* Hash key of a shared plan cache entry */
+typedef struct SharedPlanCacheKey
+{
+	Oid			dbId;			/* database ID */
+	Oid			roleId;			/* user that built the plan */
+	uint64		queryId;		/* combined query IDs of the querytrees */
+	uint32		hashValue;		/* hash of query string, search path etc. */
+} SharedPlanCacheKey;
+
+/* A dependency of a cached plan on a syscache entry */
+typedef struct SharedPlanInvalItem
+{
+	int			cacheId;		/* syscache ID */
+	uint32		hashValue;		/* hash value of object's cache lookup key */
+} SharedPlanInvalItem;
+
+/*
+ * Settings that a plan was built for, and that take effect when the plan is
+ * executed.  The planner derives PlannedStmt.jitFlags from the JIT settings,
+ * and the number of workers that Gather nodes request from the parallel
+ * query settings.
+ */
+typedef struct SharedPlanSettings
+{
+	bool		jit_enabled;
+	bool		jit_expressions;
+	bool		jit_tuple_deforming;
+	bool		parallel_leader_participation;
+	int			force_parallel_mode;
+	int			max_parallel_workers_per_gather;
+	double		jit_above_cost;
+	double		jit_inline_above_cost;
+	double		jit_optimize_above_cost;
+} SharedPlanSettings;
+
+/*
+ * The shared memory chunk that holds a cached plan.  The variable-length
+ * parts follow the struct, in this order: the parameter types, the search
+ * path, the OIDs of the relations and the syscache entries the plan depends
+ * on, the query string, the node string of the analyzed querytrees and the
+ * node string of the list of PlannedStmts.
+ */
+typedef struct SharedPlanData
+{
+	SharedPlanSettings settings;	/* settings the plan was built for */
+	int			cursor_options; /* cursor options used for planning */
+	int			num_params;		/* number of parameters */
+	int			npath;			/* number of schemas in search path */
+	int			nrels;			/* number of relation dependencies */
+	int			nitems;			/* number of other dependencies */
+	Size		text_len;		/* length of query string, with terminator */
+	Size		query_len;		/* length of querytree string, likewise */
+	Size		plan_len;		/* length of plan string, with terminator */
+} SharedPlanData;
+
+#define SharedPlanParamTypes(data) \
+	((Oid *) ((char *) (data) + MAXALIGN(sizeof(SharedPlanData))))
+#define SharedPlanSearchPath(data) \
+	(SharedPlanParamTypes(data) + (data)->num_params)
+#define SharedPlanRelations(data) \
+	(SharedPlanSearchPath(data) + (data)->npath)
+#define SharedPlanInvalItems(data) \
+	((SharedPlanInvalItem *) (SharedPlanRelations(data) + (data)->nrels))
+#define SharedPlanQueryString(data) \
+	((char *) (SharedPlanInvalItems(data) + (data)->nitems))
+#define SharedPlanQueryTree(data) \
+	(SharedPlanQueryString(data) + (data)->text_len)
+#define SharedPlanString(data) \
+	(SharedPlanQueryTree(data) + (data)->query_len)
+
+/* A cached plan */
+typedef struct SharedPlanCacheEntry
+{
+	SharedPlanCacheKey key;		/* hash key; must be first */
+	dsa_pointer data;			/* SharedPlanData */
+	Size		size;			/* allocated size of data */
+} SharedPlanCacheEntry;
+
+/*
+ * Hash key of the dependency index: a syscache entry, or a relation if
+ * cacheId is SHARED_PLAN_DEP_RELATION, in which case hashValue is the OID of
+ * the relation.  The database is not part of the key, since relcache
+ * messages for shared catalogs don't carry one; the plan keys in the entry
+ * tell which database each plan belongs to.
+ */
+typedef struct SharedPlanDepKey
+{
+	int			cacheId;		/* syscache ID, or relation marker */
+	uint32		hashValue;		/* hash value of cache lookup key, or OID */
+} SharedPlanDepKey;
+
+#define SHARED_PLAN_DEP_RELATION	(-1)
+
+/* The cached plans that depend on an object */
+typedef struct SharedPlanDepEntry
+{
+	SharedPlanDepKey key;		/* hash key; must be first */
+	dsa_pointer plans;			/* array of SharedPlanCacheKey */
+	int			nplans;			/* number of valid array elements */
+	int			maxplans;		/* allocated length of array */
+} SharedPlanDepEntry;
+
+/* How an invalidation message affects the shared plan cache */
+typedef enum SharedPlanInvalKind
+{
+	SHARED_PLAN_INVAL_NONE,		/* affects no plan */
+	SHARED_PLAN_INVAL_INDEXED,	/* affects plans found in dependency index */
+	SHARED_PLAN_INVAL_SCAN		/* needs a scan of all plans */
+} SharedPlanInvalKind;
+
+/* Shared memory state */
+typedef struct SharedPlanCacheCtl
+{
+	dshash_table_handle hash_handle;	/* handle of the dshash table */
+	dshash_table_handle dep_handle; /* handle of the dependency index */
+	pg_atomic_uint32 inval_in_progress; /* # of running invalidations */
+	pg_atomic_uint64 inval_count;	/* bumped around removing entries */
+	pg_atomic_uint64 reset_requested;	/* # of failed invalidations */
+	pg_atomic_uint64 reset_done;	/* reset_requested as of last reset */
+	pg_atomic_uint64 used;		/* bytes used by plans and the index */
+	char		raw_dsa_area[FLEXIBLE_ARRAY_MEMBER];	/* DSA area in place */
+} SharedPlanCacheCtl;
+
+/*
+ * What a cached plan must match, in addition to the hash key, to be used
+ * for a CachedPlanSource.
+ */
+typedef struct SharedPlanMatchInfo
+{
+	Oid			path[SHARED_PLAN_MAX_SEARCH_PATH];	/* search path */
+	int			npath;			/* number of schemas in search path */
+	SharedPlanSettings settings;	/* current settings */
+	char	   *querytree;		/* node string of the analyzed querytrees */
+	Size		query_len;		/* its length, with terminator */
+} SharedPlanMatchInfo;
+
+/* GUC variable */
+int			shared_plan_cache_size = 0;
+
+static SharedPlanCacheCtl *SharedPlanCache = NULL;
+
+/* This backend's references to the DSA area and the hash table */
+static dsa_area *SharedPlanCacheArea = NULL;
+static dshash_table *SharedPlanCacheHash = NULL;
+static dshash_table *SharedPlanDepHash = NULL;
+
+static const dshash_parameters SharedPlanCacheParams = {
+	sizeof(SharedPlanCacheKey),
+	sizeof(SharedPlanCacheEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_PLANCACHE_HASH
+};
+
+static const dshash_parameters SharedPlanDepParams = {
+	sizeof(SharedPlanDepKey),
+	sizeof(SharedPlanDepEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_PLANCACHE_DEPS
+};
+
+static void SharedPlanCacheAttach(void);
+static bool SharedPlanCacheHidden(void);
+static bool SharedPlanCacheMakeKey(CachedPlanSource *plansource,
+								   SharedPlanCacheKey *key,
+								   SharedPlanMatchInfo *info);
+static bool SharedPlanMatches(SharedPlanData *data,
+							  CachedPlanSource *plansource,
+							  SharedPlanMatchInfo *info);
+static int	SharedPlanInvalItemCmp(const void *a, const void *b);
+static bool SharedPlanDepAdd(const SharedPlanDepKey *depkey,
+							 const SharedPlanCacheKey *key);
+static void SharedPlanDepRemove(const SharedPlanDepKey *depkey,
+								const SharedPlanCacheKey *key);
+static bool SharedPlanDepAddAll(SharedPlanData *data,
+								const SharedPlanCacheKey *key);
+static void SharedPlanDepRemoveAll(SharedPlanData *data,
+								   const SharedPlanCacheKey *key, int ndeps);
+static SharedPlanInvalKind SharedPlanInvalKindOf(const SharedInvalidationMessage *msg,
+												 SharedPlanDepKey *depkey);
+static bool SharedPlanInvalidatedBy(SharedPlanCacheEntry *entry,
+									const SharedInvalidationMessage *msg);
+static void SharedPlanInvalidateIndexed(const SharedInvalidationMessage *msg,
+										const SharedPlanDepKey *depkey);
+static void SharedPlanCacheRemove(SharedPlanCacheEntry *entry);
+
+
+/*
+ * Size of the DSA area that is created in the main shared memory segment.
+ */
+static Size
+SharedPlanCacheDSASize(void)
+{
+	Size		sz;
+
+	sz = mul_size((Size) shared_plan_cache_size, 1024);
+	sz = Max(sz, dsa_minimum_size());
+	return MAXALIGN(sz);
+}
+
+/*
+ * Compute shared memory space needed for the shared plan cache
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		sz;
+
+	if (shared_plan_cache_size == 0)
+		return 0;
+
+	sz = offsetof(SharedPlanCacheCtl, raw_dsa_area);
+	sz = add_size(MAXALIGN(sz), SharedPlanCacheDSASize());
+
+	return sz;
+}
+
+/*
+ * Initialize the shared plan cache during startup
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_plan_cache_size == 0)
+		return;
+
+	/* Entries are keyed by query ID, so make sure it's computed */
+	EnableQueryId();
+
+	SharedPlanCache = (SharedPlanCacheCtl *)
+		ShmemInitStruct("Shared Plan Cache", SharedPlanCacheShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *dsh;
+
+		Assert(!found);
+
+		/* As for the shared catalog cache, see SharedCatCacheShmemInit() */
+		dsa = dsa_create_in_place(SharedPlanCache->raw_dsa_area,
+								  SharedPlanCacheDSASize(),
+								  LWTRANCHE_SHARED_PLANCACHE_DSA, 0);
+		dsa_pin(dsa);
+
+		dsa_set_size_limit(dsa, SharedPlanCacheDSASize());
+		dsh = dshash_create(dsa, &SharedPlanCacheParams, 0);
+		SharedPlanCache->hash_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
+		dsh = dshash_create(dsa, &SharedPlanDepParams, 0);
+		SharedPlanCache->dep_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
+		dsa_set_size_limit(dsa, -1);
+
+		dsa_detach(dsa);
+
+		pg_atomic_init_u32(&SharedPlanCache->inval_in_progress, 0);
+		pg_atomic_init_u64(&SharedPlanCache->inval_count, 0);
+		pg_atomic_init_u64(&SharedPlanCache->reset_requested, 0);
+		pg_atomic_init_u64(&SharedPlanCache->reset_done, 0);
+		pg_atomic_init_u64(&SharedPlanCache->used, 0);
+	}
+	else
+	{
+		Assert(found);
+	}
+}
+
+/*
+ * Attach to the DSA area and the hash table, if we haven't yet.
+ */
+static void
+SharedPlanCacheAttach(void)
+{
+	MemoryContext oldcontext;
+
+	if (SharedPlanDepHash != NULL)
+		return;
+
+	/*
+	 * We keep the references for the lifetime of the process.  If attaching
+	 * fails halfway, the next call continues where this one stopped.
+	 */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	if (SharedPlanCacheArea == NULL)
+	{
+		SharedPlanCacheArea =
+			dsa_attach_in_place(SharedPlanCache->raw_dsa_area, NULL);
+		dsa_pin_mapping(SharedPlanCacheArea);
+	}
+
+	if (SharedPlanCacheHash == NULL)
+		SharedPlanCacheHash = dshash_attach(SharedPlanCacheArea,
+											&SharedPlanCacheParams,
+											SharedPlanCache->hash_handle, 0);
+	SharedPlanDepHash = dshash_attach(SharedPlanCacheArea,
+									  &SharedPlanDepParams,
+									  SharedPlanCache->dep_handle, 0);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Must cached plans be ignored right now?  That is the case while an
+ * invalidation is in progress, which may not have removed the entries it
+ * outdates yet, and after an invalidation failed to remove them, until the
+ * cache has been emptied.
+ */
+static bool
+SharedPlanCacheHidden(void)
+{
+	if (pg_atomic_read_u32(&SharedPlanCache->inval_in_progress) != 0)
+		return true;
+
+	return pg_atomic_read_u64(&SharedPlanCache->reset_requested) !=
+		pg_atomic_read_u64(&SharedPlanCache->reset_done);
+}
+
+/*
+ * SharedPlanCacheUsable
+ *
+ * Can the generic plan of this CachedPlanSource be shared right now?
+ * SharedPlanCacheLookup() and SharedPlanCacheInsert() make further checks
+ * on the querytrees.
+ */
+bool
+SharedPlanCacheUsable(CachedPlanSource *plansource,
+					  QueryEnvironment *queryEnv)
+{
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+
+	if (SharedPlanCache == NULL)
+		return false;
+
+	if (!IsUnderPostmaster || !IsNormalProcessingMode() ||
+		!OidIsValid(MyDatabaseId))
+		return false;
+
+	if (plansource->is_oneshot || plansource->query_string == NULL)
+		return false;
+
+	/* Ephemeral named relations are private to the query */
+	if (queryEnv != NULL)
+		return false;
+
+	/* Row-level security makes the querytrees depend on the session */
+	if (plansource->dependsOnRLS)
+		return false;
+
+	/* Logical decoding looks at catalogs as of a point in the past */
+	if (HistoricSnapshotActive())
+		return false;
+
+	/* Plans based on our own uncommitted catalog changes must stay private */
+	if (HavePendingInvalidations())
+		return false;
+
+	/* Temporary objects are private to the session */
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+	if (OidIsValid(tempNamespaceId))
+		return false;
+
+	return true;
+}
+
+/*
+ * SharedPlanCacheGetInvalCount
+ *
+ * Returns the counter to pass to SharedPlanCacheInsert().  The caller must
+ * process pending invalidation messages after calling this, and before it
+ * builds the plan.
+ */
+uint64
+SharedPlanCacheGetInvalCount(void)
+{
+	return pg_atomic_read_u64(&SharedPlanCache->inval_count);
+}
+
+/*
+ * Compute the hash key for the plan of a CachedPlanSource.  Also fill in
+ * what a cached plan must match besides the key; the caller must pfree
+ * info->querytree.  Returns false if the plan can't be shared.
+ */
+static bool
+SharedPlanCacheMakeKey(CachedPlanSource *plansource, SharedPlanCacheKey *key,
+					   SharedPlanMatchInfo *info)
+{
+	SharedPlanSettings *settings = &info->settings;
+	uint64		queryId = 0;
+	uint32		hashValue;
+	ListCell   *lc;
+
+	if (plansource->query_list == NIL)
+		return false;
+
+	foreach(lc, plansource->query_list)
+	{
+		Query	   *query = lfirst_node(Query, lc);
+
+		/* Utility statements don't need planning */
+		if (query->commandType == CMD_UTILITY || query->utilityStmt != NULL)
+			return false;
+
+		/* We need the query ID, which compute_query_id = off disables */
+		if (query->queryId == UINT64CONST(0))
+			return false;
+
+		queryId = hash_combine64(queryId, query->queryId);
+	}
+
+	info->npath = fetch_search_path_array(info->path,
+										  SHARED_PLAN_MAX_SEARCH_PATH);
+	if (info->npath > SHARED_PLAN_MAX_SEARCH_PATH)
+		return false;
+
+	/* zero the padding, since the settings are compared with memcmp */
+	memset(settings, 0, sizeof(SharedPlanSettings));
+	settings->jit_enabled = jit_enabled;
+	settings->jit_expressions = jit_expressions;
+	settings->jit_tuple_deforming = jit_tuple_deforming;
+	settings->parallel_leader_participation = parallel_leader_participation;
+	settings->force_parallel_mode = force_parallel_mode;
+	settings->max_parallel_workers_per_gather = max_parallel_workers_per_gather;
+	settings->jit_above_cost = jit_above_cost;
+	settings->jit_inline_above_cost = jit_inline_above_cost;
+	settings->jit_optimize_above_cost = jit_optimize_above_cost;
+
+	info->querytree = nodeToString(plansource->query_list);
+	info->query_len = strlen(info->querytree) + 1;
+
+	hashValue = hash_bytes((const unsigned char *) plansource->query_string,
+						   strlen(plansource->query_string));
+	hashValue = hash_combine(hashValue,
+							 hash_bytes((const unsigned char *) info->querytree,
+										info->query_len - 1));
+	hashValue = hash_combine(hashValue,
+							 hash_bytes((const unsigned char *) info->path,
+										info->npath * sizeof(Oid)));
+	if (plansource->num_params > 0)
+		hashValue = hash_combine(hashValue,
+								 hash_bytes((const unsigned char *) plansource->param_types,
+											plansource->num_params * sizeof(Oid)));
+	hashValue = hash_combine(hashValue, (uint32) plansource->cursor_options);
+	hashValue = hash_combine(hashValue,
+							 hash_bytes((const unsigned char *) settings,
+										sizeof(SharedPlanSettings)));
+
+	/* zero the padding, since the key is compared with memcmp */
+	memset(key, 0, sizeof(SharedPlanCacheKey));
+	key->dbId = MyDatabaseId;
+	key->roleId = GetUserId();
+	key->queryId = queryId;
+	key->hashValue = hashValue;
+
+	return true;
+}
+
+/*
+ * Does a cached plan belong to the same statement as a CachedPlanSource?
+ */
+static bool
+SharedPlanMatches(SharedPlanData *data, CachedPlanSource *plansource,
+				  SharedPlanMatchInfo *info)
+{
+	if (data->cursor_options != plansource->cursor_options ||
+		data->num_params != plansource->num_params ||
+		data->npath != info->npath ||
+		data->query_len != info->query_len)
+		return false;
+
+	if (memcmp(&data->settings, &info->settings,
+			   sizeof(SharedPlanSettings)) != 0)
+		return false;
+
+	if (data->num_params > 0 &&
+		memcmp(SharedPlanParamTypes(data), plansource->param_types,
+			   data->num_params * sizeof(Oid)) != 0)
+		return false;
+
+	if (memcmp(SharedPlanSearchPath(data), info->path,
+			   info->npath * sizeof(Oid)) != 0)
+		return false;
+
+	if (strcmp(SharedPlanQueryString(data), plansource->query_string) != 0)
+		return false;
+
+	return memcmp(SharedPlanQueryTree(data), info->querytree,
+				  info->query_len) == 0;
+}
+
+/*
+ * SharedPlanCacheLookup
+ *
+ * Returns a list of PlannedStmts for the generic plan of the CachedPlanSource,
+ * allocated in the current memory context, or NIL if there is none.  The
+ * caller must have processed pending invalidation messages.
+ */
+List *
+SharedPlanCacheLookup(CachedPlanSource *plansource)
+{
+	SharedPlanCacheKey key;
+	SharedPlanMatchInfo info;
+	SharedPlanCacheEntry *entry;
+	SharedPlanData *data;
+	char	   *plan_str;
+	List	   *stmt_list;
+
+	if (!SharedPlanCacheMakeKey(plansource, &key, &info))
+		return NIL;
+
+	SharedPlanCacheAttach();
+
+	entry = dshash_find(SharedPlanCacheHash, &key, false);
+	if (entry == NULL)
+	{
+		pfree(info.querytree);
+		return NIL;
+	}
+
+	data = (SharedPlanData *) dsa_get_address(SharedPlanCacheArea,
+											  entry->data);
+	if (SharedPlanCacheHidden() ||
+		!SharedPlanMatches(data, plansource, &info))
+	{
+		dshash_release_lock(SharedPlanCacheHash, entry);
+		pfree(info.querytree);
+		return NIL;
+	}
+
+	plan_str = palloc(data->plan_len);
+	memcpy(plan_str, SharedPlanString(data), data->plan_len);
+
+	dshash_release_lock(SharedPlanCacheHash, entry);
+
+	elog(DEBUG2, "using generic plan from shared plan cache for query: %s",
+		 plansource->query_string);
+
+	stmt_list = (List *) stringToNode(plan_str);
+	pfree(plan_str);
+	pfree(info.querytree);
+
+	return stmt_list;
+}
+
+/*
+ * qsort comparator for SharedPlanInvalItems
+ */
+static int
+SharedPlanInvalItemCmp(const void *a, const void *b)
+{
+	const SharedPlanInvalItem *item1 = (const SharedPlanInvalItem *) a;
+	const SharedPlanInvalItem *item2 = (const SharedPlanInvalItem *) b;
+
+	if (item1->cacheId != item2->cacheId)
+		return item1->cacheId < item2->cacheId ? -1 : 1;
+	if (item1->hashValue != item2->hashValue)
+		return item1->hashValue < item2->hashValue ? -1 : 1;
+	return 0;
+}
+
+/*
+ * SharedPlanCacheInsert
+ *
+ * Store a generic plan that was just built for a CachedPlanSource, unless
+ * the shared cache is full, the plan can't be shared, or the plan may have
+ * been invalidated since invalCount was obtained.
+ */
+void
+SharedPlanCacheInsert(CachedPlanSource *plansource, List *stmt_list,
+					  uint64 invalCount)
+{
+	SharedPlanCacheKey key;
+	SharedPlanMatchInfo info;
+	SharedPlanCacheEntry *entry;
+	SharedPlanData *data;
+	SharedPlanInvalItem *items;
+	Oid		   *rels;
+	int			nrels;
+	int			nitems;
+	char	   *plan_str;
+	Size		text_len;
+	Size		plan_len;
+	Size		size;
+	dsa_pointer dp;
+	bool		found;
+	ListCell   *lc;
+	ListCell   *lc2;
+
+	/* Count the dependencies of the querytrees and the plans */
+	nrels = list_length(plansource->relationOids);
+	nitems = list_length(plansource->invalItems);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		/* Plans that are only valid in this transaction can't be shared */
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+
+		nrels += list_length(plannedstmt->relationOids);
+		nitems += list_length(plannedstmt->invalItems);
+	}
+
+	if (!SharedPlanCacheMakeKey(plansource, &key, &info))
+		return;
+
+	/* Collect them, each only once, since each is indexed once */
+	rels = palloc((nrels + 1) * sizeof(Oid));
+	items = palloc((nitems + 1) * sizeof(SharedPlanInvalItem));
+	nrels = 0;
+	nitems = 0;
+	foreach(lc, plansource->relationOids)
+		rels[nrels++] = lfirst_oid(lc);
+	foreach(lc, plansource->invalItems)
+	{
+		PlanInvalItem *item = (PlanInvalItem *) lfirst(lc);
+
+		items[nitems].cacheId = item->cacheId;
+		items[nitems].hashValue = item->hashValue;
+		nitems++;
+	}
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		foreach(lc2, plannedstmt->relationOids)
+			rels[nrels++] = lfirst_oid(lc2);
+		foreach(lc2, plannedstmt->invalItems)
+		{
+			PlanInvalItem *item = (PlanInvalItem *) lfirst(lc2);
+
+			items[nitems].cacheId = item->cacheId;
+			items[nitems].hashValue = item->hashValue;
+			nitems++;
+		}
+	}
+	if (nrels > 1)
+	{
+		qsort(rels, nrels, sizeof(Oid), oid_cmp);
+		nrels = qunique(rels, nrels, sizeof(Oid), oid_cmp);
+	}
+	if (nitems > 1)
+	{
+		qsort(items, nitems, sizeof(SharedPlanInvalItem),
+			  SharedPlanInvalItemCmp);
+		nitems = qunique(items, nitems, sizeof(SharedPlanInvalItem),
+						 SharedPlanInvalItemCmp);
+	}
+
+	plan_str = nodeToString(stmt_list);
+	text_len = strlen(plansource->query_string) + 1;
+	plan_len = strlen(plan_str) + 1;
+
+	size = MAXALIGN(sizeof(SharedPlanData));
+	size += (plansource->num_params + info.npath + nrels) * sizeof(Oid);
+	size += nitems * sizeof(SharedPlanInvalItem);
+	size += text_len + info.query_len + plan_len;
+
+	dp = InvalidDsaPointer;
+	if (pg_atomic_read_u64(&SharedPlanCache->used) + size <=
+		(uint64) shared_plan_cache_size * 1024)
+	{
+		SharedPlanCacheAttach();
+		dp = dsa_allocate_extended(SharedPlanCacheArea, size,
+								   DSA_ALLOC_NO_OOM);
+	}
+	if (!DsaPointerIsValid(dp))
+	{
+		pfree(rels);
+		pfree(items);
+		pfree(plan_str);
+		pfree(info.querytree);
+		return;
+	}
+
+	data = (SharedPlanData *) dsa_get_address(SharedPlanCacheArea, dp);
+	data->settings = info.settings;
+	data->cursor_options = plansource->cursor_options;
+	data->num_params = plansource->num_params;
+	data->npath = info.npath;
+	data->nrels = nrels;
+	data->nitems = nitems;
+	data->text_len = text_len;
+	data->query_len = info.query_len;
+	data->plan_len = plan_len;
+
+	if (plansource->num_params > 0)
+		memcpy(SharedPlanParamTypes(data), plansource->param_types,
+			   plansource->num_params * sizeof(Oid));
+	memcpy(SharedPlanSearchPath(data), info.path, info.npath * sizeof(Oid));
+	memcpy(SharedPlanRelations(data), rels, nrels * sizeof(Oid));
+	memcpy(SharedPlanInvalItems(data), items,
+		   nitems * sizeof(SharedPlanInvalItem));
+	memcpy(SharedPlanQueryString(data), plansource->query_string, text_len);
+	memcpy(SharedPlanQueryTree(data), info.querytree, info.query_len);
+	memcpy(SharedPlanString(data), plan_str, plan_len);
+	pfree(rels);
+	pfree(items);
+	pfree(plan_str);
+	pfree(info.querytree);
+
+	/*
+	 * Index the plan before it becomes visible.  An invalidation that looks
+	 * at the index before we add to it has bumped the counter already, so
+	 * the plan will be rejected below.
+	 */
+	if (!SharedPlanDepAddAll(data, &key))
+	{
+		dsa_free(SharedPlanCacheArea, dp);
+		return;
+	}
+
+	entry = dshash_find_or_insert(SharedPlanCacheHash, &key, &found);
+
+	/*
+	 * With the partition lock held, an invalidation of this entry either
+	 * changed the counter or marked itself in progress already, or will
+	 * remove what we insert now.
+	 */
+	if (pg_atomic_read_u64(&SharedPlanCache->inval_count) != invalCount ||
+		SharedPlanCacheHidden())
+	{
+		if (found)
+			dshash_release_lock(SharedPlanCacheHash, entry);
+		else
+			dshash_delete_entry(SharedPlanCacheHash, entry);
+		SharedPlanDepRemoveAll(data, &key, data->nrels + data->nitems);
+		dsa_free(SharedPlanCacheArea, dp);
+		return;
+	}
+
+	/* On a hash collision, the newer plan wins */
+	if (found)
+		SharedPlanCacheRemove(entry);
+
+	entry->data = dp;
+	entry->size = size;
+	pg_atomic_add_fetch_u64(&SharedPlanCache->used, size);
+
+	dshash_release_lock(SharedPlanCacheHash, entry);
+}
+
+/*
+ * Get the key of the i'th dependency of a cached plan in the dependency
+ * index.  The relations come first, then the syscache entries.
+ */
+static void
+SharedPlanDepKeyOf(SharedPlanData *data, int i, SharedPlanDepKey *depkey)
+{
+	if (i < data->nrels)
+	{
+		depkey->cacheId = SHARED_PLAN_DEP_RELATION;
+		depkey->hashValue = SharedPlanRelations(data)[i];
+	}
+	else
+	{
+		SharedPlanInvalItem *item;
+
+		item = &SharedPlanInvalItems(data)[i - data->nrels];
+
+		depkey->cacheId = item->cacheId;
+		depkey->hashValue = item->hashValue;
+	}
+}
+
+/*
+ * Release a locked entry of the dependency index, deleting it if no plan
+ * depends on the object anymore.
+ */
+static void
+SharedPlanDepRelease(SharedPlanDepEntry *dep)
+{
+	if (dep->nplans > 0)
+	{
+		dshash_release_lock(SharedPlanDepHash, dep);
+		return;
+	}
+
+	if (DsaPointerIsValid(dep->plans))
+	{
+		dsa_free(SharedPlanCacheArea, dep->plans);
+		pg_atomic_sub_fetch_u64(&SharedPlanCache->used,
+								dep->maxplans * sizeof(SharedPlanCacheKey));
+	}
+	dshash_delete_entry(SharedPlanDepHash, dep);
+}
+
+/*
+ * Record in the dependency index that the plan with the given key depends
+ * on an object.  Returns false if the shared cache is full.
+ */
+static bool
+SharedPlanDepAdd(const SharedPlanDepKey *depkey,
+				 const SharedPlanCacheKey *key)
+{
+	SharedPlanDepEntry *dep;
+	SharedPlanCacheKey *plans;
+	bool		found;
+
+	dep = dshash_find_or_insert(SharedPlanDepHash, depkey, &found);
+	if (!found)
+	{
+		dep->plans = InvalidDsaPointer;
+		dep->nplans = 0;
+		dep->maxplans = 0;
+	}
+
+	if (dep->nplans == dep->maxplans)
+	{
+		int			newmax = Max(dep->maxplans * 2, 4);
+		Size		oldsize = dep->maxplans * sizeof(SharedPlanCacheKey);
+		Size		newsize = newmax * sizeof(SharedPlanCacheKey);
+		dsa_pointer dp = InvalidDsaPointer;
+
+		if (pg_atomic_read_u64(&SharedPlanCache->used) + newsize <=
+			(uint64) shared_plan_cache_size * 1024)
+			dp = dsa_allocate_extended(SharedPlanCacheArea, newsize,
+									   DSA_ALLOC_NO_OOM);
+		if (!DsaPointerIsValid(dp))
+		{
+			SharedPlanDepRelease(dep);
+			return false;
+		}
+
+		if (DsaPointerIsValid(dep->plans))
+		{
+			memcpy(dsa_get_address(SharedPlanCacheArea, dp),
+				   dsa_get_address(SharedPlanCacheArea, dep->plans),
+				   oldsize);
+			dsa_free(SharedPlanCacheArea, dep->plans);
+			pg_atomic_sub_fetch_u64(&SharedPlanCache->used, oldsize);
+		}
+		pg_atomic_add_fetch_u64(&SharedPlanCache->used, newsize);
+		dep->plans = dp;
+		dep->maxplans = newmax;
+	}
+
+	plans = (SharedPlanCacheKey *) dsa_get_address(SharedPlanCacheArea,
+												   dep->plans);
+	plans[dep->nplans++] = *key;
+
+	dshash_release_lock(SharedPlanDepHash, dep);
+
+	return true;
+}
+
+/*
+ * Remove one reference to the plan with the given key from the index entry
+ * of an object.
+ */
+static void
+SharedPlanDepRemove(const SharedPlanDepKey *depkey,
+					const SharedPlanCacheKey *key)
+{
+	SharedPlanDepEntry *dep;
+	SharedPlanCacheKey *plans;
+	int			i;
+
+	dep = dshash_find(SharedPlanDepHash, depkey, true);
+	if (dep == NULL)
+		return;
+
+	plans = (SharedPlanCacheKey *) dsa_get_address(SharedPlanCacheArea,
+												   dep->plans);
+	for (i = 0; i < dep->nplans; i++)
+	{
+		if (memcmp(&plans[i], key, sizeof(SharedPlanCacheKey)) == 0)
+		{
+			plans[i] = plans[--dep->nplans];
+			break;
+		}
+	}
+
+	SharedPlanDepRelease(dep);
+}
+
+/*
+ * Add all dependencies of a cached plan to the dependency index.  Returns
+ * false, with none of them added, if the shared cache is full.
+ */
+static bool
+SharedPlanDepAddAll(SharedPlanData *data, const SharedPlanCacheKey *key)
+{
+	SharedPlanDepKey depkey;
+	int			i;
+
+	for (i = 0; i < data->nrels + data->nitems; i++)
+	{
+		SharedPlanDepKeyOf(data, i, &depkey);
+		if (!SharedPlanDepAdd(&depkey, key))
+		{
+			SharedPlanDepRemoveAll(data, key, i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Remove the first ndeps dependencies of a cached plan from the dependency
+ * index.
+ */
+static void
+SharedPlanDepRemoveAll(SharedPlanData *data, const SharedPlanCacheKey *key,
+					   int ndeps)
+{
+	SharedPlanDepKey depkey;
+	int			i;
+
+	for (i = 0; i < ndeps; i++)
+	{
+		SharedPlanDepKeyOf(data, i, &depkey);
+		SharedPlanDepRemove(&depkey, key);
+	}
+}
+
+/*
+ * Free the plan of an entry and remove it from the dependency index, before
+ * the caller deletes the entry.
+ *
+ * The lock on the entry is held while the locks of the index are acquired.
+ * Nobody acquires them in the opposite order.
+ */
+static void
+SharedPlanCacheRemove(SharedPlanCacheEntry *entry)
+{
+	SharedPlanData *data;
+
+	data = (SharedPlanData *) dsa_get_address(SharedPlanCacheArea,
+											  entry->data);
+	SharedPlanDepRemoveAll(data, &entry->key, data->nrels + data->nitems);
+
+	dsa_free(SharedPlanCacheArea, entry->data);
+	pg_atomic_sub_fetch_u64(&SharedPlanCache->used, entry->size);
+}
+
+/*
+ * How does an invalidation message affect cached plans?  For messages whose
+ * plans can be found in the dependency index, return the index key.  This
+ * follows the plancache.c callbacks that invalidate the plans of a backend,
+ * as does SharedPlanInvalidatedBy().
+ */
+static SharedPlanInvalKind
+SharedPlanInvalKindOf(const SharedInvalidationMessage *msg,
+					  SharedPlanDepKey *depkey)
+{
+	if (msg->id >= 0)
+	{
+		switch (msg->cc.id)
+		{
+			case PROCOID:
+			case TYPEOID:
+				if (msg->cc.hashValue == 0)
+					return SHARED_PLAN_INVAL_SCAN;
+				depkey->cacheId = msg->cc.id;
+				depkey->hashValue = msg->cc.hashValue;
+				return SHARED_PLAN_INVAL_INDEXED;
+
+			case NAMESPACEOID:
+			case OPEROID:
+			case AMOPOPID:
+			case FOREIGNSERVEROID:
+			case FOREIGNDATAWRAPPEROID:
+				/* see PlanCacheSysCallback() */
+				return SHARED_PLAN_INVAL_SCAN;
+
+			default:
+				return SHARED_PLAN_INVAL_NONE;
+		}
+	}
+	else if (msg->id == SHAREDINVALCATALOG_ID)
+	{
+		return SHARED_PLAN_INVAL_SCAN;
+	}
+	else if (msg->id == SHAREDINVALRELCACHE_ID)
+	{
+		if (!OidIsValid(msg->rc.relId))
+			return SHARED_PLAN_INVAL_SCAN;
+		depkey->cacheId = SHARED_PLAN_DEP_RELATION;
+		depkey->hashValue = msg->rc.relId;
+		return SHARED_PLAN_INVAL_INDEXED;
+	}
+
+	return SHARED_PLAN_INVAL_NONE;
+}
+
+/*
+ * Does an invalidation message outdate a cached plan?  This follows the
+ * plancache.c callbacks that invalidate the plans of a backend.
+ */
+static bool
+SharedPlanInvalidatedBy(SharedPlanCacheEntry *entry,
+						const SharedInvalidationMessage *msg)
+{
+	SharedPlanData *data;
+	int			i;
+
+	data = (SharedPlanData *) dsa_get_address(SharedPlanCacheArea,
+											  entry->data);
+
+	if (msg->id >= 0)
+	{
+		SharedPlanInvalItem *items = SharedPlanInvalItems(data);
+
+		if (OidIsValid(msg->cc.dbId) && msg->cc.dbId != entry->key.dbId)
+			return false;
+
+		switch (msg->cc.id)
+		{
+			case PROCOID:
+			case TYPEOID:
+				for (i = 0; i < data->nitems; i++)
+				{
+					if (items[i].cacheId == msg->cc.id &&
+						(msg->cc.hashValue == 0 ||
+						 items[i].hashValue == msg->cc.hashValue))
+						return true;
+				}
+				return false;
+
+			case NAMESPACEOID:
+			case OPEROID:
+			case AMOPOPID:
+			case FOREIGNSERVEROID:
+			case FOREIGNDATAWRAPPEROID:
+				/* see PlanCacheSysCallback() */
+				return true;
+
+			default:
+				return false;
+		}
+	}
+	else if (msg->id == SHAREDINVALCATALOG_ID)
+	{
+		return !OidIsValid(msg->cat.dbId) || msg->cat.dbId == entry->key.dbId;
+	}
+	else if (msg->id == SHAREDINVALRELCACHE_ID)
+	{
+		Oid		   *rels = SharedPlanRelations(data);
+
+		if (OidIsValid(msg->rc.dbId) && msg->rc.dbId != entry->key.dbId)
+			return false;
+		if (!OidIsValid(msg->rc.relId))
+			return true;
+		for (i = 0; i < data->nrels; i++)
+		{
+			if (rels[i] == msg->rc.relId)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Remove the cached plans that an invalidation message outdates, looking
+ * them up in the dependency index.
+ */
+static void
+SharedPlanInvalidateIndexed(const SharedInvalidationMessage *msg,
+							const SharedPlanDepKey *depkey)
+{
+	SharedPlanDepEntry *dep;
+	SharedPlanCacheKey *plans;
+	SharedPlanCacheKey *keys;
+	int			nkeys = 0;
+	int			nplans = 0;
+	Oid			dbId;
+	int			i;
+
+	dbId = (msg->id >= 0) ? msg->cc.dbId : msg->rc.dbId;
+
+	dep = dshash_find(SharedPlanDepHash, depkey, true);
+	if (dep == NULL)
+		return;
+
+	/*
+	 * Take the plans of the message's database out of the index entry.  The
+	 * plans themselves are removed only after we've released the entry,
+	 * since the lock of a plan must be acquired first.
+	 */
+	plans = (SharedPlanCacheKey *) dsa_get_address(SharedPlanCacheArea,
+												   dep->plans);
+	keys = palloc(dep->nplans * sizeof(SharedPlanCacheKey));
+	for (i = 0; i < dep->nplans; i++)
+	{
+		if (!OidIsValid(dbId) || plans[i].dbId == dbId)
+			keys[nkeys++] = plans[i];
+		else
+			plans[nplans++] = plans[i];
+	}
+	dep->nplans = nplans;
+	SharedPlanDepRelease(dep);
+
+	for (i = 0; i < nkeys; i++)
+	{
+		SharedPlanCacheEntry *entry;
+
+		entry = dshash_find(SharedPlanCacheHash, &keys[i], true);
+		if (entry == NULL)
+			continue;
+
+		/* the entry may hold a newer plan with the same key */
+		if (SharedPlanInvalidatedBy(entry, msg))
+		{
+			SharedPlanCacheRemove(entry);
+			dshash_delete_entry(SharedPlanCacheHash, entry);
+		}
+		else
+			dshash_release_lock(SharedPlanCacheHash, entry);
+	}
+
+	pfree(keys);
+}
+
+/*
+ * Remove all cached plans, after an invalidation failed to remove the plans
+ * it outdates.  reset is the value of reset_requested we handle.
+ */
+static void
+SharedPlanCacheReset(uint64 reset)
+{
+	dshash_seq_status status;
+	SharedPlanCacheEntry *entry;
+	uint64		done;
+
+	dshash_seq_init(&status, SharedPlanCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		SharedPlanCacheRemove(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+
+	/* A concurrent reset may have advanced reset_done further already */
+	done = pg_atomic_read_u64(&SharedPlanCache->reset_done);
+	while (done < reset &&
+		   !pg_atomic_compare_exchange_u64(&SharedPlanCache->reset_done,
+										   &done, reset))
+		;
+}
+
+/*
+ * SharedPlanCacheInvalidateBegin
+ *
+ * Mark an invalidation as in progress.  Called by SendSharedInvalidMessages()
+ * before the messages are queued, and must be followed by
+ * SharedPlanCacheInvalidateEnd(), also on error.
+ */
+void
+SharedPlanCacheInvalidateBegin(void)
+{
+	if (SharedPlanCache == NULL)
+		return;
+
+	/* Do what can fail before the invalidation is marked in progress */
+	SharedPlanCacheAttach();
+
+	pg_atomic_fetch_add_u32(&SharedPlanCache->inval_in_progress, 1);
+	pg_atomic_fetch_add_u64(&SharedPlanCache->inval_count, 1);
+}
+
+/*
+ * SharedPlanCacheInvalidate
+ *
+ * Remove the entries that the invalidation messages outdate, once they are
+ * queued.
+ */
+void
+SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	dshash_seq_status status;
+	SharedPlanCacheEntry *entry;
+	SharedPlanDepKey depkey;
+	uint64		reset;
+	bool		scan = false;
+	int			i;
+
+	if (SharedPlanCache == NULL)
+		return;
+
+	/* Empty the cache if an earlier invalidation failed */
+	reset = pg_atomic_read_u64(&SharedPlanCache->reset_requested);
+	if (reset != pg_atomic_read_u64(&SharedPlanCache->reset_done))
+	{
+		SharedPlanCacheReset(reset);
+		return;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		if (SharedPlanInvalKindOf(&msgs[i], &depkey) == SHARED_PLAN_INVAL_SCAN)
+		{
+			scan = true;
+			break;
+		}
+	}
+
+	if (!scan)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (SharedPlanInvalKindOf(&msgs[i], &depkey) ==
+				SHARED_PLAN_INVAL_INDEXED)
+				SharedPlanInvalidateIndexed(&msgs[i], &depkey);
+		}
+		return;
+	}
+
+	dshash_seq_init(&status, SharedPlanCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (SharedPlanInvalidatedBy(entry, &msgs[i]))
+			{
+				SharedPlanCacheRemove(entry);
+				dshash_delete_current(&status);
+				break;
+			}
+		}
+	}
+	dshash_seq_term(&status);
+}
+
+/*
+ * SharedPlanCacheInvalidateEnd
+ *
+ * End the invalidation that SharedPlanCacheInvalidateBegin() started.  If
+ * SharedPlanCacheInvalidate() did not complete, the cached plans stay hidden
+ * until the next invalidation has removed them all.
+ */
+void
+SharedPlanCacheInvalidateEnd(bool removed)
+{
+	if (SharedPlanCache == NULL)
+		return;
+
+	if (!removed)
+		pg_atomic_fetch_add_u64(&SharedPlanCache->reset_requested, 1);
+
+	pg_atomic_fetch_add_u64(&SharedPlanCache->inval_count, 1);
+	pg_atomic_fetch_sub_u32(&SharedPlanCache->inval_in_progress, 1);
+}
+
+/*
+ * SharedPlanCacheDropDatabase
+ *
+ * Remove all entries of a database that is being dropped, so that a new
+ * database reusing its OID doesn't find them.
+ */
+void
+SharedPlanCacheDropDatabase(Oid dbId)
+{
+	dshash_seq_status status;
+	SharedPlanCacheEntry *entry;
+
+	if (SharedPlanCache == NULL)
+		return;
+
+	SharedPlanCacheAttach();
+
+	pg_atomic_fetch_add_u64(&SharedPlanCache->inval_count, 1);
+
+	dshash_seq_init(&status, SharedPlanCacheHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->key.dbId != dbId)
+			continue;
+
+		SharedPlanCacheRemove(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
@@ -561,6 +561,38 @@ InitializeMaxBackends(void)
 		elog(ERROR, "too many backends configured");
 }
 
+/*
+ * Initialize the number of fast-path lock groups per backend.
+ *
+ * We allow enough groups for max_locks_per_transaction fast-path locks,
+ * rounded up to a power of two and capped at FP_LOCK_GROUPS_PER_BACKEND_MAX.
+ * The default of 64 locks yields 4 groups, i.e. 64 slots per backend.
+ *
+ * Like InitializeMaxBackends, this must be called before shared memory size
+ * is determined, and in EXEC_BACKEND builds the value is passed down to
+ * subprocesses via BackendParameters.
+ */
+void
+InitializeFastPathLocks(void)
+{
+	/* Should be initialized only once. */
+	Assert(FastPathLockGroupsPerBackend == 0);
+
+	/* we need at least one group */
+	FastPathLockGroupsPerBackend = 1;
+
+	while (FastPathLockGroupsPerBackend < FP_LOCK_GROUPS_PER_BACKEND_MAX)
+	{
+		/* stop once we exceed max_locks_per_xact */
+		if (FastPathLockSlotsPerBackend() >= max_locks_per_xact)
+			break;
+
+		FastPathLockGroupsPerBackend *= 2;
+	}
+
+	Assert(FastPathLockGroupsPerBackend <= FP_LOCK_GROUPS_PER_BACKEND_MAX);
+}
+
 /*
  * Early initialization of a backend (either standalone or under postmaster).
  * This happens even before InitPostgres.
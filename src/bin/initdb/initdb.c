@@ -213,6 +213,7 @@ static const char *const subdirs[] = {
 	"global",
 	"pg_wal/archive_status",
 	"pg_commit_ts",
+	"pg_csn",
 	"pg_dynshmem",
 	"pg_notify",
 	"pg_serial",
@@ -0,0 +1,19 @@
+-- pgbench script to measure concurrent WAL insertion
+--
+-- Each transaction inserts one row into pgbench_history, so nearly all the
+-- work is reserving and copying WAL records.  To see how throughput scales
+-- with wal_insertion_locks, initialize with "pgbench -i", set
+-- synchronous_commit = off so that waiting for WAL flushes doesn't dominate,
+-- and run for example
+--
+--   pgbench -n -M prepared -f wal_insert.sql -c 64 -j 64 -T 60
+--
+-- after restarting the server with each setting to compare (say 1, 8 and
+-- 128), and with client counts up to the number of CPUs and beyond.
+--
+\set aid random(1, 100000 * :scale)
+\set bid random(1, 1 * :scale)
+\set tid random(1, 10 * :scale)
+\set delta random(-5000, 5000)
+INSERT INTO pgbench_history (tid, bid, aid, delta, mtime)
+  VALUES (:tid, :bid, :aid, :delta, CURRENT_TIMESTAMP);
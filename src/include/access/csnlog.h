@@ -0,0 +1,45 @@
+/*
+ * csnlog.h
+ *
+ * Commit sequence number log manager
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/csnlog.h
+ */
+#ifndef CSNLOG_H
+#define CSNLOG_H
+
+/*
+ * A commit sequence number (CSN) orders transaction commits.  It is the value
+ * of ShmemVariableCache->xactCompletionCount just after the transaction was
+ * removed from the ProcArray, so a snapshot taken with completion count N
+ * sees exactly the transactions with a CSN <= N.
+ */
+typedef uint64 CommitSeqNo;
+
+#define InvalidCommitSeqNo		((CommitSeqNo) 0)	/* not committed (yet) */
+#define CommittingCommitSeqNo	((CommitSeqNo) 1)	/* CSN being assigned */
+#define FirstNormalCommitSeqNo	((CommitSeqNo) 2)
+
+#define CommitSeqNoIsNormal(csn) ((csn) >= FirstNormalCommitSeqNo)
+
+/* GUC variable */
+extern PGDLLIMPORT bool csn_snapshots;
+
+extern void CSNLogSetCommitting(TransactionId xid, int nsubxids,
+								TransactionId *subxids);
+extern void CSNLogSetCommitSeqNo(TransactionId xid, int nsubxids,
+								 TransactionId *subxids, CommitSeqNo csn);
+extern CommitSeqNo CSNLogGetCommitSeqNo(TransactionId xid);
+extern TransactionId CSNLogGetStartXid(void);
+
+extern Size CSNLogShmemSize(void);
+extern void CSNLogShmemInit(void);
+extern void StartupCSNLog(TransactionId oldestActiveXID);
+extern void CheckPointCSNLog(void);
+extern void ExtendCSNLog(TransactionId newestXact);
+extern void TruncateCSNLog(TransactionId oldestXact);
+
+#endif							/* CSNLOG_H */
@@ -12,6 +12,7 @@
 
 #include "access/amapi.h"
 #include "access/gin.h"
+#include "access/gin_tuple.h"
 #include "access/ginblock.h"
 #include "access/itup.h"
 #include "catalog/pg_am_d.h"
@@ -122,6 +123,7 @@ extern void ginEntryInsert(GinState *ginstate,
 						   OffsetNumber attnum, Datum key, GinNullCategory category,
 						   ItemPointerData *items, uint32 nitem,
 						   GinStatsData *buildStats);
+extern int	_gin_compare_tuples(GinTuple *a, GinTuple *b, GinState *ginstate);
 
 /* ginbtree.c */
 
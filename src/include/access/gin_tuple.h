@@ -0,0 +1,59 @@
+/*--------------------------------------------------------------------------
+ * gin_tuple.h
+ *	  Public header file for the GIN tuples passed between the participants
+ *	  of a parallel GIN index build.
+ *
+ *	Copyright (c) 2022, PostgreSQL Global Development Group
+ *
+ *	src/include/access/gin_tuple.h
+ *--------------------------------------------------------------------------
+ */
+#ifndef GIN_TUPLE_H
+#define GIN_TUPLE_H
+
+#include "storage/itemptr.h"
+
+/*
+ * A GinTuple carries one index key together with a sorted list of heap TIDs
+ * for that key.  Workers of a parallel build produce these from their
+ * private BuildAccumulator and feed them to a tuplesort; the leader merges
+ * the sorted stream back into per-key TID lists.
+ *
+ * The key value follows the fixed-size header at a MAXALIGN'd offset, so
+ * that pass-by-reference values can be used in place.  A pass-by-value key
+ * is stored as a whole Datum.  The TIDs follow the key at a SHORTALIGN'd
+ * offset, uncompressed.
+ */
+typedef struct GinTuple
+{
+	int			tuplen;			/* length of the whole tuple */
+	int			keylen;			/* bytes in data for key value */
+	int			nitems;			/* number of TIDs in the data */
+	OffsetNumber attrnum;		/* attnum of index key */
+	int16		typlen;			/* typlen for key */
+	bool		typbyval;		/* typbyval for key */
+	signed char category;		/* category: normal or NULL? */
+} GinTuple;
+
+#define SizeOfGinTupleHeader	MAXALIGN(sizeof(GinTuple))
+
+static inline char *
+GinTupleGetKeyData(GinTuple *tup)
+{
+	return (char *) tup + SizeOfGinTupleHeader;
+}
+
+static inline ItemPointer
+GinTupleGetItems(GinTuple *tup)
+{
+	return (ItemPointer) (GinTupleGetKeyData(tup) + SHORTALIGN(tup->keylen));
+}
+
+static inline ItemPointer
+GinTupleGetFirst(GinTuple *tup)
+{
+	Assert(tup->nitems > 0);
+	return GinTupleGetItems(tup);
+}
+
+#endif							/* GIN_TUPLE_H */
@@ -22,6 +22,7 @@
 #include "access/tableam.h"
 #include "nodes/lockoptions.h"
 #include "nodes/primnodes.h"
+#include "storage/bufmgr.h"
 #include "storage/bufpage.h"
 #include "storage/dsm.h"
 #include "storage/lockdefs.h"
@@ -65,6 +66,16 @@ typedef struct HeapScanDescData
 
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
+	/*
+	 * Streaming read used to fetch pages ahead of the scan, or NULL if pages
+	 * are read one at a time.  rs_dir is the direction the stream is reading
+	 * in, and rs_prefetch_block the last block it was handed (or
+	 * InvalidBlockNumber to start over at the beginning of the scan).
+	 */
+	StreamingRead *rs_stream;
+	ScanDirection rs_dir;
+	BlockNumber rs_prefetch_block;
+
 	/*
 	 * For parallel scans to store page allocation data.  NULL when not
 	 * performing a parallel scan.
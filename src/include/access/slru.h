@@ -14,9 +14,15 @@
 #define SLRU_H
 
 #include "access/xlogdefs.h"
+#include "port/atomics.h"
 #include "storage/lwlock.h"
 #include "storage/sync.h"
 
+/*
+ * To avoid overflowing internal arithmetic and the size_t data type, the
+ * number of buffers must not exceed this number.
+ */
+#define SLRU_MAX_ALLOWED_BUFFERS ((1024 * 1024 * 1024) / BLCKSZ)
 
 /*
  * Define SLRU segment size.  A page is the same BLCKSZ as is used everywhere
@@ -33,6 +39,16 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * The buffer slots of an SLRU are divided into banks of SLRU_BANK_SIZE
+ * slots each.  A given page can only ever live in one bank, chosen from its
+ * page number, and each bank has its own lock.  Looking up a page or picking
+ * a victim buffer therefore only needs to scan one bank, which keeps those
+ * operations cheap however large the SLRU is, and lookups of pages in
+ * different banks don't contend with each other.
+ */
+#define SLRU_BANK_SIZE			16
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be true only in the VALID or WRITE_IN_PROGRESS states;
@@ -52,8 +68,6 @@ typedef enum
  */
 typedef struct SlruSharedData
 {
-	LWLock	   *ControlLock;
-
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
@@ -66,8 +80,16 @@ typedef struct SlruSharedData
 	bool	   *page_dirty;
 	int		   *page_number;
 	int		   *page_lru_count;
+
+	/* Per-buffer locks, protecting the I/O on each buffer slot */
 	LWLockPadded *buffer_locks;
 
+	/*
+	 * Per-bank locks, protecting the shared state of the buffer slots in each
+	 * bank.  See SimpleLruGetBankLock().
+	 */
+	LWLockPadded *bank_locks;
+
 	/*
 	 * Optional array of WAL flush LSNs associated with entries in the SLRU
 	 * pages.  If not zero/NULL, we must flush WAL before writing pages (true
@@ -80,22 +102,26 @@ typedef struct SlruSharedData
 	int			lsn_groups_per_page;
 
 	/*----------
+	 * Instead of a global counter, we keep an LRU counter per bank, so that
+	 * processes working in different banks don't bounce the same cache line.
 	 * We mark a page "most recently used" by setting
-	 *		page_lru_count[slotno] = ++cur_lru_count;
-	 * The oldest page is therefore the one with the highest value of
-	 *		cur_lru_count - page_lru_count[slotno]
+	 *		page_lru_count[slotno] = ++bank_cur_lru_count[bankno];
+	 * The oldest page in the bank is therefore the one with the highest value
+	 * of
+	 *		bank_cur_lru_count[bankno] - page_lru_count[slotno]
 	 * The counts will eventually wrap around, but this calculation still
 	 * works as long as no page's age exceeds INT_MAX counts.
 	 *----------
 	 */
-	int			cur_lru_count;
+	int		   *bank_cur_lru_count;
 
 	/*
 	 * latest_page_number is the page number of the current end of the log;
 	 * this is not critical data, since we use it only to avoid swapping out
-	 * the latest page.
+	 * the latest page.  It is updated and read without holding any of the
+	 * bank locks, hence atomic.
 	 */
-	int			latest_page_number;
+	pg_atomic_uint32 latest_page_number;
 
 	/* SLRU's index for statistics purposes (might not be unique) */
 	int			slru_stats_idx;
@@ -111,6 +137,9 @@ typedef struct SlruCtlData
 {
 	SlruShared	shared;
 
+	/* Number of banks in this SLRU. */
+	uint16		nbanks;
+
 	/*
 	 * Which sync handler function to use when handing sync requests over to
 	 * the checkpointer.  SYNC_HANDLER_NONE to disable fsync (eg pg_notify).
@@ -138,11 +167,26 @@ typedef struct SlruCtlData
 
 typedef SlruCtlData *SlruCtl;
 
+/*
+ * Get the SLRU bank lock for given SlruCtl and the pageno.
+ *
+ * This lock needs to be acquired to access the slru buffer slots in the
+ * respective bank.
+ */
+static inline LWLock *
+SimpleLruGetBankLock(SlruCtl ctl, int pageno)
+{
+	int			bankno;
+
+	bankno = pageno % ctl->nbanks;
+	return &(ctl->shared->bank_locks[bankno].lock);
+}
 
 extern Size SimpleLruShmemSize(int nslots, int nlsns);
+extern int	SimpleLruAutotuneBuffers(int divisor, int max);
 extern void SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
-						  LWLock *ctllock, const char *subdir, int tranche_id,
-						  SyncRequestHandler sync_handler);
+						  const char *subdir, int buffer_tranche_id,
+						  int bank_tranche_id, SyncRequestHandler sync_handler);
 extern int	SimpleLruZeroPage(SlruCtl ctl, int pageno);
 extern int	SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 							  TransactionId xid);
@@ -170,5 +214,6 @@ extern bool SlruScanDirCbReportPresence(SlruCtl ctl, char *filename,
 										int segpage, void *data);
 extern bool SlruScanDirCbDeleteAll(SlruCtl ctl, char *filename, int segpage,
 								   void *data);
+extern bool check_slru_buffers(const char *name, int *newval);
 
 #endif							/* SLRU_H */
@@ -35,6 +35,7 @@ extern PGDLLIMPORT bool synchronize_seqscans;
 struct BulkInsertStateData;
 struct IndexInfo;
 struct SampleScanState;
+struct StreamingRead;
 struct TBMIterateResult;
 struct VacuumParams;
 struct ValidateIndexState;
@@ -632,25 +633,26 @@ typedef struct TableAmRoutine
 									BufferAccessStrategy bstrategy);
 
 	/*
-	 * Prepare to analyze block `blockno` of `scan`. The scan has been started
-	 * with table_beginscan_analyze().  See also
-	 * table_scan_analyze_next_block().
+	 * Prepare to analyze the next block of `scan`, as returned by the
+	 * streaming read `stream`.  The scan has been started with
+	 * table_beginscan_analyze().  See also table_scan_analyze_next_block().
 	 *
 	 * The callback may acquire resources like locks that are held until
 	 * table_scan_analyze_next_tuple() returns false. It e.g. can make sense
 	 * to hold a lock until all tuples on a block have been analyzed by
 	 * scan_analyze_next_tuple.
 	 *
-	 * The callback can return false if the block is not suitable for
-	 * sampling, e.g. because it's a metapage that could never contain tuples.
+	 * The callback returns false once the stream is exhausted.  A block that
+	 * is not suitable for sampling, e.g. because it's a metapage that could
+	 * never contain tuples, can be skipped by making the following
+	 * scan_analyze_next_tuple call return false right away.
 	 *
 	 * XXX: This obviously is primarily suited for block-based AMs. It's not
 	 * clear what a good interface for non block based AMs would be, so there
 	 * isn't one yet.
 	 */
 	bool		(*scan_analyze_next_block) (TableScanDesc scan,
-											BlockNumber blockno,
-											BufferAccessStrategy bstrategy);
+											struct StreamingRead *stream);
 
 	/*
 	 * See table_scan_analyze_next_tuple().
@@ -1682,19 +1684,18 @@ table_relation_vacuum(Relation rel, struct VacuumParams *params,
 }
 
 /*
- * Prepare to analyze block `blockno` of `scan`. The scan needs to have been
- * started with table_beginscan_analyze().  Note that this routine might
- * acquire resources like locks that are held until
+ * Prepare to analyze the next block of `scan` read by `stream`. The scan
+ * needs to have been started with table_beginscan_analyze().  Note that this
+ * routine might acquire resources like locks that are held until
  * table_scan_analyze_next_tuple() returns false.
  *
- * Returns false if block is unsuitable for sampling, true otherwise.
+ * Returns false if the stream has been exhausted, true otherwise.
  */
 static inline bool
-table_scan_analyze_next_block(TableScanDesc scan, BlockNumber blockno,
-							  BufferAccessStrategy bstrategy)
+table_scan_analyze_next_block(TableScanDesc scan,
+							  struct StreamingRead *stream)
 {
-	return scan->rs_rd->rd_tableam->scan_analyze_next_block(scan, blockno,
-															bstrategy);
+	return scan->rs_rd->rd_tableam->scan_analyze_next_block(scan, stream);
 }
 
 /*
@@ -14,6 +14,7 @@
 #ifndef COPY_H
 #define COPY_H
 
+#include "access/parallel.h"
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_node.h"
@@ -59,6 +60,8 @@ typedef struct CopyFormatOptions
 	bool	   *force_null_flags;	/* per-column CSV FN flags */
 	bool		convert_selectively;	/* do selective binary conversion? */
 	List	   *convert_select; /* list of column names (can be NIL) */
+	int			nworkers;		/* number of parallel workers for COPY FROM,
+								 * 0 to load serially */
 } CopyFormatOptions;
 
 /* These are private in commands/copy[from|to].c */
@@ -83,6 +86,7 @@ extern bool NextCopyFromRawFields(CopyFromState cstate,
 extern void CopyFromErrorCallback(void *arg);
 
 extern uint64 CopyFrom(CopyFromState cstate);
+extern void ParallelCopyFromMain(dsm_segment *seg, shm_toc *toc);
 
 extern DestReceiver *CreateCopyDestReceiver(void);
 
@@ -49,6 +49,9 @@ typedef enum CopyInsertMethod
 	CIM_MULTI_CONDITIONAL		/* use table_multi_insert only if valid */
 } CopyInsertMethod;
 
+/* Private state of a parallel COPY FROM worker, see copyfromparallel.c */
+typedef struct ParallelCopyWorkerState ParallelCopyWorkerState;
+
 /*
  * This struct contains all the state variables used throughout a COPY FROM
  * operation.
@@ -68,6 +71,8 @@ typedef struct CopyFromStateData
 	/* parameters from the COPY command */
 	Relation	rel;			/* relation to copy from */
 	List	   *attnumlist;		/* integer list of attnums to copy */
+	List	   *attnamelist;	/* column name list, as given to BeginCopyFrom */
+	List	   *options;		/* option list, as given to BeginCopyFrom */
 	char	   *filename;		/* filename, or NULL for STDIN */
 	bool		is_program;		/* is 'filename' a program to popen? */
 	copy_data_source_cb data_source_cb; /* function for reading data */
@@ -98,6 +103,9 @@ typedef struct CopyFromStateData
 
 	TransitionCaptureState *transition_capture;
 
+	/* set in parallel COPY FROM workers, NULL otherwise */
+	ParallelCopyWorkerState *pcworker;
+
 	/*
 	 * These variables are used to reduce overhead in COPY FROM.
 	 *
@@ -168,5 +176,11 @@ typedef struct CopyFromStateData
 
 extern void ReceiveCopyBegin(CopyFromState cstate);
 extern void ReceiveCopyBinaryHeader(CopyFromState cstate);
+extern bool NextCopyFromLine(CopyFromState cstate);
+
+/* in copyfromparallel.c */
+extern int	ParallelCopyComputeWorkers(CopyFromState cstate);
+extern uint64 ParallelCopyFrom(CopyFromState cstate, int nworkers);
+extern bool ParallelCopyReadLine(CopyFromState cstate);
 
 #endif							/* COPYFROM_INTERNAL_H */
@@ -0,0 +1,76 @@
+/*-------------------------------------------------------------------------
+ * execBatch.h
+ *		Support for processing tuples a batch at a time
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/executor/execBatch.h
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "access/tableam.h"
+#include "nodes/execnodes.h"
+
+/* Maximum number of tuples in a batch */
+#define EXEC_BATCH_SIZE		1024
+
+/*
+ * Maximum number of distinct buffers the tuples of a batch keep pinned.  With
+ * wide rows, a full batch could otherwise pin one buffer per row, which can
+ * run out of local buffers for temporary tables or starve other scans of
+ * shared buffers.
+ */
+#define EXEC_BATCH_MAX_BUFFERS	8
+
+/*
+ * A batch of tuples fetched from a table scan.
+ *
+ * The columns the batch's consumers need are deformed into arrays of values
+ * and null flags, indexed by row number.  Columns that nobody needs have no
+ * arrays.  The selection vector lists the rows that passed the quals so far,
+ * in ascending order.  Each row's tuple stays in its own slot, which keeps
+ * pass-by-reference values valid until the next batch is fetched.  A batch
+ * holds fewer rows than EXEC_BATCH_SIZE when its tuples would otherwise pin
+ * more than EXEC_BATCH_MAX_BUFFERS buffers.
+ *
+ * The first batch of a scan holds a single row, and each batch may hold
+ * twice as many as the one before, up to EXEC_BATCH_SIZE.  That way, a scan
+ * never reads far ahead of the rows its consumer has asked for, as under
+ * LIMIT or when a cursor fetches a few rows at a time.
+ */
+typedef struct TupleBatch
+{
+	int			nrows;			/* number of rows in the batch */
+	int			nselected;		/* number of entries in selection */
+	int			next;			/* next selected row to return, in row mode */
+	bool		done;			/* has the scan returned its last row? */
+	int			maxrows;		/* maximum number of rows in next batch */
+	int			ncols;			/* number of deformed columns */
+	AttrNumber *attnos;			/* attribute numbers of deformed columns */
+	AttrNumber	maxattno;		/* highest attribute number to deform */
+	Datum	  **values;			/* values[attno - 1][row], or NULL */
+	bool	  **isnull;			/* isnull[attno - 1][row], or NULL */
+	int		   *selection;		/* rows that passed the quals */
+	TupleTableSlot **slots;		/* slots[row] holds the row's tuple */
+} TupleBatch;
+
+/* Quals that can be evaluated a batch at a time; private to execBatch.c */
+typedef struct BatchQual BatchQual;
+
+/* GUC variable */
+extern PGDLLIMPORT bool enable_batch_execution;
+
+extern BatchQual *ExecInitBatchQual(List *qual, Index scanrelid,
+									List **residual, Bitmapset **attnos);
+extern void ExecBatchQual(BatchQual *bqual, TupleBatch *batch);
+extern TupleBatch *ExecInitTupleBatch(EState *estate, Relation rel,
+									  Bitmapset *attnos);
+extern int	ExecFillTupleBatch(TupleBatch *batch, TableScanDesc scandesc);
+extern void ExecClearTupleBatch(TupleBatch *batch);
+
+#endif							/* EXECBATCH_H */
@@ -110,6 +110,25 @@ typedef struct HashSkewBucket
 #define SKEW_HASH_MEM_PERCENT  2
 #define SKEW_MIN_OUTER_FRACTION  0.01
 
+/*
+ * A runtime filter (see HashRuntimeFilter) is only used if no more than this
+ * fraction of its bits ended up set; beyond that, too many tuples without a
+ * join partner would pass it for the filter to pay off.
+ */
+#define RUNTIME_FILTER_MAX_BITS_SET  0.5
+
+/*
+ * When probing a compact hash table, the join reads this many outer tuples
+ * ahead, prefetching the parts of the table they are going to probe.
+ */
+#define HJ_PREFETCH_DISTANCE  16
+
+#ifdef __GNUC__
+#define hj_prefetch(addr)	__builtin_prefetch(addr)
+#else
+#define hj_prefetch(addr)	((void) 0)
+#endif
+
 /*
  * To reduce palloc overhead, the HashJoinTuples for the current batch are
  * packed in 32kB buffers instead of pallocing each tuple individually.
@@ -299,6 +318,16 @@ typedef struct HashJoinTableData
 		dsa_pointer_atomic *shared;
 	}			buckets;
 
+	/*
+	 * Compact copy of the unshared buckets, for probing, see
+	 * ExecHashTableCompact().  The hash values and tuples of bucket i are at
+	 * positions compact_starts[i] up to compact_starts[i + 1] of the other
+	 * two arrays.  NULL if not built; the linked lists stay valid either way.
+	 */
+	uint32	   *compact_starts;
+	uint32	   *compact_hashvalues;
+	struct HashJoinTupleData **compact_tuples;
+
 	bool		keepNulls;		/* true to store unmatchable NULL tuples */
 
 	bool		skewEnabled;	/* are we using skew optimization? */
@@ -16,6 +16,10 @@
 
 #include "access/parallel.h"
 #include "nodes/execnodes.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
+#include "storage/sharedfileset.h"
+#include "utils/sharedtuplestore.h"
 
 
 /*
@@ -321,6 +325,41 @@ typedef struct AggStatePerHashData
 	Agg		   *aggnode;		/* original Agg node, for numGroups etc. */
 }			AggStatePerHashData;
 
+/*
+ * ParallelAggState - shared state for a Parallel Finalize HashAggregate
+ *
+ * Each participant hashes the partial aggregate states it reads from its
+ * outer plan and writes them to one of npartitions shared tuplestores, chosen
+ * by the high bits of the hash.  Once all participants have finished, each
+ * one repeatedly claims a whole partition and finalizes the groups in it
+ * privately, so the groups emitted by different participants are disjoint.
+ *
+ * This is stored in the DSM segment, followed by npartitions SharedTuplestore
+ * objects (see ParallelAggPartition).
+ */
+typedef struct ParallelAggState
+{
+	Barrier		barrier;		/* synchronization for the phases below */
+	pg_atomic_uint32 next_partition;	/* next partition to be finalized */
+	int			nparticipants;	/* number of participants planned */
+	int			npartitions;	/* number of partitions, a power of 2 */
+	SharedFileSet fileset;		/* space for partition files */
+} ParallelAggState;
+
+/* The phases of a Parallel Finalize HashAggregate, used by barrier. */
+#define PAGG_PHASE_PARTITIONING		0
+#define PAGG_PHASE_FINALIZING		1
+
+#define ParallelAggPartitionSize(nparticipants) \
+	MAXALIGN(sts_estimate(nparticipants))
+#define ParallelAggStateSize(nparticipants, npartitions) \
+	(MAXALIGN(sizeof(ParallelAggState)) + \
+	 (npartitions) * ParallelAggPartitionSize(nparticipants))
+#define ParallelAggPartition(pstate, n) \
+	((SharedTuplestore *) \
+	 ((char *) (pstate) + MAXALIGN(sizeof(ParallelAggState)) + \
+	  (n) * ParallelAggPartitionSize((pstate)->nparticipants)))
+
 
 extern AggState *ExecInitAgg(Agg *node, EState *estate, int eflags);
 extern void ExecEndAgg(AggState *node);
@@ -331,10 +370,12 @@ extern Size hash_agg_entry_size(int numTrans, Size tupleWidth,
 extern void hash_agg_set_limits(double hashentrysize, double input_groups,
 								int used_bits, Size *mem_limit,
 								uint64 *ngroups_limit, int *num_partitions);
+extern int	hash_agg_parallel_num_partitions(int nparticipants);
 
-/* parallel instrumentation support */
+/* parallel partitioning and instrumentation support */
 extern void ExecAggEstimate(AggState *node, ParallelContext *pcxt);
 extern void ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt);
+extern void ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt);
 extern void ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt);
 extern void ExecAggRetrieveInstrumentation(AggState *node);
 
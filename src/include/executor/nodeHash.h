@@ -19,10 +19,16 @@
 
 struct SharedHashJoinBatch;
 
+/* GUC variable */
+extern PGDLLIMPORT bool enable_hashjoin_prefetch;
+
 extern HashState *ExecInitHash(Hash *node, EState *estate, int eflags);
 extern Node *MultiExecHash(HashState *node);
 extern void ExecEndHash(HashState *node);
 extern void ExecReScanHash(HashState *node);
+extern void ExecHashRuntimeFilterReset(HashState *node);
+extern bool ExecHashRuntimeFilterTest(HashRuntimeFilter *filter,
+									  ExprContext *econtext);
 
 extern HashJoinTable ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 										 bool keepNulls);
@@ -59,6 +65,7 @@ extern void ExecPrepHashTableForUnmatched(HashJoinState *hjstate);
 extern bool ExecScanHashTableForUnmatched(HashJoinState *hjstate,
 										  ExprContext *econtext);
 extern void ExecHashTableReset(HashJoinTable hashtable);
+extern void ExecHashTableCompact(HashJoinTable hashtable);
 extern void ExecHashTableResetMatchFlags(HashJoinTable hashtable);
 extern void ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 									bool try_combined_hash_mem,
@@ -18,6 +18,9 @@
 #include "nodes/execnodes.h"
 #include "storage/buffile.h"
 
+/* GUC variable */
+extern PGDLLIMPORT bool enable_hashjoin_runtime_filter;
+
 extern HashJoinState *ExecInitHashJoin(HashJoin *node, EState *estate, int eflags);
 extern void ExecEndHashJoin(HashJoinState *node);
 extern void ExecReScanHashJoin(HashJoinState *node);
@@ -53,6 +53,12 @@ typedef struct LLVMJitContext
 
 	/* list of handles for code emitted via Orc */
 	List	   *handles;
+
+	/* may the code be cached, and used by later contexts? */
+	bool		cache;
+
+	/* modules in the JIT code cache whose code this context uses */
+	List	   *cached_modules;
 } LLVMJitContext;
 
 /* llvm module containing information about types */
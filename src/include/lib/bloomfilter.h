@@ -17,7 +17,10 @@ typedef struct bloom_filter bloom_filter;
 
 extern bloom_filter *bloom_create(int64 total_elems, int bloom_work_mem,
 								  uint64 seed);
+extern bloom_filter *bloom_create_sized(int64 total_elems,
+										uint64 bitset_bytes, uint64 seed);
 extern void bloom_free(bloom_filter *filter);
+extern void bloom_reset(bloom_filter *filter);
 extern void bloom_add_element(bloom_filter *filter, unsigned char *elem,
 							  size_t len);
 extern bool bloom_lacks_element(bloom_filter *filter, unsigned char *elem,
@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * radixtree.h
+ *	  Adaptive radix tree mapping 64-bit integer keys to 64-bit values,
+ *	  in backend-local memory or in a DSA area.
+ *
+ * Portions Copyright (c) 2022, PostgreSQL Global Development Group
+ *
+ * src/include/lib/radixtree.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef RADIXTREE_H
+#define RADIXTREE_H
+
+#include "utils/dsa.h"
+
+typedef struct radix_tree radix_tree;
+typedef struct rt_iter rt_iter;
+
+/* A handle that can be passed to another backend to attach to a tree */
+typedef dsa_pointer rt_handle;
+
+extern radix_tree *rt_create(MemoryContext ctx, dsa_area *dsa);
+extern void rt_free(radix_tree *tree);
+
+extern bool rt_search(radix_tree *tree, uint64 key, uint64 *val_p);
+extern bool rt_set(radix_tree *tree, uint64 key, uint64 val);
+extern bool rt_delete(radix_tree *tree, uint64 key);
+
+extern rt_iter *rt_begin_iterate(radix_tree *tree);
+extern bool rt_iterate_next(rt_iter *iter, uint64 *key_p, uint64 *val_p);
+extern void rt_end_iterate(rt_iter *iter);
+
+extern uint64 rt_num_entries(radix_tree *tree);
+extern uint64 rt_memory_usage(radix_tree *tree);
+
+extern rt_handle rt_get_handle(radix_tree *tree);
+extern radix_tree *rt_attach(dsa_area *dsa, rt_handle handle);
+extern void rt_detach(radix_tree *tree);
+
+#endif							/* RADIXTREE_H */
@@ -112,6 +112,13 @@ typedef struct ExprState
 	/* private state for an evalfunc */
 	void	   *evalfunc_private;
 
+	/*
+	 * Pointers that a JIT compiled evalfunc loads at runtime, instead of
+	 * having them embedded in its code, or NULL.
+	 */
+#define FIELDNO_EXPRSTATE_EVALFUNC_PTRS 9
+	void	  **evalfunc_ptrs;
+
 	/*
 	 * XXX: following fields only needed during "compilation" (ExecInitExpr);
 	 * could be thrown away afterwards.
@@ -120,7 +127,7 @@ typedef struct ExprState
 	int			steps_len;		/* number of steps currently */
 	int			steps_alloc;	/* allocated length of steps array */
 
-#define FIELDNO_EXPRSTATE_PARENT 11
+#define FIELDNO_EXPRSTATE_PARENT 12
 	struct PlanState *parent;	/* parent PlanState node, if any */
 	ParamListInfo ext_params;	/* for compiling PARAM_EXTERN nodes */
 
@@ -1126,6 +1133,11 @@ typedef struct PlanState
 		if (((PlanState *)(node))->instrument) \
 			((PlanState *)(node))->instrument->nfiltered2 += (delta); \
 	} while(0)
+#define InstrCountFiltered3(node, delta) \
+	do { \
+		if (((PlanState *)(node))->instrument) \
+			((PlanState *)(node))->instrument->nfiltered3 += (delta); \
+	} while(0)
 
 /*
  * EPQState is state for executing an EvalPlanQual recheck on a candidate
@@ -1441,6 +1453,8 @@ typedef struct ScanState
 	Relation	ss_currentRelation;
 	struct TableScanDescData *ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	struct HashRuntimeFilter *ss_RuntimeFilter; /* pushed down by a hash
+												 * join, or NULL */
 } ScanState;
 
 /* ----------------
@@ -1451,6 +1465,14 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+
+	/* these fields are used in batch mode, see execBatch.c */
+	bool		batch_capable;	/* can the scan run in batch mode? */
+	bool		batch_mode;		/* does it? */
+	struct BatchQual *batchqual;	/* quals evaluated a batch at a time */
+	ExprState  *batch_residual; /* other quals, evaluated for each row */
+	Bitmapset  *batch_attnos;	/* columns to deform into the batch */
+	struct TupleBatch *batch;	/* current batch, or NULL if none yet */
 } SeqScanState;
 
 /* ----------------
@@ -2047,6 +2069,7 @@ typedef struct MergeJoinState
  *		hj_CurSkewBucketNo		skew bucket# for current outer tuple
  *		hj_CurTuple				last inner tuple matched to current outer
  *								tuple, or NULL if starting search
+ *		hj_CurTupleIndex		position of hj_CurTuple in a compact table
  *								(hj_CurXXX variables are undefined if
  *								OuterTupleSlot is empty!)
  *		hj_OuterTupleSlot		tuple slot for outer tuples
@@ -2057,6 +2080,11 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_PrefetchSlots		ring of outer tuples read ahead, or NULL
+ *		hj_PrefetchHashValues	hash values of the tuples in the ring
+ *		hj_PrefetchHead			position of the oldest tuple in the ring
+ *		hj_PrefetchCount		number of tuples in the ring
+ *		hj_PrefetchDone			true if outer plan has returned its last tuple
  * ----------------
  */
 
@@ -2076,6 +2104,7 @@ typedef struct HashJoinState
 	int			hj_CurBucketNo;
 	int			hj_CurSkewBucketNo;
 	HashJoinTuple hj_CurTuple;
+	uint32		hj_CurTupleIndex;
 	TupleTableSlot *hj_OuterTupleSlot;
 	TupleTableSlot *hj_HashTupleSlot;
 	TupleTableSlot *hj_NullOuterTupleSlot;
@@ -2084,6 +2113,11 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	TupleTableSlot **hj_PrefetchSlots;
+	uint32	   *hj_PrefetchHashValues;
+	int			hj_PrefetchHead;
+	int			hj_PrefetchCount;
+	bool		hj_PrefetchDone;
 } HashJoinState;
 
 
@@ -2413,6 +2447,12 @@ typedef struct AggState
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
 	SharedAggInfo *shared_info; /* one entry per worker */
+	/* these fields are used by Parallel Finalize HashAggregate: */
+	struct ParallelAggState *parallel_state;	/* shared state, or NULL */
+	SharedTuplestoreAccessor **partition_accessors; /* one per partition */
+	int			partition_bits; /* log2 of number of partitions */
+	/* input column of each transition function, for batch mode: */
+	AttrNumber *batch_attnos;	/* 0 if no input; NULL if not in batch mode */
 } AggState;
 
 /* ----------------
@@ -2616,6 +2656,33 @@ typedef struct SharedHashInfo
 	HashInstrumentation hinstrument[FLEXIBLE_ARRAY_MEMBER];
 } SharedHashInfo;
 
+/* ----------------
+ *	 HashRuntimeFilter information
+ *
+ *		A Bloom filter over the hash values of the tuples put into a hash
+ *		join's hash table.  The join pushes it down into the scan of its
+ *		outer side, which computes the same hash value for each tuple it
+ *		fetches and discards those that cannot have a join partner.  That
+ *		happens before the scan evaluates its quals only if the hash
+ *		functions are leakproof, since the quals may include security
+ *		barrier quals.  The filter is only active while a complete hash
+ *		table exists; its memory is kept for rebuilding it on rescan.
+ * ----------------
+ */
+typedef struct HashRuntimeFilter
+{
+	struct bloom_filter *bloom; /* filter, or NULL if not built yet */
+	Size		bloom_size;		/* size of its bitset in bytes */
+	bool		active;			/* does bloom hold the current hash table? */
+	bool		before_quals;	/* apply it before the scan's quals? */
+	int			nkeys;			/* number of hash keys */
+	AttrNumber *attnos;			/* scan column of each outer hash key */
+	AttrNumber	maxattno;		/* highest of attnos */
+	FmgrInfo   *hashfunctions;	/* outer hash function of each key */
+	Oid		   *collations;		/* collation of each key */
+	bool	   *hashStrict;		/* is each hash join operator strict? */
+} HashRuntimeFilter;
+
 /* ----------------
  *	 HashState information
  * ----------------
@@ -2643,6 +2710,9 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Runtime filter to build along with the hash table, or NULL */
+	HashRuntimeFilter *runtime_filter;
 } HashState;
 
 /* ----------------
@@ -67,6 +67,7 @@ extern PGDLLIMPORT bool enable_partitionwise_join;
 extern PGDLLIMPORT bool enable_partitionwise_aggregate;
 extern PGDLLIMPORT bool enable_parallel_append;
 extern PGDLLIMPORT bool enable_parallel_hash;
+extern PGDLLIMPORT bool enable_parallel_hashagg;
 extern PGDLLIMPORT bool enable_partition_pruning;
 extern PGDLLIMPORT bool enable_async_append;
 extern PGDLLIMPORT int constraint_exclusion;
@@ -131,6 +132,12 @@ extern void cost_agg(Path *path, PlannerInfo *root,
 					 List *quals,
 					 Cost input_startup_cost, Cost input_total_cost,
 					 double input_tuples, double input_width);
+extern void cost_parallel_hashagg(Path *path, PlannerInfo *root,
+								  const AggClauseCosts *aggcosts,
+								  int numGroupCols, double numGroups,
+								  List *quals,
+								  Cost input_startup_cost, Cost input_total_cost,
+								  double input_tuples, double input_width);
 extern void cost_windowagg(Path *path, PlannerInfo *root,
 						   List *windowFuncs, int numPartCols, int numOrderCols,
 						   Cost input_startup_cost, Cost input_total_cost,
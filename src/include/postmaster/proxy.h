@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.h
+ *	  Exports from postmaster/proxy.c.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/proxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _PROXY_H
+#define _PROXY_H
+
+/* Upper limit for connection_proxies */
+#define MAX_CONNECTION_PROXIES	64
+
+/*
+ * Transaction status that a pooled backend reports in ReadyForQuery in
+ * place of 'I', when its session holds state that keeps it bound to the
+ * current client.  The proxy turns it back into 'I' for the client.
+ */
+#define PROXY_PINNED_STATUS		'P'
+
+/* GUC options */
+extern PGDLLIMPORT int ConnectionProxies;
+extern PGDLLIMPORT int ProxyPortNumber;
+extern PGDLLIMPORT int SessionPoolSize;
+
+/* Is this backend serving the sessions of a connection proxy? */
+extern PGDLLIMPORT bool ProxyPooledBackend;
+
+extern void ProxyCreateHandoverSockets(void);
+extern void ProxyClosePostmasterSockets(void);
+extern int	ProxyStart(int id);
+
+extern void ProxyHandOverClient(void);
+extern bool ProxySessionIsPinned(void);
+
+#endif							/* _PROXY_H */
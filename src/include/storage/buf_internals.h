@@ -15,6 +15,7 @@
 #ifndef BUFMGR_INTERNALS_H
 #define BUFMGR_INTERNALS_H
 
+#include "pgstat.h"
 #include "port/atomics.h"
 #include "storage/buf.h"
 #include "storage/bufmgr.h"
@@ -243,6 +244,7 @@ typedef struct PendingWriteback
 {
 	/* could store different types of pending flushes here */
 	BufferTag	tag;
+	int			nblocks;		/* number of consecutive blocks from tag */
 } PendingWriteback;
 
 /* struct forward declared in bufmgr.h */
@@ -254,6 +256,9 @@ typedef struct WritebackContext
 	/* current number of pending writeback requests */
 	int			nr_pending;
 
+	/* total number of blocks covered by the pending requests */
+	int			nr_pending_blocks;
+
 	/* pending requests */
 	PendingWriteback pending_writebacks[WRITEBACK_MAX_PENDING_FLUSHES];
 } WritebackContext;
@@ -342,14 +347,16 @@ extern PGDLLIMPORT CkptSortItem *CkptBufferIds;
 /* bufmgr.c */
 extern void WritebackContextInit(WritebackContext *context, int *max_pending);
 extern void IssuePendingWritebacks(WritebackContext *context);
-extern void ScheduleBufferTagForWriteback(WritebackContext *context, BufferTag *tag);
+extern void ScheduleBufferTagForWriteback(WritebackContext *context,
+										  BufferTag *tag, int nblocks);
 
 /* freelist.c */
 extern BufferDesc *StrategyGetBuffer(BufferAccessStrategy strategy,
-									 uint32 *buf_state);
+									 uint32 *buf_state, bool *from_ring);
 extern void StrategyFreeBuffer(BufferDesc *buf);
+extern IOContext IOContextForStrategy(BufferAccessStrategy strategy);
 extern bool StrategyRejectBuffer(BufferAccessStrategy strategy,
-								 BufferDesc *buf);
+								 BufferDesc *buf, bool from_ring);
 
 extern int	StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc);
 extern void StrategyNotifyBgWriter(int bgwprocno);
@@ -14,6 +14,7 @@
 #ifndef BUFMGR_H
 #define BUFMGR_H
 
+#include "port/pg_iovec.h"
 #include "storage/block.h"
 #include "storage/buf.h"
 #include "storage/bufpage.h"
@@ -55,6 +56,21 @@ typedef struct PrefetchBufferResult
 	bool		initiated_io;	/* If true, a miss resulting in async I/O */
 } PrefetchBufferResult;
 
+/*
+ * Streaming reads; see StreamingReadBegin().
+ *
+ * The callback returns the next block number to read, or InvalidBlockNumber
+ * at the end of the stream.
+ */
+typedef struct StreamingRead StreamingRead;
+
+typedef BlockNumber (*StreamingReadBlockCB) (void *callback_private_data,
+											 void *per_buffer_data);
+
+/* Flags for StreamingReadBegin() */
+#define STREAMING_READ_DEFAULT		0x00
+#define STREAMING_READ_MAINTENANCE	0x01	/* use maintenance_io_concurrency */
+
 /* forward declared, to avoid having to expose buf_internals.h here */
 struct WritebackContext;
 
@@ -71,6 +87,7 @@ extern PGDLLIMPORT double bgwriter_lru_multiplier;
 extern PGDLLIMPORT bool track_io_timing;
 extern PGDLLIMPORT int effective_io_concurrency;
 extern PGDLLIMPORT int maintenance_io_concurrency;
+extern PGDLLIMPORT int io_combine_limit;
 
 extern PGDLLIMPORT int checkpoint_flush_after;
 extern PGDLLIMPORT int backend_flush_after;
@@ -87,6 +104,10 @@ extern PGDLLIMPORT int32 *LocalRefCount;
 /* upper limit for effective_io_concurrency */
 #define MAX_IO_CONCURRENCY 1000
 
+/* upper limit and default for io_combine_limit */
+#define MAX_IO_COMBINE_LIMIT PG_IOV_MAX
+#define DEFAULT_IO_COMBINE_LIMIT Min(MAX_IO_COMBINE_LIMIT, (128 * 1024) / BLCKSZ)
+
 /* special block number for ReadBuffer() */
 #define P_NEW	InvalidBlockNumber	/* grow the file to get a new page */
 
@@ -116,6 +137,16 @@ extern Buffer ReadBufferWithoutRelcache(RelFileLocator rlocator,
 										ForkNumber forkNum, BlockNumber blockNum,
 										ReadBufferMode mode, BufferAccessStrategy strategy,
 										bool permanent);
+extern StreamingRead *StreamingReadBegin(Relation rel, ForkNumber forknum,
+										 BufferAccessStrategy strategy,
+										 int flags,
+										 StreamingReadBlockCB callback,
+										 void *callback_private_data,
+										 size_t per_buffer_data_size);
+extern Buffer StreamingReadNextBuffer(StreamingRead *stream,
+									  void **per_buffer_data);
+extern void StreamingReadReset(StreamingRead *stream);
+extern void StreamingReadEnd(StreamingRead *stream);
 extern void ReleaseBuffer(Buffer buffer);
 extern void UnlockReleaseBuffer(Buffer buffer);
 extern void MarkBufferDirty(Buffer buffer);
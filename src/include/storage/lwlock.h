@@ -173,6 +173,7 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_MULTIXACTMEMBER_BUFFER,
 	LWTRANCHE_NOTIFY_BUFFER,
 	LWTRANCHE_SERIAL_BUFFER,
+	LWTRANCHE_CSN_LOG_BUFFER,
 	LWTRANCHE_WAL_INSERT,
 	LWTRANCHE_BUFFER_CONTENT,
 	LWTRANCHE_REPLICATION_ORIGIN_STATE,
@@ -193,6 +194,20 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_PGSTATS_DSA,
 	LWTRANCHE_PGSTATS_HASH,
 	LWTRANCHE_PGSTATS_DATA,
+	LWTRANCHE_PARALLEL_VACUUM_DSA,
+	LWTRANCHE_XACT_SLRU,
+	LWTRANCHE_COMMITTS_SLRU,
+	LWTRANCHE_SUBTRANS_SLRU,
+	LWTRANCHE_MULTIXACTOFFSET_SLRU,
+	LWTRANCHE_MULTIXACTMEMBER_SLRU,
+	LWTRANCHE_NOTIFY_SLRU,
+	LWTRANCHE_SERIAL_SLRU,
+	LWTRANCHE_CSN_LOG_SLRU,
+	LWTRANCHE_SHARED_CATCACHE_DSA,
+	LWTRANCHE_SHARED_CATCACHE_HASH,
+	LWTRANCHE_SHARED_PLANCACHE_DSA,
+	LWTRANCHE_SHARED_PLANCACHE_HASH,
+	LWTRANCHE_SHARED_PLANCACHE_DEPS,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
@@ -75,12 +75,24 @@ struct XidCache
 #define		PROC_XMIN_FLAGS (PROC_IN_VACUUM | PROC_IN_SAFE_IC)
 
 /*
- * We allow a small number of "weak" relation locks (AccessShareLock,
+ * We allow a limited number of "weak" relation locks (AccessShareLock,
  * RowShareLock, RowExclusiveLock) to be recorded in the PGPROC structure
- * rather than the main lock table.  This eases contention on the lock
- * manager LWLocks.  See storage/lmgr/README for additional details.
+ * (or rather in shared memory referenced from PGPROC) rather than the main
+ * lock table.  This eases contention on the lock manager LWLocks.  See
+ * storage/lmgr/README for additional details.
+ *
+ * The slots are divided into groups of FP_LOCK_SLOTS_PER_GROUP, so that the
+ * lock modes of one group fit into a single uint64.  A relation can only use
+ * slots of the group its OID maps to, see FAST_PATH_REL_GROUP in lock.c.
+ * The number of groups is determined at startup from
+ * max_locks_per_transaction, see InitializeFastPathLocks.
  */
-#define		FP_LOCK_SLOTS_PER_BACKEND 16
+extern PGDLLIMPORT int FastPathLockGroupsPerBackend;
+
+#define		FP_LOCK_GROUPS_PER_BACKEND_MAX	1024
+#define		FP_LOCK_SLOTS_PER_GROUP		16	/* don't change */
+#define		FastPathLockSlotsPerBackend() \
+	(FP_LOCK_SLOTS_PER_GROUP * FastPathLockGroupsPerBackend)
 
 /*
  * An invalid pgprocno.  Must be larger than the maximum number of PGPROC
@@ -267,6 +279,13 @@ struct PGPROC
 	 */
 	TransactionId procArrayGroupMemberXid;
 
+	/*
+	 * CSN assigned when the transaction was removed from the ProcArray, see
+	 * csnlog.c.  Set while holding ProcArrayLock exclusively, possibly by the
+	 * group XID clearing leader.
+	 */
+	uint64		commitSeqNo;
+
 	uint32		wait_event_info;	/* proc's wait information */
 
 	/* Support for group transaction status update. */
@@ -280,10 +299,16 @@ struct PGPROC
 	XLogRecPtr	clogGroupMemberLsn; /* WAL location of commit record for clog
 									 * group member */
 
+	/* Support for group WAL flush. */
+	bool		walFlushGroupMember;	/* true, if member of WAL flush group */
+	pg_atomic_uint32 walFlushGroupNext; /* next WAL flush group member */
+	XLogRecPtr	walFlushGroupLsn;	/* WAL location to be flushed for WAL
+									 * flush group member */
+
 	/* Lock manager data, recording fast-path locks taken by this backend. */
 	LWLock		fpInfoLock;		/* protects per-backend fast-path state */
-	uint64		fpLockBits;		/* lock modes held for each fast-path slot */
-	Oid			fpRelId[FP_LOCK_SLOTS_PER_BACKEND]; /* slots for rel oids */
+	uint64	   *fpLockBits;		/* lock modes held for each fast-path slot */
+	Oid		   *fpRelId;		/* slots for rel oids */
 	bool		fpVXIDLock;		/* are we holding a fast-path VXID lock? */
 	LocalTransactionId fpLocalTransactionId;	/* lxid for fast-path VXID
 												 * lock */
@@ -390,6 +415,8 @@ typedef struct PROC_HDR
 	pg_atomic_uint32 procArrayGroupFirst;
 	/* First pgproc waiting for group transaction status update */
 	pg_atomic_uint32 clogGroupFirst;
+	/* First pgproc waiting for group WAL flush */
+	pg_atomic_uint32 walFlushGroupFirst;
 	/* WALWriter process's latch */
 	Latch	   *walwriterLatch;
 	/* Checkpointer process's latch */
@@ -77,6 +77,7 @@ typedef struct catcache
 	 * searches, each of which will result in loading a negative entry
 	 */
 	long		cc_invals;		/* # of entries invalidated from cache */
+	long		cc_evictions;	/* # of entries evicted from cache */
 	long		cc_lsearches;	/* total # list-searches */
 	long		cc_lhits;		/* # of matches against existing lists */
 #endif
@@ -103,6 +104,12 @@ typedef struct catctup
 	 */
 	dlist_node	cache_elem;		/* list member of per-bucket list */
 
+	/*
+	 * All tuples of all caches are also members of a dlist in LRU order, to
+	 * find the entries to evict when catalog_cache_memory_limit is exceeded.
+	 */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+
 	/*
 	 * A tuple marked "dead" must not be returned by subsequent searches.
 	 * However, it won't be physically deleted from the cache until its
@@ -183,8 +190,14 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	dlist_head	ch_lru;			/* all tuples, most recently used first */
+	Size		ch_memsize;		/* memory used by all tuples */
+	MemoryContext ch_context;	/* context holding tuples and lists */
 } CatCacheHeader;
 
+/* GUC variable */
+extern PGDLLIMPORT int catalog_cache_memory_limit;
+
 
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
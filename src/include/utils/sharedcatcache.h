@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Catalog tuples cached in shared memory for all backends.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "access/htup.h"
+#include "storage/sinval.h"
+
+/* GUC variable */
+extern PGDLLIMPORT int shared_catalog_cache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern bool SharedCatCacheUsable(bool relisshared);
+extern uint64 SharedCatCacheGetInvalCount(void);
+extern HeapTuple SharedCatCacheLookup(int cacheId, Oid dbId,
+									  uint32 hashValue);
+extern void SharedCatCacheInsert(int cacheId, Oid dbId, uint32 hashValue,
+								 HeapTuple tuple, uint64 invalCount);
+extern void SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs,
+									 int n);
+extern void SharedCatCacheDropDatabase(Oid dbId);
+
+#endif							/* SHAREDCATCACHE_H */
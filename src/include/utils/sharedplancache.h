@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Generic plans cached in shared memory for all backends.
+ *
+ * Portions Copyright (c) 1996-2022, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/plancache.h"
+
+/* GUC variable */
+extern PGDLLIMPORT int shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern bool SharedPlanCacheUsable(CachedPlanSource *plansource,
+								  QueryEnvironment *queryEnv);
+extern uint64 SharedPlanCacheGetInvalCount(void);
+extern List *SharedPlanCacheLookup(CachedPlanSource *plansource);
+extern void SharedPlanCacheInsert(CachedPlanSource *plansource,
+								  List *stmt_list, uint64 invalCount);
+extern void SharedPlanCacheInvalidateBegin(void);
+extern void SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs,
+									  int n);
+extern void SharedPlanCacheInvalidateEnd(bool removed);
+extern void SharedPlanCacheDropDatabase(Oid dbId);
+
+#endif							/* SHAREDPLANCACHE_H */
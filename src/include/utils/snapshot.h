@@ -214,6 +214,13 @@ typedef struct SnapshotData
 	 * transactions completed since the last GetSnapshotData().
 	 */
 	uint64		snapXactCompletionCount;
+
+	/*
+	 * With csn_snapshots, the commit sequence number as of which this
+	 * snapshot sees transactions as completed, see csnlog.c.  Zero if the
+	 * snapshot's XID arrays have to be used instead.
+	 */
+	uint64		snapshotCsn;
 } SnapshotData;
 
 #endif							/* SNAPSHOT_H */
@@ -0,0 +1,134 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Check MVCC visibility with csn_snapshots enabled, including for
+# subtransactions and for prepared transactions that were recovered at
+# startup, whose XIDs predate the CSN log.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq[
+csn_snapshots = on
+max_prepared_transactions = 5
+]);
+$node->start;
+
+isnt($node->safe_psql('postgres', 'SHOW csn_log_buffers'),
+	'0', 'csn_log_buffers is auto-tuned');
+
+$node->safe_psql('postgres', 'CREATE TABLE csn_test (a int)');
+$node->safe_psql('postgres', 'INSERT INTO csn_test VALUES (1)');
+
+my $query = q[SELECT string_agg(a::text, ',' ORDER BY a) FROM csn_test];
+
+# A prepared transaction with a committed and an aborted subtransaction
+$node->safe_psql(
+	'postgres', q[
+BEGIN;
+INSERT INTO csn_test VALUES (100);
+SAVEPOINT s1;
+INSERT INTO csn_test VALUES (101);
+RELEASE s1;
+SAVEPOINT s2;
+INSERT INTO csn_test VALUES (102);
+ROLLBACK TO s2;
+PREPARE TRANSACTION 'p1';
+]);
+
+# A session whose snapshot is taken before any of the commits below
+my $psql_timeout = IPC::Run::timer($PostgreSQL::Test::Utils::timeout_default);
+my %psql = ('stdin' => '', 'stdout' => '');
+$psql{run} =
+  $node->background_psql('postgres', \$psql{stdin}, \$psql{stdout},
+	$psql_timeout);
+
+query_in_snapshot("BEGIN ISOLATION LEVEL REPEATABLE READ;\n$query;\n",
+	qr/^1$/m, 'snapshot taken');
+
+# Committed and aborted subtransactions of a regular transaction
+$node->safe_psql(
+	'postgres', q[
+BEGIN;
+INSERT INTO csn_test VALUES (2);
+SAVEPOINT s1;
+INSERT INTO csn_test VALUES (3);
+RELEASE s1;
+SAVEPOINT s2;
+INSERT INTO csn_test VALUES (4);
+ROLLBACK TO s2;
+COMMIT;
+]);
+is($node->safe_psql('postgres', $query),
+	'1,2,3', 'committed subtransaction visible, aborted one not');
+
+$node->safe_psql('postgres', "COMMIT PREPARED 'p1'");
+is($node->safe_psql('postgres', $query),
+	'1,2,3,100,101', 'prepared transaction visible once committed');
+
+query_in_snapshot("$query;\n", qr/^1$/m,
+	'transactions committed after the snapshot are not visible');
+query_in_snapshot("COMMIT;\n$query;\n", qr/^1,2,3,100,101$/m,
+	'transactions visible in a new snapshot');
+
+# A prepared transaction survives a restart, so its XIDs precede the ones
+# the CSN log knows about.
+$node->safe_psql(
+	'postgres', q[
+BEGIN;
+INSERT INTO csn_test VALUES (200);
+SAVEPOINT s1;
+INSERT INTO csn_test VALUES (201);
+RELEASE s1;
+PREPARE TRANSACTION 'p2';
+]);
+
+$psql{stdin} .= "\\q\n";
+$psql{run}->finish;
+
+$node->restart;
+
+$psql{run} =
+  $node->background_psql('postgres', \$psql{stdin}, \$psql{stdout},
+	$psql_timeout);
+
+query_in_snapshot("BEGIN ISOLATION LEVEL REPEATABLE READ;\n$query;\n",
+	qr/^1,2,3,100,101$/m, 'snapshot taken after restart');
+
+$node->safe_psql('postgres', "COMMIT PREPARED 'p2'");
+is($node->safe_psql('postgres', $query),
+	'1,2,3,100,101,200,201',
+	'recovered prepared transaction visible once committed');
+
+query_in_snapshot("$query;\n", qr/^1,2,3,100,101$/m,
+	'recovered prepared transaction committed after the snapshot is not visible'
+);
+
+$psql{stdin} .= "\\q\n";
+$psql{run}->finish;
+
+is( $node->safe_psql(
+		'postgres', q[SELECT count(*) FROM pg_stat_slru WHERE name = 'CSNLog']),
+	'1',
+	'CSNLog SLRU statistics are reported');
+
+$node->stop;
+
+done_testing();
+
+# Run queries in the background session and wait for the expected output.
+sub query_in_snapshot
+{
+	my ($sql, $match, $test_name) = @_;
+
+	$psql{stdout} = '';
+	$psql{stdin} .= $sql;
+	ok(pump_until($psql{run}, $psql_timeout, \$psql{stdout}, $match),
+		$test_name);
+}
@@ -0,0 +1,173 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Check that sessions connecting to proxy_port share the backends of the
+# connection proxy, and that session state doesn't leak between them.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+if ($windows_os)
+{
+	plan skip_all => 'connection proxies are not supported on Windows';
+}
+
+my $proxy_port = PostgreSQL::Test::Cluster::get_free_port();
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq[
+connection_proxies = 1
+proxy_port = $proxy_port
+session_pool_size = 1
+]);
+$node->start;
+
+my $proxy_connstr =
+  'port=' . $proxy_port . ' host=' . $node->host . ' dbname=postgres';
+
+# Run queries in a new session on the proxy port.
+sub proxy_psql
+{
+	my ($sql) = @_;
+
+	return $node->safe_psql('postgres', $sql, connstr => $proxy_connstr);
+}
+
+$node->safe_psql('postgres', 'CREATE TABLE proxy_test (a int)');
+
+proxy_psql('INSERT INTO proxy_test VALUES (1)');
+is($node->safe_psql('postgres', 'SELECT count(*) FROM proxy_test'),
+	'1', 'changes made through the proxy are visible');
+
+my $pid = proxy_psql('SELECT pg_backend_pid()');
+is(proxy_psql('SELECT pg_backend_pid()'),
+	$pid, 'consecutive sessions share the pooled backend');
+
+# Settings are reset before the backend serves the next session
+proxy_psql("SET work_mem = '1234kB'");
+is(proxy_psql('SHOW work_mem'), '4MB', 'SET does not leak into next session');
+is(proxy_psql('SELECT pg_backend_pid()'),
+	$pid, 'backend is reused after SET');
+
+# So is an open transaction
+proxy_psql('BEGIN; INSERT INTO proxy_test VALUES (2)');
+is(proxy_psql('SELECT count(*) FROM proxy_test'),
+	'1', 'transaction left open by a session is rolled back');
+
+# Temporary tables retire the backend at the end of the session
+proxy_psql('CREATE TEMP TABLE proxy_temp (a int)');
+isnt(proxy_psql('SELECT pg_backend_pid()'),
+	$pid, 'backend with temporary tables is not reused');
+
+# Several statements in a transaction, and an error within one
+is( proxy_psql(
+		q[BEGIN; INSERT INTO proxy_test VALUES (3);
+SELECT count(*) FROM proxy_test; COMMIT;]),
+	'2',
+	'transaction block through the proxy');
+my ($ret, $stdout, $stderr) = $node->psql(
+	'postgres', 'SELECT 1/0',
+	connstr => $proxy_connstr);
+like($stderr, qr/division by zero/, 'errors are relayed to the client');
+is(proxy_psql('SELECT 1'), '1', 'backend is reused after an error');
+
+# Two clients interleave their transactions on the single pooled backend
+$node->safe_psql(
+	'postgres', q[
+CREATE SEQUENCE proxy_seq;
+CREATE FUNCTION proxy_lastval() RETURNS text LANGUAGE plpgsql AS $$
+BEGIN
+	RETURN lastval()::text;
+EXCEPTION WHEN object_not_in_prerequisite_state THEN
+	RETURN 'undefined';
+END
+$$;
+]);
+
+my $timer = IPC::Run::timeout($PostgreSQL::Test::Utils::timeout_default);
+
+# Start a psql session on the proxy port that reads queries as we send them.
+sub start_client
+{
+	my %client = (stdin => '', stdout => '');
+
+	$client{harness} = IPC::Run::start(
+		[
+			$node->installed_command('psql'), '-XAtq',
+			'-d', $proxy_connstr, '-f', '-'
+		],
+		'<', \$client{stdin},
+		'>', \$client{stdout},
+		$timer);
+
+	return \%client;
+}
+
+# Send a query to a client session, without waiting for the result.
+sub client_send
+{
+	my ($client, $sql) = @_;
+
+	$client->{stdout} = '';
+	$client->{stdin} .= "$sql;\n\\echo QUERY_DONE\n";
+}
+
+# Wait for the result of the query sent last.
+sub client_result
+{
+	my ($client) = @_;
+
+	$client->{harness}->pump
+	  until $client->{stdout} =~ /QUERY_DONE\n/ || $timer->is_expired;
+	die "query through connection proxy timed out" if $timer->is_expired;
+
+	my $result = $client->{stdout};
+	$result =~ s/QUERY_DONE\n$//;
+	chomp $result;
+	return $result;
+}
+
+sub client_query
+{
+	my ($client, $sql) = @_;
+
+	client_send($client, $sql);
+	return client_result($client);
+}
+
+my $client1 = start_client();
+my $client2 = start_client();
+
+my $pid1 = client_query($client1, 'SELECT pg_backend_pid()');
+is(client_query($client2, 'SELECT pg_backend_pid()'),
+	$pid1, 'concurrent clients share the pooled backend');
+
+# nextval() pins the session, so currval() works in its next transaction
+is(client_query($client1, "SELECT nextval('proxy_seq')"),
+	'1', 'nextval in first client');
+is(client_query($client1, "SELECT currval('proxy_seq')"),
+	'1', 'currval in a later transaction of the first client');
+
+# The other client waits for the backend until the first one leaves, and
+# then doesn't see the first client's sequence state
+client_send($client2, 'SELECT proxy_lastval()');
+$client1->{stdin} .= "\\q\n";
+$client1->{harness}->finish;
+is(client_result($client2),
+	'undefined', 'sequence state does not leak into the next client');
+is(client_query($client2, 'SELECT pg_backend_pid()'),
+	$pid1, 'second client took over the pooled backend');
+is(client_query($client2, "SELECT nextval('proxy_seq')"),
+	'2', 'nextval in second client');
+
+$client2->{stdin} .= "\\q\n";
+$client2->{harness}->finish;
+
+$node->stop;
+
+done_testing();
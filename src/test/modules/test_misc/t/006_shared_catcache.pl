@@ -0,0 +1,125 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Check that catalog changes are seen by sessions that load catalog tuples
+# from the shared catalog cache.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'shared_catalog_cache_size = 1MB');
+$node->start;
+
+$node->safe_psql(
+	'postgres', q[
+CREATE FUNCTION shcc_func() RETURNS int LANGUAGE sql AS 'SELECT 1';
+CREATE TABLE shcc_tab (a int);
+]);
+
+# The first session caches the tuples, the next ones may find them shared
+is($node->safe_psql('postgres', 'SELECT shcc_func()'),
+	'1', 'function result in first session');
+is($node->safe_psql('postgres', 'SELECT shcc_func()'),
+	'1', 'function result in second session');
+
+# A session that keeps the old tuple in its private cache
+my $psql_timeout = IPC::Run::timer($PostgreSQL::Test::Utils::timeout_default);
+my %psql = ('stdin' => '', 'stdout' => '');
+$psql{run} =
+  $node->background_psql('postgres', \$psql{stdin}, \$psql{stdout},
+	$psql_timeout);
+query_background("SELECT shcc_func();\n", qr/^1$/m,
+	'function result in background session');
+
+$node->safe_psql('postgres',
+	q[CREATE OR REPLACE FUNCTION shcc_func() RETURNS int LANGUAGE sql AS 'SELECT 2']
+);
+is($node->safe_psql('postgres', 'SELECT shcc_func()'),
+	'2', 'new session sees replaced function');
+query_background("SELECT shcc_func();\n", qr/^2$/m,
+	'background session sees replaced function');
+
+# A catalog change that is rolled back must not leak to other sessions
+query_background(
+	"BEGIN; ALTER TABLE shcc_tab RENAME TO shcc_renamed; SELECT 'shcc_renamed'::regclass;\n",
+	qr/^shcc_renamed$/m,
+	'uncommitted rename is visible in its own transaction');
+is($node->safe_psql('postgres', q[SELECT 'shcc_tab'::regclass]),
+	'shcc_tab', 'uncommitted rename is not visible in other sessions');
+query_background("ROLLBACK; SELECT 'shcc_tab'::regclass;\n",
+	qr/^shcc_tab$/m, 'rename is rolled back');
+is($node->safe_psql('postgres', q[SELECT 'shcc_tab'::regclass]),
+	'shcc_tab', 'rolled back rename is not visible in new session');
+
+$node->safe_psql('postgres',
+	'ALTER TABLE shcc_tab RENAME TO shcc_renamed');
+is( $node->safe_psql(
+		'postgres', q[SELECT relname FROM pg_class WHERE oid = 'shcc_renamed'::regclass]),
+	'shcc_renamed',
+	'committed rename is visible in new session');
+
+# Check that a tuple loaded by one session is served from the shared cache
+# to another one.  The background session reports shared cache hits in the
+# server log, and warms its private cache with the same query on another
+# function first, so that the pg_proc entry of the new function is the only
+# one it has to look up.
+$node->safe_psql('postgres',
+	q[CREATE FUNCTION shcc_hit() RETURNS int LANGUAGE sql AS 'SELECT 3']);
+is($node->safe_psql('postgres', 'SELECT shcc_hit()'),
+	'3', 'function result in session loading the tuple');
+
+query_background(
+	"SET log_min_messages = debug2; SELECT oid::regproc FROM pg_proc WHERE proname = 'shcc_func';\n",
+	qr/^shcc_func$/m,
+	'background session warmed up');
+
+my $hit_regexp =
+  qr/DEBUG:  SearchCatCache\(pg_proc\): put shared tuple in bucket/;
+my $offset = -s $node->logfile;
+query_background(
+	"SELECT oid::regproc FROM pg_proc WHERE proname = 'shcc_hit';\n",
+	qr/^shcc_hit$/m,
+	'background session looks up tuple');
+like(slurp_file($node->logfile, $offset),
+	$hit_regexp, 'tuple loaded by other session is found in shared cache');
+
+# After a concurrent change, the background session must read the new
+# version from the catalog, not get the old one from the shared cache.
+$node->safe_psql('postgres', 'ALTER FUNCTION shcc_hit() RENAME TO shcc_hit2');
+
+$offset = -s $node->logfile;
+query_background(
+	"SELECT oid::regproc FROM pg_proc WHERE proname = 'shcc_hit2';\n",
+	qr/^shcc_hit2$/m,
+	'background session sees renamed function');
+unlike(slurp_file($node->logfile, $offset),
+	$hit_regexp, 'altered tuple is not found in shared cache');
+
+# The new version read by the background session is shared again
+is( $node->safe_psql(
+		'postgres', q[SELECT oid::regproc FROM pg_proc WHERE proname = 'shcc_hit2']),
+	'shcc_hit2',
+	'new session sees renamed function');
+
+$psql{stdin} .= "\\q\n";
+$psql{run}->finish;
+
+$node->stop;
+
+done_testing();
+
+# Run queries in the background session and wait for the expected output.
+sub query_background
+{
+	my ($sql, $match, $test_name) = @_;
+
+	$psql{stdout} = '';
+	$psql{stdin} .= $sql;
+	ok(pump_until($psql{run}, $psql_timeout, \$psql{stdout}, $match),
+		$test_name);
+}
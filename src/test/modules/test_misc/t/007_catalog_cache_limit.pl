@@ -0,0 +1,85 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Check that catalog_cache_memory_limit bounds the memory of the catalog
+# cache, and that evicted entries are transparently rebuilt.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->start;
+
+$node->safe_psql(
+	'postgres', q[
+DO $$
+BEGIN
+  FOR i IN 1..300 LOOP
+    EXECUTE format('CREATE TABLE cclimit_%s (a int, b text, c numeric)', i);
+    EXECUTE format('INSERT INTO cclimit_%s VALUES (%s)', i, i);
+  END LOOP;
+END
+$$;
+]);
+
+# Touch all tables twice in one session, so that evicted entries are reloaded
+my $sum = $node->safe_psql(
+	'postgres', q[
+SET catalog_cache_memory_limit = '64kB';
+CREATE FUNCTION cclimit_sum() RETURNS bigint LANGUAGE plpgsql AS $$
+DECLARE
+  s bigint := 0;
+  v int;
+BEGIN
+  FOR i IN 1..300 LOOP
+    EXECUTE format('SELECT a FROM cclimit_%s', i) INTO v;
+    s := s + v;
+  END LOOP;
+  RETURN s;
+END
+$$;
+SELECT cclimit_sum() + cclimit_sum();
+]);
+is($sum, 300 * 301, 'queries are correct with a small cache limit');
+
+# The catalog cache stays close to the limit
+my $used = $node->safe_psql(
+	'postgres', q[
+SET catalog_cache_memory_limit = '64kB';
+SELECT count(*) FROM (SELECT cclimit_sum()) s;
+SELECT used_bytes FROM pg_backend_memory_contexts
+  WHERE name = 'CatCacheMemoryContext';
+]);
+cmp_ok($used, '<', 256 * 1024, 'catalog cache memory is bounded');
+
+my $used_unlimited = $node->safe_psql(
+	'postgres', q[
+SELECT count(*) FROM (SELECT cclimit_sum()) s;
+SELECT used_bytes FROM pg_backend_memory_contexts
+  WHERE name = 'CatCacheMemoryContext';
+]);
+cmp_ok($used_unlimited, '>', $used,
+	'catalog cache grows larger without limit');
+
+# Prepared statements still work after their generic plans are discarded
+is( $node->safe_psql(
+		'postgres', q[
+SET catalog_cache_memory_limit = '64kB';
+SET plan_cache_mode = force_generic_plan;
+PREPARE p1(int) AS SELECT a FROM cclimit_1 WHERE a = $1;
+PREPARE p2(int) AS SELECT a FROM cclimit_2 WHERE a = $1;
+EXECUTE p1(1);
+SELECT cclimit_sum() > 0;
+EXECUTE p2(2);
+EXECUTE p1(1);
+]),
+	"1\nt\n2\n1",
+	'prepared statements with a small cache limit');
+
+$node->stop;
+
+done_testing();
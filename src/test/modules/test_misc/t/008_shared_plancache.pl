@@ -0,0 +1,168 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Check that sessions sharing generic plans through the shared plan cache
+# see the effects of catalog changes.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'shared_plan_cache_size = 1MB');
+$node->start;
+
+$node->safe_psql(
+	'postgres', q[
+CREATE TABLE shpc_tab (a int PRIMARY KEY, b text);
+INSERT INTO shpc_tab SELECT g, 'v' || g FROM generate_series(1, 100) g;
+CREATE FUNCTION shpc_func() RETURNS int LANGUAGE sql IMMUTABLE
+  AS 'SELECT 1';
+]);
+
+# Run a prepared statement with a generic plan in a new session.
+sub run_prepared
+{
+	my ($prepare, $execute) = @_;
+
+	return $node->safe_psql(
+		'postgres', qq[
+SET plan_cache_mode = force_generic_plan;
+$prepare;
+$execute;
+]);
+}
+
+# Like run_prepared(), but also return whether the generic plan was taken
+# from the shared plan cache.
+sub run_prepared_hit
+{
+	my ($prepare, $execute) = @_;
+	my ($stdout, $stderr);
+
+	$node->psql(
+		'postgres', qq[
+SET plan_cache_mode = force_generic_plan;
+SET client_min_messages = debug2;
+$prepare;
+$execute;
+],
+		stdout       => \$stdout,
+		stderr       => \$stderr,
+		on_error_die => 1);
+
+	return ($stdout,
+		$stderr =~ /DEBUG:  using generic plan from shared plan cache/ ? 1 : 0);
+}
+
+my $prep_sel = 'PREPARE p(int) AS SELECT b FROM shpc_tab WHERE a = $1';
+my $prep_func = 'PREPARE f AS SELECT shpc_func()';
+
+# The first session builds the plans, the next ones may take them
+is(run_prepared($prep_sel, 'EXECUTE p(42)'), 'v42', 'plan in first session');
+is(run_prepared($prep_sel, 'EXECUTE p(43)'), 'v43', 'plan in second session');
+is(run_prepared($prep_func, 'EXECUTE f'), '1', 'inlined function');
+is(run_prepared($prep_func, 'EXECUTE f'), '1', 'inlined function again');
+
+# Catalog changes remove the plans that depend on them
+$node->safe_psql('postgres',
+	q[CREATE OR REPLACE FUNCTION shpc_func() RETURNS int LANGUAGE sql IMMUTABLE AS 'SELECT 2']
+);
+is(run_prepared($prep_func, 'EXECUTE f'), '2', 'replaced function');
+
+$node->safe_psql('postgres',
+	'ALTER TABLE shpc_tab ALTER COLUMN b TYPE varchar(10)');
+is( run_prepared(
+		'PREPARE t(int) AS SELECT pg_typeof(b) FROM shpc_tab WHERE a = $1',
+		'EXECUTE t(1)'),
+	'character varying',
+	'altered column type');
+is(run_prepared($prep_sel, 'EXECUTE p(44)'), 'v44', 'plan after ALTER TABLE');
+
+# The same query text in another schema refers to another table
+$node->safe_psql(
+	'postgres', q[
+CREATE SCHEMA shpc;
+CREATE TABLE shpc.shpc_tab (a int, b text);
+INSERT INTO shpc.shpc_tab VALUES (42, 'other');
+]);
+is( $node->safe_psql(
+		'postgres', qq[
+SET search_path = shpc, public;
+SET plan_cache_mode = force_generic_plan;
+$prep_sel;
+EXECUTE p(42);
+]),
+	'other',
+	'plan with different search_path');
+
+# Settings that change the constants of the querytree keep plans apart
+my $prep_tz =
+  q[PREPARE z AS SELECT extract(epoch FROM '2000-01-01 00:00'::timestamptz)];
+is(run_prepared("SET TimeZone = 'UTC'; $prep_tz", 'EXECUTE z'),
+	'946684800.000000', 'plan with TimeZone UTC');
+is(run_prepared("SET TimeZone = 'UTC'; $prep_tz", 'EXECUTE z'),
+	'946684800.000000', 'plan with TimeZone UTC again');
+is(run_prepared("SET TimeZone = 'America/New_York'; $prep_tz", 'EXECUTE z'),
+	'946702800.000000', 'plan with different TimeZone');
+
+my $prep_ds = q[PREPARE d AS SELECT '01/02/2000'::date = '2000-01-02'];
+is(run_prepared("SET DateStyle = 'ISO, MDY'; $prep_ds", 'EXECUTE d'),
+	't', 'plan with DateStyle MDY');
+is(run_prepared("SET DateStyle = 'ISO, DMY'; $prep_ds", 'EXECUTE d'),
+	'f', 'plan with different DateStyle');
+
+# Sessions with temporary tables don't share, and don't pick up, plans
+is( $node->safe_psql(
+		'postgres', qq[
+CREATE TEMP TABLE shpc_tab (a int, b text);
+INSERT INTO shpc_tab VALUES (42, 'temp');
+SET plan_cache_mode = force_generic_plan;
+$prep_sel;
+EXECUTE p(42);
+]),
+	'temp',
+	'plan with temporary table');
+is(run_prepared($prep_sel, 'EXECUTE p(42)'), 'v42',
+	'plan after session with temporary table');
+
+# Check which sessions take the plan another one built
+$node->safe_psql(
+	'postgres', q[
+CREATE ROLE shpc_role;
+GRANT SELECT ON shpc_tab TO shpc_role;
+]);
+my $prep_hit = 'PREPARE h(int) AS SELECT count(*) FROM shpc_tab WHERE a < $1';
+is_deeply([ run_prepared_hit($prep_hit, 'EXECUTE h(10)') ],
+	[ '9', 0 ], 'plan built by first session');
+is_deeply([ run_prepared_hit($prep_hit, 'EXECUTE h(11)') ],
+	[ '10', 1 ], 'plan reused by second session');
+is_deeply(
+	[ run_prepared_hit("SET search_path = public, shpc; $prep_hit",
+			'EXECUTE h(11)') ],
+	[ '10', 0 ],
+	'plan not reused with different search_path');
+
+is_deeply(
+	[ run_prepared_hit("SET ROLE shpc_role; $prep_hit", 'EXECUTE h(11)') ],
+	[ '10', 0 ],
+	'plan not reused by different role');
+is_deeply(
+	[ run_prepared_hit("SET ROLE shpc_role; $prep_hit", 'EXECUTE h(11)') ],
+	[ '10', 1 ],
+	'plan reused by same role');
+
+# A change of the table removes the plan, and the next session shares the
+# new one
+$node->safe_psql('postgres', 'ALTER TABLE shpc_tab ADD COLUMN c int');
+is_deeply([ run_prepared_hit($prep_hit, 'EXECUTE h(11)') ],
+	[ '10', 0 ], 'plan not reused after ALTER TABLE');
+is_deeply([ run_prepared_hit($prep_hit, 'EXECUTE h(11)') ],
+	[ '10', 1 ], 'plan reused after being built again');
+
+$node->stop;
+
+done_testing();
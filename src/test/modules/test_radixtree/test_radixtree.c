@@ -0,0 +1,575 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_radixtree.c
+ *		Test radix tree data structure.
+ *
+ * Copyright (c) 2022, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_radixtree/test_radixtree.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/pg_prng.h"
+#include "fmgr.h"
+#include "lib/radixtree.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "utils/dsa.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+/*
+ * If you enable this, the "pattern" tests will print information about
+ * how long populating, probing, and iterating the test tree takes, and
+ * how much memory the test tree consumed.  That can be used as
+ * micro-benchmark of various operations and input patterns.
+ */
+static const bool rt_test_stats = false;
+
+/*
+ * The number of children at which each node kind is full.  Adding one more
+ * child than that makes the node grow into the next kind.
+ */
+static const int rt_node_kind_fanouts[] = {
+	3,
+	4,							/* node-4 */
+	15,
+	16,							/* node-16 */
+	47,
+	48,							/* node-48 */
+	255,
+	256							/* node-256 */
+};
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_radixtree);
+
+/*
+ * A struct to define a pattern of integers, for use with the test_pattern()
+ * function.
+ */
+typedef struct
+{
+	char	   *test_name;		/* short name of the test, for humans */
+	char	   *pattern_str;	/* a bit pattern */
+	uint64		spacing;		/* pattern repeats at this interval */
+	uint64		num_values;		/* number of integers to set in total */
+} test_spec;
+
+static const test_spec test_specs[] = {
+	{
+		"all ones", "1111111111",
+		10, 1000000
+	},
+	{
+		"alternating bits", "0101010101",
+		10, 1000000
+	},
+	{
+		"clusters of ten", "1111111111",
+		10000, 1000000
+	},
+	{
+		"clusters of hundred",
+		"1111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111",
+		10000, 10000000
+	},
+	{
+		"one-every-64k", "1",
+		65536, 1000000
+	},
+	{
+		"sparse", "100000000000000000000000000000001",
+		10000000, 1000000
+	},
+	{
+		"single values, distance > 2^32", "1",
+		UINT64CONST(10000000000), 100000
+	},
+	{
+		"clusters, distance > 2^32", "10101010",
+		UINT64CONST(10000000000), 1000000
+	},
+	{
+		"clusters, distance > 2^60", "10101010",
+		UINT64CONST(2000000000000000000),
+		23						/* can't be much higher than this, or we
+								 * overflow uint64 */
+	}
+};
+
+/* The DSA area for the shared-memory variant of the tests, if any */
+static dsa_area *test_dsa = NULL;
+
+static radix_tree *test_create(void);
+static void test_empty(void);
+static void test_basic(int children, int shift);
+static void test_node_types(int shift);
+static void test_pattern(const test_spec *spec);
+
+/*
+ * SQL-callable entry point to perform all tests.
+ */
+Datum
+test_radixtree(PG_FUNCTION_ARGS)
+{
+	int			tranche_id;
+
+	/* Run all the tests on a local tree first, then on a shared one */
+	for (int pass = 0; pass < 2; pass++)
+	{
+		if (pass == 1)
+		{
+			tranche_id = LWLockNewTrancheId();
+			LWLockRegisterTranche(tranche_id, "test_radixtree");
+			test_dsa = dsa_create(tranche_id);
+		}
+
+		elog(NOTICE, "testing %s radix tree",
+			 test_dsa ? "shared" : "local");
+
+		test_empty();
+
+		for (int shift = 0; shift <= (64 - 8); shift += 8)
+			test_node_types(shift);
+
+		/* Test different test patterns, with lots of entries */
+		for (int i = 0; i < lengthof(test_specs); i++)
+			test_pattern(&test_specs[i]);
+	}
+
+	dsa_detach(test_dsa);
+	test_dsa = NULL;
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Create a tree for a test, in local memory or in the DSA area depending on
+ * the current pass.
+ */
+static radix_tree *
+test_create(void)
+{
+	return rt_create(CurrentMemoryContext, test_dsa);
+}
+
+static void
+test_empty(void)
+{
+	radix_tree *radixtree;
+	rt_iter    *iter;
+	uint64		dummy;
+	uint64		key;
+	uint64		val;
+
+	radixtree = test_create();
+
+	if (rt_search(radixtree, 0, &dummy))
+		elog(ERROR, "rt_search on empty tree returned true");
+
+	if (rt_search(radixtree, 1, &dummy))
+		elog(ERROR, "rt_search on empty tree returned true");
+
+	if (rt_search(radixtree, PG_UINT64_MAX, &dummy))
+		elog(ERROR, "rt_search on empty tree returned true");
+
+	if (rt_delete(radixtree, 0))
+		elog(ERROR, "rt_delete on empty tree returned true");
+
+	if (rt_num_entries(radixtree) != 0)
+		elog(ERROR, "rt_num_entries on empty tree return non-zero");
+
+	iter = rt_begin_iterate(radixtree);
+
+	if (rt_iterate_next(iter, &key, &val))
+		elog(ERROR, "rt_iterate_next on empty tree returned true");
+
+	rt_end_iterate(iter);
+
+	rt_free(radixtree);
+}
+
+/*
+ * Check that the tree contains exactly the keys 0 .. children - 1, shifted
+ * left by 'shift' bits, each with its key as value.
+ */
+static void
+check_search_on_node(radix_tree *radixtree, int children, int shift)
+{
+	for (int i = 0; i < children; i++)
+	{
+		uint64		key = ((uint64) i << shift);
+		uint64		val;
+
+		if (!rt_search(radixtree, key, &val))
+			elog(ERROR, "key 0x%" INT64_MODIFIER "X is not found in the node with %d children",
+				 key, children);
+		if (val != key)
+			elog(ERROR, "rt_search with key 0x%" INT64_MODIFIER "X returns 0x%" INT64_MODIFIER "X, expected 0x%" INT64_MODIFIER "X",
+				 key, val, key);
+	}
+}
+
+/*
+ * Check that iteration returns the keys 0 .. children - 1, shifted left by
+ * 'shift' bits, in ascending order.
+ */
+static void
+check_iterate_on_node(radix_tree *radixtree, int children, int shift)
+{
+	rt_iter    *iter;
+	uint64		key;
+	uint64		val;
+	int			n = 0;
+
+	iter = rt_begin_iterate(radixtree);
+	while (rt_iterate_next(iter, &key, &val))
+	{
+		uint64		expected = ((uint64) n << shift);
+
+		if (n >= children)
+			elog(ERROR, "iteration returned more than %d keys", children);
+		if (key != expected)
+			elog(ERROR, "iteration returned key 0x%" INT64_MODIFIER "X, expected 0x%" INT64_MODIFIER "X",
+				 key, expected);
+		if (val != key)
+			elog(ERROR, "iteration returned value 0x%" INT64_MODIFIER "X for key 0x%" INT64_MODIFIER "X",
+				 val, key);
+		n++;
+	}
+	rt_end_iterate(iter);
+
+	if (n != children)
+		elog(ERROR, "iteration returned %d keys, expected %d", n, children);
+}
+
+/*
+ * Fill a node with 'children' keys, then update and delete them all.
+ */
+static void
+test_basic(int children, int shift)
+{
+	radix_tree *radixtree;
+
+	elog(DEBUG1, "test_basic with %d children at shift %d", children, shift);
+
+	radixtree = test_create();
+
+	/* insert keys */
+	for (int i = 0; i < children; i++)
+	{
+		uint64		key = ((uint64) i << shift);
+
+		if (rt_set(radixtree, key, key))
+			elog(ERROR, "new inserted key 0x%" INT64_MODIFIER "X found", key);
+	}
+
+	if (rt_num_entries(radixtree) != children)
+		elog(ERROR, "rt_num_entries returned " UINT64_FORMAT ", expected %d",
+			 rt_num_entries(radixtree), children);
+
+	check_search_on_node(radixtree, children, shift);
+	check_iterate_on_node(radixtree, children, shift);
+
+	/* update keys, which must not change the number of entries */
+	for (int i = 0; i < children; i++)
+	{
+		uint64		key = ((uint64) i << shift);
+
+		if (!rt_set(radixtree, key, key + 1))
+			elog(ERROR, "could not find key 0x%" INT64_MODIFIER "X", key);
+		if (!rt_set(radixtree, key, key))
+			elog(ERROR, "could not find key 0x%" INT64_MODIFIER "X", key);
+	}
+
+	if (rt_num_entries(radixtree) != children)
+		elog(ERROR, "rt_num_entries returned " UINT64_FORMAT ", expected %d",
+			 rt_num_entries(radixtree), children);
+
+	check_search_on_node(radixtree, children, shift);
+
+	/* delete keys, and check that they're gone */
+	for (int i = 0; i < children; i++)
+	{
+		uint64		key = ((uint64) i << shift);
+		uint64		val;
+
+		if (!rt_delete(radixtree, key))
+			elog(ERROR, "could not delete key 0x%" INT64_MODIFIER "X", key);
+		if (rt_search(radixtree, key, &val))
+			elog(ERROR, "deleted key 0x%" INT64_MODIFIER "X is still found", key);
+		if (rt_delete(radixtree, key))
+			elog(ERROR, "deleted key 0x%" INT64_MODIFIER "X was deleted again", key);
+	}
+
+	if (rt_num_entries(radixtree) != 0)
+		elog(ERROR, "rt_num_entries returned " UINT64_FORMAT ", expected 0",
+			 rt_num_entries(radixtree));
+
+	rt_free(radixtree);
+}
+
+/*
+ * Test for inserting and deleting key-value pairs to each node kind at the
+ * given shift level, filling each kind up to its capacity and then growing
+ * it into the next kind.
+ */
+static void
+test_node_types(int shift)
+{
+	elog(NOTICE, "testing radix tree node types with shift %d", shift);
+
+	for (int i = 0; i < lengthof(rt_node_kind_fanouts); i++)
+		test_basic(rt_node_kind_fanouts[i], shift);
+}
+
+/*
+ * Test with a repeating pattern, defined by the 'spec'.
+ */
+static void
+test_pattern(const test_spec *spec)
+{
+	radix_tree *radixtree;
+	rt_iter    *iter;
+	MemoryContext radixtree_ctx;
+	TimestampTz starttime;
+	TimestampTz endtime;
+	uint64		n;
+	uint64		last_int;
+	uint64		ndeleted;
+	uint64		nbefore;
+	uint64		nafter;
+	int			patternlen;
+	uint64	   *pattern_values;
+	uint64		pattern_num_values;
+
+	elog(NOTICE, "testing radix tree with pattern \"%s\"", spec->test_name);
+	if (rt_test_stats)
+		fprintf(stderr, "-----\ntesting radix tree with pattern \"%s\"\n", spec->test_name);
+
+	/* Pre-process the pattern, creating an array of integers from it. */
+	patternlen = strlen(spec->pattern_str);
+	pattern_values = palloc(patternlen * sizeof(uint64));
+	pattern_num_values = 0;
+	for (int i = 0; i < patternlen; i++)
+	{
+		if (spec->pattern_str[i] == '1')
+			pattern_values[pattern_num_values++] = i;
+	}
+
+	/*
+	 * Allocate the radix tree.
+	 *
+	 * Allocate it in a separate memory context, so that we can print its
+	 * memory usage easily.
+	 */
+	radixtree_ctx = AllocSetContextCreate(CurrentMemoryContext,
+										  "radixtree test",
+										  ALLOCSET_SMALL_SIZES);
+	MemoryContextSetIdentifier(radixtree_ctx, spec->test_name);
+	radixtree = rt_create(radixtree_ctx, test_dsa);
+
+	/*
+	 * Add values to the set.
+	 */
+	starttime = GetCurrentTimestamp();
+
+	n = 0;
+	last_int = 0;
+	while (n < spec->num_values)
+	{
+		uint64		x = 0;
+
+		for (int i = 0; i < pattern_num_values && n < spec->num_values; i++)
+		{
+			x = last_int + pattern_values[i];
+
+			if (rt_set(radixtree, x, x))
+				elog(ERROR, "new inserted key 0x%" INT64_MODIFIER "X found", x);
+
+			n++;
+		}
+		last_int += spec->spacing;
+	}
+
+	endtime = GetCurrentTimestamp();
+
+	if (rt_test_stats)
+		fprintf(stderr, "added " UINT64_FORMAT " values in %d ms\n",
+				spec->num_values, (int) (endtime - starttime) / 1000);
+
+	/*
+	 * Print stats on the amount of memory used.
+	 *
+	 * We print the usage reported by rt_memory_usage(), as well as the stats
+	 * from the memory context.  For a local tree they should be in the same
+	 * ballpark, but it's hard to automate testing that, so if you're making
+	 * changes to the implementation, just observe that manually.
+	 */
+	if (rt_test_stats)
+	{
+		uint64		mem_usage;
+
+		mem_usage = rt_memory_usage(radixtree);
+		fprintf(stderr, "rt_memory_usage() reported " UINT64_FORMAT " (%0.2f bytes / integer)\n",
+				mem_usage, (double) mem_usage / spec->num_values);
+
+		MemoryContextStats(radixtree_ctx);
+	}
+
+	/* Check that rt_num_entries works */
+	n = rt_num_entries(radixtree);
+	if (n != spec->num_values)
+		elog(ERROR, "rt_num_entries returned " UINT64_FORMAT ", expected " UINT64_FORMAT, n, spec->num_values);
+
+	/*
+	 * Test random-access probes with rt_search()
+	 */
+	starttime = GetCurrentTimestamp();
+
+	for (n = 0; n < 100000; n++)
+	{
+		bool		found;
+		bool		expected;
+		uint64		x;
+		uint64		v;
+
+		/*
+		 * Pick next value to probe at random.  We limit the probes to the
+		 * last integer that we added to the set, plus an arbitrary constant
+		 * (1000).  There's no point in probing the whole 0 - 2^64 range, if
+		 * only a small part of the integer space is used.  We would very
+		 * rarely hit values that are actually in the set.
+		 */
+		x = pg_prng_uint64_range(&pg_global_prng_state, 0, last_int + 1000);
+
+		/* Do we expect this value to be present in the set? */
+		if (x >= last_int)
+			expected = false;
+		else
+		{
+			uint64		idx = x % spec->spacing;
+
+			if (idx >= patternlen)
+				expected = false;
+			else if (spec->pattern_str[idx] == '1')
+				expected = true;
+			else
+				expected = false;
+		}
+
+		/* Is it present according to rt_search() ? */
+		found = rt_search(radixtree, x, &v);
+
+		if (found != expected)
+			elog(ERROR, "mismatch at 0x%" INT64_MODIFIER "X: %d vs %d", x, found, expected);
+		if (found && (v != x))
+			elog(ERROR, "found 0x%" INT64_MODIFIER "X, expected 0x%" INT64_MODIFIER "X",
+				 v, x);
+	}
+	endtime = GetCurrentTimestamp();
+	if (rt_test_stats)
+		fprintf(stderr, "probed " UINT64_FORMAT " values in %d ms\n",
+				n, (int) (endtime - starttime) / 1000);
+
+	/*
+	 * Test iterator
+	 */
+	starttime = GetCurrentTimestamp();
+
+	iter = rt_begin_iterate(radixtree);
+	n = 0;
+	last_int = 0;
+	while (n < spec->num_values)
+	{
+		for (int i = 0; i < pattern_num_values && n < spec->num_values; i++)
+		{
+			uint64		expected = last_int + pattern_values[i];
+			uint64		x;
+			uint64		val;
+
+			if (!rt_iterate_next(iter, &x, &val))
+				break;
+
+			if (x != expected)
+				elog(ERROR,
+					 "iterate returned wrong key; got 0x%" INT64_MODIFIER "X, expected 0x%" INT64_MODIFIER "X at %d",
+					 x, expected, i);
+			if (val != expected)
+				elog(ERROR,
+					 "iterate returned wrong value; got 0x%" INT64_MODIFIER "X, expected 0x%" INT64_MODIFIER "X at %d",
+					 val, expected, i);
+			n++;
+		}
+		last_int += spec->spacing;
+	}
+	endtime = GetCurrentTimestamp();
+	if (rt_test_stats)
+		fprintf(stderr, "iterated " UINT64_FORMAT " values in %d ms\n",
+				n, (int) (endtime - starttime) / 1000);
+
+	rt_end_iterate(iter);
+
+	if (n < spec->num_values)
+		elog(ERROR, "iterator stopped short after " UINT64_FORMAT " entries, expected " UINT64_FORMAT, n, spec->num_values);
+	if (n > spec->num_values)
+		elog(ERROR, "iterator returned " UINT64_FORMAT " entries, " UINT64_FORMAT " was expected", n, spec->num_values);
+
+	/*
+	 * Test random-access probes with rt_delete()
+	 */
+	starttime = GetCurrentTimestamp();
+
+	nbefore = rt_num_entries(radixtree);
+	ndeleted = 0;
+	for (n = 0; n < 100000; n++)
+	{
+		bool		found;
+		uint64		x;
+		uint64		v;
+
+		/*
+		 * Pick next value to probe at random.  We limit the probes to the
+		 * last integer that we added to the set, plus an arbitrary constant
+		 * (1000).  There's no point in probing the whole 0 - 2^64 range, if
+		 * only a small part of the integer space is used.  We would very
+		 * rarely hit values that are actually in the set.
+		 */
+		x = pg_prng_uint64_range(&pg_global_prng_state, 0, last_int + 1000);
+
+		/* Is it present according to rt_search() ? */
+		found = rt_search(radixtree, x, &v);
+
+		if (!found)
+			continue;
+
+		/* If the key is found, delete it and check again */
+		if (!rt_delete(radixtree, x))
+			elog(ERROR, "could not delete key 0x%" INT64_MODIFIER "X", x);
+		if (rt_search(radixtree, x, &v))
+			elog(ERROR, "found deleted key 0x%" INT64_MODIFIER "X", x);
+		if (rt_delete(radixtree, x))
+			elog(ERROR, "deleted already-deleted key 0x%" INT64_MODIFIER "X", x);
+
+		ndeleted++;
+	}
+	endtime = GetCurrentTimestamp();
+	if (rt_test_stats)
+		fprintf(stderr, "deleted " UINT64_FORMAT " values in %d ms\n",
+				ndeleted, (int) (endtime - starttime) / 1000);
+
+	nafter = rt_num_entries(radixtree);
+
+	/* Check that rt_num_entries works */
+	if ((nbefore - ndeleted) != nafter)
+		elog(ERROR, "rt_num_entries returned " UINT64_FORMAT ", expected " UINT64_FORMAT " after " UINT64_FORMAT " deletion",
+			 nafter, (nbefore - ndeleted), ndeleted);
+
+	rt_free(radixtree);
+	MemoryContextDelete(radixtree_ctx);
+}
@@ -0,0 +1,76 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Check the WAL written by concurrent inserters with the lowest and highest
+# wal_insertion_locks settings.  pg_waldump and crash recovery both check
+# that the prev-link of each record points to the record before it.
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+foreach my $locks (1, 128)
+{
+	my $node = PostgreSQL::Test::Cluster->new("locks_$locks");
+	$node->init;
+	$node->append_conf(
+		'postgresql.conf', qq(
+wal_insertion_locks = $locks
+synchronous_commit = off
+));
+	$node->start;
+
+	$node->safe_psql('postgres',
+		'CREATE TABLE wal_tab (client int, filler text)');
+	my $start_lsn =
+	  $node->safe_psql('postgres', 'SELECT pg_current_wal_insert_lsn()');
+
+	# Rows of varying sizes, some of them toasted, so that records of many
+	# sizes are inserted concurrently and some of them span WAL pages.
+	$node->pgbench(
+		'--no-vacuum --client=8 --jobs=4 --transactions=250',
+		0,
+		[qr{processed: 2000/2000}],
+		[qr{^$}],
+		"concurrent inserts with wal_insertion_locks = $locks",
+		{
+			"034_wal_insertion_locks_$locks" => q{
+\set len random(1, 400)
+INSERT INTO wal_tab SELECT :client_id, string_agg(md5(g::text || random()::text), '') FROM generate_series(1, :len) g;
+}
+		});
+
+	# Flush all the WAL written so far
+	$node->safe_psql('postgres',
+		"SET synchronous_commit = on; INSERT INTO wal_tab VALUES (-1, 'last')"
+	);
+	my $end_lsn =
+	  $node->safe_psql('postgres', 'SELECT pg_current_wal_flush_lsn()');
+
+	command_ok(
+		[
+			'pg_waldump', '--quiet',
+			'--path',     $node->data_dir . '/pg_wal',
+			'--start',    $start_lsn,
+			'--end',      $end_lsn
+		],
+		"pg_waldump reads WAL written with wal_insertion_locks = $locks");
+
+	my $result_query =
+	  'SELECT count(*), count(DISTINCT client), sum(length(filler)) FROM wal_tab';
+	my $before = $node->safe_psql('postgres', $result_query);
+	like($before, qr/^2001\|9\|\d+$/,
+		"rows inserted with wal_insertion_locks = $locks");
+
+	# Replay all of it in crash recovery
+	$node->stop('immediate');
+	$node->start;
+
+	is($node->safe_psql('postgres', $result_query),
+		$before, "rows after crash recovery with wal_insertion_locks = $locks");
+
+	$node->stop;
+}
+
+done_testing();
@@ -0,0 +1,60 @@
+--
+-- Tests for batch-at-a-time execution of sequential scans and plain
+-- aggregates (enable_batch_execution)
+--
+CREATE TABLE batch_tab AS
+  SELECT g AS a,
+         CASE WHEN g % 7 = 0 THEN NULL ELSE g % 100 END AS b,
+         'row ' || g AS c
+  FROM generate_series(1, 5000) g;
+ANALYZE batch_tab;
+
+SET enable_batch_execution = on;
+
+-- Aggregates consuming whole batches, with and without batch quals
+SELECT count(*), sum(a), min(b), max(b), count(b) FROM batch_tab;
+SELECT count(*), count(b) FROM batch_tab WHERE b IS NULL;
+SELECT count(*), sum(a), sum(b) FROM batch_tab
+  WHERE a > 4990 AND b IS NOT NULL;
+SELECT count(*) FROM batch_tab WHERE 100 > a AND c <> 'row 50';
+
+-- Rows returned one at a time, with residual quals and projection
+SELECT a, b, upper(c) FROM batch_tab WHERE a <= 20 AND b % 5 = 0 ORDER BY a;
+
+-- Rescans
+SELECT x, (SELECT count(*) FROM batch_tab WHERE a <= x) AS n
+  FROM (VALUES (10), (2000)) v(x);
+
+-- HAVING is checked on the aggregated row
+SELECT count(*) FROM batch_tab WHERE a < 0 HAVING count(*) > 0;
+
+-- Batches of wide rows don't keep a buffer pinned for every row, which would
+-- run out of local buffers here
+SET temp_buffers = 100;
+CREATE TEMP TABLE batch_wide WITH (fillfactor = 10) AS
+  SELECT g AS a, repeat('x', 900) AS b FROM generate_series(1, 500) g;
+SELECT count(*), sum(length(b)) FROM batch_wide;
+SELECT count(*) FROM batch_wide WHERE a > 250;
+DROP TABLE batch_wide;
+
+-- A cursor is positioned on the row the batch scan returned last, and
+-- doesn't read far ahead of the rows it has fetched
+CREATE FUNCTION batch_seen(int) RETURNS bool LANGUAGE plpgsql VOLATILE AS
+  $$BEGIN RAISE NOTICE 'seen %', $1; RETURN true; END$$;
+BEGIN;
+DECLARE batch_cur NO SCROLL CURSOR FOR
+  SELECT a, b FROM batch_tab WHERE a > 0 AND batch_seen(a);
+FETCH batch_cur;
+UPDATE batch_tab SET c = 'updated' WHERE CURRENT OF batch_cur;
+FETCH 2 FROM batch_cur;
+UPDATE batch_tab SET c = 'updated' WHERE CURRENT OF batch_cur;
+SELECT a, c FROM batch_tab WHERE c = 'updated' ORDER BY a;
+ROLLBACK;
+DROP FUNCTION batch_seen(int);
+
+-- Same results in the ordinary mode
+SET enable_batch_execution = off;
+SELECT count(*), sum(a), min(b), max(b), count(b) FROM batch_tab;
+
+RESET enable_batch_execution;
+DROP TABLE batch_tab;
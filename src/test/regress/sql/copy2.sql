@@ -66,6 +66,10 @@ COPY x from stdin (force_not_null (a), force_not_null (b));
 COPY x from stdin (force_null (a), force_null (b));
 COPY x from stdin (convert_selectively (a), convert_selectively (b));
 COPY x from stdin (encoding 'sql_ascii', encoding 'sql_ascii');
+COPY x from stdin (parallel 2, parallel 2);
+COPY x from stdin (parallel -1);
+COPY x from stdin (format binary, parallel 2);
+COPY x to stdout (parallel 2);
 
 -- too many columns in column list: should fail
 COPY x (a, b, c, d, e, d, c) from stdin;
@@ -454,6 +458,19 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- parallel COPY FROM, with embedded newlines in CSV quoted fields
+CREATE TABLE parallel_copy_tbl (a int PRIMARY KEY, b text, c int DEFAULT 42);
+COPY parallel_copy_tbl (a, b) FROM stdin WITH (FORMAT csv, HEADER, PARALLEL 2);
+a,b
+1,one
+2,"two
+lines"
+3,"three, with ""quotes"""
+4,
+\.
+SELECT a, replace(b, E'\n', '\n') AS b, c FROM parallel_copy_tbl ORDER BY a;
+DROP TABLE parallel_copy_tbl;
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
@@ -171,3 +171,34 @@ reset enable_seqscan;
 reset enable_bitmapscan;
 
 drop table t_gin_test_tbl;
+
+-- Test parallel index build, with both pass-by-value and pass-by-reference
+-- keys, empty items and NULL items.
+create table gin_parallel_test_tbl(a int[], t text[]);
+insert into gin_parallel_test_tbl
+  select array[g % 100, g % 7], array[(g % 50)::text]
+  from generate_series(1, 20000) g;
+insert into gin_parallel_test_tbl
+  select '{}', null from generate_series(1, 100);
+
+set max_parallel_maintenance_workers = 2;
+set min_parallel_table_scan_size = 0;
+set maintenance_work_mem = '128MB';
+create index gin_parallel_test_idx on gin_parallel_test_tbl using gin (a, t);
+reset max_parallel_maintenance_workers;
+reset min_parallel_table_scan_size;
+reset maintenance_work_mem;
+
+set enable_seqscan = off;
+
+explain (costs off)
+select count(*) from gin_parallel_test_tbl where a @> array[5];
+select count(*) from gin_parallel_test_tbl where a @> array[5];
+select count(*) from gin_parallel_test_tbl where a @> array[5, 3];
+select count(*) from gin_parallel_test_tbl where a @> '{}'::int[];
+select count(*) from gin_parallel_test_tbl where t @> array['7'];
+select count(*) from gin_parallel_test_tbl where t && array['1', '2'];
+
+reset enable_seqscan;
+
+drop table gin_parallel_test_tbl;
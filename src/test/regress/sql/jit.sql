@@ -0,0 +1,83 @@
+--
+-- Tests for JIT compilation
+--
+
+/* skip test if JIT compilation is not available */
+SET jit = on;
+SELECT NOT pg_jit_available() AS skip_test \gset
+\if :skip_test
+\quit
+\endif
+
+SET max_parallel_workers_per_gather = 0;
+
+CREATE TABLE jit_tab AS SELECT g AS a FROM generate_series(1, 100) g;
+
+-- Return the number of functions JIT compilation created for a query.  Only
+-- that query is compiled, not the one calling the function.
+CREATE FUNCTION explain_jit_functions(query text) RETURNS int
+LANGUAGE plpgsql
+SET jit_above_cost = 0
+SET jit_inline_above_cost = -1
+SET jit_optimize_above_cost = -1
+AS
+$$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN
+        EXECUTE format('EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF) %s',
+                       query)
+    LOOP
+        IF ln ~ '^ *Functions: ' THEN
+            RETURN substring(ln FROM 'Functions: (\d+)')::int;
+        END IF;
+    END LOOP;
+    RETURN 0;
+END;
+$$;
+
+--
+-- jit_defer_threshold
+--
+
+-- By default, the scan's qual is compiled before it is first evaluated
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 0') AS undeferred \gset
+SELECT :undeferred > 0 AS compiled;
+
+-- The qual is evaluated once per row, 100 times.  That's not more than a
+-- threshold of 100, so it is only interpreted, but it is more than 99.
+SET jit_defer_threshold = 100;
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 0') AS functions;
+SET jit_defer_threshold = 99;
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 0') = :undeferred
+  AS compiled;
+RESET jit_defer_threshold;
+
+--
+-- jit_cache_size
+--
+
+SET jit_cache_size = 1;
+SET client_min_messages = debug1;
+
+-- The first execution compiles the qual, the second one finds it in the cache
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 1') > 0 AS compiled;
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 1') > 0 AS compiled;
+
+-- Different code is not found, and evicts the cached code
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 2') > 0 AS compiled;
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 1') > 0 AS compiled;
+
+-- Disabling the cache discards its contents
+SET jit_cache_size = 0;
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 1') > 0 AS compiled;
+SET jit_cache_size = 1;
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 1') > 0 AS compiled;
+SELECT explain_jit_functions('SELECT * FROM jit_tab WHERE a > 1') > 0 AS compiled;
+
+RESET client_min_messages;
+RESET jit_cache_size;
+
+DROP FUNCTION explain_jit_functions(text);
+DROP TABLE jit_tab;
@@ -556,3 +556,86 @@ WHERE
     AND hjtest_1.a <> hjtest_2.b;
 
 ROLLBACK;
+
+-- Runtime filters pushed down from a hash join into its outer scan
+begin;
+set local enable_hashjoin_runtime_filter = on;
+set local enable_mergejoin = off;
+set local enable_nestloop = off;
+set local max_parallel_workers_per_gather = 0;
+
+create function runtime_filter_rows(query text)
+returns setof text language plpgsql
+as
+$$
+declare
+  ln text;
+begin
+  for ln in
+    execute 'explain (analyze, costs off, summary off, timing off) ' || query
+  loop
+    if ln ~ 'Runtime Filter' then
+      return next trim(ln);
+    end if;
+  end loop;
+end;
+$$;
+
+create table rtf_fact as
+  select g as id, g % 1000 as dim_id from generate_series(1, 10000) g;
+create table rtf_dim as
+  select g as id, 'dim ' || g as name from generate_series(1, 1000) g;
+analyze rtf_fact, rtf_dim;
+
+select count(*) from rtf_fact f join rtf_dim d on f.dim_id = d.id
+  where d.id % 100 = 0;
+select * from runtime_filter_rows('
+select count(*) from rtf_fact f join rtf_dim d on f.dim_id = d.id
+  where d.id % 100 = 0');
+select count(*) from rtf_fact f
+  where exists (select 1 from rtf_dim d where d.id = f.dim_id and d.id % 100 = 0);
+select count(d.name) from rtf_fact f
+  left join (select * from rtf_dim where id % 100 = 0) d on f.dim_id = d.id;
+
+-- hashint4() isn't leakproof, so the filter only sees rows that passed the
+-- scan's own quals
+select count(*) from rtf_fact f join rtf_dim d on f.dim_id = d.id
+  where d.id % 100 = 0 and f.id <= 5000;
+select * from runtime_filter_rows('
+select count(*) from rtf_fact f join rtf_dim d on f.dim_id = d.id
+  where d.id % 100 = 0 and f.id <= 5000');
+
+rollback;
+
+-- Compact hash tables, probed with prefetching, must give the same results,
+-- in one batch and in several
+begin;
+set local enable_hashjoin_prefetch = on;
+set local enable_mergejoin = off;
+set local enable_nestloop = off;
+set local max_parallel_workers_per_gather = 0;
+
+create table hjp_outer as
+  select g as id, g % 3000 as k from generate_series(1, 20000) g;
+create table hjp_inner as
+  select g as k, g % 7 as v from generate_series(1, 5000) g;
+analyze hjp_outer, hjp_inner;
+
+select count(*), sum(i.v) from hjp_outer o join hjp_inner i on o.k = i.k;
+select count(*) filter (where o.id is null) as inner_only,
+       count(*) filter (where i.k is null) as outer_only
+  from hjp_outer o full join hjp_inner i on o.k = i.k;
+-- the read-ahead slots feed join quals and projections that expect the
+-- outer scan's slot type, also when they are JIT-compiled
+set local jit_above_cost = 0;
+select count(*), sum(o.id), sum(i.v)
+  from hjp_outer o join hjp_inner i on o.k = i.k and o.id % 2 = 0;
+reset jit_above_cost;
+
+set local work_mem = '64kB';
+select count(*), sum(i.v) from hjp_outer o join hjp_inner i on o.k = i.k;
+select count(*) filter (where o.id is null) as inner_only,
+       count(*) filter (where i.k is null) as outer_only
+  from hjp_outer o full join hjp_inner i on o.k = i.k;
+
+rollback;
@@ -171,6 +171,40 @@ ROLLBACK;
 RESET ROLE;
 REVOKE UPDATE ON TABLE lock_view8 FROM regress_rol_lock1;
 
+--
+-- Verify that a transaction can hold more weak relation locks in fast-path
+-- slots than fit into one group of them (16), and that the locks that find
+-- no free slot are recorded in the shared lock table instead.
+--
+DO $$
+BEGIN
+  FOR i IN 1..100 LOOP
+    EXECUTE format('CREATE TABLE lock_fp_tbl%s (a int)', i);
+  END LOOP;
+END;
+$$;
+BEGIN;
+DO $$
+BEGIN
+  FOR i IN 1..100 LOOP
+    EXECUTE format('LOCK TABLE lock_fp_tbl%s IN ACCESS SHARE MODE', i);
+  END LOOP;
+END;
+$$;
+SELECT count(*) AS locks,
+       count(*) FILTER (WHERE l.fastpath) > 16 AS fastpath_beyond_group
+  FROM pg_locks l JOIN pg_class c ON c.oid = l.relation
+  WHERE l.pid = pg_backend_pid() AND l.mode = 'AccessShareLock'
+    AND c.relname LIKE 'lock\_fp\_tbl%';
+COMMIT;
+DO $$
+BEGIN
+  FOR i IN 1..100 LOOP
+    EXECUTE format('DROP TABLE lock_fp_tbl%s', i);
+  END LOOP;
+END;
+$$;
+
 --
 -- Clean up
 --
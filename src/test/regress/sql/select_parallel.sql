@@ -92,6 +92,16 @@ select length(stringu1) from tenk1 group by length(stringu1);
 explain (costs off)
 	select stringu1, count(*) from tenk1 group by stringu1 order by stringu1;
 
+-- test parallel finalize of hashed aggregation
+set enable_parallel_hashagg = on;
+set parallel_tuple_cost = 0.1;
+explain (costs off)
+	select twothousand, count(*) from tenk1 group by twothousand;
+select count(*), sum(c), min(c), max(c)
+  from (select twothousand, count(*) as c from tenk1 group by twothousand) ss;
+reset parallel_tuple_cost;
+reset enable_parallel_hashagg;
+
 -- test that parallel plan for aggregates is not selected when
 -- target list contains parallel restricted clause.
 explain (costs off)
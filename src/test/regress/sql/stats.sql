@@ -301,6 +301,7 @@ SELECT checkpoints_req AS rqst_ckpts_before FROM pg_stat_bgwriter \gset
 
 -- Test pg_stat_wal
 SELECT wal_bytes AS wal_bytes_before FROM pg_stat_wal \gset
+SELECT wal_group_flush AS wal_group_flush_before FROM pg_stat_wal \gset
 
 CREATE TABLE test_stats_temp AS SELECT 17;
 DROP TABLE test_stats_temp;
@@ -313,6 +314,9 @@ CHECKPOINT;
 
 SELECT checkpoints_req > :rqst_ckpts_before FROM pg_stat_bgwriter;
 SELECT wal_bytes > :wal_bytes_before FROM pg_stat_wal;
+-- Commit and checkpoint records are flushed by group flushes
+SELECT wal_group_flush > :wal_group_flush_before,
+       wal_group_members >= wal_group_flush FROM pg_stat_wal;
 
 
 -----
@@ -349,11 +353,18 @@ SELECT pg_stat_reset_shared('wal');
 SELECT stats_reset > :'wal_reset_ts'::timestamptz FROM pg_stat_wal;
 SELECT stats_reset AS wal_reset_ts FROM pg_stat_wal \gset
 
+-- Test that reset_shared with io specified as the stats type works
+SELECT max(stats_reset) AS io_reset_ts FROM pg_stat_io \gset
+SELECT pg_stat_reset_shared('io');
+SELECT max(stats_reset) > :'io_reset_ts'::timestamptz FROM pg_stat_io;
+SELECT max(stats_reset) AS io_reset_ts FROM pg_stat_io \gset
+
 -- Test that reset_shared with no specified stats type doesn't reset anything
 SELECT pg_stat_reset_shared(NULL);
 SELECT stats_reset = :'archiver_reset_ts'::timestamptz FROM pg_stat_archiver;
 SELECT stats_reset = :'bgwriter_reset_ts'::timestamptz FROM pg_stat_bgwriter;
 SELECT stats_reset = :'wal_reset_ts'::timestamptz FROM pg_stat_wal;
+SELECT max(stats_reset) = :'io_reset_ts'::timestamptz FROM pg_stat_io;
 
 -- Test that reset works for pg_stat_database
 
@@ -391,6 +402,36 @@ SELECT pg_stat_have_stats('database', (SELECT oid FROM pg_database WHERE datname
 SELECT pg_stat_have_stats('database', (SELECT oid FROM pg_database WHERE datname = current_database()), 0);
 
 
+----
+-- pg_stat_io
+----
+-- Extending a shared relation is counted as extends in the normal context,
+-- and reading it back without a strategy as hits or reads
+SELECT sum(extends) AS io_sum_shared_before_extends
+  FROM pg_stat_io WHERE context = 'normal' AND object = 'relation' \gset
+CREATE TABLE test_io_shared(a int);
+INSERT INTO test_io_shared SELECT i FROM generate_series(1, 100) i;
+SELECT count(*) FROM test_io_shared;
+SELECT pg_stat_force_next_flush();
+SELECT sum(extends) AS io_sum_shared_after_extends
+  FROM pg_stat_io WHERE context = 'normal' AND object = 'relation' \gset
+SELECT :io_sum_shared_after_extends > :io_sum_shared_before_extends;
+-- Extending a temporary relation is counted in the temp relation rows
+SELECT sum(extends) AS io_sum_local_before_extends
+  FROM pg_stat_io WHERE context = 'normal' AND object = 'temp relation' \gset
+CREATE TEMPORARY TABLE test_io_local(a int, b TEXT);
+INSERT INTO test_io_local SELECT generate_series(1, 100), repeat('a', 200);
+SELECT pg_stat_force_next_flush();
+SELECT sum(extends) AS io_sum_local_after_extends
+  FROM pg_stat_io WHERE context = 'normal' AND object = 'temp relation' \gset
+SELECT :io_sum_local_after_extends > :io_sum_local_before_extends;
+-- Operations a backend type never performs are NULL rather than zero
+SELECT reads IS NULL AND hits IS NULL AND extends IS NULL
+  FROM pg_stat_io WHERE backend_type = 'checkpointer' AND context = 'normal';
+DROP TABLE test_io_shared;
+DROP TABLE test_io_local;
+
+
 -- ensure that stats accessors handle NULL input correctly
 SELECT pg_stat_get_replication_slot(NULL);
 SELECT pg_stat_get_subscription_stats(NULL);
@@ -0,0 +1,239 @@
+
+# Copyright (c) 2022, PostgreSQL Global Development Group
+
+# Test applying large streamed transactions with parallel apply workers
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+# Create publisher node
+my $node_publisher = PostgreSQL::Test::Cluster->new('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->append_conf('postgresql.conf',
+	'logical_decoding_work_mem = 64kB');
+$node_publisher->start;
+
+# Create subscriber node.  We look for DEBUG1 messages to find out how each
+# streamed transaction was applied.
+my $node_subscriber = PostgreSQL::Test::Cluster->new('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->append_conf(
+	'postgresql.conf', qq(
+max_parallel_apply_workers_per_subscription = 2
+log_min_messages = debug1
+));
+$node_subscriber->start;
+
+# Create some preexisting content on publisher
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE test_tab (a int primary key, b text)");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_tab VALUES (1, 'foo'), (2, 'bar')");
+
+# Setup structure on subscriber
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE test_tab (a int primary key, b text)");
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE test_tab");
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub WITH (streaming = parallel)"
+);
+
+# Wait for initial table sync to finish
+$node_subscriber->wait_for_subscription_sync($node_publisher, $appname);
+
+my $result =
+  $node_subscriber->safe_psql('postgres', "SELECT count(*) FROM test_tab");
+is($result, qq(2), 'check initial data was copied to subscriber');
+
+# Number of transactions the parallel apply workers are in the middle of
+my $applying_query =
+  "SELECT count(*) FROM pg_locks WHERE locktype = 'applytransaction' AND objsubid = 1";
+
+# Insert, update and delete enough rows to exceed the 64kB limit.  The
+# transaction is handed to a parallel apply worker.
+my $offset = -s $node_subscriber->logfile;
+
+$node_publisher->safe_psql(
+	'postgres', q{
+BEGIN;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(3, 5000) s(i);
+UPDATE test_tab SET b = md5(b) WHERE mod(a,2) = 0;
+DELETE FROM test_tab WHERE mod(a,3) = 0;
+COMMIT;
+});
+
+$node_subscriber->wait_for_log(
+	qr/LOG: ( [A-Z0-9]+:)? logical replication parallel apply worker for subscription "tap_sub" has started/,
+	$offset);
+
+$node_publisher->wait_for_catchup($appname);
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), count(*) FILTER (WHERE b = md5(md5(a::text))) FROM test_tab"
+);
+is($result, qq(3334|1666),
+	'check streamed transaction was applied by a parallel apply worker');
+
+# Large transaction with rollbacks of subtransactions whose changes were
+# already streamed.  The parallel apply worker has to roll back to the
+# savepoints it defined for them.
+$offset = -s $node_subscriber->logfile;
+
+$node_publisher->safe_psql(
+	'postgres', q{
+BEGIN;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(5001,5500) s(i);
+SAVEPOINT s1;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(5501,6000) s(i);
+SAVEPOINT s2;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(6001,6500) s(i);
+SAVEPOINT s3;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(6501,7000) s(i);
+ROLLBACK TO s2;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(7001,7500) s(i);
+ROLLBACK TO s1;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(7501,8000) s(i);
+COMMIT;
+});
+
+$node_subscriber->wait_for_log(
+	qr/DEBUG: ( [A-Z0-9]+:)? rolling back to savepoint \S+ in logical replication parallel apply worker/,
+	$offset);
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), min(a), max(a) FROM test_tab WHERE a > 5000");
+is($result, qq(1000|5001|8000),
+	'check rollback to savepoint was applied by a parallel apply worker');
+
+# Three overlapping large transactions.  The first two are handed to the
+# two parallel apply workers, which leaves none for the third one.  That one
+# is serialized to a file by the leader, and committed first.
+my $timer = IPC::Run::timeout($PostgreSQL::Test::Utils::timeout_default);
+
+my $in1  = '';
+my $out1 = '';
+my $h1 = $node_publisher->background_psql('postgres', \$in1, \$out1, $timer,
+	on_error_stop => 0);
+
+my $in2  = '';
+my $out2 = '';
+my $h2 = $node_publisher->background_psql('postgres', \$in2, \$out2, $timer,
+	on_error_stop => 0);
+
+$in1 .= q{
+BEGIN;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(10001, 15000) s(i);
+};
+$h1->pump_nb;
+
+$node_subscriber->poll_query_until('postgres', "$applying_query = 1")
+  or die "Timed out while waiting for the first transaction to be applied";
+
+$in2 .= q{
+BEGIN;
+INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(15001, 20000) s(i);
+};
+$h2->pump_nb;
+
+$node_subscriber->poll_query_until('postgres', "$applying_query = 2")
+  or die "Timed out while waiting for the second transaction to be applied";
+
+$offset = -s $node_subscriber->logfile;
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_tab SELECT i, md5(i::text) FROM generate_series(20001, 25000) s(i)"
+);
+
+$node_subscriber->wait_for_log(
+	qr/DEBUG: ( [A-Z0-9]+:)? opening file ".*" for streamed changes/,
+	$offset);
+
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(*) = 5000 FROM test_tab WHERE a > 20000")
+  or die "Timed out while waiting for the serialized transaction to be applied";
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM test_tab WHERE a BETWEEN 10001 AND 20000");
+is($result, qq(0),
+	'check transactions still open on the publisher are not visible');
+
+# Commit the second transaction, then make the first one depend on the rows
+# of the serialized transaction before committing it too.  This only works
+# out if the subscriber commits them in the publisher's order.
+$in2 .= q{
+COMMIT;
+\q
+};
+$h2->finish;
+
+$in1 .= q{
+UPDATE test_tab SET b = 'updated' WHERE a > 20000;
+COMMIT;
+\q
+};
+$h1->finish;
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), count(*) FILTER (WHERE b = 'updated') FROM test_tab WHERE a > 10000"
+);
+is($result, qq(15000|5000),
+	'check overlapping streamed transactions were applied in commit order');
+
+# Block the parallel apply worker on a lock and stream more than fits into
+# its queue.  The leader gives up waiting for queue space and serializes the
+# rest of the transaction to a file, which the parallel apply worker replays
+# once it can go on.
+my $in3  = '';
+my $out3 = '';
+my $h3 = $node_subscriber->background_psql('postgres', \$in3, \$out3, $timer,
+	on_error_stop => 0);
+
+$in3 .= q{
+BEGIN;
+LOCK test_tab IN SHARE MODE;
+SELECT 'locked';
+};
+pump_until($h3, $timer, \$out3, qr/locked/)
+  or die "Timed out while waiting for the table lock";
+
+$offset = -s $node_subscriber->logfile;
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_tab SELECT i, repeat(md5(i::text), 32) FROM generate_series(30001, 50000) s(i)"
+);
+
+$node_subscriber->wait_for_log(
+	qr/LOG: ( [A-Z0-9]+:)? logical replication apply worker will serialize the remaining changes of remote transaction \d+ to a file/,
+	$offset);
+
+$in3 .= q{
+COMMIT;
+\q
+};
+$h3->finish;
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), count(*) FILTER (WHERE b = repeat(md5(a::text), 32)) FROM test_tab WHERE a > 30000"
+);
+is($result, qq(20000|20000),
+	'check transaction partially serialized to a file was applied');
+
+$node_subscriber->stop;
+$node_publisher->stop;
+
+done_testing();